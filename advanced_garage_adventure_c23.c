@@ -10,231 +10,139 @@
  * - Physics-based calculations for vehicle performance
  * - Advanced data structures and memory management
  *
- * Compile: gcc -std=c23 -Wall -Wextra -O2 -lm advanced_garage_adventure_c23.c -o garage_adventure
+ * Compile: gcc -std=c23 -Wall -Wextra -O2 advanced_garage_adventure_c23.c garage_*.c \
+ *          -o garage_adventure -pthread -lm      (or: make garage_adventure)
  * Run: ./garage_adventure
+ *      ./garage_adventure --bench path [max_side]
+ *      ./garage_adventure --world hpa <file> [queries] [cluster size]
+ *      ./garage_adventure --bench fleet [vehicles]
+ *      ./garage_adventure --bench sim [vehicles]
+ *      ./garage_adventure --bench optimize [max parts]
+ *      ./garage_adventure --bench parse [commands]
+ *      ./garage_adventure --record <file>
+ *      ./garage_adventure --replay <script> [rounds] [expected hash]
  */
 
+#define _GNU_SOURCE  // fopencookie
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <math.h>
 #include <ctype.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "garage_game.h"
+#include "garage_path.h"
+#include "garage_world.h"
+#include "garage_hpa.h"
+#include "garage_fleet.h"
+#include "garage_sim.h"
+#include "garage_optimize.h"
+#include "garage_bench.h"
 
 // ============================================================================
 // CONSTANTS AND CONFIGURATION
 // ============================================================================
 
-constexpr int MAX_ROOMS = 20;
-constexpr int MAX_INPUT = 256;
-constexpr int MAX_NAME = 64;
-constexpr int MAX_DESCRIPTION = 512;
-constexpr int MAX_VEHICLES = 10;
-constexpr int MAX_PARTS = 50;
 constexpr int MAX_PATH_LENGTH = 100;
+constexpr uint32_t VERB_HASH_SEED = 0x811E09F7;  // No two VERB_TABLE words share a slot
+constexpr int VERB_HASH_BITS = 6;
+constexpr int VERB_SLOTS = 64;                   // 1 << VERB_HASH_BITS
+constexpr double ROOM_CLUSTER_SIZE = 15.0;  // HPA* cluster side, in room coordinates
 
 constexpr double GRAVITY = 9.81;  // m/s²
 constexpr double PI = 3.14159265358979323846;
 constexpr double AIR_DENSITY = 1.225;  // kg/m³ at sea level
-
-// Pathfinding constants
-constexpr int INFINITY_COST = 999999;
-constexpr double HEURISTIC_WEIGHT = 1.0;
-
-// ============================================================================
-// TYPE DEFINITIONS
-// ============================================================================
-
-typedef enum {
-    ROOM_GARAGE_ENTRANCE,
-    ROOM_MAIN_GARAGE,
-    ROOM_WORKSHOP,
-    ROOM_PARTS_STORAGE,
-    ROOM_PAINT_BOOTH,
-    ROOM_TESTING_TRACK,
-    ROOM_OFFICE,
-    ROOM_TOOL_ROOM,
-    ROOM_COMPUTER_LAB,
-    ROOM_SHOWROOM,
-    ROOM_COUNT
-} RoomID;
-
-typedef enum {
-    DIR_NORTH,
-    DIR_SOUTH,
-    DIR_EAST,
-    DIR_WEST,
-    DIR_COUNT
-} Direction;
-
-typedef enum {
-    VEHICLE_NONE,
-    VEHICLE_SPORTS_CAR,
-    VEHICLE_TRUCK,
-    VEHICLE_MOTORCYCLE,
-    VEHICLE_RACE_CAR,
-    VEHICLE_CLASSIC_CAR
-} VehicleType;
-
-typedef enum {
-    PART_ENGINE,
-    PART_TRANSMISSION,
-    PART_WHEELS,
-    PART_BRAKES,
-    PART_SUSPENSION,
-    PART_TURBOCHARGER,
-    PART_EXHAUST,
-    PART_ECU
-} PartType;
-
-typedef enum {
-    VERB_UNKNOWN,
-    VERB_GO,
-    VERB_LOOK,
-    VERB_EXAMINE,
-    VERB_INVENTORY,
-    VERB_TAKE,
-    VERB_DROP,
-    VERB_USE,
-    VERB_INSTALL,
-    VERB_CALCULATE,
-    VERB_PATH,
-    VERB_NAVIGATE,
-    VERB_TUNE,
-    VERB_HELP,
-    VERB_QUIT
-} Verb;
+constexpr double FAILED_LAUNCH = 1e3;       // s; metric for a car that never reaches the test speed
 
 // ============================================================================
 // DATA STRUCTURES
 // ============================================================================
 
+// Every verb, alias and direction word, stored at the slot verb_hash()
+// gives it, so lookups are one hash and one strcmp. VERB_HASH_SEED is one
+// under which no two words share a slot. main() checks every entry first
+// and refuses to start if one is misplaced, printing the slot it hashes to;
+// a duplicate slot is flagged at compile time by -Woverride-init (-Wextra).
+// If a new word's slot is taken, the seed has to change.
 typedef struct {
-    double x;
-    double y;
-} Point2D;
-
-typedef struct {
-    char name[MAX_NAME];
-    PartType type;
-    double weight;      // kg
-    double cost;        // dollars
-    int performance_boost;  // percentage
-    bool installed;
-} Part;
-
-typedef struct {
-    char name[MAX_NAME];
-    VehicleType type;
-    double mass;           // kg
-    double engine_power;   // horsepower
-    double drag_coefficient;  // Cd
-    double frontal_area;   // m²
-    double max_speed;      // m/s
-    double acceleration;   // m/s²
-    int parts_count;
-    Part parts[MAX_PARTS];
-} Vehicle;
-
-typedef struct {
-    Vehicle vehicles[MAX_VEHICLES];
-    int vehicle_count;
-    Part loose_parts[MAX_PARTS];
-    int loose_parts_count;
-    int money;
-} GarageInventory;
-
-typedef struct {
-    RoomID id;
-    char name[MAX_NAME];
-    char description[MAX_DESCRIPTION];
-    RoomID connections[DIR_COUNT];
-    Point2D coordinates;  // For pathfinding
-    bool has_vehicle_access;
-    bool has_computer;
-} Room;
-
-typedef struct {
+    const char *word;
     Verb verb;
-    char object[MAX_INPUT];
-    char target[MAX_INPUT];
-    Direction direction;
-} Command;
-
-typedef struct {
-    int parent[MAX_ROOMS];
-    double cost[MAX_ROOMS];
-    bool visited[MAX_ROOMS];
-} PathfindingState;
-
+    Direction direction;    // DIR_COUNT unless the word is a direction
+} VerbEntry;
+
+static const VerbEntry VERB_TABLE[VERB_SLOTS] = {
+    [0]  = { "west",      VERB_GO,        DIR_WEST },
+    [1]  = { "lock",      VERB_LOCK,      DIR_COUNT },
+    [2]  = { "?",         VERB_HELP,      DIR_COUNT },
+    [4]  = { "north",     VERB_GO,        DIR_NORTH },
+    [5]  = { "opt",       VERB_OPTIMIZE,  DIR_COUNT },
+    [10] = { "optimize",  VERB_OPTIMIZE,  DIR_COUNT },
+    [11] = { "look",      VERB_LOOK,      DIR_COUNT },
+    [12] = { "exit",      VERB_QUIT,      DIR_COUNT },
+    [13] = { "install",   VERB_INSTALL,   DIR_COUNT },
+    [15] = { "calc",      VERB_CALCULATE, DIR_COUNT },
+    [19] = { "examine",   VERB_EXAMINE,   DIR_COUNT },
+    [29] = { "unlock",    VERB_UNLOCK,    DIR_COUNT },
+    [30] = { "south",     VERB_GO,        DIR_SOUTH },
+    [32] = { "path",      VERB_PATH,      DIR_COUNT },
+    [33] = { "nav",       VERB_NAVIGATE,  DIR_COUNT },
+    [35] = { "take",      VERB_TAKE,      DIR_COUNT },
+    [36] = { "navigate",  VERB_NAVIGATE,  DIR_COUNT },
+    [45] = { "get",       VERB_TAKE,      DIR_COUNT },
+    [47] = { "move",      VERB_GO,        DIR_COUNT },
+    [48] = { "w",         VERB_GO,        DIR_WEST },
+    [49] = { "s",         VERB_GO,        DIR_SOUTH },
+    [50] = { "q",         VERB_QUIT,      DIR_COUNT },
+    [52] = { "x",         VERB_EXAMINE,   DIR_COUNT },
+    [53] = { "e",         VERB_GO,        DIR_EAST },
+    [54] = { "n",         VERB_GO,        DIR_NORTH },
+    [55] = { "l",         VERB_LOOK,      DIR_COUNT },
+    [56] = { "i",         VERB_INVENTORY, DIR_COUNT },
+    [57] = { "quit",      VERB_QUIT,      DIR_COUNT },
+    [58] = { "go",        VERB_GO,        DIR_COUNT },
+    [59] = { "help",      VERB_HELP,      DIR_COUNT },
+    [60] = { "inventory", VERB_INVENTORY, DIR_COUNT },
+    [61] = { "calculate", VERB_CALCULATE, DIR_COUNT },
+    [62] = { "east",      VERB_GO,        DIR_EAST },
+};
+
+const VerbEntry* lookup_word(const char *word, uint32_t hash);
+bool verb_table_valid(void);
 // ============================================================================
-// GLOBAL GAME STATE
+// MAIN FUNCTION
 // ============================================================================
 
-typedef struct {
-    Room rooms[MAX_ROOMS];
-    RoomID current_room;
-    GarageInventory garage;
-    Vehicle *current_vehicle;
-    bool running;
-    int moves_count;
-} GameState;
+int main(int argc, char *argv[]) {
+    if (!verb_table_valid()) return 1;
 
-// ============================================================================
-// FUNCTION PROTOTYPES
-// ============================================================================
+    if (argc > 1 && strcmp(argv[1], "--world") == 0) {
+        return world_command(argc - 2, argv + 2);
+    }
 
-// Initialization
-void init_game(GameState *game);
-void init_rooms(Room rooms[]);
-void init_garage(GarageInventory *garage);
-
-// Game loop
-void game_loop(GameState *game);
-bool parse_command(const char *input, Command *cmd);
-void execute_command(GameState *game, const Command *cmd);
-
-// Commands
-void cmd_go(GameState *game, Direction dir);
-void cmd_look(GameState *game);
-void cmd_examine(GameState *game, const char *object);
-void cmd_inventory(GameState *game);
-void cmd_take(GameState *game, const char *object);
-void cmd_install(GameState *game, const char *part_name);
-void cmd_calculate(GameState *game, const char *calc_type);
-void cmd_navigate(GameState *game, const char *destination);
-void cmd_help(void);
-
-// Physics calculations
-double calculate_terminal_velocity(const Vehicle *v);
-double calculate_acceleration_time(const Vehicle *v, double target_speed);
-double calculate_braking_distance(const Vehicle *v, double initial_speed);
-double calculate_drag_force(const Vehicle *v, double velocity);
-double calculate_power_required(const Vehicle *v, double velocity);
-double calculate_lap_time(const Vehicle *v, double track_length, int turns);
-
-// Pathfinding algorithms
-void dijkstra_shortest_path(const Room rooms[], RoomID start, RoomID end,
-                           PathfindingState *state);
-double heuristic_distance(Point2D a, Point2D b);
-bool astar_pathfinding(const Room rooms[], RoomID start, RoomID end,
-                      RoomID path[], int path_length);
-void print_path(const Room rooms[], const RoomID path[], int path_length);
-
-// Utilities
-const char* direction_to_string(Direction dir);
-Direction string_to_direction(const char *str);
-const char* vehicle_type_to_string(VehicleType type);
-const char* part_type_to_string(PartType type);
-void to_lowercase(char *str);
-void print_separator(void);
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+        int rounds = argc > 3 ? atoi(argv[3]) : 1;
+        return replay_script(argv[2], rounds > 0 ? rounds : 1, argc > 4 ? argv[4] : nullptr);
+    }
 
-// ============================================================================
-// MAIN FUNCTION
-// ============================================================================
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0) {
+        int size = argc > 3 ? atoi(argv[3]) : 0;
+        if (strcmp(argv[2], "path") == 0) return bench_pathfinding(size > 0 ? size : 1000);
+        if (strcmp(argv[2], "routes") == 0) return bench_routes(size > 0 ? size : 32);
+        if (strcmp(argv[2], "batch") == 0) return bench_batch(size > 0 ? size : 512);
+        if (strcmp(argv[2], "fleet") == 0) return bench_fleet(size > 0 ? size : 10000);
+        if (strcmp(argv[2], "sim") == 0) return bench_sim(size > 0 ? size : 256);
+        if (strcmp(argv[2], "optimize") == 0) return bench_optimize(size > 0 ? size : 16);
+        if (strcmp(argv[2], "parse") == 0) return bench_parse(size > 0 ? size : 1000000);
+        fprintf(stderr, "Unknown benchmark: %s (try: path, routes, batch, fleet, sim, optimize, parse)\n",
+                argv[2]);
+        return 1;
+    }
 
-int main(void) {
     GameState game = {};  // C23: zero initialization
 
     printf("\n");
@@ -245,12 +153,76 @@ int main(void) {
     printf("\n");
 
     init_game(&game);
+    if (argc > 2 && strcmp(argv[1], "--record") == 0) {
+        game.record = fopen(argv[2], "w");
+        if (game.record == nullptr) {
+            fprintf(stderr, "Cannot write %s\n", argv[2]);
+            free_game(&game);
+            return 1;
+        }
+    }
     game_loop(&game);
 
     printf("\nThanks for playing! Total moves: %d\n", game.moves_count);
+
+    if (game.record != nullptr) fclose(game.record);
+    free_game(&game);
     return 0;
 }
 
+void free_game(GameState *game) {
+    hpa_free(&game->room_hpa);
+    path_routes_free(&game->room_routes);
+    path_search_free(&game->room_search);
+    path_graph_free(&game->room_graph);
+}
+
+// --world generate <grid|geometric|maze> <nodes> <file> [seed]
+// --world bench <file> [queries]
+// --world hpa <file> [queries] [cluster size]
+int world_command(int argc, char *argv[]) {
+    if (argc >= 4 && strcmp(argv[0], "generate") == 0) {
+        WorldKind kind = string_to_world_kind(argv[1]);
+        int nodes = atoi(argv[2]);
+        unsigned seed = argc > 4 ? (unsigned)strtoul(argv[4], nullptr, 10) : 1u;
+
+        if (kind >= WORLD_KIND_COUNT || nodes <= 0) {
+            fprintf(stderr, "Usage: --world generate <grid|geometric|maze> <nodes> <file> [seed]\n");
+            return 1;
+        }
+
+        PathGraph graph;
+        if (!world_generate(&graph, kind, nodes, seed)) {
+            fprintf(stderr, "Out of memory generating the world\n");
+            return 1;
+        }
+
+        bool ok = world_save(&graph, kind, argv[3]);
+        if (ok) {
+            printf("Generated %s world: %d nodes, %d edges -> %s\n",
+                   world_kind_to_string(kind), graph.node_count, graph.edge_count, argv[3]);
+        }
+        path_graph_free(&graph);
+        return ok ? 0 : 1;
+    }
+
+    if (argc >= 2 && strcmp(argv[0], "bench") == 0) {
+        int queries = argc > 2 ? atoi(argv[2]) : 100;
+        return bench_world(argv[1], queries > 0 ? queries : 100);
+    }
+
+    if (argc >= 2 && strcmp(argv[0], "hpa") == 0) {
+        int queries = argc > 2 ? atoi(argv[2]) : 100;
+        double cluster_size = argc > 3 ? atof(argv[3]) : 16.0;
+        return bench_hpa(argv[1], queries > 0 ? queries : 100, cluster_size > 0 ? cluster_size : 16.0);
+    }
+
+    fprintf(stderr, "Usage: --world generate <grid|geometric|maze> <nodes> <file> [seed]\n");
+    fprintf(stderr, "       --world bench <file> [queries]\n");
+    fprintf(stderr, "       --world hpa <file> [queries] [cluster size]\n");
+    return 1;
+}
+
 // ============================================================================
 // INITIALIZATION FUNCTIONS
 // ============================================================================
@@ -260,10 +232,19 @@ void init_game(GameState *game) {
     game->current_vehicle = nullptr;
     game->running = true;
     game->moves_count = 0;
+    game->input = stdin;
 
     init_rooms(game->rooms);
     init_garage(&game->garage);
 
+    if (!build_room_graph(game, &game->room_graph) ||
+        !path_search_init(&game->room_search, game->room_graph.node_count) ||
+        !path_routes_build(&game->room_routes, &game->room_graph, &game->room_search) ||
+        !hpa_build(&game->room_hpa, &game->room_graph, &game->room_search, ROOM_CLUSTER_SIZE)) {
+        fprintf(stderr, "Out of memory building the room graph\n");
+        exit(1);
+    }
+
     printf("Welcome to Advanced Garage Adventure!\n");
     printf("Type 'help' for available commands.\n\n");
 
@@ -541,37 +522,112 @@ void game_loop(GameState *game) {
 
     while (game->running) {
         printf("\n> ");
-        if (fgets(input, sizeof(input), stdin) == nullptr) {
+        if (!read_line(game, input, sizeof(input))) {
             break;
         }
 
-        // Remove newline
-        input[strcspn(input, "\n")] = '\0';
-
         if (strlen(input) == 0) {
             continue;
         }
 
-        if (parse_command(input, &cmd)) {
+        struct timespec start;
+        if (game->times != nullptr) timespec_get(&start, TIME_UTC);
+
+        bool understood = parse_command(input, &cmd);
+        if (understood) {
             execute_command(game, &cmd);
             game->moves_count++;
         } else {
             printf("I don't understand that command. Type 'help' for assistance.\n");
         }
+
+        if (game->times != nullptr) {
+            struct timespec end;
+            timespec_get(&end, TIME_UTC);
+            Verb verb = understood ? cmd.verb : VERB_UNKNOWN;
+            game->times->count[verb]++;
+            game->times->seconds[verb] += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        }
     }
 }
 
+// One line of input without its newline, copied to game->record. Lines
+// starting with '#' are comments (for replay scripts) and are skipped.
+bool read_line(GameState *game, char buffer[], int size) {
+    do {
+        if (fgets(buffer, size, game->input) == nullptr) {
+            return false;
+        }
+    } while (buffer[0] == '#');
+
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    if (game->record != nullptr) {
+        fprintf(game->record, "%s\n", buffer);
+        fflush(game->record);
+    }
+    return true;
+}
+
 // ============================================================================
 // COMMAND PARSING
 // ============================================================================
 
-bool parse_command(const char *input, Command *cmd) {
-    char buffer[MAX_INPUT];
-    strncpy(buffer, input, MAX_INPUT - 1);
-    buffer[MAX_INPUT - 1] = '\0';
+static inline uint32_t verb_hash_step(uint32_t hash, unsigned char c) {
+    return (hash ^ c) * 16777619u;  // FNV-1a
+}
 
-    to_lowercase(buffer);
+// Copy the next space- or tab-separated word at *cursor into token[]
+// (MAX_INPUT bytes), lowercased, and hash it for lookup_word(). Leaves
+// *cursor after the word; returns its length, 0 at the end of the input.
+// Unlike strtok it keeps no state and never writes to the input.
+static size_t next_token(const char **cursor, char token[], uint32_t *hash) {
+    const char *c = *cursor;
+    while (*c == ' ' || *c == '\t') c++;
+
+    size_t length = 0;
+    uint32_t h = VERB_HASH_SEED;
+    for (; *c != '\0' && *c != ' ' && *c != '\t'; c++) {
+        char lower = (char)tolower((unsigned char)*c);
+        h = verb_hash_step(h, (unsigned char)lower);
+        if (length < (size_t)MAX_INPUT - 1) token[length] = lower;
+        length++;
+    }
+
+    token[length < (size_t)MAX_INPUT - 1 ? length : (size_t)MAX_INPUT - 1] = '\0';
+    *cursor = c;
+    *hash = h;
+    return length;
+}
+
+// The VERB_TABLE entry for a lowercase word hashed by next_token()
+const VerbEntry* lookup_word(const char *word, uint32_t hash) {
+    const VerbEntry *entry = &VERB_TABLE[hash >> (32 - VERB_HASH_BITS)];
+    if (entry->word == nullptr || strcmp(entry->word, word) != 0) return nullptr;
+    return entry;
+}
+
+// Every VERB_TABLE word must be found by parsing it: stored lowercase, at
+// the slot its hash selects. Reports each one that is not.
+bool verb_table_valid(void) {
+    bool valid = true;
+    for (int slot = 0; slot < VERB_SLOTS; slot++) {
+        const char *word = VERB_TABLE[slot].word;
+        if (word == nullptr) continue;
+
+        const char *cursor = word;
+        char token[MAX_INPUT];
+        uint32_t hash;
+        next_token(&cursor, token, &hash);
+        if (lookup_word(token, hash) != &VERB_TABLE[slot]) {
+            fprintf(stderr, "VERB_TABLE: '%s' is in slot %d but parses to slot %u\n",
+                    word, slot, hash >> (32 - VERB_HASH_BITS));
+            valid = false;
+        }
+    }
+    return valid;
+}
 
+bool parse_command(const char *input, Command *cmd) {
     // Initialize command
     *cmd = (Command){
         .verb = VERB_UNKNOWN,
@@ -580,69 +636,34 @@ bool parse_command(const char *input, Command *cmd) {
         .direction = DIR_COUNT
     };
 
-    char *token = strtok(buffer, " \t");
-    if (token == nullptr) {
+    const char *cursor = input;
+    char token[MAX_INPUT];
+    uint32_t hash;
+    if (next_token(&cursor, token, &hash) == 0) {
         return false;
     }
 
-    // Parse verb
-    if (strcmp(token, "go") == 0 || strcmp(token, "move") == 0) {
-        cmd->verb = VERB_GO;
-    } else if (strcmp(token, "look") == 0 || strcmp(token, "l") == 0) {
-        cmd->verb = VERB_LOOK;
-    } else if (strcmp(token, "examine") == 0 || strcmp(token, "x") == 0) {
-        cmd->verb = VERB_EXAMINE;
-    } else if (strcmp(token, "inventory") == 0 || strcmp(token, "i") == 0) {
-        cmd->verb = VERB_INVENTORY;
-    } else if (strcmp(token, "take") == 0 || strcmp(token, "get") == 0) {
-        cmd->verb = VERB_TAKE;
-    } else if (strcmp(token, "install") == 0) {
-        cmd->verb = VERB_INSTALL;
-    } else if (strcmp(token, "calculate") == 0 || strcmp(token, "calc") == 0) {
-        cmd->verb = VERB_CALCULATE;
-    } else if (strcmp(token, "navigate") == 0 || strcmp(token, "nav") == 0) {
-        cmd->verb = VERB_NAVIGATE;
-    } else if (strcmp(token, "path") == 0) {
-        cmd->verb = VERB_PATH;
-    } else if (strcmp(token, "help") == 0 || strcmp(token, "?") == 0) {
-        cmd->verb = VERB_HELP;
-    } else if (strcmp(token, "quit") == 0 || strcmp(token, "exit") == 0 || strcmp(token, "q") == 0) {
-        cmd->verb = VERB_QUIT;
-    } else if (strcmp(token, "north") == 0 || strcmp(token, "n") == 0) {
-        cmd->verb = VERB_GO;
-        cmd->direction = DIR_NORTH;
-        return true;
-    } else if (strcmp(token, "south") == 0 || strcmp(token, "s") == 0) {
-        cmd->verb = VERB_GO;
-        cmd->direction = DIR_SOUTH;
-        return true;
-    } else if (strcmp(token, "east") == 0 || strcmp(token, "e") == 0) {
-        cmd->verb = VERB_GO;
-        cmd->direction = DIR_EAST;
-        return true;
-    } else if (strcmp(token, "west") == 0 || strcmp(token, "w") == 0) {
-        cmd->verb = VERB_GO;
-        cmd->direction = DIR_WEST;
-        return true;
-    } else {
+    // Parse verb; a bare direction is a complete command
+    const VerbEntry *entry = lookup_word(token, hash);
+    if (entry == nullptr) {
         return false;
     }
+    cmd->verb = entry->verb;
+    if (entry->direction != DIR_COUNT) {
+        cmd->direction = entry->direction;
+        return true;
+    }
 
     // Parse object
-    token = strtok(nullptr, " \t");
-    if (token != nullptr) {
-        strncpy(cmd->object, token, MAX_INPUT - 1);
-
+    if (next_token(&cursor, cmd->object, &hash) > 0) {
         // For GO command, check if object is a direction
         if (cmd->verb == VERB_GO) {
-            cmd->direction = string_to_direction(token);
+            entry = lookup_word(cmd->object, hash);
+            if (entry != nullptr) cmd->direction = entry->direction;
         }
 
         // Parse target
-        token = strtok(nullptr, " \t");
-        if (token != nullptr) {
-            strncpy(cmd->target, token, MAX_INPUT - 1);
-        }
+        next_token(&cursor, cmd->target, &hash);
     }
 
     return true;
@@ -671,9 +692,16 @@ void execute_command(GameState *game, const Command *cmd) {
         case VERB_CALCULATE:
             cmd_calculate(game, cmd->object);
             break;
+        case VERB_OPTIMIZE:
+            cmd_optimize(game, cmd->object, cmd->target);
+            break;
         case VERB_NAVIGATE:
         case VERB_PATH:
-            cmd_navigate(game, cmd->object);
+            cmd_navigate(game, cmd->object, cmd->target);
+            break;
+        case VERB_LOCK:
+        case VERB_UNLOCK:
+            cmd_lock(game, string_to_direction(cmd->object), cmd->verb == VERB_LOCK);
             break;
         case VERB_HELP:
             cmd_help();
@@ -681,7 +709,7 @@ void execute_command(GameState *game, const Command *cmd) {
         case VERB_QUIT:
             printf("Are you sure you want to quit? (yes/no): ");
             char answer[10];
-            if (fgets(answer, sizeof(answer), stdin) != nullptr) {
+            if (read_line(game, answer, sizeof(answer))) {
                 to_lowercase(answer);
                 if (strncmp(answer, "yes", 3) == 0 || strncmp(answer, "y", 1) == 0) {
                     game->running = false;
@@ -713,6 +741,11 @@ void cmd_go(GameState *game, Direction dir) {
         return;
     }
 
+    if (game->locked[game->current_room][dir]) {
+        printf("The door to the %s is locked.\n", direction_to_string(dir));
+        return;
+    }
+
     game->current_room = next_room;
     printf("You move %s.\n\n", direction_to_string(dir));
     cmd_look(game);
@@ -738,6 +771,7 @@ void cmd_look(GameState *game) {
         if (room->connections[i] != game->current_room) {
             if (!first) printf(", ");
             printf("%s", direction_to_string((Direction)i));
+            if (game->locked[game->current_room][i]) printf(" (locked)");
             first = false;
         }
     }
@@ -851,20 +885,23 @@ void cmd_install(GameState *game, const char *part_name) {
         return;
     }
 
-    // Install the part
-    v->parts[v->parts_count++] = *part_to_install;
-    part_to_install->installed = true;
-
-    // Apply performance boost
-    v->engine_power *= (1.0 + part_to_install->performance_boost / 100.0);
-    v->max_speed *= (1.0 + part_to_install->performance_boost / 200.0);
-    v->mass += part_to_install->weight;
+    install_part(v, part_to_install);
 
     printf("Installed %s on %s!\n", part_to_install->name, v->name);
     printf("New engine power: %.0f HP\n", v->engine_power);
     printf("New max speed: %.1f m/s (%.1f mph)\n", v->max_speed, v->max_speed * 2.237);
 }
 
+void install_part(Vehicle *v, Part *part) {
+    v->parts[v->parts_count++] = *part;
+    part->installed = true;
+
+    // Apply performance boost (opt_equip in garage_optimize.c matches this)
+    v->engine_power *= (1.0 + part->performance_boost / 100.0);
+    v->max_speed *= (1.0 + part->performance_boost / 200.0);
+    v->mass += part->weight;
+}
+
 void cmd_calculate(GameState *game, const char *calc_type) {
     Room *room = &game->rooms[game->current_room];
 
@@ -879,6 +916,11 @@ void cmd_calculate(GameState *game, const char *calc_type) {
         return;
     }
 
+    if (strcmp(calc_type, "fleet") == 0) {
+        calculate_fleet(&game->garage);
+        return;
+    }
+
     Vehicle *v = &game->garage.vehicles[0];  // Use first vehicle
 
     printf("\n=== PERFORMANCE CALCULATIONS FOR %s ===\n\n", v->name);
@@ -886,38 +928,146 @@ void cmd_calculate(GameState *game, const char *calc_type) {
     if (strlen(calc_type) == 0 || strcmp(calc_type, "all") == 0) {
         // Calculate everything
         double terminal_v = calculate_terminal_velocity(v);
-        double accel_time = calculate_acceleration_time(v, 26.8);  // 0-60 mph time
-        double braking = calculate_braking_distance(v, 26.8);
+        double accel_time = simulate_acceleration_time(v, TEST_SPEED);
+        double braking = calculate_braking_distance(v, TEST_SPEED);
         double drag = calculate_drag_force(v, v->max_speed);
         double power_req = calculate_power_required(v, v->max_speed);
-        double lap_time = calculate_lap_time(v, 5000.0, 12);
+        double lap_time = simulate_lap_time(v);
 
         printf("Terminal Velocity: %.2f m/s (%.1f mph)\n", terminal_v, terminal_v * 2.237);
-        printf("0-60 mph time: %.2f seconds\n", accel_time);
+        printf("0-60 mph time: %.2f seconds (simulated)\n", accel_time);
         printf("Braking distance from 60 mph: %.2f meters (%.1f feet)\n", braking, braking * 3.281);
         printf("Drag force at max speed: %.0f N\n", drag);
         printf("Power required at max speed: %.0f kW (%.0f HP)\n",
                power_req / 1000.0, power_req / 745.7);
-        printf("Estimated lap time (5km, 12 turns): %.1f seconds\n", lap_time);
+        printf("Lap time (5km, 12 turns, simulated flying lap): %.1f seconds\n", lap_time);
 
     } else if (strcmp(calc_type, "terminal") == 0) {
         double terminal_v = calculate_terminal_velocity(v);
         printf("Terminal Velocity: %.2f m/s (%.1f mph)\n", terminal_v, terminal_v * 2.237);
 
     } else if (strcmp(calc_type, "acceleration") == 0) {
-        double accel_time = calculate_acceleration_time(v, 26.8);
-        printf("0-60 mph time: %.2f seconds\n", accel_time);
+        double accel_time = simulate_acceleration_time(v, TEST_SPEED);
+        printf("0-60 mph time: %.2f seconds (simulated; closed-form estimate %.2f)\n",
+               accel_time, calculate_acceleration_time(v, TEST_SPEED));
+
+    } else if (strcmp(calc_type, "lap") == 0) {
+        printf("Lap time (5km, 12 turns, simulated flying lap): %.1f seconds\n",
+               simulate_lap_time(v));
+        printf("Closed-form estimate: %.1f seconds\n",
+               calculate_lap_time(v, TEST_TRACK_LENGTH, TEST_TURNS));
 
     } else if (strcmp(calc_type, "braking") == 0) {
         double braking = calculate_braking_distance(v, 26.8);
         printf("Braking distance from 60 mph: %.2f meters (%.1f feet)\n",
                braking, braking * 3.281);
     } else {
-        printf("Unknown calculation type. Try: all, terminal, acceleration, braking\n");
+        printf("Unknown calculation type. Try: all, terminal, acceleration, braking, lap, fleet\n");
     }
 }
 
-void cmd_navigate(GameState *game, const char *destination) {
+void cmd_optimize(GameState *game, const char *metric_name, const char *action) {
+    Room *room = &game->rooms[game->current_room];
+    GarageInventory *garage = &game->garage;
+
+    if (!room->has_computer) {
+        printf("You need to be at a computer terminal to plan upgrades.\n");
+        printf("Try the Computer Lab, Office, or Testing Track.\n");
+        return;
+    }
+
+    OptMetricFn metric;
+    const char *label;
+    if (strlen(metric_name) == 0 || strcmp(metric_name, "lap") == 0) {
+        metric_name = "lap";
+        metric = simulated_lap;
+        label = "lap time";
+    } else if (strcmp(metric_name, "launch") == 0 || strcmp(metric_name, "acceleration") == 0) {
+        metric = simulated_launch;
+        label = "0-60 time";
+    } else {
+        printf("Optimize for what? Try: lap, launch\n");
+        return;
+    }
+
+    if (garage->vehicle_count == 0) {
+        printf("No vehicles available.\n");
+        return;
+    }
+
+    // Parts still on the shelf
+    OptPart parts[OPT_MAX_PARTS];
+    int shelf[OPT_MAX_PARTS];
+    int part_count = 0;
+    for (int i = 0; i < garage->loose_parts_count && part_count < OPT_MAX_PARTS; i++) {
+        const Part *part = &garage->loose_parts[i];
+        if (part->installed) continue;
+        shelf[part_count] = i;
+        parts[part_count++] = (OptPart){
+            .cost = part->cost,
+            .weight = part->weight,
+            .performance_boost = part->performance_boost
+        };
+    }
+    if (part_count == 0) {
+        printf("There are no loose parts left to install.\n");
+        return;
+    }
+
+    FleetVehicle vehicles[MAX_VEHICLES];
+    for (int v = 0; v < garage->vehicle_count; v++) {
+        vehicles[v] = vehicle_physics(&garage->vehicles[v]);
+    }
+
+    OptResult result;
+    if (!opt_search(vehicles, garage->vehicle_count, parts, part_count, garage->money,
+                    metric, OPTIMIZE_THREADS, &result)) {
+        printf("The optimizer could not run (out of memory or threads).\n");
+        return;
+    }
+
+    printf("\n=== PARTS PLAN: lowest total %s, budget $%d ===\n\n", label, garage->money);
+    int assigned = 0;
+    for (int p = 0; p < part_count; p++) {
+        int v = result.assignment[p];
+        if (v != OPT_UNUSED) assigned++;
+        printf("  %-20s $%6.0f  -> %s\n", garage->loose_parts[shelf[p]].name, parts[p].cost,
+               v != OPT_UNUSED ? garage->vehicles[v].name : "(leave on the shelf)");
+    }
+    printf("\nCost: $%.0f\n", result.cost);
+    printf("Total %s over %d vehicles: %.2f s -> %.2f s\n",
+           label, garage->vehicle_count, result.baseline, result.value);
+    printf("Searched %.0f possible assignments with %lld simulations\n",
+           pow(garage->vehicle_count + 1, part_count), result.evaluations);
+
+    if (assigned == 0) {
+        printf("No affordable part improves the garage.\n");
+        return;
+    }
+    if (strcmp(action, "apply") != 0) {
+        printf("\nType 'optimize %s apply' to buy and install these parts.\n", metric_name);
+        return;
+    }
+
+    printf("\n");
+    for (int p = 0; p < part_count; p++) {
+        int v = result.assignment[p];
+        if (v == OPT_UNUSED) continue;
+
+        Vehicle *vehicle = &garage->vehicles[v];
+        Part *part = &garage->loose_parts[shelf[p]];
+        if (vehicle->parts_count >= MAX_PARTS) {
+            printf("%s has no more room for %s.\n", vehicle->name, part->name);
+            continue;
+        }
+        install_part(vehicle, part);
+        garage->money -= (int)part->cost;
+        printf("Installed %s on %s.\n", part->name, vehicle->name);
+    }
+    printf("Money left: $%d\n", garage->money);
+}
+
+void cmd_navigate(GameState *game, const char *destination, const char *mode) {
     if (strlen(destination) == 0) {
         printf("Navigate to where?\n");
         printf("Available rooms: garage, workshop, parts, paint, track, office, tools, computer, showroom\n");
@@ -948,21 +1098,47 @@ void cmd_navigate(GameState *game, const char *destination) {
         return;
     }
 
+    bool hierarchical = strcmp(mode, "hpa") == 0;
+    if (!hierarchical && strlen(mode) > 0) {
+        printf("Unknown navigation mode '%s'. Try: navigate <room> [hpa]\n", mode);
+        return;
+    }
+
     printf("\n=== PATHFINDING: %s to %s ===\n\n",
            game->rooms[game->current_room].name,
            game->rooms[dest_id].name);
 
-    // Use A* pathfinding
     RoomID path[MAX_PATH_LENGTH];
-    int path_length = 0;
+    int nodes[MAX_PATH_LENGTH];
+    int path_length;
+
+    if (hierarchical) {
+        double cost = 0;
+        path_length = hpa_find_path(&game->room_hpa, &game->room_graph, &game->room_search,
+                                    game->current_room, dest_id, nodes, MAX_PATH_LENGTH, &cost);
+        if (path_length > 0) {
+            printf("HPA* over %d clusters, %d entrances: %d nodes expanded, length %.1f\n",
+                   game->room_hpa.cluster_count, game->room_hpa.abstract_count,
+                   game->room_hpa.expanded, cost);
+        }
+    } else {
+        // Routes are precomputed; this only follows next-hop entries
+        path_length = path_routes_walk(&game->room_routes, game->current_room, dest_id,
+                                       nodes, MAX_PATH_LENGTH);
+    }
+
+    if (path_length > 0) {
+        for (int i = 0; i < path_length; i++) {
+            path[i] = (RoomID)nodes[i];
+        }
 
-    if (astar_pathfinding(game->rooms, game->current_room, dest_id, path, path_length)) {
-        printf("Optimal path found (%d steps):\n", path_length - 1);
+        printf("%s path found (%d steps):\n", hierarchical ? "Hierarchical" : "Optimal",
+               path_length - 1);
         print_path(game->rooms, path, path_length);
 
         printf("\nWould you like to follow this path? (yes/no): ");
         char answer[10];
-        if (fgets(answer, sizeof(answer), stdin) != nullptr) {
+        if (read_line(game, answer, sizeof(answer))) {
             to_lowercase(answer);
             if (strncmp(answer, "yes", 3) == 0 || strncmp(answer, "y", 1) == 0) {
                 game->current_room = dest_id;
@@ -975,6 +1151,70 @@ void cmd_navigate(GameState *game, const char *destination) {
     }
 }
 
+// Find the direction in room that leads to target, or DIR_COUNT
+static Direction door_towards(const Room *room, RoomID target) {
+    for (int dir = 0; dir < DIR_COUNT; dir++) {
+        if (room->connections[dir] == target) return (Direction)dir;
+    }
+    return DIR_COUNT;
+}
+
+void cmd_lock(GameState *game, Direction dir, bool lock) {
+    if (dir >= DIR_COUNT) {
+        printf("Which door? (north, south, east, west)\n");
+        return;
+    }
+
+    RoomID here = game->current_room;
+    RoomID there = game->rooms[here].connections[dir];
+
+    if (there == here) {
+        printf("There is no door to the %s.\n", direction_to_string(dir));
+        return;
+    }
+    if (game->locked[here][dir] == lock) {
+        printf("That door is already %s.\n", lock ? "locked" : "unlocked");
+        return;
+    }
+
+    // Doors work both ways
+    Direction back = door_towards(&game->rooms[there], here);
+    game->locked[here][dir] = lock;
+    if (back < DIR_COUNT) game->locked[there][back] = lock;
+
+    double weight = heuristic_distance(game->rooms[here].coordinates, game->rooms[there].coordinates);
+    PathEdge changes[2];
+    int change_count = 0;
+    changes[change_count++] = (PathEdge){ .from = here, .to = there, .weight = lock ? -1.0 : weight };
+    if (back < DIR_COUNT) {
+        changes[change_count++] = (PathEdge){ .from = there, .to = here, .weight = lock ? -1.0 : weight };
+    }
+
+    PathGraph graph;
+    int recomputed = -1;
+    if (build_room_graph(game, &graph)) {
+        path_graph_free(&game->room_graph);
+        game->room_graph = graph;
+        recomputed = path_routes_update(&game->room_routes, &game->room_graph, &game->room_search,
+                                        changes, change_count);
+
+        // The hierarchy is small enough to rebuild outright
+        hpa_free(&game->room_hpa);
+        if (!hpa_build(&game->room_hpa, &game->room_graph, &game->room_search, ROOM_CLUSTER_SIZE)) {
+            recomputed = -1;
+        }
+    }
+
+    if (recomputed < 0) {
+        fprintf(stderr, "Out of memory updating routes\n");
+        exit(1);
+    }
+
+    printf("You %s the door to the %s.\n", lock ? "lock" : "unlock", direction_to_string(dir));
+    printf("Navigation routes updated (%d of %d destinations recomputed).\n",
+           recomputed, game->room_routes.node_count);
+}
+
 void cmd_help(void) {
     print_separator();
     printf("AVAILABLE COMMANDS:\n");
@@ -982,7 +1222,10 @@ void cmd_help(void) {
     printf("\nMovement:\n");
     printf("  go <direction>     - Move in a direction (north, south, east, west)\n");
     printf("  n, s, e, w         - Quick movement shortcuts\n");
-    printf("  navigate <room>    - Use A* pathfinding to find optimal route\n");
+    printf("  navigate <room>    - Follow the precomputed shortest route\n");
+    printf("  navigate <room> hpa - Plan the route hierarchically (HPA*)\n");
+    printf("  lock <direction>   - Lock a door (navigation reroutes around it)\n");
+    printf("  unlock <direction> - Unlock a door\n");
     printf("\nInformation:\n");
     printf("  look               - Look around current room\n");
     printf("  examine <object>   - Examine an object in detail\n");
@@ -990,7 +1233,9 @@ void cmd_help(void) {
     printf("\nVehicle Management:\n");
     printf("  install <part>     - Install a part on a vehicle\n");
     printf("  calculate <type>   - Perform physics calculations\n");
-    printf("                       Types: all, terminal, acceleration, braking\n");
+    printf("                       Types: all, terminal, acceleration, braking, lap, fleet\n");
+    printf("  optimize <metric>  - Best use of the loose parts within budget (lap, launch)\n");
+    printf("  optimize <metric> apply - Buy and install that plan\n");
     printf("\nOther:\n");
     printf("  help               - Show this help message\n");
     printf("  quit               - Exit the game\n");
@@ -1055,160 +1300,126 @@ double calculate_lap_time(const Vehicle *v, double track_length, int turns) {
     return turn_time + straight_time + accel_penalty;
 }
 
-// ============================================================================
-// PATHFINDING ALGORITHMS
-// ============================================================================
-
-double heuristic_distance(Point2D a, Point2D b) {
-    // Euclidean distance for A* heuristic
-    double dx = a.x - b.x;
-    double dy = a.y - b.y;
-    return sqrt(dx * dx + dy * dy);
+// Time-stepped versions of the two estimates above (see garage_sim.h)
+double simulate_acceleration_time(const Vehicle *v, double target_speed) {
+    FleetVehicle physics = vehicle_physics(v);
+    return sim_launch_time(&physics, target_speed, SIM_DT, nullptr);
 }
 
-void dijkstra_shortest_path(const Room rooms[], RoomID start, RoomID end,
-                           PathfindingState *state) {
-    // Initialize
-    for (int i = 0; i < MAX_ROOMS; i++) {
-        state->cost[i] = INFINITY_COST;
-        state->visited[i] = false;
-        state->parent[i] = -1;
-    }
-
-    state->cost[start] = 0;
-
-    // Main algorithm loop
-    for (int count = 0; count < ROOM_COUNT; count++) {
-        // Find minimum cost unvisited node
-        double min_cost = INFINITY_COST;
-        int min_node = -1;
-
-        for (int i = 0; i < ROOM_COUNT; i++) {
-            if (!state->visited[i] && state->cost[i] < min_cost) {
-                min_cost = state->cost[i];
-                min_node = i;
-            }
-        }
+double simulate_lap_time(const Vehicle *v) {
+    FleetVehicle physics = vehicle_physics(v);
+    return simulated_lap(&physics);
+}
 
-        if (min_node == -1 || min_node == end) {
-            break;
-        }
+// 0-60 mph in seconds, with FAILED_LAUNCH for cars that never get there
+double simulated_launch(const FleetVehicle *physics) {
+    double seconds = sim_launch_time(physics, TEST_SPEED, SIM_DT, nullptr);
+    return seconds < 0 ? FAILED_LAUNCH : seconds;
+}
 
-        state->visited[min_node] = true;
+double simulated_lap(const FleetVehicle *physics) {
+    SimSegment segments[2 * TEST_TURNS + 1];
+    SimTrack track = {
+        .segments = segments,
+        .count = sim_track_build(segments, TEST_TRACK_LENGTH, TEST_TURNS,
+                                 TEST_TURN_LENGTH, TEST_TURN_RADIUS)
+    };
 
-        // Update neighbors
-        for (int dir = 0; dir < DIR_COUNT; dir++) {
-            RoomID neighbor = rooms[min_node].connections[dir];
+    // Two laps from a standing start; the second (flying) lap is the best
+    return sim_laps(physics, &track, SIM_BENCH_LAPS, SIM_DT).best_lap;
+}
 
-            if (neighbor != min_node && !state->visited[neighbor]) {
-                double edge_cost = heuristic_distance(
-                    rooms[min_node].coordinates,
-                    rooms[neighbor].coordinates
-                );
+// ============================================================================
+// FLEET ANALYSIS
+// ============================================================================
 
-                double new_cost = state->cost[min_node] + edge_cost;
+FleetVehicle vehicle_physics(const Vehicle *v) {
+    return (FleetVehicle){
+        .mass = v->mass,
+        .engine_power = v->engine_power,
+        .drag_coefficient = v->drag_coefficient,
+        .frontal_area = v->frontal_area,
+        .max_speed = v->max_speed,
+        .acceleration = v->acceleration
+    };
+}
 
-                if (new_cost < state->cost[neighbor]) {
-                    state->cost[neighbor] = new_cost;
-                    state->parent[neighbor] = min_node;
-                }
-            }
-        }
+void calculate_fleet(const GarageInventory *garage) {
+    Fleet fleet;
+    FleetMetrics metrics;
+    if (!fleet_init(&fleet, garage->vehicle_count)) {
+        printf("Not enough memory for fleet analysis.\n");
+        return;
+    }
+    if (!fleet_metrics_init(&metrics, garage->vehicle_count)) {
+        printf("Not enough memory for fleet analysis.\n");
+        fleet_free(&fleet);
+        return;
     }
-}
 
-bool astar_pathfinding(const Room rooms[], RoomID start, RoomID end,
-                      RoomID path[], int path_length) {
-    // A* pathfinding implementation
-    double g_score[MAX_ROOMS];  // Cost from start
-    double f_score[MAX_ROOMS];  // g_score + heuristic
-    bool closed_set[MAX_ROOMS];
-    bool open_set[MAX_ROOMS];
-    int came_from[MAX_ROOMS];
-
-    // Initialize
-    for (int i = 0; i < MAX_ROOMS; i++) {
-        g_score[i] = INFINITY_COST;
-        f_score[i] = INFINITY_COST;
-        closed_set[i] = false;
-        open_set[i] = false;
-        came_from[i] = -1;
-    }
-
-    g_score[start] = 0;
-    f_score[start] = heuristic_distance(rooms[start].coordinates, rooms[end].coordinates);
-    open_set[start] = true;
-
-    int actual_path_length = 0;
-
-    // Main A* loop
-    while (true) {
-        // Find node in open_set with lowest f_score
-        double min_f = INFINITY_COST;
-        int current = -1;
-
-        for (int i = 0; i < ROOM_COUNT; i++) {
-            if (open_set[i] && f_score[i] < min_f) {
-                min_f = f_score[i];
-                current = i;
-            }
-        }
+    for (int i = 0; i < garage->vehicle_count; i++) {
+        FleetVehicle physics = vehicle_physics(&garage->vehicles[i]);
+        fleet_add(&fleet, &physics);
+    }
 
-        if (current == -1) {
-            return false;  // No path found
-        }
+    FleetCourse course = { .test_speed = TEST_SPEED, .track_length = TEST_TRACK_LENGTH, .turns = TEST_TURNS };
+    fleet_analyze(&fleet, &course, &metrics);
 
-        if (current == end) {
-            // Reconstruct path
-            actual_path_length = 0;
-            int node = end;
+    printf("=== FLEET ANALYSIS (%d vehicles) ===\n\n", fleet.count);
+    printf("%-18s %12s %8s %10s %12s %10s\n",
+           "Vehicle", "Top m/s", "0-60 s", "Drag N", "Power kW", "Lap s");
+    for (int i = 0; i < fleet.count; i++) {
+        printf("%-18s %12.1f %8.2f %10.0f %12.0f %10.1f\n", garage->vehicles[i].name,
+               metrics.terminal_velocity[i], metrics.launch_time[i], metrics.drag_at_max[i],
+               metrics.power_at_max[i] / 1000.0, metrics.lap_time[i]);
+    }
+    printf("\nBraking from 60 mph: %.1f m for every vehicle (tire-limited)\n",
+           metrics.braking_distance[0]);
 
-            while (node != -1 && actual_path_length < MAX_PATH_LENGTH) {
-                path[actual_path_length] = (RoomID)node;
-                actual_path_length++;
-                node = came_from[node];
-            }
+    fleet_metrics_free(&metrics);
+    fleet_free(&fleet);
+}
 
-            // Reverse path
-            for (int i = 0; i < actual_path_length / 2; i++) {
-                RoomID temp = path[i];
-                path[i] = path[actual_path_length - 1 - i];
-                path[actual_path_length - 1 - i] = temp;
-            }
+// ============================================================================
+// PATHFINDING ALGORITHMS
+// ============================================================================
 
-            return true;
-        }
+double heuristic_distance(Point2D a, Point2D b) {
+    // Euclidean distance for A* heuristic
+    double dx = a.x - b.x;
+    double dy = a.y - b.y;
+    return sqrt(dx * dx + dy * dy);
+}
 
-        open_set[current] = false;
-        closed_set[current] = true;
+bool build_room_graph(const GameState *game, PathGraph *graph) {
+    const Room *rooms = game->rooms;
+    PathEdge edges[ROOM_COUNT * DIR_COUNT];
+    int edge_count = 0;
 
-        // Check neighbors
+    // A connection back to the room itself is a wall. Edge weights are the
+    // distance between room coordinates, computed once here.
+    for (int room = 0; room < ROOM_COUNT; room++) {
         for (int dir = 0; dir < DIR_COUNT; dir++) {
-            RoomID neighbor = rooms[current].connections[dir];
-
-            if (neighbor == current || closed_set[neighbor]) {
-                continue;
-            }
-
-            double tentative_g = g_score[current] +
-                               heuristic_distance(rooms[current].coordinates,
-                                                rooms[neighbor].coordinates);
-
-            if (!open_set[neighbor]) {
-                open_set[neighbor] = true;
-            } else if (tentative_g >= g_score[neighbor]) {
-                continue;
-            }
-
-            came_from[neighbor] = current;
-            g_score[neighbor] = tentative_g;
-            f_score[neighbor] = g_score[neighbor] +
-                              HEURISTIC_WEIGHT * heuristic_distance(rooms[neighbor].coordinates,
-                                                                   rooms[end].coordinates);
+            RoomID neighbor = rooms[room].connections[dir];
+            if (neighbor == (RoomID)room || game->locked[room][dir]) continue;
+
+            edges[edge_count++] = (PathEdge){
+                .from = room,
+                .to = neighbor,
+                .weight = heuristic_distance(rooms[room].coordinates, rooms[neighbor].coordinates)
+            };
         }
     }
 
-    return false;
+    if (!path_graph_build(graph, ROOM_COUNT, edges, edge_count)) {
+        return false;
+    }
+
+    for (int room = 0; room < ROOM_COUNT; room++) {
+        graph->x[room] = rooms[room].coordinates.x;
+        graph->y[room] = rooms[room].coordinates.y;
+    }
+    return true;
 }
 
 void print_path(const Room rooms[], const RoomID path[], int path_length) {
@@ -1250,6 +1461,29 @@ Direction string_to_direction(const char *str) {
     return DIR_COUNT;
 }
 
+const char* verb_to_string(Verb verb) {
+    switch (verb) {
+        case VERB_GO: return "go";
+        case VERB_LOOK: return "look";
+        case VERB_EXAMINE: return "examine";
+        case VERB_INVENTORY: return "inventory";
+        case VERB_TAKE: return "take";
+        case VERB_DROP: return "drop";
+        case VERB_USE: return "use";
+        case VERB_INSTALL: return "install";
+        case VERB_CALCULATE: return "calculate";
+        case VERB_OPTIMIZE: return "optimize";
+        case VERB_PATH: return "path";
+        case VERB_NAVIGATE: return "navigate";
+        case VERB_TUNE: return "tune";
+        case VERB_LOCK: return "lock";
+        case VERB_UNLOCK: return "unlock";
+        case VERB_HELP: return "help";
+        case VERB_QUIT: return "quit";
+        default: return "(not understood)";
+    }
+}
+
 const char* vehicle_type_to_string(VehicleType type) {
     switch (type) {
         case VEHICLE_SPORTS_CAR: return "Sports Car";
@@ -1284,3 +1518,107 @@ void to_lowercase(char *str) {
 void print_separator(void) {
     printf("========================================================\n");
 }
+
+// ============================================================================
+// HEADLESS REPLAY
+// ============================================================================
+
+constexpr uint64_t OUTPUT_HASH_SEED = 0xcbf29ce484222325;  // FNV-1a, 64-bit
+constexpr uint64_t OUTPUT_HASH_PRIME = 0x100000001b3;
+constexpr size_t OUTPUT_BUFFER = 1 << 16;
+
+// Everything the game prints during a replay goes through this stream,
+// which keeps only a running hash of the bytes
+static ssize_t hash_output(void *cookie, const char *data, size_t size) {
+    uint64_t *hash = cookie;
+    for (size_t i = 0; i < size; i++) {
+        *hash = (*hash ^ (unsigned char)data[i]) * OUTPUT_HASH_PRIME;
+    }
+    return (ssize_t)size;
+}
+
+// Play the script `rounds` times, each time in a fresh game, answering
+// every prompt from the script. Output is hashed instead of shown; every
+// round must produce the same hash, and it must match expected_hash
+// when one is given (a 16-digit hex value printed by an earlier run).
+int replay_script(const char *path, int rounds, const char *expected_hash) {
+    FILE *script = fopen(path, "r");
+    if (script == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+
+    uint64_t hash = OUTPUT_HASH_SEED;
+    FILE *hashed = fopencookie(&hash, "w", (cookie_io_functions_t){ .write = hash_output });
+    if (hashed == nullptr) {
+        fprintf(stderr, "Cannot create the output hash stream\n");
+        fclose(script);
+        return 1;
+    }
+    setvbuf(hashed, nullptr, _IOFBF, OUTPUT_BUFFER);
+
+    // glibc's stdout is an ordinary variable; point it at the hash
+    FILE *console = stdout;
+    stdout = hashed;
+
+    CommandTimes times = {};
+    uint64_t first_hash = 0;
+    bool deterministic = true;
+    int moves = 0;
+
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+    for (int round = 0; round < rounds; round++) {
+        GameState game = {};
+        init_game(&game);
+        rewind(script);
+        game.input = script;
+        game.times = &times;
+        game_loop(&game);
+        moves = game.moves_count;
+        free_game(&game);
+
+        fflush(hashed);
+        if (round == 0) first_hash = hash;
+        else if (hash != first_hash) deterministic = false;
+        hash = OUTPUT_HASH_SEED;
+    }
+    timespec_get(&end, TIME_UTC);
+    double wall_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    stdout = console;
+    fclose(hashed);
+    fclose(script);
+
+    long long commands = 0;
+    double command_seconds = 0;
+    for (int v = 0; v < VERB_COUNT; v++) {
+        commands += times.count[v];
+        command_seconds += times.seconds[v];
+    }
+
+    printf("=== Replay of %s (%d rounds, %d moves each) ===\n\n", path, rounds, moves);
+    printf("%-18s %10s %12s %14s %8s\n", "command", "count", "total ms", "us/command", "share");
+    for (int v = 0; v < VERB_COUNT; v++) {
+        if (times.count[v] == 0) continue;
+        printf("%-18s %10lld %12.2f %14.2f %7.1f%%\n", verb_to_string((Verb)v), times.count[v],
+               times.seconds[v] * 1e3, times.seconds[v] / times.count[v] * 1e6,
+               command_seconds > 0 ? 100.0 * times.seconds[v] / command_seconds : 0.0);
+    }
+    printf("\n%lld commands in %.3f s (%.3e commands/s, %.3f s including setup)\n",
+           commands, command_seconds, commands / (command_seconds > 0 ? command_seconds : 1e-9),
+           wall_seconds);
+
+    char hash_text[17];
+    snprintf(hash_text, sizeof(hash_text), "%016llx", (unsigned long long)first_hash);
+    printf("Output hash: %s (%s across rounds)\n", hash_text,
+           deterministic ? "identical" : "DIFFERENT");
+
+    int status = deterministic ? 0 : 1;
+    if (expected_hash != nullptr && strcmp(expected_hash, hash_text) != 0) {
+        printf("!! Expected output hash %s\n", expected_hash);
+        status = 1;
+    }
+    return status;
+}
+
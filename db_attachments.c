@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_attachments.h"
+#include "db_memory.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static void fill_attachment(sqlite3_stmt *stmt, Attachment *attachment) {
+    attachment->id = sqlite3_column_int64(stmt, 0);
+    attachment->lesson_id = sqlite3_column_int(stmt, 1);
+    snprintf(attachment->name, sizeof(attachment->name), "%s",
+             (const char *)sqlite3_column_text(stmt, 2));
+    attachment->size = sqlite3_column_int64(stmt, 3);
+    attachment->timestamp = (time_t)sqlite3_column_int64(stmt, 4);
+}
+
+int attachment_write(sqlite3 *db, int lesson_id, const char *name, FILE *in,
+                     sqlite3_int64 size, AttachmentProgress progress, void *user_data,
+                     sqlite3_int64 *id) {
+    if (memory_is_open(db)) {
+        fprintf(stderr, "Attachments cannot be written in in-memory mode.\n");
+        return SQLITE_MISUSE;
+    }
+    if (size < 0 || size > sqlite3_limit(db, SQLITE_LIMIT_LENGTH, -1)) {
+        fprintf(stderr, "Attachment too large: %lld bytes (limit %d)\n",
+                size, sqlite3_limit(db, SQLITE_LIMIT_LENGTH, -1));
+        return SQLITE_TOOBIG;
+    }
+
+    // The row is created at its final size, then filled in place
+    const char *sql = "INSERT INTO attachments (lesson_id, name, size, timestamp, data) "
+                      "VALUES (?1, ?2, ?3, ?4, zeroblob(?3));";
+
+    int rc = sqlite3_exec(db, "SAVEPOINT attachment_write;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot start attachment write: %s\n", sqlite3_errmsg(db));
+        return rc;
+    }
+
+    sqlite3_stmt *stmt;
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, lesson_id);
+        sqlite3_bind_text(stmt, 2, name, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, size);
+        sqlite3_bind_int64(stmt, 4, (sqlite3_int64)time(NULL));
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db);
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_int64 rowid = sqlite3_last_insert_rowid(db);
+    sqlite3_blob *blob = NULL;
+    if (rc == SQLITE_OK) rc = sqlite3_blob_open(db, "main", "attachments", "data", rowid, 1, &blob);
+
+    unsigned char chunk[ATTACHMENT_CHUNK_SIZE];
+    sqlite3_int64 done = 0;
+    while (rc == SQLITE_OK && done < size) {
+        size_t want = size - done < ATTACHMENT_CHUNK_SIZE ? (size_t)(size - done) : ATTACHMENT_CHUNK_SIZE;
+        size_t got = fread(chunk, 1, want, in);
+        if (got == 0) {
+            fprintf(stderr, "Attachment input ended after %lld of %lld bytes\n", done, size);
+            rc = SQLITE_IOERR;
+            break;
+        }
+        rc = sqlite3_blob_write(blob, chunk, (int)got, (int)done);
+        done += got;
+        if (progress) progress(done, size, user_data);
+    }
+
+    if (rc != SQLITE_OK && rc != SQLITE_IOERR) {
+        fprintf(stderr, "Attachment write failed: %s\n", sqlite3_errmsg(db));
+    }
+    if (blob && sqlite3_blob_close(blob) != SQLITE_OK && rc == SQLITE_OK) rc = sqlite3_errcode(db);
+
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_exec(db, "RELEASE attachment_write;", NULL, NULL, NULL);
+        if (id) *id = rowid;
+    } else {
+        sqlite3_exec(db, "ROLLBACK TO attachment_write; RELEASE attachment_write;", NULL, NULL, NULL);
+    }
+    return rc;
+}
+
+int attachment_read(sqlite3 *db, sqlite3_int64 id, FILE *out,
+                    AttachmentProgress progress, void *user_data) {
+    // The open handle holds a read transaction, so every chunk comes from
+    // the same version of the row
+    sqlite3_blob *blob;
+    int rc = sqlite3_blob_open(db, "main", "attachments", "data", id, 0, &blob);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot open attachment %lld: %s\n", id, sqlite3_errmsg(db));
+        sqlite3_blob_close(blob);
+        return rc;
+    }
+
+    unsigned char chunk[ATTACHMENT_CHUNK_SIZE];
+    int size = sqlite3_blob_bytes(blob);
+    int done = 0;
+    while (rc == SQLITE_OK && done < size) {
+        int length = size - done < ATTACHMENT_CHUNK_SIZE ? size - done : ATTACHMENT_CHUNK_SIZE;
+        rc = sqlite3_blob_read(blob, chunk, length, done);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Attachment read failed: %s\n", sqlite3_errmsg(db));
+        } else if (fwrite(chunk, 1, length, out) != (size_t)length) {
+            fprintf(stderr, "Cannot write attachment output\n");
+            rc = SQLITE_IOERR;
+        } else {
+            done += length;
+            if (progress) progress(done, size, user_data);
+        }
+    }
+
+    sqlite3_blob_close(blob);
+    return rc;
+}
+
+int attachment_import(sqlite3 *db, int lesson_id, const char *path, sqlite3_int64 *id) {
+    struct stat info;
+    FILE *in = fopen(path, "rb");
+    if (in == NULL || fstat(fileno(in), &info) != 0 || !S_ISREG(info.st_mode)) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        if (in) fclose(in);
+        return SQLITE_CANTOPEN;
+    }
+
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    int rc = attachment_write(db, lesson_id, name, in, (sqlite3_int64)info.st_size,
+                              NULL, NULL, id);
+    fclose(in);
+    return rc;
+}
+
+int attachment_export(sqlite3 *db, sqlite3_int64 id, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        return SQLITE_CANTOPEN;
+    }
+
+    int rc = attachment_read(db, id, out, NULL, NULL);
+    if (fclose(out) != 0 && rc == SQLITE_OK) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        rc = SQLITE_IOERR;
+    }
+    // No half-written files left behind
+    if (rc != SQLITE_OK) remove(path);
+    return rc;
+}
+
+int attachment_list(sqlite3 *db, int lesson_id, Attachment *attachments, int max) {
+    // Metadata columns only; data is stored last and its pages are not read
+    const char *sql = "SELECT id, lesson_id, name, size, timestamp FROM attachments "
+                      "WHERE lesson_id = ? ORDER BY id;";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, lesson_id);
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (count < max) fill_attachment(stmt, &attachments[count]);
+        count++;
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+int attachment_get(sqlite3 *db, sqlite3_int64 id, Attachment *attachment) {
+    const char *sql = "SELECT id, lesson_id, name, size, timestamp FROM attachments WHERE id = ?;";
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return rc;
+
+    sqlite3_bind_int64(stmt, 1, id);
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) fill_attachment(stmt, attachment);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW ? SQLITE_OK : rc == SQLITE_DONE ? SQLITE_NOTFOUND : rc;
+}
+
+int attachment_delete(sqlite3 *db, sqlite3_int64 id) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, "DELETE FROM attachments WHERE id = ?;", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return rc;
+
+    sqlite3_bind_int64(stmt, 1, id);
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db);
+    sqlite3_finalize(stmt);
+    return rc;
+}
@@ -0,0 +1,57 @@
+#ifndef DB_ATTACHMENTS_H
+#define DB_ATTACHMENTS_H
+
+#include "db_common.h"
+#include <stdio.h>
+
+// Bytes moved per sqlite3_blob_read()/sqlite3_blob_write() call
+#define ATTACHMENT_CHUNK_SIZE (64 * 1024)
+
+// Large files (sample projects, datasets, long listings) attached to a
+// lesson, stored in the attachments table.
+//
+// Attachments are never held in memory as a whole. Importing inserts a
+// zeroblob() of the final size and fills it through sqlite3_blob_write()
+// one chunk at a time; exporting reads it back with sqlite3_blob_read().
+// Memory use stays at one chunk whatever the size. Each import runs in a
+// savepoint, so it is atomic on its own and part of the caller's
+// transaction when there is one. In-memory connections (db_memory.h)
+// cannot journal blob writes and refuse imports with SQLITE_MISUSE.
+
+typedef struct {
+    sqlite3_int64 id;
+    int lesson_id;
+    char name[256];
+    sqlite3_int64 size;
+    time_t timestamp;
+} Attachment;
+
+// Called after every chunk; may be NULL
+typedef void (*AttachmentProgress)(sqlite3_int64 done, sqlite3_int64 total, void *user_data);
+
+// Store size bytes read from in as a new attachment of lesson_id. *id is
+// set to the new attachment's id.
+int attachment_write(sqlite3 *db, int lesson_id, const char *name, FILE *in,
+                     sqlite3_int64 size, AttachmentProgress progress, void *user_data,
+                     sqlite3_int64 *id);
+
+// Write attachment id to out
+int attachment_read(sqlite3 *db, sqlite3_int64 id, FILE *out,
+                    AttachmentProgress progress, void *user_data);
+
+// attachment_write() from the file at path, named after its last component
+int attachment_import(sqlite3 *db, int lesson_id, const char *path, sqlite3_int64 *id);
+
+// attachment_read() into a new file at path
+int attachment_export(sqlite3 *db, sqlite3_int64 id, const char *path);
+
+// Fill up to max attachments of lesson_id, oldest first; returns how many
+// the lesson has (may exceed max), or -1 on error
+int attachment_list(sqlite3 *db, int lesson_id, Attachment *attachments, int max);
+
+// Metadata of one attachment; SQLITE_NOTFOUND if there is none
+int attachment_get(sqlite3 *db, sqlite3_int64 id, Attachment *attachment);
+
+int attachment_delete(sqlite3 *db, sqlite3_int64 id);
+
+#endif // DB_ATTACHMENTS_H
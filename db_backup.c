@@ -0,0 +1,173 @@
+#define _XOPEN_SOURCE 700  // realpath
+
+#include "db_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <time.h>
+
+// Default pacing: 64 pages (256 KB with 4 KB pages) every 10 ms
+#define DEFAULT_PAGES_PER_STEP 64
+#define DEFAULT_SLEEP_MS 10
+
+typedef struct {
+    struct timespec start;
+    int page_size;
+    int pagecount;
+    int last_percent;
+} BackupReport;
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report_progress(const BackupProgress *progress, void *user_data) {
+    BackupReport *report = user_data;
+    int copied = progress->pagecount - progress->remaining;
+    report->pagecount = progress->pagecount;
+    int percent = progress->pagecount > 0 ? (100 * copied) / progress->pagecount : 100;
+
+    // One line per 10% keeps the output readable for large files
+    if (percent / 10 == report->last_percent / 10 && progress->remaining > 0) {
+        return;
+    }
+    report->last_percent = percent;
+
+    double seconds = elapsed_seconds(&report->start);
+    double mb = (double)copied * report->page_size / (1024.0 * 1024.0);
+
+    printf("  %3d%%  %6d / %-6d pages  %8.2f MB/s  (%d batches)\n",
+           percent, copied, progress->pagecount,
+           seconds > 0 ? mb / seconds : 0.0, progress->steps);
+}
+
+static void default_snapshot_name(char *buffer, size_t size) {
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(buffer, size, "lessons-%Y%m%d-%H%M%S.db", &tm_now);
+}
+
+// Resolve path to an absolute name without symlinks. A file that does not
+// exist yet is resolved through its directory, so "./x.db" and "/abs/x.db"
+// compare equal whether or not x.db is there.
+static int resolve_path(const char *path, char *resolved) {
+    if (realpath(path, resolved) != NULL) {
+        return 1;
+    }
+    const char *slash = strrchr(path, '/');
+    char dir[PATH_MAX];
+    const char *base = path;
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+        base = slash + 1;
+    }
+    char resolved_dir[PATH_MAX];
+    if (realpath(dir, resolved_dir) == NULL) {
+        return 0;
+    }
+    return snprintf(resolved, PATH_MAX, "%s/%s", resolved_dir, base) < PATH_MAX;
+}
+
+static int same_inode(const char *a, const char *b) {
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 &&
+           sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+// True when writing dest would clobber the live database or one of the
+// files SQLite keeps beside it. Paths are compared after resolving symlinks
+// and relative names, and by inode to catch hard links.
+static int overwrites_source(const char *dest, const char *source) {
+    static const char *const suffixes[] = { "", "-wal", "-shm", "-journal" };
+    char dest_real[PATH_MAX], source_real[PATH_MAX];
+    int resolved = resolve_path(dest, dest_real) && resolve_path(source, source_real);
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        char sibling[PATH_MAX + 16];
+        snprintf(sibling, sizeof(sibling), "%s%s", source, suffixes[i]);
+        if (same_inode(dest, sibling)) {
+            return 1;
+        }
+        snprintf(sibling, sizeof(sibling), "%s%s", source_real, suffixes[i]);
+        if (resolved && strcmp(dest_real, sibling) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    char snapshot_name[64];
+    const char *dest_path;
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf("Usage: %s [dest.db] [pages_per_step] [sleep_ms]\n", argv[0]);
+        printf("  dest.db         Backup file (default: lessons-<timestamp>.db)\n");
+        printf("  pages_per_step  Pages copied per batch, 0 = all at once (default: %d)\n",
+               DEFAULT_PAGES_PER_STEP);
+        printf("  sleep_ms        Pause between batches (default: %d)\n", DEFAULT_SLEEP_MS);
+        return 0;
+    }
+
+    if (argc > 1) {
+        dest_path = argv[1];
+    } else {
+        default_snapshot_name(snapshot_name, sizeof(snapshot_name));
+        dest_path = snapshot_name;
+    }
+
+    int pages_per_step = argc > 2 ? atoi(argv[2]) : DEFAULT_PAGES_PER_STEP;
+    int sleep_ms = argc > 3 ? atoi(argv[3]) : DEFAULT_SLEEP_MS;
+
+    if (overwrites_source(dest_path, database_path())) {
+        fprintf(stderr, "Refusing to back up onto %s: it is %s or one of its files.\n",
+                dest_path, database_path());
+        return 1;
+    }
+
+    sqlite3 *db;
+    int rc = init_database(&db);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Failed to initialize database.\n");
+        return 1;
+    }
+
+    BackupReport report = { .page_size = 4096, .last_percent = -10 };
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "PRAGMA page_size;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            report.page_size = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    printf("Backing up %s to %s (%d pages per batch, %d ms pause)...\n",
+           database_path(), dest_path, pages_per_step, sleep_ms);
+
+    clock_gettime(CLOCK_MONOTONIC, &report.start);
+    rc = backup_database(db, dest_path, pages_per_step, sleep_ms, report_progress, &report);
+    double seconds = elapsed_seconds(&report.start);
+
+    close_database(db);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Backup failed.\n");
+        return 1;
+    }
+
+    printf("\n=== Backup Complete ===\n");
+    printf("Snapshot: %s\n", dest_path);
+    double mb = (double)report.pagecount * report.page_size / (1024.0 * 1024.0);
+    printf("Copied: %d pages (%.2f MB)\n", report.pagecount, mb);
+    printf("Elapsed: %.3f seconds (%.2f MB/s)\n", seconds, seconds > 0 ? mb / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,847 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_common.h"
+#include "db_memory.h"
+#include "db_uring.h"
+#include "db_search.h"
+#include "db_complete.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define DEFAULT_ROUNDS 200
+#define DEFAULT_EXTRA_LESSONS 2000
+#define DEFAULT_SCAN_LESSONS 50000
+#define DEFAULT_PARTITION_LESSONS 20000
+#define DEFAULT_FUZZY_LESSONS 50000
+#define DEFAULT_COMPLETE_LESSONS 100000
+#define SCRATCH_DB "db_bench_scratch.db"
+
+// The queries db_manager runs, in the order of its menu
+typedef struct {
+    const char *name;
+    const char *sql;
+} BenchQuery;
+
+// (with each printed lesson's content, which it looks up by id)
+static const BenchQuery queries[] = {
+    { "view all",      "SELECT id, topic, category, difficulty, content, timestamp "
+                       "FROM lessons_full ORDER BY id;" },
+    { "search (LIKE)", "SELECT id, topic, category, difficulty, content, timestamp "
+                       "FROM lessons_full WHERE topic LIKE ?1 OR category LIKE ?1 OR content LIKE ?1;" },
+    { "lookup by id",  "SELECT id, topic, category, difficulty, content, timestamp "
+                       "FROM lessons_full WHERE id = ?2;" },
+    { "by category",   "SELECT id, topic, category, difficulty, content, timestamp "
+                       "FROM lessons_full WHERE category = ?3 ORDER BY difficulty, topic;" },
+};
+
+#define QUERY_COUNT ((int)(sizeof(queries) / sizeof(queries[0])))
+
+typedef struct {
+    double startup;             // Open plus the first query
+    double query[QUERY_COUNT];  // Per query
+    double write;               // Per autocommit UPDATE
+    double flush;               // Final flush and close
+} BenchTimes;
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void remove_scratch(void) {
+    const char *suffixes[] = { "", "-wal", "-shm", "-journal", "-memjournal" };
+    char path[128];
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", SCRATCH_DB, suffixes[i]);
+        remove(path);
+    }
+}
+
+// Copy the live database and pad it so the queries have something to scan
+static int make_scratch(int extra_lessons, char *category, size_t category_size) {
+    sqlite3 *src;
+    if (open_database(database_path(), &src) != SQLITE_OK) return 0;
+    int rc = backup_database(src, SCRATCH_DB, 0, 0, NULL, NULL);
+    sqlite3_close(src);
+    if (rc != SQLITE_OK) return 0;
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) return 0;
+
+    sqlite3_stmt *stmt = NULL, *content_stmt = NULL;
+    rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db,
+            "INSERT INTO lessons (topic, category, difficulty, timestamp) "
+            "VALUES (?1, ?2, ?3, ?5);", -1, &stmt, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db,
+            "INSERT INTO lesson_content (lesson_id, content) "
+            "VALUES (last_insert_rowid(), ?);", -1, &content_stmt, NULL);
+    }
+    for (int i = 0; rc == SQLITE_OK && i < extra_lessons; i++) {
+        char topic[64], content[512];
+        snprintf(topic, sizeof(topic), "Benchmark lesson %d", i);
+        snprintf(content, sizeof(content),
+                 "Synthetic lesson %d. Covers loops, arrays and buffers in enough "
+                 "detail that a LIKE scan has real text to read through; the "
+                 "keyword only shows up in every tenth lesson%s.",
+                 i, i % 10 == 0 ? " about pointers" : "");
+        sqlite3_bind_text(stmt, 1, topic, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, i % 2 ? "Benchmarks" : "Synthetic", -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 3, DIFFICULTY_BEGINNER + i % 4);
+        sqlite3_bind_int64(stmt, 5, (sqlite3_int64)time(NULL));
+        sqlite3_bind_text(content_stmt, 1, content, -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE || sqlite3_step(content_stmt) != SQLITE_DONE) {
+            rc = SQLITE_ERROR;
+        }
+        sqlite3_reset(stmt);
+        sqlite3_reset(content_stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(content_stmt);
+    sqlite3_exec(db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+
+    // Most common category, for the category filter
+    snprintf(category, category_size, "Synthetic");
+    if (sqlite3_prepare_v2(db, "SELECT category FROM lessons GROUP BY category "
+                               "ORDER BY COUNT(*) DESC LIMIT 1;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            snprintf(category, category_size, "%s", (const char *)sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_close(db);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot pad the scratch database.\n");
+    return rc == SQLITE_OK;
+}
+
+static int lesson_count(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    int count = 0;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM lessons;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) count = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return count;
+}
+
+static int run_mode(int in_memory, int rounds, const char *category, BenchTimes *times) {
+    struct timespec start;
+    sqlite3 *db;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = in_memory ? memory_open(SCRATCH_DB, &db) : open_database(SCRATCH_DB, &db);
+    if (rc != SQLITE_OK) {
+        close_database(db);
+        return 0;
+    }
+    int lessons = lesson_count(db);
+    times->startup = elapsed_seconds(&start);
+    if (lessons == 0) lessons = 1;
+
+    // Each query read to the end with every column fetched, like the menu
+    for (int q = 0; q < QUERY_COUNT; q++) {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db, queries[q].sql, -1, &stmt, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Query failed: %s\n", sqlite3_errmsg(db));
+            close_database(db);
+            return 0;
+        }
+
+        size_t bytes = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int r = 0; r < rounds; r++) {
+            sqlite3_bind_text(stmt, 1, "%pointers%", -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, 1 + r % lessons);
+            sqlite3_bind_text(stmt, 3, category, -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                bytes += (size_t)sqlite3_column_bytes(stmt, 4);
+            }
+            sqlite3_reset(stmt);
+        }
+        times->query[q] = elapsed_seconds(&start) / rounds;
+        sqlite3_finalize(stmt);
+        if (bytes == 0 && q == 0) fprintf(stderr, "Warning: the lessons table is empty.\n");
+    }
+
+    // Autocommit writes: durable in the file, journaled in memory mode
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "UPDATE lessons SET timestamp = ? WHERE id = ?;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        close_database(db);
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; r++) {
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)time(NULL) + r);
+        sqlite3_bind_int(stmt, 2, 1 + r % lessons);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    times->write = elapsed_seconds(&start) / rounds;
+    sqlite3_finalize(stmt);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    close_database(db);
+    times->flush = elapsed_seconds(&start);
+    return 1;
+}
+
+// ============================================================================
+// COLD SCANS
+// ============================================================================
+
+// Evict the scratch file from the page cache so the next read goes to disk
+static int drop_cache(void) {
+    int fd = open(SCRATCH_DB, O_RDONLY);
+    if (fd < 0) return 0;
+    fdatasync(fd);
+    int ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+}
+
+static double time_query(sqlite3 *db, const char *sql) {
+    sqlite3_stmt *stmt;
+    struct timespec start;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return -1.0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sqlite3_bind_text(stmt, 1, "%pointers%", -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {}
+    double seconds = elapsed_seconds(&start);
+    sqlite3_finalize(stmt);
+    return seconds;
+}
+
+// The full-table queries with the default VFS and the io_uring VFS, each
+// once on a dropped page cache and once warm
+static int cold_scan(int extra_lessons) {
+    char category[128];
+    remove_scratch();
+    if (!make_scratch(extra_lessons, category, sizeof(category))) {
+        remove_scratch();
+        return 1;
+    }
+
+    const char *modes[] = { "default", URING_VFS_NAME };
+    double times[2][2][2];  // [vfs][query][cold, warm]
+    int dropped = 1;
+
+    for (int m = 0; m < 2; m++) {
+        setenv(URING_ENV, m ? "1" : "0", 1);
+        for (int q = 0; q < 2; q++) {
+            dropped &= drop_cache();
+
+            sqlite3 *db;
+            if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+                close_database(db);
+                remove_scratch();
+                return 1;
+            }
+            times[m][q][0] = time_query(db, queries[q].sql);
+            times[m][q][1] = time_query(db, queries[q].sql);
+            close_database(db);
+        }
+    }
+
+    struct stat info;
+    double mb = stat(SCRATCH_DB, &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0.0;
+    remove_scratch();
+
+    printf("=== Cold Scans (%.1f MB, +%d lessons) ===\n", mb, extra_lessons);
+    printf("  %-16s %-8s %12s %12s %10s\n", "", "VFS", "cold (ms)", "warm (ms)", "cold MB/s");
+    for (int q = 0; q < 2; q++) {
+        for (int m = 0; m < 2; m++) {
+            double cold = times[m][q][0];
+            printf("  %-16s %-8s %12.2f %12.2f %10.1f\n", m ? "" : queries[q].name, modes[m],
+                   cold * 1e3, times[m][q][1] * 1e3, cold > 0 ? mb / cold : 0.0);
+        }
+    }
+
+    UringStats stats;
+    uring_stats(&stats);
+    if (uring_vfs_name() == NULL) {
+        printf("io_uring is not available here; both rows used the default VFS.\n");
+    } else {
+        printf("io_uring: %lld read-ahead windows, %lld reads served from them, "
+               "%lld single reads, %lld passed to the unix VFS\n",
+               stats.windows, stats.window_hits, stats.uring_reads, stats.fallback_reads);
+    }
+    if (!dropped) printf("Note: the page cache could not be dropped; cold times are warm.\n");
+    return 0;
+}
+
+// ============================================================================
+// METADATA SCANS
+// ============================================================================
+
+// Metadata-only queries of test_db and the db_manager listings; %s is the
+// table they run against
+static const BenchQuery metadata_queries[] = {
+    { "count",         "SELECT COUNT(*) FROM %s;" },
+    { "by category",   "SELECT category, COUNT(*) FROM %s GROUP BY category ORDER BY category;" },
+    { "by difficulty", "SELECT difficulty, COUNT(*) FROM %s GROUP BY difficulty ORDER BY difficulty;" },
+    { "listing",       "SELECT id, topic, category, difficulty, timestamp FROM %s "
+                       "ORDER BY category, topic;" },
+};
+
+#define METADATA_QUERY_COUNT ((int)(sizeof(metadata_queries) / sizeof(metadata_queries[0])))
+
+// The same lessons twice: in lessons + lesson_content, and in one table
+// laid out like lessons before the split, with content inline
+static int make_partition_scratch(int lessons) {
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) return 0;
+
+    const char *sql[] = {
+        "CREATE TABLE inline_lessons (id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "topic TEXT NOT NULL, category TEXT NOT NULL, difficulty INTEGER NOT NULL, "
+        "content TEXT NOT NULL, timestamp INTEGER NOT NULL, content_hash INTEGER);",
+        "INSERT INTO lessons (topic, category, difficulty, timestamp) VALUES (?1, ?2, ?3, ?5);",
+        "INSERT INTO lesson_content (lesson_id, content) VALUES (last_insert_rowid(), ?4);",
+        "INSERT INTO inline_lessons (topic, category, difficulty, content, timestamp) "
+        "VALUES (?1, ?2, ?3, ?4, ?5);",
+    };
+    sqlite3_stmt *stmt[3] = { NULL, NULL, NULL };
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) rc = sqlite3_exec(db, sql[0], NULL, NULL, NULL);
+    for (int s = 0; rc == SQLITE_OK && s < 3; s++) {
+        rc = sqlite3_prepare_v2(db, sql[s + 1], -1, &stmt[s], NULL);
+    }
+
+    // Bodies of 2-4 KB, like the seeded lessons: each spills into overflow pages
+    char content[4096];
+    for (int i = 0; rc == SQLITE_OK && i < lessons; i++) {
+        char topic[64];
+        snprintf(topic, sizeof(topic), "Partition lesson %d", i);
+        int length = snprintf(content, sizeof(content), "Synthetic lesson %d. ", i);
+        int target = 2048 + (i * 37) % 2048;
+        while (length < target) {
+            length += snprintf(content + length, sizeof(content) - length,
+                               "Loops, arrays, pointers and buffers, explained once more. ");
+        }
+        content[target < (int)sizeof(content) ? target : (int)sizeof(content) - 1] = '\0';
+
+        for (int s = 0; s < 3; s++) {
+            sqlite3_bind_text(stmt[s], 1, topic, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt[s], 2, i % 7 ? "Synthetic" : "Benchmarks", -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt[s], 3, DIFFICULTY_BEGINNER + i % 4);
+            sqlite3_bind_text(stmt[s], 4, content, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt[s], 5, (sqlite3_int64)time(NULL));
+            if (sqlite3_step(stmt[s]) != SQLITE_DONE) rc = SQLITE_ERROR;
+            sqlite3_reset(stmt[s]);
+        }
+    }
+    for (int s = 0; s < 3; s++) sqlite3_finalize(stmt[s]);
+    sqlite3_exec(db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+
+    // Everything into the main file, so a dropped cache means a cold read
+    if (rc == SQLITE_OK) rc = sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot build the scratch database: %s\n", sqlite3_errmsg(db));
+    close_database(db);
+    return rc == SQLITE_OK;
+}
+
+// Time each metadata query against the inline layout and the split one,
+// once on a dropped page cache and once warm
+static int partition_scan(int lessons) {
+    remove_scratch();
+    if (!make_partition_scratch(lessons)) {
+        remove_scratch();
+        return 1;
+    }
+
+    const char *tables[] = { "inline_lessons", "lessons" };
+    double times[METADATA_QUERY_COUNT][2][2];  // [query][table][cold, warm]
+    int dropped = 1;
+
+    for (int q = 0; q < METADATA_QUERY_COUNT; q++) {
+        for (int t = 0; t < 2; t++) {
+            char sql[256];
+            snprintf(sql, sizeof(sql), metadata_queries[q].sql, tables[t]);
+            dropped &= drop_cache();
+
+            sqlite3 *db;
+            if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+                close_database(db);
+                remove_scratch();
+                return 1;
+            }
+            times[q][t][0] = time_query(db, sql);
+            times[q][t][1] = time_query(db, sql);
+            close_database(db);
+        }
+    }
+
+    struct stat info;
+    double mb = stat(SCRATCH_DB, &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0.0;
+    remove_scratch();
+
+    printf("=== Metadata Scans, Content Inline vs Split (%d lessons, %.1f MB) ===\n", lessons, mb);
+    printf("  %-16s %13s %13s %13s %13s %8s\n", "", "inline cold", "split cold",
+           "inline warm", "split warm", "speedup");
+    for (int q = 0; q < METADATA_QUERY_COUNT; q++) {
+        double inline_cold = times[q][0][0], split_cold = times[q][1][0];
+        printf("  %-16s %10.2f ms %10.2f ms %10.2f ms %10.2f ms %7.1fx\n", metadata_queries[q].name,
+               inline_cold * 1e3, split_cold * 1e3, times[q][0][1] * 1e3, times[q][1][1] * 1e3,
+               split_cold > 0 ? inline_cold / split_cold : 0.0);
+    }
+    printf("(speedup: inline cold / split cold)\n");
+    if (!dropped) printf("Note: the page cache could not be dropped; cold times are warm.\n");
+    return 0;
+}
+
+// ============================================================================
+// FUZZY SEARCH
+// ============================================================================
+
+#define FUZZY_QUERIES 1000
+#define FUZZY_LIKE_QUERIES 5
+#define FUZZY_RESULTS 10
+#define FUZZY_VOCABULARY 20000
+#define FUZZY_WORDS 150
+
+static unsigned fuzzy_seed = 2024;
+
+static unsigned fuzzy_random(void) {
+    fuzzy_seed = fuzzy_seed * 1103515245u + 12345u;
+    return fuzzy_seed >> 8;
+}
+
+// A made-up word for vocabulary entry n: 3 or 4 syllables, spread out
+// so that most words are more than one edit from each other
+static void fuzzy_word(int n, char *word) {
+    static const char consonants[] = "bcdfghklmnprstvz";
+    static const char vowels[] = "aeiou";
+    int length = 0;
+    unsigned x = (unsigned)n * 2654435761u % (80u * 80u * 80u * 80u);
+    if (x < 80u * 80u * 80u) x += 80u * 80u * 80u;
+    while (x > 0) {
+        word[length++] = consonants[x % 16];
+        x /= 16;
+        word[length++] = vowels[x % 5];
+        x /= 5;
+    }
+    word[length] = '\0';
+}
+
+// Word w of lesson i, the same every time
+static int lesson_word(int i, int w) {
+    unsigned x = (unsigned)i * 2654435761u ^ (unsigned)w * 40503u;
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+    // Skewed towards the low (common) end of the vocabulary
+    unsigned r = x % FUZZY_VOCABULARY;
+    return (int)((unsigned long long)r * r / FUZZY_VOCABULARY);
+}
+
+static int make_fuzzy_scratch(int lessons) {
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) return 0;
+
+    sqlite3_stmt *lesson = NULL, *content = NULL;
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lessons (id, topic, category, difficulty, timestamp) "
+                                    "VALUES (?, ?, 'Synthetic', 1, ?);", -1, &lesson, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lesson_content (lesson_id, content) VALUES (?, ?);",
+                                -1, &content, NULL);
+    }
+
+    char text[FUZZY_WORDS * 16], word[16];
+    for (int i = 1; rc == SQLITE_OK && i <= lessons; i++) {
+        int length = 0;
+        for (int w = 0; w < FUZZY_WORDS; w++) {
+            fuzzy_word(lesson_word(i, w), word);
+            length += snprintf(text + length, sizeof(text) - length, "%s ", word);
+        }
+        char topic[64];
+        snprintf(topic, sizeof(topic), "Fuzzy lesson %d", i);
+
+        sqlite3_bind_int(lesson, 1, i);
+        sqlite3_bind_text(lesson, 2, topic, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(lesson, 3, (sqlite3_int64)time(NULL));
+        sqlite3_bind_int(content, 1, i);
+        sqlite3_bind_text(content, 2, text, length, SQLITE_TRANSIENT);
+        if (sqlite3_step(lesson) != SQLITE_DONE || sqlite3_step(content) != SQLITE_DONE) rc = SQLITE_ERROR;
+        sqlite3_reset(lesson);
+        sqlite3_reset(content);
+    }
+    sqlite3_finalize(lesson);
+    sqlite3_finalize(content);
+    sqlite3_exec(db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot build the scratch database: %s\n", sqlite3_errmsg(db));
+    close_database(db);
+    return rc == SQLITE_OK;
+}
+
+// Two rarer words of a lesson, each with one letter replaced
+static int typo_query(int lesson_id, char *query, size_t size) {
+    char first[16], second[16];
+    int a = fuzzy_random() % FUZZY_WORDS, b = fuzzy_random() % FUZZY_WORDS;
+    for (int tries = 0; tries < 8 && lesson_word(lesson_id, a) < FUZZY_VOCABULARY / 4; tries++) {
+        a = fuzzy_random() % FUZZY_WORDS;
+    }
+    for (int tries = 0; tries < 8 && lesson_word(lesson_id, b) < FUZZY_VOCABULARY / 4; tries++) {
+        b = fuzzy_random() % FUZZY_WORDS;
+    }
+    fuzzy_word(lesson_word(lesson_id, a), first);
+    fuzzy_word(lesson_word(lesson_id, b), second);
+    first[fuzzy_random() % strlen(first)] = 'x';
+    second[fuzzy_random() % strlen(second)] = 'q';
+    return snprintf(query, size, "%s %s", first, second);
+}
+
+static int compare_seconds(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Misspelled two-word queries through the trigram index, and through the
+// LIKE search db_manager ran before it
+static int fuzzy_search_bench(int lessons) {
+    remove_scratch();
+    if (!make_fuzzy_scratch(lessons)) {
+        remove_scratch();
+        return 1;
+    }
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+        close_database(db);
+        remove_scratch();
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SearchIndex *index = search_open(db);
+    double build = elapsed_seconds(&start);
+    if (index == NULL) {
+        close_database(db);
+        remove_scratch();
+        return 1;
+    }
+    SearchStats stats;
+    search_stats(index, &stats);
+
+    double *latency = malloc(FUZZY_QUERIES * sizeof(double));
+    double total = 0.0;
+    int top1 = 0, top10 = 0;
+    for (int q = 0; latency && q < FUZZY_QUERIES; q++) {
+        int lesson_id = 1 + (int)(fuzzy_random() % lessons);
+        char query[64];
+        typo_query(lesson_id, query, sizeof(query));
+
+        SearchMatch matches[FUZZY_RESULTS];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int found = search_fuzzy(index, query, FUZZY_RESULTS, matches, NULL, 0);
+        latency[q] = elapsed_seconds(&start);
+        total += latency[q];
+
+        for (int i = 0; i < found; i++) {
+            if (matches[i].lesson_id != lesson_id) continue;
+            top1 += i == 0;
+            top10++;
+        }
+    }
+
+    // A freshly edited lesson is reindexed on its own
+    sqlite3_exec(db, "UPDATE lesson_content SET content = content || ' refreshed' WHERE lesson_id = 1;"
+                     "UPDATE lessons SET timestamp = timestamp + 1 WHERE id = 1;", NULL, NULL, NULL);
+    search_refresh(index);
+    SearchStats refreshed;
+    search_stats(index, &refreshed);
+
+    sqlite3_stmt *stmt;
+    double like_total = 0.0;
+    int like_rows = 0;
+    const char *like_sql = "SELECT id FROM lessons l WHERE topic LIKE ?1 OR category LIKE ?1 OR EXISTS ("
+                           "SELECT 1 FROM lesson_content c WHERE c.lesson_id = l.id AND c.content LIKE ?1);";
+    if (sqlite3_prepare_v2(db, like_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        for (int q = 0; q < FUZZY_LIKE_QUERIES; q++) {
+            char query[64], pattern[80];
+            typo_query(1 + (int)(fuzzy_random() % lessons), query, sizeof(query));
+            snprintf(pattern, sizeof(pattern), "%%%s%%", query);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            sqlite3_bind_text(stmt, 1, pattern, -1, SQLITE_TRANSIENT);
+            while (sqlite3_step(stmt) == SQLITE_ROW) like_rows++;
+            sqlite3_reset(stmt);
+            like_total += elapsed_seconds(&start);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    search_close(index);
+    close_database(db);
+    remove_scratch();
+    if (latency == NULL) return 1;
+
+    qsort(latency, FUZZY_QUERIES, sizeof(double), compare_seconds);
+    printf("=== Typo-Tolerant Search (%d lessons of %d words, %d-word vocabulary) ===\n",
+           lessons, FUZZY_WORDS, stats.words);
+    printf("  index build      %10.2f s\n", build);
+    printf("  fuzzy query      %10.1f us avg, %.1f us p50, %.1f us p99 (%d queries)\n",
+           total / FUZZY_QUERIES * 1e6, latency[FUZZY_QUERIES / 2] * 1e6,
+           latency[FUZZY_QUERIES * 99 / 100] * 1e6, FUZZY_QUERIES);
+    printf("  source lesson    %10.1f%% first, %.1f%% in top %d\n", 100.0 * top1 / FUZZY_QUERIES,
+           100.0 * top10 / FUZZY_QUERIES, FUZZY_RESULTS);
+    printf("  refresh, 1 edit  %10.2f ms (%d reindexed)\n", refreshed.refresh_seconds * 1e3,
+           refreshed.reindexed);
+    printf("  LIKE search      %10.1f ms avg, %d rows (%d queries)\n",
+           like_total / FUZZY_LIKE_QUERIES * 1e3, like_rows, FUZZY_LIKE_QUERIES);
+    free(latency);
+    return 0;
+}
+
+// ============================================================================
+// COMPLETION
+// ============================================================================
+
+#define COMPLETE_QUERIES 10000
+#define COMPLETE_LIKE_QUERIES 20
+#define COMPLETE_RESULTS 5
+#define COMPLETE_CATEGORIES 40
+
+// Topics repeat, common ones far more often, so popularity matters
+static void complete_topic(int i, char *topic, size_t size) {
+    char first[16], second[16];
+    int name = lesson_word(i, 0) * 4 + lesson_word(i, 1) % 4;
+    fuzzy_word(name, first);
+    fuzzy_word(name + 4 * FUZZY_VOCABULARY, second);
+    snprintf(topic, size, "%c%s %s", first[0] - 'a' + 'A', first + 1, second);
+}
+
+static int make_complete_scratch(int lessons) {
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) return 0;
+
+    sqlite3_stmt *stmt = NULL;
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lessons (id, topic, category, difficulty, timestamp) "
+                                    "VALUES (?, ?, ?, 1, 0);", -1, &stmt, NULL);
+    }
+    for (int i = 1; rc == SQLITE_OK && i <= lessons; i++) {
+        char topic[64], category[32], word[16];
+        complete_topic(i, topic, sizeof(topic));
+        fuzzy_word(lesson_word(i, 4) % COMPLETE_CATEGORIES, word);
+        snprintf(category, sizeof(category), "%c%s", word[0] - 'a' + 'A', word + 1);
+
+        sqlite3_bind_int(stmt, 1, i);
+        sqlite3_bind_text(stmt, 2, topic, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, category, -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE) rc = SQLITE_ERROR;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot build the scratch database: %s\n", sqlite3_errmsg(db));
+    close_database(db);
+    return rc == SQLITE_OK;
+}
+
+// The first 1 to 4 characters of some lesson's topic
+static void topic_prefix(int lessons, char *prefix) {
+    char topic[64];
+    complete_topic(1 + (int)(fuzzy_random() % lessons), topic, sizeof(topic));
+    int length = 1 + (int)(fuzzy_random() % 4);
+    memcpy(prefix, topic, length);
+    prefix[length] = '\0';
+}
+
+// Top topics by prefix from the radix tree, and the same through LIKE
+static int completion_bench(int lessons) {
+    remove_scratch();
+    if (!make_complete_scratch(lessons)) {
+        remove_scratch();
+        return 1;
+    }
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+        close_database(db);
+        remove_scratch();
+        return 1;
+    }
+
+    CompleteIndex *index = complete_open(db);
+    if (index == NULL) {
+        close_database(db);
+        remove_scratch();
+        return 1;
+    }
+    CompleteStats stats;
+    complete_stats(index, &stats);
+    double build = stats.refresh_seconds;
+
+    double *latency = malloc(COMPLETE_QUERIES * sizeof(double));
+    double total = 0.0;
+    long results = 0;
+    struct timespec start;
+    for (int q = 0; latency && q < COMPLETE_QUERIES; q++) {
+        char prefix[8];
+        topic_prefix(lessons, prefix);
+        Completion completions[COMPLETE_RESULTS];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        results += complete_prefix(index, COMPLETE_TOPIC, prefix, COMPLETE_RESULTS, completions);
+        latency[q] = elapsed_seconds(&start);
+        total += latency[q];
+    }
+
+    // A lesson added through this connection reaches the tree by the hook
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sqlite3_exec(db, "INSERT INTO lessons (topic, category, difficulty, timestamp) "
+                     "VALUES ('Zz new topic', 'Zz', 1, 0);", NULL, NULL, NULL);
+    double insert = elapsed_seconds(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    complete_refresh(index);
+    double refresh = elapsed_seconds(&start);
+    Completion added;
+    int found = complete_prefix(index, COMPLETE_TOPIC, "zz n", 1, &added) == 1 &&
+                strcmp(added.text, "Zz new topic") == 0;
+
+    sqlite3_stmt *stmt;
+    double like_total = 0.0;
+    const char *like_sql = "SELECT min(topic), COUNT(*) AS uses FROM lessons WHERE topic LIKE ?1 || '%' "
+                           "GROUP BY lower(topic) ORDER BY uses DESC, 1 LIMIT 5;";
+    if (sqlite3_prepare_v2(db, like_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        for (int q = 0; q < COMPLETE_LIKE_QUERIES; q++) {
+            char prefix[8];
+            topic_prefix(lessons, prefix);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_TRANSIENT);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {}
+            sqlite3_reset(stmt);
+            like_total += elapsed_seconds(&start);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    complete_stats(index, &stats);
+    complete_close(index);
+    close_database(db);
+    remove_scratch();
+    if (latency == NULL) return 1;
+
+    qsort(latency, COMPLETE_QUERIES, sizeof(double), compare_seconds);
+    printf("=== Topic Completion (%d lessons, %d topics, %d categories) ===\n",
+           lessons, stats.topics, stats.categories);
+    printf("  index build      %10.2f ms (%d radix nodes)\n", build * 1e3, stats.nodes);
+    printf("  top %d by prefix  %10.2f us avg, %.2f us p50, %.2f us p99 (%.1f results)\n", COMPLETE_RESULTS,
+           total / COMPLETE_QUERIES * 1e6, latency[COMPLETE_QUERIES / 2] * 1e6,
+           latency[COMPLETE_QUERIES * 99 / 100] * 1e6, (double)results / COMPLETE_QUERIES);
+    printf("  insert + refresh %10.1f us + %.1f us (%s)\n", insert * 1e6, refresh * 1e6,
+           found ? "completed" : "MISSING");
+    printf("  LIKE prefix      %10.2f ms avg (%d queries)\n",
+           like_total / COMPLETE_LIKE_QUERIES * 1e3, COMPLETE_LIKE_QUERIES);
+    free(latency);
+    return found ? 0 : 1;
+}
+
+static void print_row(const char *name, double file, double memory) {
+    printf("  %-16s %12.1f %12.1f %9.1fx\n", name, file * 1e6, memory * 1e6,
+           memory > 0 ? file / memory : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf("Usage: %s [rounds] [extra_lessons]\n", argv[0]);
+        printf("       %s --scan [extra_lessons]\n", argv[0]);
+        printf("       %s --partition [lessons]\n", argv[0]);
+        printf("       %s --fuzzy [lessons]\n", argv[0]);
+        printf("       %s --complete [lessons]\n", argv[0]);
+        printf("  rounds         Times each query and write is run (default: %d)\n",
+               DEFAULT_ROUNDS);
+        printf("  extra_lessons  Synthetic lessons added to the scratch copy (default: %d)\n",
+               DEFAULT_EXTRA_LESSONS);
+        printf("  --scan         Time cold full-table scans with the default and io_uring\n"
+               "                 VFS instead (default: +%d lessons)\n", DEFAULT_SCAN_LESSONS);
+        printf("  --partition    Time metadata scans with lesson content inline and split\n"
+               "                 into lesson_content (default: %d lessons)\n",
+               DEFAULT_PARTITION_LESSONS);
+        printf("  --fuzzy        Time misspelled searches through the trigram index and LIKE\n"
+               "                 (default: %d lessons)\n", DEFAULT_FUZZY_LESSONS);
+        printf("  --complete     Time topic completion through the radix tree and LIKE\n"
+               "                 (default: %d lessons)\n", DEFAULT_COMPLETE_LESSONS);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--scan") == 0) {
+        int extra_lessons = argc > 2 ? atoi(argv[2]) : DEFAULT_SCAN_LESSONS;
+        return cold_scan(extra_lessons < 0 ? 0 : extra_lessons);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--partition") == 0) {
+        int lessons = argc > 2 ? atoi(argv[2]) : DEFAULT_PARTITION_LESSONS;
+        return partition_scan(lessons < 1 ? 1 : lessons);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--fuzzy") == 0) {
+        int lessons = argc > 2 ? atoi(argv[2]) : DEFAULT_FUZZY_LESSONS;
+        return fuzzy_search_bench(lessons < 1 ? 1 : lessons);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--complete") == 0) {
+        int lessons = argc > 2 ? atoi(argv[2]) : DEFAULT_COMPLETE_LESSONS;
+        return completion_bench(lessons < 1 ? 1 : lessons);
+    }
+
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    int extra_lessons = argc > 2 ? atoi(argv[2]) : DEFAULT_EXTRA_LESSONS;
+    if (rounds < 1) rounds = 1;
+    if (extra_lessons < 0) extra_lessons = 0;
+
+    char category[128];
+    remove_scratch();
+    if (!make_scratch(extra_lessons, category, sizeof(category))) {
+        fprintf(stderr, "Cannot copy %s to %s.\n", database_path(), SCRATCH_DB);
+        remove_scratch();
+        return 1;
+    }
+
+    BenchTimes file_times = {0}, memory_times = {0};
+    int ok = run_mode(0, rounds, category, &file_times) &&
+             run_mode(1, rounds, category, &memory_times);
+
+    // Memory mode must have written its updates back
+    if (ok) {
+        sqlite3 *db;
+        ok = open_database(SCRATCH_DB, &db) == SQLITE_OK;
+        sqlite3_stmt *stmt;
+        if (ok && sqlite3_prepare_v2(db, "SELECT generation FROM memory_flush_state;",
+                                     -1, &stmt, NULL) == SQLITE_OK) {
+            ok = sqlite3_step(stmt) == SQLITE_ROW;
+            sqlite3_finalize(stmt);
+        } else {
+            ok = 0;
+        }
+        sqlite3_close(db);
+        if (!ok) fprintf(stderr, "Memory mode did not flush its writes.\n");
+    }
+    remove_scratch();
+    if (!ok) return 1;
+
+    printf("=== File vs In-Memory Mode (%d rounds, +%d lessons) ===\n", rounds, extra_lessons);
+    printf("  %-16s %12s %12s %10s\n", "", "file (us)", "memory (us)", "speedup");
+    print_row("startup", file_times.startup, memory_times.startup);
+    for (int q = 0; q < QUERY_COUNT; q++) {
+        print_row(queries[q].name, file_times.query[q], memory_times.query[q]);
+    }
+    print_row("write", file_times.write, memory_times.write);
+    print_row("flush + close", file_times.flush, memory_times.flush);
+    return 0;
+}
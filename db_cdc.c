@@ -0,0 +1,490 @@
+#define _GNU_SOURCE  // F_OFD_SETLKW
+
+// The pre-update hook and changeset iterator are only declared when these are defined
+#define SQLITE_ENABLE_PREUPDATE_HOOK 1
+#define SQLITE_ENABLE_SESSION 1
+
+#include "db_cdc.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CDC_MAX_COLUMNS 16
+
+// Bytes read per step when scanning the log backwards
+#define TAIL_CHUNK 8192
+
+// What SQLite's own WAL hook checkpoints at; installing ours replaces it
+#define AUTOCHECKPOINT_PAGES 1000
+
+typedef struct {
+    const char *name;
+    int column_count;
+    char columns[CDC_MAX_COLUMNS][64];
+} CdcTable;
+
+// Simple growable string used for the pending transaction batch
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} CdcBuffer;
+
+struct CdcLog {
+    sqlite3 *db;
+    FILE *file;
+    CdcTable tables[5];
+    int table_count;
+    CdcBuffer pending;      // Change bodies of the open transaction, one per line
+    int pending_count;
+    int failed;             // Out of memory while buffering; batch is dropped
+    int uses_preupdate;     // Cleared when a session takes over the hook
+    int after_commit;       // WAL mode: write batches from the WAL hook
+    int committing;         // Batch waiting for its commit to finish
+};
+
+static void finish_commit(CdcLog *log);
+
+static const char *tracked_tables[] = {
+    "lessons", "lesson_content", "learning_progress", "game_lessons", "game_lesson_content"
+};
+
+static void buffer_append(CdcLog *log, const char *text, size_t length) {
+    CdcBuffer *buf = &log->pending;
+    if (log->failed) return;
+
+    if (buf->length + length + 1 > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity * 2 : 4096;
+        while (capacity < buf->length + length + 1) capacity *= 2;
+
+        char *data = realloc(buf->data, capacity);
+        if (data == NULL) {
+            log->failed = 1;
+            return;
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    memcpy(buf->data + buf->length, text, length);
+    buf->length += length;
+    buf->data[buf->length] = '\0';
+}
+
+static void buffer_append_str(CdcLog *log, const char *text) {
+    buffer_append(log, text, strlen(text));
+}
+
+static void buffer_append_json_string(CdcLog *log, const unsigned char *text, int length) {
+    char escape[8];
+    buffer_append(log, "\"", 1);
+
+    int start = 0;
+    for (int i = 0; i < length; i++) {
+        unsigned char c = text[i];
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+
+        buffer_append(log, (const char *)text + start, i - start);
+        switch (c) {
+            case '"':  buffer_append_str(log, "\\\""); break;
+            case '\\': buffer_append_str(log, "\\\\"); break;
+            case '\n': buffer_append_str(log, "\\n"); break;
+            case '\t': buffer_append_str(log, "\\t"); break;
+            case '\r': buffer_append_str(log, "\\r"); break;
+            default:
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                buffer_append_str(log, escape);
+        }
+        start = i + 1;
+    }
+
+    buffer_append(log, (const char *)text + start, length - start);
+    buffer_append(log, "\"", 1);
+}
+
+static void buffer_append_value(CdcLog *log, sqlite3_value *value) {
+    char number[64];
+
+    switch (sqlite3_value_type(value)) {
+        case SQLITE_INTEGER:
+            snprintf(number, sizeof(number), "%lld", sqlite3_value_int64(value));
+            buffer_append_str(log, number);
+            break;
+        case SQLITE_FLOAT:
+            snprintf(number, sizeof(number), "%.17g", sqlite3_value_double(value));
+            buffer_append_str(log, number);
+            break;
+        case SQLITE_TEXT:
+            buffer_append_json_string(log, sqlite3_value_text(value), sqlite3_value_bytes(value));
+            break;
+        case SQLITE_BLOB: {
+            // Blobs are logged as a hex string
+            const unsigned char *bytes = sqlite3_value_blob(value);
+            int length = sqlite3_value_bytes(value);
+            buffer_append(log, "\"", 1);
+            for (int i = 0; i < length; i++) {
+                snprintf(number, sizeof(number), "%02x", bytes[i]);
+                buffer_append(log, number, 2);
+            }
+            buffer_append(log, "\"", 1);
+            break;
+        }
+        default:
+            buffer_append_str(log, "null");
+    }
+}
+
+static const CdcTable* find_table(const CdcLog *log, const char *name) {
+    for (int i = 0; i < log->table_count; i++) {
+        if (strcmp(log->tables[i].name, name) == 0) return &log->tables[i];
+    }
+    return NULL;
+}
+
+static void load_table_columns(CdcLog *log, const char *name) {
+    char sql[128];
+    snprintf(sql, sizeof(sql), "PRAGMA table_info(%s);", name);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(log->db, sql, -1, &stmt, NULL) != SQLITE_OK) return;
+
+    CdcTable *table = &log->tables[log->table_count];
+    table->name = name;
+    table->column_count = 0;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW && table->column_count < CDC_MAX_COLUMNS) {
+        const unsigned char *column = sqlite3_column_text(stmt, 1);
+        snprintf(table->columns[table->column_count++], sizeof(table->columns[0]), "%s", column);
+    }
+    sqlite3_finalize(stmt);
+
+    if (table->column_count > 0) log->table_count++;
+}
+
+static void append_change(CdcLog *log, const CdcTable *table, const char *op_name,
+                          sqlite3_int64 rowid, sqlite3_int64 old_rowid,
+                          sqlite3_value **values, int count) {
+    char header[160];
+    snprintf(header, sizeof(header), "\"op\":\"%s\",\"table\":\"%s\",\"rowid\":%lld",
+             op_name, table->name, rowid);
+    buffer_append_str(log, header);
+
+    if (old_rowid != rowid) {
+        snprintf(header, sizeof(header), ",\"old_rowid\":%lld", old_rowid);
+        buffer_append_str(log, header);
+    }
+
+    // Deletes carry the old row so consumers can evict by any column
+    buffer_append_str(log, ",\"row\":{");
+    for (int i = 0; i < count && i < table->column_count; i++) {
+        if (i > 0) buffer_append(log, ",", 1);
+        buffer_append_json_string(log, (const unsigned char *)table->columns[i],
+                                  (int)strlen(table->columns[i]));
+        buffer_append(log, ":", 1);
+        if (values[i]) {
+            buffer_append_value(log, values[i]);
+        } else {
+            buffer_append_str(log, "null");
+        }
+    }
+    buffer_append_str(log, "}}\n");
+    log->pending_count++;
+}
+
+static const char* op_string(int op) {
+    return op == SQLITE_INSERT ? "INSERT" : op == SQLITE_DELETE ? "DELETE" : "UPDATE";
+}
+
+static void preupdate_callback(void *user_data, sqlite3 *db, int op,
+                               const char *db_name, const char *table_name,
+                               sqlite3_int64 old_rowid, sqlite3_int64 new_rowid) {
+    CdcLog *log = user_data;
+
+    if (strcmp(db_name, "main") != 0) return;
+    finish_commit(log);
+    const CdcTable *table = find_table(log, table_name);
+    if (table == NULL) return;
+
+    sqlite3_value *values[CDC_MAX_COLUMNS] = {0};
+    int count = sqlite3_preupdate_count(db);
+    if (count > CDC_MAX_COLUMNS) count = CDC_MAX_COLUMNS;
+
+    for (int i = 0; i < count; i++) {
+        if (op == SQLITE_DELETE) {
+            sqlite3_preupdate_old(db, i, &values[i]);
+        } else {
+            sqlite3_preupdate_new(db, i, &values[i]);
+        }
+    }
+
+    if (op == SQLITE_INSERT) old_rowid = new_rowid;
+    if (op == SQLITE_DELETE) new_rowid = old_rowid;
+    append_change(log, table, op_string(op), new_rowid, old_rowid, values, count);
+}
+
+void cdc_release_preupdate_hook(CdcLog *log) {
+    if (log == NULL || !log->uses_preupdate) return;
+    sqlite3_preupdate_hook(log->db, NULL, NULL);
+    log->uses_preupdate = 0;
+}
+
+int cdc_log_changeset(CdcLog *log, int size, void *changeset) {
+    if (log == NULL) return SQLITE_OK;
+    finish_commit(log);
+
+    sqlite3_changeset_iter *iter;
+    int rc = sqlite3changeset_start(&iter, size, changeset);
+    if (rc != SQLITE_OK) return rc;
+
+    while (sqlite3changeset_next(iter) == SQLITE_ROW) {
+        const char *table_name;
+        int column_count, op, indirect;
+        sqlite3changeset_op(iter, &table_name, &column_count, &op, &indirect);
+
+        const CdcTable *table = find_table(log, table_name);
+        if (table == NULL) continue;
+        if (column_count > CDC_MAX_COLUMNS) column_count = CDC_MAX_COLUMNS;
+
+        sqlite3_value *values[CDC_MAX_COLUMNS] = {0};
+        sqlite3_value *key = NULL;
+
+        if (op == SQLITE_INSERT) {
+            for (int i = 0; i < column_count; i++) sqlite3changeset_new(iter, i, &values[i]);
+            sqlite3_int64 rowid = sqlite3_value_int64(values[0]);
+            append_change(log, table, "INSERT", rowid, rowid, values, column_count);
+        } else if (op == SQLITE_DELETE) {
+            for (int i = 0; i < column_count; i++) sqlite3changeset_old(iter, i, &values[i]);
+            sqlite3_int64 rowid = sqlite3_value_int64(values[0]);
+            append_change(log, table, "DELETE", rowid, rowid, values, column_count);
+        } else {
+            // Changesets only carry the modified columns of an UPDATE, so the
+            // full row is read back inside the still-open transaction
+            sqlite3changeset_old(iter, 0, &key);
+            sqlite3_int64 old_rowid = sqlite3_value_int64(key);
+            sqlite3_int64 rowid = old_rowid;
+            if (sqlite3changeset_new(iter, 0, &key) == SQLITE_OK && key) {
+                rowid = sqlite3_value_int64(key);
+            }
+
+            char sql[128];
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE rowid = ?;", table->name);
+            sqlite3_stmt *stmt;
+            if (sqlite3_prepare_v2(log->db, sql, -1, &stmt, NULL) != SQLITE_OK) continue;
+            sqlite3_bind_int64(stmt, 1, rowid);
+
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                int count = sqlite3_column_count(stmt);
+                if (count > CDC_MAX_COLUMNS) count = CDC_MAX_COLUMNS;
+                for (int i = 0; i < count; i++) values[i] = sqlite3_column_value(stmt, i);
+                append_change(log, table, "UPDATE", rowid, old_rowid, values, count);
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    return sqlite3changeset_finalize(iter);
+}
+
+static void discard_pending(CdcLog *log) {
+    log->pending.length = 0;
+    log->pending_count = 0;
+    log->failed = 0;
+}
+
+// Writers of one log take turns through a lock on the file, held from
+// the commit hook (under the database write lock, so in commit order)
+// until the batch is written. The lock belongs to this CdcLog's open file,
+// not the process: other connections in the process wait for it too, and
+// closing some other descriptor of the log does not drop it.
+static void lock_log(CdcLog *log, int type) {
+    struct flock lock = { .l_type = type, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0 };
+    while (fcntl(fileno(log->file), F_OFD_SETLKW, &lock) == -1 && errno == EINTR) {}
+}
+
+// Position of the last '\n' before offset, or -1
+static off_t previous_newline(int fd, off_t offset) {
+    char chunk[TAIL_CHUNK];
+    while (offset > 0) {
+        off_t start = offset > TAIL_CHUNK ? offset - TAIL_CHUNK : 0;
+        size_t length = (size_t)(offset - start);
+        if (pread(fd, chunk, length, start) != (ssize_t)length) return -1;
+        for (off_t i = (off_t)length - 1; i >= 0; i--) {
+            if (chunk[i] == '\n') return start + i;
+        }
+        offset = start;
+    }
+    return -1;
+}
+
+// Last seq in the log, from the last complete line that parses; a torn
+// line left by a crash is skipped. *torn is set when the file does not
+// end with a newline. Reads with pread, so fd's offset is left alone.
+static sqlite3_int64 read_last_sequence(int fd, int *torn) {
+    *torn = 0;
+    struct stat info;
+    if (fstat(fd, &info) != 0) return 0;
+
+    off_t size = info.st_size;
+    off_t line_end = previous_newline(fd, size);
+    *torn = line_end != size - 1 && size > 0;
+
+    while (line_end >= 0) {
+        off_t line_start = previous_newline(fd, line_end) + 1;
+        char head[40];
+        size_t length = (size_t)(line_end - line_start) < sizeof(head) - 1 ?
+                        (size_t)(line_end - line_start) : sizeof(head) - 1;
+        ssize_t got = pread(fd, head, length, line_start);
+        head[got > 0 ? got : 0] = '\0';
+
+        // A repaired torn line keeps its head but lost its closing brace
+        char last = '\0';
+        if (line_end > line_start && pread(fd, &last, 1, line_end - 1) != 1) last = '\0';
+
+        long long value;
+        if (last == '}' && sscanf(head, "{\"seq\":%lld", &value) == 1) return value;
+        line_end = line_start - 1;
+    }
+    return 0;
+}
+
+sqlite3_int64 cdc_read_last_sequence(const char *log_path) {
+    int fd = open(log_path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    int torn;
+    sqlite3_int64 seq = read_last_sequence(fd, &torn);
+    close(fd);
+    return seq;
+}
+
+// Append the pending batch, numbered after the last line in the file
+static void write_batch(CdcLog *log) {
+    int torn;
+    sqlite3_int64 seq = read_last_sequence(fileno(log->file), &torn);
+    sqlite3_int64 txn = seq + 1;
+
+    // End a torn line so it stays one unreadable line of its own
+    if (torn) fputc('\n', log->file);
+
+    const char *line = log->pending.data;
+    for (int i = 0; i < log->pending_count; i++) {
+        const char *end = strchr(line, '\n');
+        fprintf(log->file, "{\"seq\":%lld,\"txn\":%lld,%.*s\n",
+                ++seq, txn, (int)(end - line), line);
+        line = end + 1;
+    }
+    fflush(log->file);
+    discard_pending(log);
+}
+
+// A commit that was neither rolled back nor reported by the WAL hook
+// before the connection moved on did succeed
+static void finish_commit(CdcLog *log) {
+    if (!log->committing) return;
+    write_batch(log);
+    lock_log(log, F_UNLCK);
+    log->committing = 0;
+}
+
+static int commit_callback(void *user_data) {
+    CdcLog *log = user_data;
+
+    if (log->pending_count == 0) return 0;
+    if (log->failed) {
+        fprintf(stderr, "CDC: out of memory, dropped %d change(s)\n", log->pending_count);
+        discard_pending(log);
+        return 0;
+    }
+
+    // The commit can still fail here; in WAL mode the batch waits for the
+    // WAL hook, which only runs once it has succeeded
+    lock_log(log, F_WRLCK);
+    if (log->after_commit) {
+        log->committing = 1;
+    } else {
+        write_batch(log);
+        lock_log(log, F_UNLCK);
+    }
+    return 0;
+}
+
+static int wal_callback(void *user_data, sqlite3 *db, const char *db_name, int pages) {
+    finish_commit(user_data);
+    if (pages >= AUTOCHECKPOINT_PAGES) {
+        sqlite3_wal_checkpoint_v2(db, db_name, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    }
+    return SQLITE_OK;
+}
+
+static void rollback_callback(void *user_data) {
+    CdcLog *log = user_data;
+    if (log->committing) {
+        lock_log(log, F_UNLCK);
+        log->committing = 0;
+    }
+    discard_pending(log);
+}
+
+static int in_wal_mode(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    int wal = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *mode = (const char *)sqlite3_column_text(stmt, 0);
+            wal = mode && strcmp(mode, "wal") == 0;
+        }
+        sqlite3_finalize(stmt);
+    }
+    return wal;
+}
+
+CdcLog* cdc_open(sqlite3 *db, const char *log_path) {
+    CdcLog *log = calloc(1, sizeof(CdcLog));
+    if (log == NULL) return NULL;
+
+    log->db = db;
+    log->file = fopen(log_path, "a+");  // Read back for the last seq
+    if (log->file == NULL) {
+        fprintf(stderr, "CDC: cannot open change log %s\n", log_path);
+        free(log);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(tracked_tables) / sizeof(tracked_tables[0]); i++) {
+        load_table_columns(log, tracked_tables[i]);
+    }
+
+    sqlite3_preupdate_hook(db, preupdate_callback, log);
+    log->uses_preupdate = 1;
+    sqlite3_commit_hook(db, commit_callback, log);
+    sqlite3_rollback_hook(db, rollback_callback, log);
+
+    // In-memory connections have no WAL; their commits cannot fail on disk
+    log->after_commit = in_wal_mode(db);
+    if (log->after_commit) sqlite3_wal_hook(db, wal_callback, log);
+    return log;
+}
+
+CdcLog* cdc_open_from_env(sqlite3 *db) {
+    const char *log_path = getenv(CDC_LOG_ENV);
+    if (log_path == NULL || log_path[0] == '\0') return NULL;
+    return cdc_open(db, log_path);
+}
+
+void cdc_close(CdcLog *log) {
+    if (log == NULL) return;
+
+    finish_commit(log);
+    cdc_release_preupdate_hook(log);
+    sqlite3_commit_hook(log->db, NULL, NULL);
+    sqlite3_rollback_hook(log->db, NULL, NULL);
+    if (log->after_commit) sqlite3_wal_autocheckpoint(log->db, AUTOCHECKPOINT_PAGES);
+
+    fclose(log->file);
+    free(log->pending.data);
+    free(log);
+}
@@ -0,0 +1,46 @@
+#ifndef DB_CDC_H
+#define DB_CDC_H
+
+#include "db_common.h"
+
+// Environment variable naming the change log; capture is off when unset
+#define CDC_LOG_ENV "LESSONS_CDC_LOG"
+
+// Change-data-capture log attached to one connection.
+//
+// Every committed INSERT/UPDATE/DELETE on lessons, learning_progress and
+// game_lessons is appended to the log as one JSON object per line:
+//
+//   {"seq":42,"txn":41,"op":"UPDATE","table":"learning_progress","rowid":3,
+//    "row":{"id":3,"lesson_id":2,...}}
+//
+// seq increases by one per change across all writers of the log, and txn is
+// the seq of the first change in the same transaction. A transaction's
+// changes are written in a single batch once its commit has succeeded (from
+// the WAL hook, which takes over SQLite's auto-checkpoint at the same 1000
+// pages) and dropped when it rolls back, so consumers can resume from the
+// last seq they processed. Writers take turns through a lock on the log
+// file, taken in commit order; the next seq follows the last complete line
+// that parses, however long, and a line torn by a crash is ended and skipped.
+typedef struct CdcLog CdcLog;
+
+// Start capturing changes made through db into log_path
+CdcLog* cdc_open(sqlite3 *db, const char *log_path);
+
+// Start capturing if LESSONS_CDC_LOG is set; returns NULL otherwise
+CdcLog* cdc_open_from_env(sqlite3 *db);
+
+// Detach the hooks and close the log file (NULL is ignored)
+void cdc_close(CdcLog *log);
+
+// Stop using the pre-update hook so an sqlite3_session can own it. Changes
+// must then be fed through cdc_log_changeset() before each COMMIT.
+void cdc_release_preupdate_hook(CdcLog *log);
+
+// Queue the changes of a changeset for the current transaction
+int cdc_log_changeset(CdcLog *log, int size, void *changeset);
+
+// Sequence number of the last complete change in the log file (0 when none)
+sqlite3_int64 cdc_read_last_sequence(const char *log_path);
+
+#endif // DB_CDC_H
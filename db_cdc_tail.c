@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_cdc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// How often --follow checks the log for new changes
+#define FOLLOW_INTERVAL_MS 200
+
+// Print every change with seq > after_seq; returns the last seq printed
+static long long print_changes(FILE *file, long long after_seq) {
+    // Lines carry whole rows, so they can be any length
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    long long last_seq = after_seq;
+
+    while ((length = getline(&line, &capacity, file)) > 0) {
+        // A partial line means a writer is mid-batch; re-read it next round
+        if (line[length - 1] != '\n') {
+            fseek(file, -(long)length, SEEK_CUR);
+            break;
+        }
+
+        // A line torn by a crash was ended later without its closing brace
+        if (length < 2 || line[length - 2] != '}') continue;
+
+        long long seq;
+        if (sscanf(line, "{\"seq\":%lld", &seq) != 1 || seq <= after_seq) continue;
+
+        fputs(line, stdout);
+        last_seq = seq;
+    }
+
+    free(line);
+    fflush(stdout);
+    return last_seq;
+}
+
+int main(int argc, char *argv[]) {
+    const char *log_path = getenv(CDC_LOG_ENV);
+    long long after_seq = 0;
+    int follow = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--follow") == 0) {
+            follow = 1;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [after_seq] [--follow]\n", argv[0]);
+            printf("Prints changes from $%s with a sequence number above after_seq.\n",
+                   CDC_LOG_ENV);
+            return 0;
+        } else {
+            after_seq = atoll(argv[i]);
+        }
+    }
+
+    if (log_path == NULL || log_path[0] == '\0') {
+        fprintf(stderr, "Set %s to the change log written by db_manager/learning_game.\n",
+                CDC_LOG_ENV);
+        return 1;
+    }
+
+    FILE *file = fopen(log_path, "r");
+    if (file == NULL && !follow) {
+        fprintf(stderr, "Cannot open change log: %s\n", log_path);
+        return 1;
+    }
+
+    struct timespec interval = { 0, FOLLOW_INTERVAL_MS * 1000000L };
+    do {
+        if (file == NULL) {
+            file = fopen(log_path, "r");
+        }
+        if (file) {
+            after_seq = print_changes(file, after_seq);
+            clearerr(file);
+        }
+        if (follow) nanosleep(&interval, NULL);
+    } while (follow);
+
+    fclose(file);
+    return 0;
+}
@@ -1,15 +1,119 @@
 #include "db_common.h"
+#include "db_memory.h"
+#include "db_uring.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+const char* database_path(void) {
+    const char *path = getenv(DB_FILE_ENV);
+    return (path && *path) ? path : DB_FILE;
+}
+
 int init_database(sqlite3 **db) {
-    int rc = sqlite3_open(DB_FILE, db);
+    if (memory_mode_requested()) return memory_open(database_path(), db);
+    return open_database(database_path(), db);
+}
+
+static int schema_version(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    int version = -1;
+
+    // Read straight from the file header; does not load the schema
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+int open_database(const char *path, sqlite3 **db) {
+    int rc = sqlite3_open_v2(path, db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, uring_vfs_name());
     if (rc != SQLITE_OK) {
         fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(*db));
         return rc;
     }
 
+    // WAL lets readers (backups, the learning game) run alongside a writer;
+    // the busy timeout covers the short windows where locks still collide
+    sqlite3_busy_timeout(*db, BUSY_TIMEOUT_MS);
+
+    // Per connection: without it a -wal file keeps its largest size
+    char limit[64];
+    snprintf(limit, sizeof(limit), "PRAGMA journal_size_limit = %d;", WAL_SIZE_LIMIT_BYTES);
+    sqlite3_exec(*db, limit, NULL, NULL, NULL);
+
+    // Journal mode and tables are persistent, so a file that has been set
+    // up once needs neither on later opens
+    if (schema_version(*db) == SCHEMA_VERSION) return SQLITE_OK;
+
+    // Only takes effect on a file without tables yet; lets the maintenance
+    // jobs hand free pages back in small batches
+    sqlite3_exec(*db, "PRAGMA auto_vacuum=INCREMENTAL;", NULL, NULL, NULL);
+    sqlite3_exec(*db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+
+    rc = sqlite3_exec(*db, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot set up schema: %s\n", sqlite3_errmsg(*db));
+        return rc;
+    }
+
+    rc = create_schema(*db);
+    if (rc == SQLITE_OK) {
+        char sql[64];
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d;", SCHEMA_VERSION);
+        rc = sqlite3_exec(*db, sql, NULL, NULL, NULL);
+    }
+
+    sqlite3_exec(*db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+    return rc;
+}
+
+static int has_column(sqlite3 *db, const char *table, const char *column) {
+    sqlite3_stmt *stmt;
+    int found = 0;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_info(?) WHERE name = ?;",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, column, -1, SQLITE_STATIC);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    return found;
+}
+
+// Copy columns (a comma-separated list, all still in table) into the
+// content table keyed by table's id, then drop them from table. Does
+// nothing once the first column is gone.
+static int move_columns(sqlite3 *db, const char *table, const char *content_table,
+                        const char *columns) {
+    char first[64];
+    snprintf(first, sizeof(first), "%.*s", (int)strcspn(columns, ","), columns);
+    if (!has_column(db, table, first)) return SQLITE_OK;
+
+    char sql[512];
+    char *err_msg = NULL;
+    snprintf(sql, sizeof(sql), "INSERT OR REPLACE INTO %s (lesson_id, %s) SELECT id, %s FROM %s;",
+             content_table, columns, columns, table);
+    int rc = sqlite3_exec(db, sql, NULL, NULL, &err_msg);
+
+    // One ALTER per column; each rewrites the table without it
+    for (const char *column = columns; rc == SQLITE_OK && *column; ) {
+        size_t length = strcspn(column, ",");
+        snprintf(sql, sizeof(sql), "ALTER TABLE %s DROP COLUMN %.*s;", table, (int)length, column);
+        rc = sqlite3_exec(db, sql, NULL, NULL, &err_msg);
+        column += length;
+        column += strspn(column, ", ");
+    }
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (%s upgrade): %s\n", table, err_msg);
+        sqlite3_free(err_msg);
+    }
+    return rc;
+}
+
+int create_schema(sqlite3 *db) {
     // Create lessons table
     const char *sql_create_lessons =
         "CREATE TABLE IF NOT EXISTS lessons ("
@@ -17,10 +121,28 @@ int init_database(sqlite3 **db) {
         "topic TEXT NOT NULL,"
         "category TEXT NOT NULL,"
         "difficulty INTEGER NOT NULL CHECK(difficulty >= 1 AND difficulty <= 4),"
-        "content TEXT NOT NULL,"
-        "timestamp INTEGER NOT NULL"
+        "timestamp INTEGER NOT NULL,"
+        "content_hash INTEGER"
         ");";
 
+    // Lesson bodies live apart from the metadata, so listings and GROUP BY
+    // scans over lessons never read their overflow pages
+    const char *sql_create_lesson_content =
+        "CREATE TABLE IF NOT EXISTS lesson_content ("
+        "lesson_id INTEGER PRIMARY KEY REFERENCES lessons(id),"
+        "content TEXT NOT NULL"
+        ");";
+
+    // Lessons as they looked before the split, for reading
+    const char *sql_create_lessons_full =
+        "CREATE VIEW IF NOT EXISTS lessons_full AS "
+        "SELECT l.id, l.topic, l.category, l.difficulty, c.content, l.timestamp, l.content_hash "
+        "FROM lessons l LEFT JOIN lesson_content c ON c.lesson_id = l.id;";
+
+    // Seeded lessons are matched by hash; NULLs (hand-added lessons) may repeat
+    const char *sql_create_hash_index =
+        "CREATE UNIQUE INDEX IF NOT EXISTS idx_lessons_content_hash ON lessons(content_hash);";
+
     // Create learning_progress table for the game
     const char *sql_create_progress =
         "CREATE TABLE IF NOT EXISTS learning_progress ("
@@ -39,46 +161,149 @@ int init_database(sqlite3 **db) {
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "level INTEGER NOT NULL,"
         "title TEXT NOT NULL,"
+        "completed INTEGER DEFAULT 0,"
+        "timestamp INTEGER NOT NULL"
+        ");";
+
+    const char *sql_create_game_lesson_content =
+        "CREATE TABLE IF NOT EXISTS game_lesson_content ("
+        "lesson_id INTEGER PRIMARY KEY REFERENCES game_lessons(id),"
         "description TEXT NOT NULL,"
         "code_example TEXT,"
         "challenge TEXT,"
-        "solution TEXT,"
-        "completed INTEGER DEFAULT 0,"
-        "timestamp INTEGER NOT NULL"
+        "solution TEXT"
         ");";
 
+    const char *sql_create_game_lessons_full =
+        "CREATE VIEW IF NOT EXISTS game_lessons_full AS "
+        "SELECT g.id, g.level, g.title, c.description, c.code_example, c.challenge, "
+        "c.solution, g.completed, g.timestamp "
+        "FROM game_lessons g LEFT JOIN game_lesson_content c ON c.lesson_id = g.id;";
+
+    // Files attached to lessons (db_attachments.h). data is the last column,
+    // so reading the others never walks the blob's overflow pages.
+    const char *sql_create_attachments =
+        "CREATE TABLE IF NOT EXISTS attachments ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "lesson_id INTEGER NOT NULL REFERENCES lessons(id),"
+        "name TEXT NOT NULL,"
+        "size INTEGER NOT NULL,"
+        "timestamp INTEGER NOT NULL,"
+        "data BLOB NOT NULL"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_attachments_lesson ON attachments(lesson_id);";
+
     char *err_msg = NULL;
+    int rc;
 
-    rc = sqlite3_exec(*db, sql_create_lessons, NULL, NULL, &err_msg);
+    rc = sqlite3_exec(db, sql_create_lessons, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
         fprintf(stderr, "SQL error (lessons): %s\n", err_msg);
         sqlite3_free(err_msg);
         return rc;
     }
 
-    rc = sqlite3_exec(*db, sql_create_progress, NULL, NULL, &err_msg);
+    // Version 1 files: lessons has no content_hash yet
+    if (!has_column(db, "lessons", "content_hash")) {
+        rc = sqlite3_exec(db, "ALTER TABLE lessons ADD COLUMN content_hash INTEGER;",
+                          NULL, NULL, &err_msg);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "SQL error (lessons upgrade): %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return rc;
+        }
+    }
+
+    rc = sqlite3_exec(db, sql_create_hash_index, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (lessons index): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return rc;
+    }
+
+    rc = sqlite3_exec(db, sql_create_lesson_content, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (lesson_content): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return rc;
+    }
+
+    // Version 2 files: content is still a column of lessons
+    rc = move_columns(db, "lessons", "lesson_content", "content");
+    if (rc != SQLITE_OK) return rc;
+
+    rc = sqlite3_exec(db, sql_create_lessons_full, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (lessons_full): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return rc;
+    }
+
+    rc = sqlite3_exec(db, sql_create_attachments, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (attachments): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return rc;
+    }
+
+    rc = sqlite3_exec(db, sql_create_progress, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
         fprintf(stderr, "SQL error (progress): %s\n", err_msg);
         sqlite3_free(err_msg);
         return rc;
     }
 
-    rc = sqlite3_exec(*db, sql_create_game_lessons, NULL, NULL, &err_msg);
+    rc = sqlite3_exec(db, sql_create_game_lessons, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
         fprintf(stderr, "SQL error (game_lessons): %s\n", err_msg);
         sqlite3_free(err_msg);
         return rc;
     }
 
+    rc = sqlite3_exec(db, sql_create_game_lesson_content, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (game_lesson_content): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return rc;
+    }
+
+    rc = move_columns(db, "game_lessons", "game_lesson_content",
+                      "description, code_example, challenge, solution");
+    if (rc != SQLITE_OK) return rc;
+
+    rc = sqlite3_exec(db, sql_create_game_lessons_full, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (game_lessons_full): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return rc;
+    }
+
     return SQLITE_OK;
 }
 
 void close_database(sqlite3 *db) {
-    if (db) {
+    if (db && !memory_close(db)) {
         sqlite3_close(db);
     }
 }
 
+sqlite3_int64 lesson_hash(const char *topic, const char *category, int difficulty,
+                          const char *content) {
+    char level[16];
+    snprintf(level, sizeof(level), "%d", difficulty);
+    const char *fields[] = { topic, category, level, content };
+
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (int f = 0; f < 4; f++) {
+        for (const unsigned char *c = (const unsigned char *)fields[f]; *c; c++) {
+            hash = (hash ^ *c) * 0x100000001b3ULL;
+        }
+        // Field separator, so "ab" + "c" differs from "a" + "bc"
+        hash = (hash ^ 0x1f) * 0x100000001b3ULL;
+    }
+    return (sqlite3_int64)hash;
+}
+
 const char* get_difficulty_string(int level) {
     switch (level) {
         case DIFFICULTY_BEGINNER: return "Beginner";
@@ -88,3 +313,58 @@ const char* get_difficulty_string(int level) {
         default: return "Unknown";
     }
 }
+
+int backup_database(sqlite3 *src, const char *dest_path, int pages_per_step,
+                    int sleep_ms, BackupCallback callback, void *user_data) {
+    sqlite3 *dest;
+    int rc = sqlite3_open(dest_path, &dest);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot open backup file: %s\n", sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        return rc;
+    }
+
+    // Pin one read snapshot for the whole copy. In WAL mode writers keep
+    // committing past it, and the backup never restarts because of them.
+    int own_txn = sqlite3_get_autocommit(src);
+    if (own_txn) {
+        sqlite3_exec(src, "BEGIN; SELECT COUNT(*) FROM sqlite_master;", NULL, NULL, NULL);
+    }
+
+    sqlite3_backup *backup = sqlite3_backup_init(dest, "main", src, "main");
+    if (backup == NULL) {
+        fprintf(stderr, "Backup init failed: %s\n", sqlite3_errmsg(dest));
+        rc = sqlite3_errcode(dest);
+        if (own_txn) sqlite3_exec(src, "COMMIT;", NULL, NULL, NULL);
+        sqlite3_close(dest);
+        return rc;
+    }
+
+    if (pages_per_step <= 0) pages_per_step = -1;  // Everything in one step
+
+    BackupProgress progress = {0};
+    do {
+        rc = sqlite3_backup_step(backup, pages_per_step);
+        progress.remaining = sqlite3_backup_remaining(backup);
+        progress.pagecount = sqlite3_backup_pagecount(backup);
+        progress.steps++;
+
+        if (callback) callback(&progress, user_data);
+
+        if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            if (sleep_ms > 0) sqlite3_sleep(sleep_ms);
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    if (own_txn) sqlite3_exec(src, "COMMIT;", NULL, NULL, NULL);
+
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Backup failed: %s\n", sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        return rc;
+    }
+
+    sqlite3_close(dest);
+    return SQLITE_OK;
+}
@@ -7,6 +7,19 @@
 // Database file name
 #define DB_FILE "lessons.db"
 
+// Environment variable that points every tool at another database file
+#define DB_FILE_ENV "LESSONS_DB"
+
+// Stored in PRAGMA user_version once create_schema() has run; bump it
+// whenever the schema changes so existing files are brought up to date
+#define SCHEMA_VERSION 4
+
+// How long a connection waits for another one's lock before SQLITE_BUSY
+#define BUSY_TIMEOUT_MS 5000
+
+// Size the -wal file is cut back to whenever the log starts over
+#define WAL_SIZE_LIMIT_BYTES (4 * 1024 * 1024)
+
 // Difficulty levels
 typedef enum {
     DIFFICULTY_BEGINNER = 1,
@@ -25,13 +38,50 @@ typedef struct {
     time_t timestamp;
 } Lesson;
 
-// Initialize database and create tables if they don't exist
+// Database file used by init_database(): $LESSONS_DB, or DB_FILE if unset
+const char* database_path(void);
+
+// Initialize database and create tables if they don't exist. With
+// LESSONS_IN_MEMORY set the file is loaded into RAM (see db_memory.h).
 int init_database(sqlite3 **db);
 
-// Close database connection
+// Same as init_database() for a database file other than DB_FILE.
+// Files already at SCHEMA_VERSION are opened without running any DDL.
+// With LESSONS_IO_URING set, pages are read through io_uring (db_uring.h).
+int open_database(const char *path, sqlite3 **db);
+
+// Create the lessons, learning_progress and game_lessons tables if missing
+// and bring tables from older schema versions up to date. Lesson bodies are
+// kept in lesson_content and game_lesson_content, one row per lesson id;
+// the lessons_full and game_lessons_full views join them back together.
+// Files attached to lessons go in attachments (db_attachments.h).
+int create_schema(sqlite3 *db);
+
+// 64-bit FNV-1a over every field of a lesson. The seeder stores it in
+// lessons.content_hash (unique) to tell which lessons changed; lessons
+// added by hand have none.
+sqlite3_int64 lesson_hash(const char *topic, const char *category, int difficulty,
+                          const char *content);
+
+// Close database connection, flushing it first if it is in memory
 void close_database(sqlite3 *db);
 
 // Get difficulty level string
 const char* get_difficulty_string(int level);
 
+// Online backup progress, reported after every batch of copied pages
+typedef struct {
+    int remaining;      // Pages still to copy
+    int pagecount;      // Total pages in the source snapshot
+    int steps;          // Batches completed so far
+} BackupProgress;
+
+typedef void (*BackupCallback)(const BackupProgress *progress, void *user_data);
+
+// Copy the live database to dest_path while other connections keep writing.
+// Pages are copied pages_per_step at a time from a single read snapshot,
+// sleeping sleep_ms between batches. callback may be NULL.
+int backup_database(sqlite3 *src, const char *dest_path, int pages_per_step,
+                    int sleep_ms, BackupCallback callback, void *user_data);
+
 #endif // DB_COMMON_H
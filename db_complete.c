@@ -0,0 +1,477 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_complete.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FIELDS 2
+
+typedef struct {
+    int label;                  // Edge text: offset into keys
+    int label_length;
+    int parent;
+    int first_child;            // Children sorted by first label byte, -1 if none
+    int next_sibling;
+    int entry;                  // Value ending at this node, -1 if none
+    int top[COMPLETE_MAX_RESULTS];  // Subtree's most popular entries, -1 past the end
+} RadixNode;
+
+typedef struct {
+    int text;                   // Offset into texts, as first seen
+    int node;
+    int popularity;
+} Entry;
+
+typedef struct {
+    RadixNode *nodes;           // Node 0 is the root, with an empty label
+    int node_count;
+    int node_capacity;
+    Entry *entries;
+    int entry_count;
+    int entry_capacity;
+    int live;                   // Entries with popularity > 0
+    char *keys;                 // Lowercase values, back to back
+    int keys_length;
+    int keys_capacity;
+    char *texts;                // Values as stored, NUL-terminated
+    int texts_length;
+    int texts_capacity;
+} RadixTree;
+
+typedef struct {
+    int entry[FIELDS];          // -1 if the lesson is not indexed
+} LessonState;
+
+struct CompleteIndex {
+    sqlite3 *db;
+    RadixTree trees[FIELDS];
+    LessonState *lessons;       // By lesson id
+    int lesson_capacity;
+
+    // Filled by the update hook, applied by complete_refresh()
+    sqlite3_int64 *pending;
+    int pending_count;
+    int pending_capacity;
+    int stale;                  // Rebuild on the next refresh
+
+    sqlite3_int64 data_version; // At the last refresh
+    CompleteStats last;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Grow array (of element size bytes) to hold at least needed elements,
+// zero-filling the new part
+static int reserve(void **array, int *capacity, int needed, size_t size) {
+    if (needed <= *capacity) return 1;
+    int grown = *capacity ? *capacity : 64;
+    while (grown < needed) grown *= 2;
+
+    void *data = realloc(*array, (size_t)grown * size);
+    if (data == NULL) return 0;
+    memset((char *)data + (size_t)*capacity * size, 0, (size_t)(grown - *capacity) * size);
+    *array = data;
+    *capacity = grown;
+    return 1;
+}
+
+static char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+// ============================================================================
+// RADIX TREE
+// ============================================================================
+
+static int new_node(RadixTree *tree, int label, int label_length, int parent) {
+    if (!reserve((void **)&tree->nodes, &tree->node_capacity, tree->node_count + 1, sizeof(RadixNode))) {
+        return -1;
+    }
+    RadixNode *node = &tree->nodes[tree->node_count];
+    node->label = label;
+    node->label_length = label_length;
+    node->parent = parent;
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->entry = -1;
+    for (int i = 0; i < COMPLETE_MAX_RESULTS; i++) node->top[i] = -1;
+    return tree->node_count++;
+}
+
+static void tree_clear(RadixTree *tree) {
+    free(tree->nodes);
+    free(tree->entries);
+    free(tree->keys);
+    free(tree->texts);
+    memset(tree, 0, sizeof(*tree));
+}
+
+static void link_child(RadixTree *tree, int parent, int child) {
+    char first = tree->keys[tree->nodes[child].label];
+    int *link = &tree->nodes[parent].first_child;
+    while (*link >= 0 && tree->keys[tree->nodes[*link].label] < first) {
+        link = &tree->nodes[*link].next_sibling;
+    }
+    tree->nodes[child].next_sibling = *link;
+    *link = child;
+}
+
+static int find_child(const RadixTree *tree, int parent, char first) {
+    for (int child = tree->nodes[parent].first_child; child >= 0; child = tree->nodes[child].next_sibling) {
+        char c = tree->keys[tree->nodes[child].label];
+        if (c == first) return child;
+        if (c > first) break;
+    }
+    return -1;
+}
+
+// The entry for text, added with popularity 0 if new; -1 if out of memory
+static int tree_entry(RadixTree *tree, const char *text) {
+    int length = (int)strlen(text);
+    if (tree->node_count == 0 && new_node(tree, 0, 0, -1) < 0) return -1;
+
+    // Keys are copied first so that edge labels can point into them
+    if (!reserve((void **)&tree->keys, &tree->keys_capacity, tree->keys_length + length + 1, 1)) return -1;
+    char *key = tree->keys + tree->keys_length;
+    for (int i = 0; i < length; i++) key[i] = lower(text[i]);
+
+    int node = 0, matched = 0;
+    while (matched < length) {
+        int child = find_child(tree, node, key[matched]);
+        if (child < 0) {
+            // New leaf for the rest of the key
+            int leaf = new_node(tree, tree->keys_length + matched, length - matched, node);
+            if (leaf < 0) return -1;
+            link_child(tree, node, leaf);
+            node = leaf;
+            matched = length;
+            tree->keys_length += length;
+            break;
+        }
+
+        RadixNode *edge = &tree->nodes[child];
+        const char *label = tree->keys + edge->label;
+        int common = 0;
+        while (common < edge->label_length && matched + common < length &&
+               label[common] == key[matched + common]) {
+            common++;
+        }
+        if (common < edge->label_length) {
+            // Split the edge where the key leaves it
+            int split = new_node(tree, tree->nodes[child].label, common, node);
+            if (split < 0) return -1;
+            edge = &tree->nodes[child];
+
+            // The split node takes the child's place among its siblings
+            int *link = &tree->nodes[node].first_child;
+            while (*link != child) link = &tree->nodes[*link].next_sibling;
+            *link = split;
+            tree->nodes[split].next_sibling = edge->next_sibling;
+
+            edge->label += common;
+            edge->label_length -= common;
+            edge->parent = split;
+            edge->next_sibling = -1;
+            tree->nodes[split].first_child = child;
+            memcpy(tree->nodes[split].top, edge->top, sizeof(edge->top));
+            child = split;
+        }
+        node = child;
+        matched += common;
+    }
+
+    if (tree->nodes[node].entry >= 0) return tree->nodes[node].entry;
+
+    if (!reserve((void **)&tree->entries, &tree->entry_capacity, tree->entry_count + 1, sizeof(Entry)) ||
+        !reserve((void **)&tree->texts, &tree->texts_capacity, tree->texts_length + length + 1, 1)) {
+        return -1;
+    }
+    Entry *entry = &tree->entries[tree->entry_count];
+    entry->text = tree->texts_length;
+    entry->node = node;
+    entry->popularity = 0;
+    memcpy(tree->texts + tree->texts_length, text, length + 1);
+    tree->texts_length += length + 1;
+    tree->nodes[node].entry = tree->entry_count;
+    return tree->entry_count++;
+}
+
+// More popular first; alphabetical between equals
+static int better_entry(const RadixTree *tree, int a, int b) {
+    const Entry *x = &tree->entries[a], *y = &tree->entries[b];
+    if (x->popularity != y->popularity) return x->popularity > y->popularity;
+    return strcmp(tree->texts + x->text, tree->texts + y->text) < 0;
+}
+
+static void offer(const RadixTree *tree, int *top, int *count, int entry) {
+    if (tree->entries[entry].popularity <= 0) return;
+    if (*count == COMPLETE_MAX_RESULTS && !better_entry(tree, entry, top[*count - 1])) return;
+
+    int at = *count < COMPLETE_MAX_RESULTS ? (*count)++ : COMPLETE_MAX_RESULTS - 1;
+    while (at > 0 && better_entry(tree, entry, top[at - 1])) {
+        top[at] = top[at - 1];
+        at--;
+    }
+    top[at] = entry;
+}
+
+// A node's best entries are its own and its children's best
+static void recompute_top(RadixTree *tree, int node) {
+    int top[COMPLETE_MAX_RESULTS], count = 0;
+    if (tree->nodes[node].entry >= 0) offer(tree, top, &count, tree->nodes[node].entry);
+    for (int child = tree->nodes[node].first_child; child >= 0; child = tree->nodes[child].next_sibling) {
+        const int *best = tree->nodes[child].top;
+        for (int i = 0; i < COMPLETE_MAX_RESULTS && best[i] >= 0; i++) offer(tree, top, &count, best[i]);
+    }
+    for (int i = count; i < COMPLETE_MAX_RESULTS; i++) top[i] = -1;
+    memcpy(tree->nodes[node].top, top, sizeof(top));
+}
+
+// After a bulk load: children before parents
+static void recompute_subtree(RadixTree *tree, int node) {
+    for (int child = tree->nodes[node].first_child; child >= 0; child = tree->nodes[child].next_sibling) {
+        recompute_subtree(tree, child);
+    }
+    recompute_top(tree, node);
+}
+
+// Change an entry's popularity; with update, fix the caches on its path.
+// Every ancestor is recomputed, since the entry may now outrank (or fall
+// behind) entries in a sibling subtree.
+static void add_popularity(RadixTree *tree, int entry, int delta, int update) {
+    Entry *e = &tree->entries[entry];
+    int was_live = e->popularity > 0;
+    e->popularity += delta;
+    tree->live += (e->popularity > 0) - was_live;
+    if (!update) return;
+    for (int node = e->node; node >= 0; node = tree->nodes[node].parent) recompute_top(tree, node);
+}
+
+// ============================================================================
+// LESSONS
+// ============================================================================
+
+// Replace what lesson_id contributes; NULL values for a deleted lesson
+static int set_lesson(CompleteIndex *index, int lesson_id, const char *values[FIELDS], int update) {
+    if (lesson_id <= 0) return SQLITE_OK;
+    if (lesson_id >= index->lesson_capacity) {
+        if (values[0] == NULL) return SQLITE_OK;
+        int old = index->lesson_capacity;
+        if (!reserve((void **)&index->lessons, &index->lesson_capacity, lesson_id + 1, sizeof(LessonState))) {
+            return SQLITE_NOMEM;
+        }
+        for (int i = old; i < index->lesson_capacity; i++) {
+            for (int f = 0; f < FIELDS; f++) index->lessons[i].entry[f] = -1;
+        }
+    }
+
+    LessonState *state = &index->lessons[lesson_id];
+    for (int f = 0; f < FIELDS; f++) {
+        int entry = values[f] ? tree_entry(&index->trees[f], values[f]) : -1;
+        if (values[f] && entry < 0) return SQLITE_NOMEM;
+        if (entry == state->entry[f]) continue;
+
+        if (state->entry[f] >= 0) add_popularity(&index->trees[f], state->entry[f], -1, update);
+        if (entry >= 0) add_popularity(&index->trees[f], entry, 1, update);
+        state->entry[f] = entry;
+    }
+    return SQLITE_OK;
+}
+
+// Load every lesson from scratch
+static int rebuild(CompleteIndex *index) {
+    for (int f = 0; f < FIELDS; f++) tree_clear(&index->trees[f]);
+    for (int i = 0; i < index->lesson_capacity; i++) {
+        for (int f = 0; f < FIELDS; f++) index->lessons[i].entry[f] = -1;
+    }
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(index->db, "SELECT id, topic, category FROM lessons;", -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *values[FIELDS] = {
+            (const char *)sqlite3_column_text(stmt, 1),
+            (const char *)sqlite3_column_text(stmt, 2)
+        };
+        if (values[0] == NULL || values[1] == NULL) continue;
+        rc = set_lesson(index, sqlite3_column_int(stmt, 0), values, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    for (int f = 0; rc == SQLITE_OK && f < FIELDS; f++) {
+        if (index->trees[f].node_count > 0) recompute_subtree(&index->trees[f], 0);
+    }
+    index->last.rebuilds++;
+    index->last.updated = 0;
+    return rc;
+}
+
+// Re-read the lessons the update hook reported
+static int apply_pending(CompleteIndex *index) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(index->db, "SELECT topic, category FROM lessons WHERE id = ?;", -1, &stmt, NULL);
+    for (int i = 0; rc == SQLITE_OK && i < index->pending_count; i++) {
+        sqlite3_int64 lesson_id = index->pending[i];
+        if (lesson_id <= 0 || lesson_id > 0x7fffffff) continue;
+
+        sqlite3_bind_int64(stmt, 1, lesson_id);
+        const char *values[FIELDS] = { NULL, NULL };
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            values[0] = (const char *)sqlite3_column_text(stmt, 0);
+            values[1] = (const char *)sqlite3_column_text(stmt, 1);
+            if (values[0] == NULL || values[1] == NULL) values[0] = values[1] = NULL;
+        }
+        rc = set_lesson(index, (int)lesson_id, values, 1);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    index->last.updated = index->pending_count;
+    return rc;
+}
+
+// Runs inside the statement that changed the row: only take note
+static void update_callback(void *arg, int op, const char *database, const char *table, sqlite3_int64 rowid) {
+    (void)op;
+    CompleteIndex *index = arg;
+    if (index->stale || strcmp(database, "main") != 0) return;
+
+    if (strcmp(table, "lessons") == 0) {
+        // A bulk change is cheaper to reload than to replay
+        if (index->pending_count >= 4096 ||
+            !reserve((void **)&index->pending, &index->pending_capacity, index->pending_count + 1,
+                     sizeof(sqlite3_int64))) {
+            index->stale = 1;
+            return;
+        }
+        index->pending[index->pending_count++] = rowid;
+    }
+}
+
+// A DELETE without WHERE empties the table in one step and never calls
+// the update hook. Answering SQLITE_IGNORE keeps the DELETE but makes
+// SQLite remove the rows one by one, so each reaches update_callback.
+static int authorize(void *arg, int action, const char *table, const char *unused,
+                     const char *database, const char *trigger) {
+    (void)arg;
+    (void)unused;
+    (void)trigger;
+    if (action == SQLITE_DELETE && table && database &&
+        strcmp(database, "main") == 0 && strcmp(table, "lessons") == 0) {
+        return SQLITE_IGNORE;
+    }
+    return SQLITE_OK;
+}
+
+int complete_refresh(CompleteIndex *index) {
+    sqlite3 *db = index->db;
+
+    // Rows changed by an open transaction may still be rolled back; they
+    // stay pending and are re-read once it ends
+    if (!sqlite3_get_autocommit(db)) return SQLITE_OK;
+
+    // Another connection committed: its changes were not hooked
+    sqlite3_stmt *stmt;
+    sqlite3_int64 data_version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA data_version;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) data_version = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (data_version != index->data_version) index->stale = 1;
+    if (!index->stale && index->pending_count == 0) return SQLITE_OK;
+
+    double start = now_seconds();
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    int rc = index->stale ? rebuild(index) : apply_pending(index);
+
+    // Renamed and deleted values stay in the tree with no popularity;
+    // start over once they outnumber the live ones
+    for (int f = 0; rc == SQLITE_OK && f < FIELDS; f++) {
+        const RadixTree *tree = &index->trees[f];
+        if (tree->entry_count > 1024 && tree->entry_count - tree->live > tree->live) {
+            rc = rebuild(index);
+            break;
+        }
+    }
+    sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+
+    index->pending_count = 0;
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot refresh the completion index: %s\n",
+                rc == SQLITE_NOMEM ? "out of memory" : sqlite3_errmsg(db));
+        index->stale = 1;
+        return rc;
+    }
+    index->stale = 0;
+    index->data_version = data_version;
+    index->last.refresh_seconds = now_seconds() - start;
+    return SQLITE_OK;
+}
+
+CompleteIndex* complete_open(sqlite3 *db) {
+    CompleteIndex *index = calloc(1, sizeof(CompleteIndex));
+    if (index == NULL) return NULL;
+    index->db = db;
+    index->stale = 1;
+    sqlite3_update_hook(db, update_callback, index);
+    sqlite3_set_authorizer(db, authorize, index);
+
+    if (complete_refresh(index) != SQLITE_OK) {
+        complete_close(index);
+        return NULL;
+    }
+    return index;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+int complete_prefix(CompleteIndex *index, CompleteField field, const char *prefix,
+                    int k, Completion *completions) {
+    const RadixTree *tree = &index->trees[field];
+    if (k > COMPLETE_MAX_RESULTS) k = COMPLETE_MAX_RESULTS;
+    if (tree->node_count == 0 || k <= 0) return 0;
+
+    // Follow the prefix down; it may end halfway along an edge
+    int node = 0;
+    for (const char *c = prefix; *c; ) {
+        node = find_child(tree, node, lower(*c));
+        if (node < 0) return 0;
+        const char *label = tree->keys + tree->nodes[node].label;
+        for (int i = 0; i < tree->nodes[node].label_length && *c; i++, c++) {
+            if (label[i] != lower(*c)) return 0;
+        }
+    }
+
+    int found = 0;
+    const int *top = tree->nodes[node].top;
+    while (found < k && top[found] >= 0) {
+        const Entry *entry = &tree->entries[top[found]];
+        completions[found].text = tree->texts + entry->text;
+        completions[found].popularity = entry->popularity;
+        found++;
+    }
+    return found;
+}
+
+void complete_stats(const CompleteIndex *index, CompleteStats *stats) {
+    *stats = index->last;
+    stats->topics = index->trees[COMPLETE_TOPIC].live;
+    stats->categories = index->trees[COMPLETE_CATEGORY].live;
+    stats->nodes = index->trees[COMPLETE_TOPIC].node_count + index->trees[COMPLETE_CATEGORY].node_count;
+}
+
+void complete_close(CompleteIndex *index) {
+    if (index == NULL) return;
+    sqlite3_update_hook(index->db, NULL, NULL);
+    sqlite3_set_authorizer(index->db, NULL, NULL);
+    for (int f = 0; f < FIELDS; f++) tree_clear(&index->trees[f]);
+    free(index->lessons);
+    free(index->pending);
+    free(index);
+}
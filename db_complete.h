@@ -0,0 +1,68 @@
+#ifndef DB_COMPLETE_H
+#define DB_COMPLETE_H
+
+#include "db_common.h"
+
+// Completions kept per prefix; complete_prefix() returns at most this many
+#define COMPLETE_MAX_RESULTS 8
+
+// Prefix completion of lesson topics and categories.
+//
+// Each field's distinct values are kept in a radix tree keyed by their
+// lowercase text, one node per shared prefix. Every node caches its
+// subtree's most popular values, so a completion is a walk down the
+// prefix and a copy, whatever the number of lessons. A value's popularity
+// is the number of lessons using it.
+//
+// The index registers an update hook on the connection: rows of lessons
+// changed through it are re-read on the next refresh and only their
+// values' paths are updated. A refresh inside a transaction waits for it
+// to end, so rows of a rolled-back transaction are re-read as they were.
+// Commits by other connections (seen through PRAGMA data_version) rebuild
+// the index, which takes a single scan.
+//
+// SQLite skips the update hook when a DELETE without WHERE truncates a
+// table, so the index also sets an authorizer that turns off that
+// optimization for lessons. The connection cannot have an authorizer of
+// its own while the index is open.
+
+typedef struct CompleteIndex CompleteIndex;
+
+typedef enum {
+    COMPLETE_TOPIC,
+    COMPLETE_CATEGORY
+} CompleteField;
+
+typedef struct {
+    const char *text;           // Valid until the index next changes
+    int popularity;
+} Completion;
+
+typedef struct {
+    int topics;                 // Distinct values in use
+    int categories;
+    int nodes;                  // Radix tree nodes, both fields
+    int rebuilds;
+    int updated;                // Lessons re-read, last refresh
+    double refresh_seconds;     // Last refresh (or the build on open)
+} CompleteStats;
+
+// Build the index for db's lessons and install its update hook and
+// authorizer. Only one index may be open on a connection, and it must be
+// used on that connection's thread.
+CompleteIndex* complete_open(sqlite3 *db);
+
+// Apply the changes seen since the last refresh
+int complete_refresh(CompleteIndex *index);
+
+// Up to k values of field starting with prefix (case-insensitive), most
+// popular first; returns how many
+int complete_prefix(CompleteIndex *index, CompleteField field, const char *prefix,
+                    int k, Completion *completions);
+
+void complete_stats(const CompleteIndex *index, CompleteStats *stats);
+
+// Drop the index and remove its hooks
+void complete_close(CompleteIndex *index);
+
+#endif // DB_COMPLETE_H
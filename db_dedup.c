@@ -0,0 +1,888 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_common.h"
+#include "db_cdc.h"
+#include "db_replica.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Near-duplicate lessons by MinHash over word shingles.
+//
+// Each lesson's content becomes the set of its SHINGLE_WORDS-word
+// sequences; MINHASH_COUNT minimums of independent hashes over that set
+// agree between two lessons with probability equal to their Jaccard
+// similarity. Signatures are cut into LSH_BANDS bands of LSH_ROWS values:
+// two lessons land in the same bucket of a band when all its values agree,
+// which lessons above ~0.7 similarity almost always do in some band and
+// unrelated ones almost never do. Only lessons sharing a bucket are
+// compared, by the fraction of agreeing signature values.
+//
+// Signatures are computed on worker threads, a batch at a time. Band keys
+// and signatures go to temp tables on disk, and buckets are read back
+// through SQLite's external sort, so memory stays at a few batches plus
+// one int per lesson id, however many lessons there are.
+
+#define MINHASH_COUNT 128
+#define LSH_BANDS 16
+#define LSH_ROWS (MINHASH_COUNT / LSH_BANDS)
+#define SHINGLE_WORDS 3
+#define MAX_WORD 32
+#define BATCH_PER_THREAD 256
+#define MAX_THREADS 64
+#define ALL_PAIRS_BUCKET 64     // Larger buckets: each member vs the first only
+#define DEFAULT_THRESHOLD 0.8
+
+#define DEFAULT_BENCH_LESSONS 100000
+#define BENCH_COPY_PERCENT 10
+#define BENCH_EDIT_PERCENT 2
+#define BENCH_WORDS 200
+#define BENCH_VOCABULARY 20000
+#define BENCH_DB "dedup_bench.db"
+
+typedef struct {
+    int lesson_id;
+    char *content;
+    int empty;                  // No words: never a duplicate
+    uint32_t signature[MINHASH_COUNT];
+} DedupDoc;
+
+typedef struct {
+    DedupDoc *docs;
+    int count;
+    int first;                  // This thread's docs: first, first + stride, ...
+    int stride;
+} SignatureWork;
+
+typedef struct {
+    int lessons;
+    int skipped;                // Without words
+    long bucket_pairs;          // Pairs compared
+    long similar_pairs;         // At or above the threshold
+    int clusters;
+    int duplicates;             // Lessons in clusters besides the one kept
+    int kept_apart;             // Of those, left alone by a merge
+    double signature_seconds;
+    double candidate_seconds;
+} DedupStats;
+
+typedef struct {
+    sqlite3 *db;
+    int threads;
+    double threshold;
+    int *parent;                // Union-find by lesson id; roots are the lowest id
+    int max_id;
+    DedupStats stats;
+} Dedup;
+
+static uint64_t hash_a[MINHASH_COUNT];
+static uint64_t hash_b[MINHASH_COUNT];
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// The same hash family on every run, so reports are reproducible
+static void init_hashes(void) {
+    for (int i = 0; i < MINHASH_COUNT; i++) {
+        hash_a[i] = mix64(2 * i + 1) | 1;
+        hash_b[i] = mix64(2 * i + 2);
+    }
+}
+
+static double peak_rss_mb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// ============================================================================
+// SIGNATURES
+// ============================================================================
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Hashes of the distinct SHINGLE_WORDS-word shingles of text (one shingle
+// of all words when there are fewer). Returns the count; *out is malloc'd.
+static int shingle_hashes(const char *text, uint64_t **out) {
+    size_t capacity = strlen(text) / 2 + 1;
+    uint64_t *shingles = malloc(capacity * sizeof(uint64_t));
+    *out = shingles;
+    if (shingles == NULL) return 0;
+
+    uint64_t window[SHINGLE_WORDS] = { 0 };
+    int words = 0, count = 0;
+    uint64_t word = 0xcbf29ce484222325ULL;
+    int length = 0;
+
+    for (const char *c = text; ; c++) {
+        char ch = *c;
+        if ((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_' || (ch >= 'A' && ch <= 'Z')) {
+            if (ch >= 'A' && ch <= 'Z') ch = ch - 'A' + 'a';
+            if (length++ < MAX_WORD) word = (word ^ (unsigned char)ch) * 0x100000001b3ULL;
+            continue;
+        }
+
+        if (length > 0) {
+            memmove(window, window + 1, (SHINGLE_WORDS - 1) * sizeof(uint64_t));
+            window[SHINGLE_WORDS - 1] = word;
+            if (++words >= SHINGLE_WORDS) {
+                uint64_t shingle = 0;
+                for (int w = 0; w < SHINGLE_WORDS; w++) shingle = mix64(shingle ^ window[w]);
+                shingles[count++] = shingle;
+            }
+        }
+        word = 0xcbf29ce484222325ULL;
+        length = 0;
+        if (ch == '\0') break;
+    }
+
+    if (words > 0 && words < SHINGLE_WORDS) {
+        uint64_t shingle = 0;
+        for (int w = SHINGLE_WORDS - words; w < SHINGLE_WORDS; w++) shingle = mix64(shingle ^ window[w]);
+        shingles[count++] = shingle;
+    }
+
+    qsort(shingles, count, sizeof(uint64_t), compare_u64);
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        if (distinct == 0 || shingles[distinct - 1] != shingles[i]) shingles[distinct++] = shingles[i];
+    }
+    return distinct;
+}
+
+static void compute_signature(DedupDoc *doc) {
+    uint64_t *shingles;
+    int count = shingle_hashes(doc->content, &shingles);
+    doc->empty = count == 0;
+
+    for (int i = 0; i < MINHASH_COUNT; i++) doc->signature[i] = UINT32_MAX;
+    for (int s = 0; s < count; s++) {
+        uint64_t shingle = shingles[s];
+        for (int i = 0; i < MINHASH_COUNT; i++) {
+            uint32_t value = (uint32_t)((hash_a[i] * shingle + hash_b[i]) >> 32);
+            if (value < doc->signature[i]) doc->signature[i] = value;
+        }
+    }
+    free(shingles);
+}
+
+static void* signature_thread(void *arg) {
+    SignatureWork *work = arg;
+    for (int i = work->first; i < work->count; i += work->stride) compute_signature(&work->docs[i]);
+    return NULL;
+}
+
+static void compute_batch(DedupDoc *docs, int count, int threads) {
+    pthread_t ids[MAX_THREADS];
+    SignatureWork work[MAX_THREADS];
+    int started = 0;
+
+    for (int t = 1; t < threads; t++) {
+        work[t] = (SignatureWork){ docs, count, t, threads };
+        if (pthread_create(&ids[t], NULL, signature_thread, &work[t]) != 0) break;
+        started = t;
+    }
+
+    // This thread takes slice 0, and any slices whose thread did not start
+    for (int t = 0; t < threads; t++) {
+        if (t == 0 || t > started) {
+            work[t] = (SignatureWork){ docs, count, t, threads };
+            signature_thread(&work[t]);
+        }
+    }
+    for (int t = 1; t <= started; t++) pthread_join(ids[t], NULL);
+}
+
+// One band of a signature as a bucket key
+static sqlite3_int64 band_key(const uint32_t *signature, int band) {
+    uint64_t key = mix64((uint64_t)band + 1);
+    for (int r = 0; r < LSH_ROWS; r++) key = mix64(key ^ signature[band * LSH_ROWS + r]);
+    return (sqlite3_int64)key;
+}
+
+static int store_batch(Dedup *dedup, sqlite3_stmt *insert_signature, sqlite3_stmt *insert_band,
+                       DedupDoc *docs, int count) {
+    int rc = SQLITE_OK;
+    for (int i = 0; rc == SQLITE_OK && i < count; i++) {
+        DedupDoc *doc = &docs[i];
+        if (doc->empty) {
+            dedup->stats.skipped++;
+            continue;
+        }
+
+        sqlite3_bind_int(insert_signature, 1, doc->lesson_id);
+        sqlite3_bind_blob(insert_signature, 2, doc->signature, sizeof(doc->signature), SQLITE_STATIC);
+        if (sqlite3_step(insert_signature) != SQLITE_DONE) rc = sqlite3_errcode(dedup->db);
+        sqlite3_reset(insert_signature);
+
+        for (int band = 0; rc == SQLITE_OK && band < LSH_BANDS; band++) {
+            sqlite3_bind_int(insert_band, 1, band);
+            sqlite3_bind_int64(insert_band, 2, band_key(doc->signature, band));
+            sqlite3_bind_int(insert_band, 3, doc->lesson_id);
+            if (sqlite3_step(insert_band) != SQLITE_DONE) rc = sqlite3_errcode(dedup->db);
+            sqlite3_reset(insert_band);
+        }
+    }
+    return rc;
+}
+
+static void free_batch(DedupDoc *docs, int count) {
+    for (int i = 0; i < count; i++) free(docs[i].content);
+}
+
+// Signatures and band keys of every lesson, into the temp tables
+static int build_signatures(Dedup *dedup) {
+    sqlite3 *db = dedup->db;
+    const char *setup =
+        "PRAGMA temp_store = FILE;"
+        "DROP TABLE IF EXISTS temp.dedup_signatures;"
+        "DROP TABLE IF EXISTS temp.dedup_bands;"
+        "CREATE TEMP TABLE dedup_signatures (lesson_id INTEGER PRIMARY KEY, signature BLOB NOT NULL);"
+        "CREATE TEMP TABLE dedup_bands (band INTEGER NOT NULL, key INTEGER NOT NULL, lesson_id INTEGER NOT NULL);";
+
+    char *err_msg = NULL;
+    if (sqlite3_exec(db, setup, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "SQL error: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return SQLITE_ERROR;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    sqlite3_stmt *read = NULL, *insert_signature = NULL, *insert_band = NULL;
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "SELECT lesson_id, content FROM lesson_content ORDER BY lesson_id;",
+                                -1, &read, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO temp.dedup_signatures (lesson_id, signature) VALUES (?, ?);",
+                                -1, &insert_signature, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO temp.dedup_bands (band, key, lesson_id) VALUES (?, ?, ?);",
+                                -1, &insert_band, NULL);
+    }
+
+    int batch_size = dedup->threads * BATCH_PER_THREAD;
+    DedupDoc *docs = rc == SQLITE_OK ? malloc(batch_size * sizeof(DedupDoc)) : NULL;
+    if (rc == SQLITE_OK && docs == NULL) rc = SQLITE_NOMEM;
+
+    int count = 0, done = 0;
+    while (rc == SQLITE_OK && !done) {
+        int step = sqlite3_step(read);
+        if (step == SQLITE_ROW) {
+            const char *content = (const char *)sqlite3_column_text(read, 1);
+            DedupDoc *doc = &docs[count];
+            doc->lesson_id = sqlite3_column_int(read, 0);
+            doc->content = strdup(content ? content : "");
+            if (doc->content == NULL) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            if (doc->lesson_id > dedup->max_id) dedup->max_id = doc->lesson_id;
+            count++;
+            dedup->stats.lessons++;
+        } else if (step == SQLITE_DONE) {
+            done = 1;
+        } else {
+            rc = step;
+        }
+
+        if (rc == SQLITE_OK && (count == batch_size || (done && count > 0))) {
+            compute_batch(docs, count, dedup->threads);
+            rc = store_batch(dedup, insert_signature, insert_band, docs, count);
+            free_batch(docs, count);
+            count = 0;
+        }
+    }
+    if (docs) free_batch(docs, count);
+    free(docs);
+
+    sqlite3_finalize(read);
+    sqlite3_finalize(insert_signature);
+    sqlite3_finalize(insert_band);
+    if (rc == SQLITE_OK) rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot compute signatures: %s\n", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    }
+    dedup->stats.signature_seconds = elapsed_seconds(&start);
+    return rc;
+}
+
+// ============================================================================
+// CANDIDATES AND CLUSTERS
+// ============================================================================
+
+static int find_root(int *parent, int id) {
+    while (parent[id] != id) {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+static void join(int *parent, int a, int b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a < b) parent[b] = a;
+    else if (b < a) parent[a] = b;
+}
+
+static int load_signature(sqlite3_stmt *stmt, int lesson_id, uint32_t *signature) {
+    sqlite3_bind_int(stmt, 1, lesson_id);
+    int found = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_bytes(stmt, 0) == MINHASH_COUNT * 4;
+    if (found) memcpy(signature, sqlite3_column_blob(stmt, 0), MINHASH_COUNT * 4);
+    sqlite3_reset(stmt);
+    return found;
+}
+
+// Estimated Jaccard similarity of two lessons
+static double similarity(const uint32_t *a, const uint32_t *b) {
+    int same = 0;
+    for (int i = 0; i < MINHASH_COUNT; i++) same += a[i] == b[i];
+    return (double)same / MINHASH_COUNT;
+}
+
+static void compare_pair(Dedup *dedup, int a, const uint32_t *sig_a, int b, const uint32_t *sig_b) {
+    dedup->stats.bucket_pairs++;
+    if (similarity(sig_a, sig_b) >= dedup->threshold) {
+        dedup->stats.similar_pairs++;
+        join(dedup->parent, a, b);
+    }
+}
+
+static void compare_bucket(Dedup *dedup, sqlite3_stmt *load, const int *members, int count,
+                           uint32_t (*signatures)[MINHASH_COUNT]) {
+    if (count < 2) return;
+
+    if (count <= ALL_PAIRS_BUCKET) {
+        for (int i = 0; i < count; i++) load_signature(load, members[i], signatures[i]);
+        for (int i = 0; i < count; i++) {
+            for (int j = i + 1; j < count; j++) {
+                // Already in one cluster through another pair
+                if (find_root(dedup->parent, members[i]) == find_root(dedup->parent, members[j])) continue;
+                compare_pair(dedup, members[i], signatures[i], members[j], signatures[j]);
+            }
+        }
+        return;
+    }
+
+    // A crowded bucket (boilerplate shared by many lessons): star comparisons
+    load_signature(load, members[0], signatures[0]);
+    for (int i = 1; i < count; i++) {
+        if (find_root(dedup->parent, members[0]) == find_root(dedup->parent, members[i])) continue;
+        load_signature(load, members[i], signatures[1]);
+        compare_pair(dedup, members[0], signatures[0], members[i], signatures[1]);
+    }
+}
+
+// Compare the lessons of every shared bucket and cluster the similar ones
+static int find_clusters(Dedup *dedup) {
+    sqlite3 *db = dedup->db;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    dedup->parent = malloc(((size_t)dedup->max_id + 1) * sizeof(int));
+    if (dedup->parent == NULL) return SQLITE_NOMEM;
+    for (int id = 0; id <= dedup->max_id; id++) dedup->parent[id] = id;
+
+    sqlite3_stmt *buckets = NULL, *load = NULL;
+    int rc = sqlite3_prepare_v2(db, "SELECT band, key, lesson_id FROM temp.dedup_bands "
+                                    "ORDER BY band, key, lesson_id;", -1, &buckets, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "SELECT signature FROM temp.dedup_signatures WHERE lesson_id = ?;",
+                                -1, &load, NULL);
+    }
+
+    uint32_t (*signatures)[MINHASH_COUNT] = malloc(ALL_PAIRS_BUCKET * sizeof(*signatures));
+    int *members = NULL;
+    int count = 0, capacity = 0;
+    int band = -1;
+    sqlite3_int64 key = 0;
+    if (rc == SQLITE_OK && signatures == NULL) rc = SQLITE_NOMEM;
+
+    while (rc == SQLITE_OK) {
+        int step = sqlite3_step(buckets);
+        if (step != SQLITE_ROW) {
+            if (step != SQLITE_DONE) rc = step;
+            break;
+        }
+
+        int row_band = sqlite3_column_int(buckets, 0);
+        sqlite3_int64 row_key = sqlite3_column_int64(buckets, 1);
+        if (row_band != band || row_key != key) {
+            compare_bucket(dedup, load, members, count, signatures);
+            band = row_band;
+            key = row_key;
+            count = 0;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            int *grown = realloc(members, capacity * sizeof(int));
+            if (grown == NULL) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            members = grown;
+        }
+        members[count++] = sqlite3_column_int(buckets, 2);
+    }
+    if (rc == SQLITE_OK) compare_bucket(dedup, load, members, count, signatures);
+
+    free(members);
+    free(signatures);
+    sqlite3_finalize(buckets);
+    sqlite3_finalize(load);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot compare candidates: %s\n", sqlite3_errmsg(db));
+    dedup->stats.candidate_seconds = elapsed_seconds(&start);
+    return rc;
+}
+
+typedef struct {
+    int root;
+    int lesson_id;
+    int seeded;                 // Has a content_hash: the seeder owns it
+    int merge;                  // Folded into the kept lesson on --merge
+} ClusterMember;
+
+static int compare_member(const void *a, const void *b) {
+    const ClusterMember *x = a, *y = b;
+    if (x->root != y->root) return (x->root > y->root) - (x->root < y->root);
+    return (x->lesson_id > y->lesson_id) - (x->lesson_id < y->lesson_id);
+}
+
+// Every lesson in a cluster of two or more, grouped by cluster, lowest
+// id first. Returns the count, or -1 when out of memory.
+static int cluster_members(Dedup *dedup, ClusterMember **members) {
+    int count = 0;
+    for (int id = 1; id <= dedup->max_id; id++) {
+        if (find_root(dedup->parent, id) != id) count++;
+    }
+
+    // Non-root members and their roots, each root once
+    *members = malloc((2 * (size_t)count + 1) * sizeof(ClusterMember));
+    if (*members == NULL) return -1;
+    char *listed = calloc((size_t)dedup->max_id + 1, 1);
+    if (listed == NULL) {
+        free(*members);
+        return -1;
+    }
+
+    int total = 0;
+    for (int id = 1; id <= dedup->max_id; id++) {
+        int root = find_root(dedup->parent, id);
+        if (root == id) continue;
+        (*members)[total++] = (ClusterMember){ root, id, 0, 0 };
+        if (!listed[root]) {
+            listed[root] = 1;
+            (*members)[total++] = (ClusterMember){ root, root, 0, 0 };
+            dedup->stats.clusters++;
+        }
+    }
+    free(listed);
+
+    qsort(*members, total, sizeof(ClusterMember), compare_member);
+    dedup->stats.duplicates = total - dedup->stats.clusters;
+    return total;
+}
+
+// The lesson a cluster keeps: a seeded one if any, since the seeder would
+// add it again, otherwise the oldest id
+static int pick_keeper(const ClusterMember *cluster, int count) {
+    for (int i = 0; i < count; i++) {
+        if (cluster[i].seeded) return cluster[i].lesson_id;
+    }
+    return cluster[0].lesson_id;
+}
+
+// Clusters chain lessons through similar pairs (A~B, B~C), so a member
+// is only merged when it is itself similar to the kept lesson; other
+// seeded lessons are never merged, or the seeder would add them back
+static void print_cluster(Dedup *dedup, sqlite3_stmt *topic, sqlite3_stmt *load, int number,
+                          ClusterMember *cluster, int count, int keeper) {
+    uint32_t kept[MINHASH_COUNT], other[MINHASH_COUNT];
+    load_signature(load, keeper, kept);
+
+    printf("\nCluster %d (%d lessons):\n", number, count);
+    for (int i = 0; i < count; i++) {
+        int id = cluster[i].lesson_id;
+        sqlite3_bind_int(topic, 1, id);
+        const char *name = sqlite3_step(topic) == SQLITE_ROW
+                         ? (const char *)sqlite3_column_text(topic, 0) : "(deleted)";
+        if (id == keeper) {
+            printf("  keep   [%d] %s\n", id, name);
+        } else {
+            load_signature(load, id, other);
+            double score = similarity(kept, other);
+            cluster[i].merge = score >= dedup->threshold && !cluster[i].seeded;
+            if (cluster[i].merge) {
+                printf("  %.2f   [%d] %s\n", score, id, name);
+            } else {
+                dedup->stats.kept_apart++;
+                printf("  %.2f   [%d] %s (kept: %s)\n", score, id, name,
+                       cluster[i].seeded ? "seeded" : "below the threshold against the kept lesson");
+            }
+        }
+        sqlite3_reset(topic);
+    }
+}
+
+// Fold a duplicate into the kept lesson: its attachments move over, the
+// rest of it is deleted
+static int merge_lesson(sqlite3 *db, int keeper, int duplicate) {
+    const char *sql[] = {
+        "UPDATE attachments SET lesson_id = ?1 WHERE lesson_id = ?2;",
+        "DELETE FROM lesson_content WHERE lesson_id = ?2;",
+        "DELETE FROM lessons WHERE id = ?2;",
+    };
+    int rc = SQLITE_OK;
+    for (size_t s = 0; rc == SQLITE_OK && s < sizeof(sql) / sizeof(sql[0]); s++) {
+        sqlite3_stmt *stmt;
+        rc = sqlite3_prepare_v2(db, sql[s], -1, &stmt, NULL);
+        if (rc != SQLITE_OK) break;
+        sqlite3_bind_int(stmt, 1, keeper);
+        sqlite3_bind_int(stmt, 2, duplicate);
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db);
+        sqlite3_finalize(stmt);
+    }
+    return rc;
+}
+
+// Print every cluster and, with merge, keep one lesson of each in a single
+// replicated transaction
+static int report_clusters(Dedup *dedup, int merge) {
+    sqlite3 *db = dedup->db;
+    ClusterMember *members;
+    int total = cluster_members(dedup, &members);
+    if (total < 0) return SQLITE_NOMEM;
+
+    sqlite3_stmt *topic = NULL, *load = NULL, *seeded = NULL;
+    int rc = sqlite3_prepare_v2(db, "SELECT topic FROM lessons WHERE id = ?;", -1, &topic, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "SELECT signature FROM temp.dedup_signatures WHERE lesson_id = ?;",
+                                -1, &load, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "SELECT content_hash IS NOT NULL FROM lessons WHERE id = ?;",
+                                -1, &seeded, NULL);
+    }
+    for (int i = 0; rc == SQLITE_OK && i < total; i++) {
+        sqlite3_bind_int(seeded, 1, members[i].lesson_id);
+        members[i].seeded = sqlite3_step(seeded) == SQLITE_ROW && sqlite3_column_int(seeded, 0);
+        sqlite3_reset(seeded);
+    }
+    if (rc == SQLITE_OK && merge) rc = replica_capture_begin(db);
+
+    int merged = 0;
+    for (int first = 0, number = 1; rc == SQLITE_OK && first < total; number++) {
+        int count = 1;
+        while (first + count < total && members[first + count].root == members[first].root) count++;
+
+        int keeper = pick_keeper(&members[first], count);
+        print_cluster(dedup, topic, load, number, &members[first], count, keeper);
+        for (int i = 0; merge && rc == SQLITE_OK && i < count; i++) {
+            if (!members[first + i].merge) continue;
+            rc = merge_lesson(db, keeper, members[first + i].lesson_id);
+            merged++;
+        }
+        first += count;
+    }
+
+    if (merge) {
+        if (rc == SQLITE_OK) rc = replica_capture_commit(db);
+        if (rc == SQLITE_OK) {
+            printf("\n✓ Merged %d duplicate lesson(s) into %d kept lesson(s).\n", merged, dedup->stats.clusters);
+        } else {
+            fprintf(stderr, "Merge failed: %s\n", sqlite3_errmsg(db));
+            replica_capture_rollback(db);
+        }
+    }
+
+    sqlite3_finalize(topic);
+    sqlite3_finalize(load);
+    sqlite3_finalize(seeded);
+    free(members);
+    return rc;
+}
+
+static void print_stats(const Dedup *dedup) {
+    const DedupStats *stats = &dedup->stats;
+    printf("\n%d lessons (%d without words), %d thread(s)\n", stats->lessons, stats->skipped, dedup->threads);
+    printf("  signatures    %8.2f s\n", stats->signature_seconds);
+    printf("  candidates    %8.2f s   (%ld pairs compared, %ld at >= %.2f)\n", stats->candidate_seconds,
+           stats->bucket_pairs, stats->similar_pairs, dedup->threshold);
+    printf("  clusters      %8d     (%d duplicate lessons", stats->clusters, stats->duplicates);
+    if (stats->kept_apart > 0) printf(", %d kept apart from their cluster's lesson", stats->kept_apart);
+    printf(")\n");
+    printf("  peak memory   %8.1f MB\n", peak_rss_mb());
+}
+
+static int detect(Dedup *dedup) {
+    int rc = build_signatures(dedup);
+    if (rc == SQLITE_OK) rc = find_clusters(dedup);
+    return rc;
+}
+
+static void dedup_free(Dedup *dedup) {
+    free(dedup->parent);
+    dedup->parent = NULL;
+    sqlite3_exec(dedup->db, "DROP TABLE IF EXISTS temp.dedup_signatures;"
+                            "DROP TABLE IF EXISTS temp.dedup_bands;", NULL, NULL, NULL);
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+static unsigned bench_seed = 4242;
+
+static unsigned next_random(void) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return bench_seed >> 8;
+}
+
+static void bench_word(int n, char *word) {
+    static const char consonants[] = "bcdfghklmnprstvz";
+    static const char vowels[] = "aeiou";
+    int length = 0;
+    n++;
+    while (n > 0) {
+        word[length++] = consonants[n % 16];
+        n /= 16;
+        word[length++] = vowels[n % 5];
+        n /= 5;
+    }
+    word[length] = '\0';
+}
+
+// The words of original lesson n, the same every time
+static void original_words(int n, int *words) {
+    uint64_t state = mix64((uint64_t)n + 1);
+    for (int w = 0; w < BENCH_WORDS; w++) {
+        state = mix64(state);
+        words[w] = (int)(state % BENCH_VOCABULARY);
+    }
+}
+
+static void bench_text(const int *words, char *text, size_t size) {
+    size_t length = 0;
+    char word[32];
+    for (int w = 0; w < BENCH_WORDS; w++) {
+        bench_word(words[w], word);
+        length += snprintf(text + length, size - length, "%s ", word);
+    }
+}
+
+// Lessons of random words; BENCH_COPY_PERCENT of them copies of an
+// earlier lesson with BENCH_EDIT_PERCENT of the words replaced.
+// source[i] is the lesson lesson i + 1 copies, or 0.
+static int build_bench_db(sqlite3 *db, int lessons, int *source) {
+    sqlite3_stmt *lesson = NULL, *content = NULL;
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lessons (id, topic, category, difficulty, timestamp) "
+                                    "VALUES (?, ?, 'Synthetic', 1, ?);", -1, &lesson, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lesson_content (lesson_id, content) VALUES (?, ?);",
+                                -1, &content, NULL);
+    }
+
+    int words[BENCH_WORDS];
+    char text[BENCH_WORDS * 24];
+    for (int i = 0; rc == SQLITE_OK && i < lessons; i++) {
+        source[i] = 0;
+        if (i > 0 && (int)(next_random() % 100) < BENCH_COPY_PERCENT) {
+            int from = next_random() % i;
+            while (source[from]) from = source[from] - 1;   // Copy an original
+            source[i] = from + 1;
+            original_words(from, words);
+            for (int e = 0; e < BENCH_WORDS * BENCH_EDIT_PERCENT / 100; e++) {
+                words[next_random() % BENCH_WORDS] = next_random() % BENCH_VOCABULARY;
+            }
+        } else {
+            original_words(i, words);
+        }
+        bench_text(words, text, sizeof(text));
+
+        char topic[64];
+        snprintf(topic, sizeof(topic), "Bench lesson %d", i + 1);
+        sqlite3_bind_int(lesson, 1, i + 1);
+        sqlite3_bind_text(lesson, 2, topic, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(lesson, 3, (sqlite3_int64)time(NULL));
+        sqlite3_bind_int(content, 1, i + 1);
+        sqlite3_bind_text(content, 2, text, -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(lesson) != SQLITE_DONE || sqlite3_step(content) != SQLITE_DONE) {
+            rc = sqlite3_errcode(db);
+        }
+        sqlite3_reset(lesson);
+        sqlite3_reset(content);
+    }
+    sqlite3_finalize(lesson);
+    sqlite3_finalize(content);
+    sqlite3_exec(db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot build the bench corpus: %s\n", sqlite3_errmsg(db));
+    return rc;
+}
+
+static void remove_bench_db(void) {
+    const char *suffixes[] = { "", "-wal", "-shm", "-journal" };
+    char path[128];
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", BENCH_DB, suffixes[i]);
+        remove(path);
+    }
+}
+
+// Detection on one thread and on all of them, with the planted copies
+// that were found
+static int run_bench(int lessons, int threads, double threshold) {
+    remove_bench_db();
+    int *source = malloc(lessons * sizeof(int));
+    sqlite3 *db;
+    if (source == NULL || open_database(BENCH_DB, &db) != SQLITE_OK || build_bench_db(db, lessons, source) != SQLITE_OK) {
+        free(source);
+        close_database(db);
+        remove_bench_db();
+        return 1;
+    }
+
+    int copies = 0;
+    for (int i = 0; i < lessons; i++) copies += source[i] != 0;
+    printf("=== Near-Duplicate Detection (%d lessons of %d words, %d copies with %d%% of words changed) ===\n",
+           lessons, BENCH_WORDS, copies, BENCH_EDIT_PERCENT);
+
+    int thread_counts[2] = { 1, threads };
+    int rc = SQLITE_OK;
+    for (int run = 0; rc == SQLITE_OK && run < (threads > 1 ? 2 : 1); run++) {
+        Dedup dedup = { .db = db, .threads = thread_counts[run], .threshold = threshold };
+        rc = detect(&dedup);
+        if (rc != SQLITE_OK) break;
+
+        ClusterMember *members;
+        if (cluster_members(&dedup, &members) < 0) rc = SQLITE_NOMEM;
+        else free(members);
+
+        int found = 0, unplanted = 0;
+        for (int i = 0; i < lessons; i++) {
+            int id = i + 1;
+            int root = find_root(dedup.parent, id);
+            if (source[i]) {
+                found += root == find_root(dedup.parent, source[i]);
+            } else {
+                // Copies have higher ids than their original, so an original
+                // that is not its cluster's root was joined to another one
+                unplanted += root != id;
+            }
+        }
+        print_stats(&dedup);
+        printf("  planted copies found: %d of %d (%.1f%%); originals merged together: %d\n",
+               found, copies, copies ? 100.0 * found / copies : 0.0, unplanted);
+        dedup_free(&dedup);
+    }
+
+    free(source);
+    close_database(db);
+    remove_bench_db();
+    return rc == SQLITE_OK ? 0 : 1;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [--merge] [--threshold J] [--threads N]\n", program);
+    printf("       %s --bench [lessons] [--threshold J] [--threads N]\n", program);
+    printf("\n");
+    printf("  (no options)  Report clusters of lessons whose content is near-identical\n");
+    printf("  --merge       Keep one lesson per cluster (a seeded one if any, else the\n");
+    printf("                oldest) and fold in the others at the threshold against it,\n");
+    printf("                other than seeded ones; their attachments move to it\n");
+    printf("  --threshold   Estimated Jaccard similarity of word shingles (default %.2f)\n",
+           DEFAULT_THRESHOLD);
+    printf("  --threads     Signature threads (default: one per core)\n");
+    printf("  --bench       Time detection on a synthetic corpus in %s\n", BENCH_DB);
+}
+
+int main(int argc, char *argv[]) {
+    int merge = 0, bench = 0;
+    int bench_lessons = DEFAULT_BENCH_LESSONS;
+    double threshold = DEFAULT_THRESHOLD;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 0 ? (int)cores : 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--merge") == 0) {
+            merge = 1;
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-') bench_lessons = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threshold <= 0.0 || threshold > 1.0) threshold = DEFAULT_THRESHOLD;
+
+    init_hashes();
+    if (bench) return run_bench(bench_lessons > 1 ? bench_lessons : 2, threads, threshold);
+
+    sqlite3 *db;
+    if (init_database(&db) != SQLITE_OK) {
+        fprintf(stderr, "Failed to initialize database.\n");
+        close_database(db);
+        return 1;
+    }
+
+    CdcLog *cdc = NULL;
+    if (merge) {
+        cdc = cdc_open_from_env(db);
+        replica_capture_open(db, cdc);
+    }
+
+    Dedup dedup = { .db = db, .threads = threads, .threshold = threshold };
+    int rc = detect(&dedup);
+    if (rc == SQLITE_OK) rc = report_clusters(&dedup, merge);
+    if (rc == SQLITE_OK) {
+        if (dedup.stats.clusters == 0) printf("No near-duplicate lessons at >= %.2f.\n", threshold);
+        print_stats(&dedup);
+    }
+    dedup_free(&dedup);
+
+    if (merge) {
+        replica_capture_close(db);
+        cdc_close(cdc);
+    }
+    close_database(db);
+    return rc == SQLITE_OK ? 0 : 1;
+}
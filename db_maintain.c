@@ -0,0 +1,98 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_maintenance.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [--every seconds]\n", program);
+    printf("       %s --enable-incremental-vacuum\n", program);
+    printf("\n");
+    printf("  (no options)   Run checkpoint, PRAGMA optimize and incremental vacuum once\n");
+    printf("  --every        Keep running them on a timer until interrupted\n");
+    printf("  --enable-incremental-vacuum\n");
+    printf("                 Convert %s to auto_vacuum=INCREMENTAL (one full VACUUM)\n",
+           database_path());
+}
+
+static int enable_incremental_vacuum(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    int mode = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA auto_vacuum;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) mode = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (mode == 2) {
+        printf("%s already uses incremental vacuum.\n", database_path());
+        return 0;
+    }
+
+    // The setting only takes effect through a VACUUM, which rewrites the file
+    printf("Rewriting %s with auto_vacuum=INCREMENTAL...\n", database_path());
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char *err_msg = NULL;
+    int rc = sqlite3_exec(db, "PRAGMA auto_vacuum=INCREMENTAL; VACUUM;", NULL, NULL, &err_msg);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "VACUUM failed: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return 1;
+    }
+    printf("✓ Done in %.3f seconds\n",
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int every = 0;
+    int enable = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+            every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--enable-incremental-vacuum") == 0) {
+            enable = 1;
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    sqlite3 *db;
+    if (init_database(&db) != SQLITE_OK) {
+        fprintf(stderr, "Failed to initialize database.\n");
+        close_database(db);
+        return 1;
+    }
+
+    if (enable) {
+        int rc = enable_incremental_vacuum(db);
+        close_database(db);
+        return rc;
+    }
+
+    Maintenance maintenance;
+    maintenance_init(&maintenance);
+    const char *log_path = getenv(MAINTENANCE_LOG_ENV);
+    if (log_path && *log_path) maintenance.log = fopen(log_path, "a");
+
+    // Every run is printed here, whether or not it found anything to do
+    do {
+        maintenance_run(db, &maintenance);
+        maintenance_print(stdout, &maintenance.last);
+        fflush(stdout);
+
+        if (every > 0) {
+            struct timespec pause = { .tv_sec = every, .tv_nsec = 0 };
+            nanosleep(&pause, NULL);
+        }
+    } while (every > 0);
+
+    if (maintenance.log) fclose(maintenance.log);
+    close_database(db);
+    return 0;
+}
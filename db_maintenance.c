@@ -0,0 +1,207 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_maintenance.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define DEFAULT_CHECKPOINT_PAGES 1000
+#define DEFAULT_TRUNCATE_PAGES 4000
+#define DEFAULT_VACUUM_BATCH_PAGES 64
+#define DEFAULT_VACUUM_MAX_BATCHES 16
+#define DEFAULT_OPTIMIZE_SECONDS 3600
+#define DEFAULT_BUSY_MS 50
+
+#define WAL_HEADER_SIZE 32
+#define WAL_FRAME_HEADER_SIZE 24
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int pragma_int(sqlite3 *db, const char *sql) {
+    sqlite3_stmt *stmt;
+    int value = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+void maintenance_init(Maintenance *maintenance) {
+    memset(maintenance, 0, sizeof(*maintenance));
+    maintenance->checkpoint_pages = DEFAULT_CHECKPOINT_PAGES;
+    maintenance->truncate_pages = DEFAULT_TRUNCATE_PAGES;
+    maintenance->vacuum_batch_pages = DEFAULT_VACUUM_BATCH_PAGES;
+    maintenance->vacuum_max_batches = DEFAULT_VACUUM_MAX_BATCHES;
+    maintenance->optimize_seconds = DEFAULT_OPTIMIZE_SECONDS;
+    maintenance->busy_ms = DEFAULT_BUSY_MS;
+}
+
+// Pages the -wal file has room for, from its size, and its checkpoint
+// sequence number, which changes whenever a writer starts the log over;
+// 0 without one (in-memory or not WAL). A PASSIVE checkpoint leaves the
+// file as it is, so this only bounds the frames still to be copied.
+static int wal_file(sqlite3 *db, unsigned *sequence) {
+    *sequence = 0;
+    const char *path = sqlite3_db_filename(db, "main");
+    if (path == NULL || *path == '\0') return 0;
+
+    char wal_path[1024];
+    struct stat info;
+    snprintf(wal_path, sizeof(wal_path), "%s-wal", path);
+    if (stat(wal_path, &info) != 0 || info.st_size <= WAL_HEADER_SIZE) return 0;
+
+    unsigned char header[WAL_HEADER_SIZE];
+    FILE *file = fopen(wal_path, "rb");
+    if (file == NULL) return 0;
+    if (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        *sequence = (unsigned)header[12] << 24 | (unsigned)header[13] << 16 |
+                    (unsigned)header[14] << 8 | header[15];
+    }
+    fclose(file);
+
+    int page_size = pragma_int(db, "PRAGMA page_size;");
+    if (page_size <= 0) return 0;
+    return (int)((info.st_size - WAL_HEADER_SIZE) / (page_size + WAL_FRAME_HEADER_SIZE));
+}
+
+static void checkpoint(sqlite3 *db, Maintenance *maintenance, MaintenanceReport *report) {
+    report->checkpoint_mode = -1;
+    unsigned sequence;
+    int file_pages = wal_file(db, &sequence);
+    report->wal_pages = file_pages;
+    if (file_pages < maintenance->checkpoint_pages) return;
+
+    // PASSIVE copies only frames not copied yet, and reports how many
+    // frames the log really holds
+    int log_pages = 0, checkpointed = 0;
+    double start = now_seconds();
+    int rc = sqlite3_wal_checkpoint_v2(db, "main", SQLITE_CHECKPOINT_PASSIVE, &log_pages, &checkpointed);
+    report->checkpoint_seconds = now_seconds() - start;
+    if (rc != SQLITE_OK) {
+        report->skipped++;
+        return;
+    }
+    report->wal_pages = log_pages;
+
+    // Frames copied by an earlier run over the same log do not count again
+    int previous = sequence == maintenance->wal_sequence ? maintenance->wal_checkpointed : 0;
+    int copied = checkpointed > previous ? checkpointed - previous : 0;
+    maintenance->wal_sequence = sequence;
+    maintenance->wal_checkpointed = checkpointed;
+
+    // The file only shrinks when the log restarts; past truncate_pages
+    // make it restart now. Readers on old snapshots keep it for next time.
+    int mode = SQLITE_CHECKPOINT_PASSIVE;
+    if (file_pages >= maintenance->truncate_pages) {
+        rc = sqlite3_wal_checkpoint_v2(db, "main", SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL);
+        report->checkpoint_seconds = now_seconds() - start;
+        if (rc == SQLITE_OK) {
+            mode = SQLITE_CHECKPOINT_TRUNCATE;
+            maintenance->wal_checkpointed = 0;
+        } else {
+            report->skipped++;
+        }
+    }
+
+    // An idle log that was copied already is not a checkpoint worth a line
+    if (copied == 0 && mode == SQLITE_CHECKPOINT_PASSIVE) return;
+    report->checkpoint_mode = mode;
+    report->checkpointed_pages = copied;
+}
+
+static void optimize(sqlite3 *db, Maintenance *maintenance, MaintenanceReport *report) {
+    time_t now = time(NULL);
+    if (maintenance->last_optimize != 0 &&
+        now - maintenance->last_optimize < maintenance->optimize_seconds) {
+        return;
+    }
+
+    double start = now_seconds();
+    int rc = sqlite3_exec(db, "PRAGMA optimize;", NULL, NULL, NULL);
+    report->optimize_seconds = now_seconds() - start;
+
+    if (rc == SQLITE_OK) {
+        report->optimized = 1;
+        maintenance->last_optimize = now;
+    } else {
+        report->skipped++;
+    }
+}
+
+static void incremental_vacuum(sqlite3 *db, Maintenance *maintenance, MaintenanceReport *report) {
+    report->freelist_pages = pragma_int(db, "PRAGMA freelist_count;");
+    report->vacuum_enabled = pragma_int(db, "PRAGMA auto_vacuum;") == 2;
+    if (report->freelist_pages <= 0 || !report->vacuum_enabled) return;
+
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA incremental_vacuum(%d);", maintenance->vacuum_batch_pages);
+
+    double start = now_seconds();
+    while (report->freelist_pages > 0 && report->vacuum_batches < maintenance->vacuum_max_batches) {
+        // Each batch is its own write transaction
+        if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+            report->skipped++;
+            break;
+        }
+        int left = pragma_int(db, "PRAGMA freelist_count;");
+        report->vacuumed_pages += report->freelist_pages - left;
+        report->freelist_pages = left;
+        report->vacuum_batches++;
+    }
+    report->vacuum_seconds = now_seconds() - start;
+}
+
+int maintenance_run(sqlite3 *db, Maintenance *maintenance) {
+    MaintenanceReport report;
+    memset(&report, 0, sizeof(report));
+
+    // Short lock waits: a busy database means the step waits for next time
+    sqlite3_busy_timeout(db, maintenance->busy_ms);
+    checkpoint(db, maintenance, &report);
+    optimize(db, maintenance, &report);
+    incremental_vacuum(db, maintenance, &report);
+    sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
+
+    maintenance->last = report;
+    if (maintenance->log && (report.checkpoint_mode >= 0 || report.optimized ||
+                             report.vacuumed_pages > 0 || report.skipped > 0)) {
+        maintenance_print(maintenance->log, &report);
+        fflush(maintenance->log);
+    }
+    return report.skipped ? SQLITE_BUSY : SQLITE_OK;
+}
+
+void maintenance_job(sqlite3 *db, void *arg) {
+    maintenance_run(db, arg);
+}
+
+void maintenance_print(FILE *out, const MaintenanceReport *report) {
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_now);
+
+    fprintf(out, "%s  wal %d pages", stamp, report->wal_pages);
+    if (report->checkpoint_mode >= 0) {
+        fprintf(out, ", %s checkpoint %d pages (%.1f ms)",
+                report->checkpoint_mode == SQLITE_CHECKPOINT_TRUNCATE ? "truncate" : "passive",
+                report->checkpointed_pages, report->checkpoint_seconds * 1e3);
+    }
+    if (report->optimized) {
+        fprintf(out, ", optimize (%.1f ms)", report->optimize_seconds * 1e3);
+    }
+    if (report->vacuum_batches > 0) {
+        fprintf(out, ", vacuumed %d pages in %d batch(es) (%.1f ms)",
+                report->vacuumed_pages, report->vacuum_batches, report->vacuum_seconds * 1e3);
+    }
+    fprintf(out, ", %d free pages left", report->freelist_pages);
+    if (report->freelist_pages > 0 && !report->vacuum_enabled) fprintf(out, " (auto_vacuum is off)");
+    if (report->skipped) fprintf(out, ", %d step(s) skipped while busy", report->skipped);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,65 @@
+#ifndef DB_MAINTENANCE_H
+#define DB_MAINTENANCE_H
+
+#include "db_common.h"
+#include <stdio.h>
+
+// Environment variable naming a file that maintenance runs are logged to
+#define MAINTENANCE_LOG_ENV "LESSONS_MAINTENANCE_LOG"
+
+// Housekeeping that keeps lessons.db small and its plans good:
+//   - WAL checkpoints: PASSIVE once the -wal file holds checkpoint_pages,
+//     reported only when it copied frames, then TRUNCATE, which also
+//     shrinks the file, past truncate_pages
+//   - PRAGMA optimize (refreshes planner statistics that went stale),
+//     at most every optimize_seconds
+//   - PRAGMA incremental_vacuum, vacuum_batch_pages at a time in separate
+//     transactions, so writers get the lock between batches
+// Every step waits at most busy_ms for a lock and is skipped otherwise;
+// the foreground programs always win. incremental_vacuum needs
+// auto_vacuum=INCREMENTAL, which new databases get; older ones can be
+// converted once with `db_maintain --enable-incremental-vacuum`.
+typedef struct {
+    int wal_pages;              // Frames in the WAL (its file size if not checkpointed)
+    int checkpoint_mode;        // SQLITE_CHECKPOINT_PASSIVE / _TRUNCATE, or -1
+    int checkpointed_pages;     // Copied by this run
+    int optimized;
+    int vacuumed_pages;
+    int vacuum_batches;
+    int freelist_pages;         // Free pages left in the file
+    int vacuum_enabled;         // auto_vacuum=INCREMENTAL
+    int skipped;                // Steps given up because the database was busy
+    double checkpoint_seconds;
+    double optimize_seconds;
+    double vacuum_seconds;
+} MaintenanceReport;
+
+typedef struct {
+    // Settings; maintenance_init() fills in the defaults
+    int checkpoint_pages;
+    int truncate_pages;
+    int vacuum_batch_pages;
+    int vacuum_max_batches;     // Per run
+    int optimize_seconds;
+    int busy_ms;
+    FILE *log;                  // Runs that did something; NULL for none
+
+    // State between runs
+    time_t last_optimize;
+    unsigned wal_sequence;      // WAL checkpoint sequence at the last run
+    int wal_checkpointed;       // Frames of that log already copied
+    MaintenanceReport last;
+} Maintenance;
+
+void maintenance_init(Maintenance *maintenance);
+
+// One pass over all steps; the result is also kept in maintenance->last
+int maintenance_run(sqlite3 *db, Maintenance *maintenance);
+
+// maintenance_run() as a DbJobFn, with the Maintenance as its argument
+void maintenance_job(sqlite3 *db, void *arg);
+
+// Write one line describing report (with a timestamp) to out
+void maintenance_print(FILE *out, const MaintenanceReport *report);
+
+#endif // DB_MAINTENANCE_H
@@ -1,8 +1,115 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "db_common.h"
+#include "db_attachments.h"
+#include "db_complete.h"
+#include "db_replica.h"
+#include "db_search.h"
+#include "db_similar.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <termios.h>
 #include <time.h>
+#include <unistd.h>
+
+#define COMPLETION_LIST 5
+
+// Topic and category completion, open when stdin is a terminal
+static CompleteIndex *complete_index = NULL;
+
+// Characters (not bytes) in UTF-8 text
+static int text_columns(const char *text) {
+    int columns = 0;
+    for (; *text; text++) columns += ((unsigned char)*text & 0xC0) != 0x80;
+    return columns;
+}
+
+// The rest of the best completion, dimmed after the cursor
+static void show_suggestion(size_t typed, const Completion *completions, int count) {
+    printf("\033[K");
+    if (count > 0 && strlen(completions[0].text) > typed) {
+        const char *rest = completions[0].text + typed;
+        printf("\033[2m%s\033[0m\033[%dD", rest, text_columns(rest));
+    }
+    fflush(stdout);
+}
+
+// Print prompt and read a line into buffer, without the newline; 0 at end
+// of input. On a terminal the most popular value of field starting with
+// what has been typed is shown as you type: Tab takes it, and Tab with
+// nothing left to add lists the top few.
+static int read_completed(const char *prompt, CompleteField field, char *buffer, size_t size) {
+    printf("%s", prompt);
+    if (complete_index == NULL || !isatty(STDIN_FILENO)) {
+        if (fgets(buffer, size, stdin) == NULL) {
+            buffer[0] = '\0';
+            return 0;
+        }
+        buffer[strcspn(buffer, "\n")] = 0;
+        return 1;
+    }
+
+    complete_refresh(complete_index);
+    struct termios saved, raw;
+    tcgetattr(STDIN_FILENO, &saved);
+    raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+    size_t length = 0;
+    buffer[0] = '\0';
+    Completion completions[COMPLETION_LIST];
+    int count = complete_prefix(complete_index, field, buffer, COMPLETION_LIST, completions);
+    show_suggestion(length, completions, count);
+
+    int c;
+    while ((c = getchar()) != EOF && c != '\n' && c != '\r') {
+        if (c == '\t' && count > 0 && strlen(completions[0].text) > length &&
+            strlen(completions[0].text) < size) {
+            // Retype what was typed in the completion's own case. ESC[0D
+            // would still move one column, so nothing typed means no move.
+            int columns = text_columns(buffer);
+            if (columns > 0) printf("\033[%dD", columns);
+            printf("%s", completions[0].text);
+            strcpy(buffer, completions[0].text);
+            length = strlen(buffer);
+        } else if (c == '\t' && count > 0) {
+            printf("\033[K\n");
+            for (int i = 0; i < count; i++) {
+                printf("  %s (%d)\n", completions[i].text, completions[i].popularity);
+            }
+            printf("%s%s", prompt, buffer);
+        } else if (c == 127 || c == '\b') {
+            // Drop one character, with its UTF-8 continuation bytes
+            if (length == 0) continue;
+            while (length > 0 && ((unsigned char)buffer[--length] & 0xC0) == 0x80) {}
+            buffer[length] = '\0';
+            printf("\b");
+        } else if (c == 27) {
+            // Arrow and function keys: ESC [ parameters final byte
+            if (getchar() == '[') {
+                while ((c = getchar()) != EOF && !(c >= '@' && c <= '~')) {}
+            }
+            if (c == EOF) break;
+            continue;
+        } else if ((unsigned char)c >= 32 && length + 1 < size) {
+            buffer[length++] = (char)c;
+            buffer[length] = '\0';
+            putchar(c);
+        } else {
+            continue;
+        }
+        count = complete_prefix(complete_index, field, buffer, COMPLETION_LIST, completions);
+        show_suggestion(length, completions, count);
+    }
+
+    printf("\033[K\n");
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    return c != EOF || length > 0;
+}
 
 void print_menu() {
     printf("\n=== Systems Programming Lesson Database ===\n");
@@ -13,6 +120,8 @@ void print_menu() {
     printf("5. Delete lesson\n");
     printf("6. List by category\n");
     printf("7. List by difficulty\n");
+    printf("8. Attach file to lesson\n");
+    printf("9. Export attachment\n");
     printf("0. Exit\n");
     printf("Choose an option: ");
 }
@@ -26,9 +135,7 @@ int add_lesson(sqlite3 *db) {
     fgets(topic, sizeof(topic), stdin);
     topic[strcspn(topic, "\n")] = 0;
 
-    printf("Category: ");
-    fgets(category, sizeof(category), stdin);
-    category[strcspn(category, "\n")] = 0;
+    read_completed("Category: ", COMPLETE_CATEGORY, category, sizeof(category));
 
     printf("Difficulty (1=Beginner, 2=Intermediate, 3=Advanced, 4=Expert): ");
     scanf("%d", &difficulty);
@@ -49,15 +156,18 @@ int add_lesson(sqlite3 *db) {
         }
     }
 
-    // Use prepared statement for security
-    const char *sql = "INSERT INTO lessons (topic, category, difficulty, content, timestamp) "
-                      "VALUES (?, ?, ?, ?, ?);";
+    // Use prepared statements for security
+    const char *sql = "INSERT INTO lessons (topic, category, difficulty, timestamp) "
+                      "VALUES (?, ?, ?, ?);";
+    const char *sql_content = "INSERT INTO lesson_content (lesson_id, content) VALUES (?, ?);";
 
-    sqlite3_stmt *stmt;
+    sqlite3_stmt *stmt, *content_stmt = NULL;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) rc = sqlite3_prepare_v2(db, sql_content, -1, &content_stmt, NULL);
 
     if (rc != SQLITE_OK) {
         fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
         return rc;
     }
 
@@ -66,41 +176,83 @@ int add_lesson(sqlite3 *db) {
     sqlite3_bind_text(stmt, 1, topic, -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, category, -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 3, difficulty);
-    sqlite3_bind_text(stmt, 4, content, -1, SQLITE_STATIC);
-    sqlite3_bind_int64(stmt, 5, now);
+    sqlite3_bind_int64(stmt, 4, now);
 
+    replica_capture_begin(db);
     rc = sqlite3_step(stmt);
+    sqlite3_int64 id = sqlite3_last_insert_rowid(db);
+
+    if (rc == SQLITE_DONE) {
+        sqlite3_bind_int64(content_stmt, 1, id);
+        sqlite3_bind_text(content_stmt, 2, content, -1, SQLITE_STATIC);
+        rc = sqlite3_step(content_stmt);
+    }
 
     if (rc != SQLITE_DONE) {
         fprintf(stderr, "Execution failed: %s\n", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
+        sqlite3_finalize(content_stmt);
+        replica_capture_rollback(db);
         return rc;
     }
 
-    printf("\nLesson added successfully! ID: %lld\n", sqlite3_last_insert_rowid(db));
     sqlite3_finalize(stmt);
+    sqlite3_finalize(content_stmt);
+
+    rc = replica_capture_commit(db);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+
+    printf("\nLesson added successfully! ID: %lld\n", id);
     return SQLITE_OK;
 }
 
-void print_lesson(sqlite3_stmt *stmt) {
+#define MAX_LISTED_ATTACHMENTS 16
+
+// Listings select metadata only (id, topic, category, difficulty,
+// timestamp) from lessons; the body is looked up by id as each lesson
+// is printed.
+void print_lesson(sqlite3 *db, sqlite3_stmt *stmt) {
     int id = sqlite3_column_int(stmt, 0);
     const unsigned char *topic = sqlite3_column_text(stmt, 1);
     const unsigned char *category = sqlite3_column_text(stmt, 2);
     int difficulty = sqlite3_column_int(stmt, 3);
-    const unsigned char *content = sqlite3_column_text(stmt, 4);
-    time_t timestamp = sqlite3_column_int64(stmt, 5);
+    time_t timestamp = sqlite3_column_int64(stmt, 4);
+
+    sqlite3_stmt *content_stmt;
+    const unsigned char *content = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT content FROM lesson_content WHERE lesson_id = ?;",
+                           -1, &content_stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(content_stmt, 1, id);
+        if (sqlite3_step(content_stmt) == SQLITE_ROW) content = sqlite3_column_text(content_stmt, 0);
+    }
 
     printf("\n--- Lesson ID: %d ---\n", id);
     printf("Topic: %s\n", topic);
     printf("Category: %s\n", category);
     printf("Difficulty: %s\n", get_difficulty_string(difficulty));
     printf("Created: %s", ctime(&timestamp));
-    printf("Content:\n%s\n", content);
+    printf("Content:\n%s\n", content ? (const char *)content : "");
+    sqlite3_finalize(content_stmt);
+
+    Attachment attachments[MAX_LISTED_ATTACHMENTS];
+    int count = attachment_list(db, id, attachments, MAX_LISTED_ATTACHMENTS);
+    if (count > 0) {
+        printf("Attachments:\n");
+        for (int i = 0; i < count && i < MAX_LISTED_ATTACHMENTS; i++) {
+            printf("  [%lld] %s (%lld bytes)\n", attachments[i].id, attachments[i].name,
+                   attachments[i].size);
+        }
+        if (count > MAX_LISTED_ATTACHMENTS) {
+            printf("  ... and %d more\n", count - MAX_LISTED_ATTACHMENTS);
+        }
+    }
     printf("-------------------\n");
 }
 
 int view_all_lessons(sqlite3 *db) {
-    const char *sql = "SELECT id, topic, category, difficulty, content, timestamp "
+    const char *sql = "SELECT id, topic, category, difficulty, timestamp "
                       "FROM lessons ORDER BY id;";
 
     sqlite3_stmt *stmt;
@@ -113,7 +265,7 @@ int view_all_lessons(sqlite3 *db) {
 
     int count = 0;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        print_lesson(stmt);
+        print_lesson(db, stmt);
         count++;
     }
 
@@ -127,14 +279,49 @@ int view_all_lessons(sqlite3 *db) {
     return SQLITE_OK;
 }
 
+#define FUZZY_RESULTS 5
+
+// Opened by the first search that LIKE cannot answer
+static SearchIndex *search_index = NULL;
+
+// Lessons matching search_term with typos allowed, when LIKE found none
+static void fuzzy_search(sqlite3 *db, const char *search_term) {
+    if (search_index == NULL) {
+        search_index = search_open(db);
+        if (search_index == NULL) return;
+    } else if (search_refresh(search_index) != SQLITE_OK) {
+        return;
+    }
+
+    SearchMatch matches[FUZZY_RESULTS];
+    char corrected[256];
+    int count = search_fuzzy(search_index, search_term, FUZZY_RESULTS, matches,
+                             corrected, sizeof(corrected));
+    if (count == 0) return;
+
+    const char *sql = "SELECT id, topic, category, difficulty, timestamp FROM lessons WHERE id = ?;";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        return;
+    }
+
+    printf("Did you mean \"%s\"? Closest lessons:\n", corrected);
+    for (int i = 0; i < count; i++) {
+        sqlite3_bind_int(stmt, 1, matches[i].lesson_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) print_lesson(db, stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+}
+
 int search_lessons(sqlite3 *db) {
     char search_term[256];
-    printf("Enter search term: ");
-    fgets(search_term, sizeof(search_term), stdin);
-    search_term[strcspn(search_term, "\n")] = 0;
+    read_completed("Enter search term: ", COMPLETE_TOPIC, search_term, sizeof(search_term));
 
-    const char *sql = "SELECT id, topic, category, difficulty, content, timestamp "
-                      "FROM lessons WHERE topic LIKE ? OR category LIKE ? OR content LIKE ?;";
+    const char *sql = "SELECT id, topic, category, difficulty, timestamp "
+                      "FROM lessons l WHERE topic LIKE ?1 OR category LIKE ?1 OR EXISTS ("
+                      "SELECT 1 FROM lesson_content c WHERE c.lesson_id = l.id AND c.content LIKE ?1);";
 
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
@@ -148,17 +335,18 @@ int search_lessons(sqlite3 *db) {
     snprintf(pattern, sizeof(pattern), "%%%s%%", search_term);
 
     sqlite3_bind_text(stmt, 1, pattern, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, pattern, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, pattern, -1, SQLITE_TRANSIENT);
 
     int count = 0;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        print_lesson(stmt);
+        print_lesson(db, stmt);
         count++;
     }
 
     if (count == 0) {
         printf("\nNo matching lessons found.\n");
+        sqlite3_finalize(stmt);
+        fuzzy_search(db, search_term);
+        return SQLITE_OK;
     } else {
         printf("\nFound %d lesson(s).\n", count);
     }
@@ -167,13 +355,47 @@ int search_lessons(sqlite3 *db) {
     return SQLITE_OK;
 }
 
+#define RELATED_LESSONS 5
+
+// Opened on first use; refreshed before each lookup, which is cheap when
+// no lesson changed
+static SimilarIndex *similar_index = NULL;
+
+static void print_related_lessons(sqlite3 *db, int id) {
+    if (similar_index == NULL) {
+        similar_index = similar_open(db);
+        if (similar_index == NULL) return;
+    } else if (similar_refresh(similar_index) != SQLITE_OK) {
+        return;
+    }
+
+    SimilarMatch matches[RELATED_LESSONS];
+    int count = similar_to_lesson(similar_index, id, RELATED_LESSONS, matches);
+    if (count <= 0) return;
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT topic FROM lessons WHERE id = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        return;
+    }
+    printf("Related lessons:\n");
+    for (int i = 0; i < count; i++) {
+        sqlite3_bind_int(stmt, 1, matches[i].lesson_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            printf("  [%d] %s (%.2f)\n", matches[i].lesson_id, sqlite3_column_text(stmt, 0),
+                   matches[i].score);
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+}
+
 int view_lesson_by_id(sqlite3 *db) {
     int id;
     printf("Enter lesson ID: ");
     scanf("%d", &id);
     getchar();
 
-    const char *sql = "SELECT id, topic, category, difficulty, content, timestamp "
+    const char *sql = "SELECT id, topic, category, difficulty, timestamp "
                       "FROM lessons WHERE id = ?;";
 
     sqlite3_stmt *stmt;
@@ -189,7 +411,10 @@ int view_lesson_by_id(sqlite3 *db) {
     rc = sqlite3_step(stmt);
 
     if (rc == SQLITE_ROW) {
-        print_lesson(stmt);
+        print_lesson(db, stmt);
+        sqlite3_finalize(stmt);
+        print_related_lessons(db, id);
+        return SQLITE_OK;
     } else if (rc == SQLITE_DONE) {
         printf("\nLesson not found.\n");
     } else {
@@ -237,36 +462,47 @@ int delete_lesson(sqlite3 *db) {
         return SQLITE_OK;
     }
 
-    // Delete the lesson
-    const char *sql_delete = "DELETE FROM lessons WHERE id = ?;";
-    rc = sqlite3_prepare_v2(db, sql_delete, -1, &stmt, NULL);
+    // Delete the lesson, its body and its attachments
+    const char *sql_delete[] = {
+        "DELETE FROM attachments WHERE lesson_id = ?;",
+        "DELETE FROM lesson_content WHERE lesson_id = ?;",
+        "DELETE FROM lessons WHERE id = ?;"
+    };
+
+    replica_capture_begin(db);
+    for (int i = 0; i < 3; i++) {
+        rc = sqlite3_prepare_v2(db, sql_delete[i], -1, &stmt, NULL);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+            replica_capture_rollback(db);
+            return rc;
+        }
 
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
-        return rc;
-    }
+        sqlite3_bind_int(stmt, 1, id);
+        rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
 
-    sqlite3_bind_int(stmt, 1, id);
-    rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            fprintf(stderr, "Deletion failed: %s\n", sqlite3_errmsg(db));
+            replica_capture_rollback(db);
+            return rc;
+        }
+    }
 
-    if (rc != SQLITE_DONE) {
-        fprintf(stderr, "Deletion failed: %s\n", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
+    rc = replica_capture_commit(db);
+    if (rc != SQLITE_OK) {
         return rc;
     }
 
     printf("\nLesson deleted successfully.\n");
-    sqlite3_finalize(stmt);
     return SQLITE_OK;
 }
 
 int list_by_category(sqlite3 *db) {
     char category[128];
-    printf("Enter category: ");
-    fgets(category, sizeof(category), stdin);
-    category[strcspn(category, "\n")] = 0;
+    read_completed("Enter category: ", COMPLETE_CATEGORY, category, sizeof(category));
 
-    const char *sql = "SELECT id, topic, category, difficulty, content, timestamp "
+    const char *sql = "SELECT id, topic, category, difficulty, timestamp "
                       "FROM lessons WHERE category = ? ORDER BY difficulty, topic;";
 
     sqlite3_stmt *stmt;
@@ -281,7 +517,7 @@ int list_by_category(sqlite3 *db) {
 
     int count = 0;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        print_lesson(stmt);
+        print_lesson(db, stmt);
         count++;
     }
 
@@ -306,7 +542,7 @@ int list_by_difficulty(sqlite3 *db) {
         return -1;
     }
 
-    const char *sql = "SELECT id, topic, category, difficulty, content, timestamp "
+    const char *sql = "SELECT id, topic, category, difficulty, timestamp "
                       "FROM lessons WHERE difficulty = ? ORDER BY category, topic;";
 
     sqlite3_stmt *stmt;
@@ -321,7 +557,7 @@ int list_by_difficulty(sqlite3 *db) {
 
     int count = 0;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        print_lesson(stmt);
+        print_lesson(db, stmt);
         count++;
     }
 
@@ -335,6 +571,91 @@ int list_by_difficulty(sqlite3 *db) {
     return SQLITE_OK;
 }
 
+int attach_file(sqlite3 *db) {
+    int id;
+    printf("Enter lesson ID: ");
+    scanf("%d", &id);
+    getchar();
+
+    const char *sql_check = "SELECT topic FROM lessons WHERE id = ?;";
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql_check, -1, &stmt, NULL);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        return rc;
+    }
+
+    sqlite3_bind_int(stmt, 1, id);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_ROW) {
+        printf("\nLesson with ID %d not found.\n", id);
+        return SQLITE_OK;
+    }
+
+    char path[1024];
+    printf("File to attach: ");
+    fgets(path, sizeof(path), stdin);
+    path[strcspn(path, "\n")] = 0;
+
+    // Streamed into the database in chunks; the file is never loaded whole
+    sqlite3_int64 attachment_id;
+    replica_capture_begin(db);
+    rc = attachment_import(db, id, path, &attachment_id);
+
+    if (rc != SQLITE_OK) {
+        replica_capture_rollback(db);
+        printf("\nAttachment failed.\n");
+        return rc;
+    }
+
+    rc = replica_capture_commit(db);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+
+    Attachment attachment;
+    if (attachment_get(db, attachment_id, &attachment) == SQLITE_OK) {
+        printf("\nAttached %s (%lld bytes) to lesson %d. Attachment ID: %lld\n",
+               attachment.name, attachment.size, id, attachment_id);
+    }
+    return SQLITE_OK;
+}
+
+int export_attachment(sqlite3 *db) {
+    long long id;
+    printf("Enter attachment ID: ");
+    scanf("%lld", &id);
+    getchar();
+
+    Attachment attachment;
+    int rc = attachment_get(db, id, &attachment);
+    if (rc == SQLITE_NOTFOUND) {
+        printf("\nAttachment with ID %lld not found.\n", id);
+        return SQLITE_OK;
+    }
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Query failed: %s\n", sqlite3_errmsg(db));
+        return rc;
+    }
+
+    char path[1024];
+    printf("Save as (empty for ./%s): ", attachment.name);
+    fgets(path, sizeof(path), stdin);
+    path[strcspn(path, "\n")] = 0;
+    if (path[0] == '\0') snprintf(path, sizeof(path), "%s", attachment.name);
+
+    rc = attachment_export(db, id, path);
+    if (rc == SQLITE_OK) {
+        printf("\nWrote %lld bytes to %s.\n", attachment.size, path);
+    } else {
+        printf("\nExport failed.\n");
+    }
+    return rc;
+}
+
 int main() {
     sqlite3 *db;
     int rc = init_database(&db);
@@ -344,7 +665,11 @@ int main() {
         return 1;
     }
 
-    printf("Database initialized successfully. Using file: %s\n", DB_FILE);
+    printf("Database initialized successfully. Using file: %s\n", database_path());
+
+    CdcLog *cdc = cdc_open_from_env(db);
+    replica_capture_open(db, cdc);
+    if (isatty(STDIN_FILENO)) complete_index = complete_open(db);
 
     int choice;
     while (1) {
@@ -374,8 +699,19 @@ int main() {
             case 7:
                 list_by_difficulty(db);
                 break;
+            case 8:
+                attach_file(db);
+                break;
+            case 9:
+                export_attachment(db);
+                break;
             case 0:
                 printf("Exiting...\n");
+                similar_close(similar_index);
+                search_close(search_index);
+                complete_close(complete_index);
+                replica_capture_close(db);
+                cdc_close(cdc);
                 close_database(db);
                 return 0;
             default:
@@ -383,6 +719,11 @@ int main() {
         }
     }
 
+    similar_close(similar_index);
+    search_close(search_index);
+    complete_close(complete_index);
+    replica_capture_close(db);
+    cdc_close(cdc);
     close_database(db);
     return 0;
 }
@@ -0,0 +1,455 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// In-memory connections open in this process; like replica captures, a
+// program rarely has more than one
+#define MAX_MEMORY_DBS 4
+
+#define JOURNAL_SUFFIX "-memjournal"
+#define JOURNAL_HEADER "-- lessons memory journal, generation %lld\n"
+#define TXN_END "-- end of transaction\n"
+// Follows an INSERT: the rowid it produced, checked on replay
+#define ROWID_PREFIX "-- rowid "
+#define ROWID_MARK ROWID_PREFIX "%lld\n"
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
+typedef struct {
+    sqlite3 *db;                // In-memory connection handed to the caller
+    sqlite3 *file;              // Connection to the file that flushes write to
+    char *journal_path;
+    FILE *journal;
+    sqlite3_int64 generation;   // Of the journal being written
+    sqlite3_int64 file_version; // file's data_version when loaded
+    TextBuffer txn;             // Write statements of the open transaction
+    TextBuffer pending;         // Committed transactions not yet flushed
+    sqlite3_int64 changes_before;
+    double flush_seconds;
+    struct timespec last_flush;
+    int failed;                 // Out of memory or journal write error
+} MemoryDb;
+
+static MemoryDb memories[MAX_MEMORY_DBS];
+
+static MemoryDb* find_memory(sqlite3 *db) {
+    for (int i = 0; i < MAX_MEMORY_DBS; i++) {
+        if (memories[i].db == db) return &memories[i];
+    }
+    return NULL;
+}
+
+static int buffer_append(TextBuffer *buf, const char *text, size_t length) {
+    if (buf->length + length + 1 > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity * 2 : 4096;
+        while (capacity < buf->length + length + 1) capacity *= 2;
+
+        char *data = realloc(buf->data, capacity);
+        if (data == NULL) return 0;
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    memcpy(buf->data + buf->length, text, length);
+    buf->length += length;
+    buf->data[buf->length] = '\0';
+    return 1;
+}
+
+static double seconds_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int memory_mode_requested(void) {
+    const char *value = getenv(MEMORY_MODE_ENV);
+    return value && *value && strcmp(value, "0") != 0;
+}
+
+// ============================================================================
+// JOURNAL
+// ============================================================================
+
+// Run the statements in sql, stopping at the first that fails or whose
+// INSERT got a different rowid than it did in memory: anything after it
+// could land on the wrong rows
+static int run_statements(sqlite3 *db, const char *sql) {
+    const char *tail = sql;
+
+    while (tail && *tail) {
+        while (*tail == ' ' || *tail == '\n' || *tail == '\t') tail++;
+
+        if (strncmp(tail, ROWID_PREFIX, strlen(ROWID_PREFIX)) == 0) {
+            long long rowid = strtoll(tail + strlen(ROWID_PREFIX), NULL, 10);
+            if (sqlite3_last_insert_rowid(db) != rowid) {
+                fprintf(stderr, "Journal replay: insert got rowid %lld, expected %lld\n",
+                        (long long)sqlite3_last_insert_rowid(db), rowid);
+                return SQLITE_MISMATCH;
+            }
+            tail = strchr(tail, '\n');
+            continue;
+        }
+
+        sqlite3_stmt *stmt;
+        int rc = sqlite3_prepare_v2(db, tail, -1, &stmt, &tail);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Journal statement failed: %s\n", sqlite3_errmsg(db));
+            return rc;
+        }
+        if (stmt == NULL) continue;  // Comment or empty statement
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {}
+        rc = sqlite3_finalize(stmt);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Journal statement failed: %s\n", sqlite3_errmsg(db));
+            return rc;
+        }
+    }
+    return SQLITE_OK;
+}
+
+static sqlite3_int64 data_version(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA data_version;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+static int start_journal(MemoryDb *memory) {
+    if (memory->journal) fclose(memory->journal);
+
+    memory->journal = fopen(memory->journal_path, "w");
+    if (memory->journal == NULL) {
+        fprintf(stderr, "Cannot write %s\n", memory->journal_path);
+        return SQLITE_CANTOPEN;
+    }
+
+    fprintf(memory->journal, JOURNAL_HEADER, memory->generation);
+    fflush(memory->journal);
+    return SQLITE_OK;
+}
+
+static int flush_memory(MemoryDb *memory) {
+    clock_gettime(CLOCK_MONOTONIC, &memory->last_flush);
+    if (memory->pending.length == 0) return SQLITE_OK;
+
+    int rc = sqlite3_exec(memory->file, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot flush to the database file: %s\n", sqlite3_errmsg(memory->file));
+        return rc;
+    }
+
+    // The copy in memory was the file as loaded; if anyone else has
+    // committed since, replaying statements would not reproduce it
+    if (data_version(memory->file) != memory->file_version) {
+        fprintf(stderr, "Cannot flush: another connection wrote to the database file since it "
+                        "was loaded; writes are kept in %s\n", memory->journal_path);
+        sqlite3_exec(memory->file, "ROLLBACK;", NULL, NULL, NULL);
+        return SQLITE_BUSY;
+    }
+
+    rc = run_statements(memory->file, memory->pending.data);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot flush: writes are kept in %s\n", memory->journal_path);
+        sqlite3_exec(memory->file, "ROLLBACK;", NULL, NULL, NULL);
+        return rc;
+    }
+
+    // Recorded in the same transaction, so a crash before the journal is
+    // emptied cannot replay it a second time
+    char sql[192];
+    snprintf(sql, sizeof(sql),
+             "CREATE TABLE IF NOT EXISTS memory_flush_state ("
+             "id INTEGER PRIMARY KEY CHECK (id = 1), generation INTEGER NOT NULL);"
+             "INSERT OR REPLACE INTO memory_flush_state VALUES (1, %lld);",
+             memory->generation);
+    rc = sqlite3_exec(memory->file, sql, NULL, NULL, NULL);
+    if (rc == SQLITE_OK) rc = sqlite3_exec(memory->file, "COMMIT;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot flush to the database file: %s\n", sqlite3_errmsg(memory->file));
+        sqlite3_exec(memory->file, "ROLLBACK;", NULL, NULL, NULL);
+        return rc;
+    }
+
+    memory->pending.length = 0;
+    memory->pending.data[0] = '\0';
+    memory->generation++;
+    return start_journal(memory);
+}
+
+static void commit_transaction(MemoryDb *memory) {
+    if (!buffer_append(&memory->txn, TXN_END, strlen(TXN_END)) ||
+        !buffer_append(&memory->pending, memory->txn.data, memory->txn.length)) {
+        memory->failed = 1;
+    }
+
+    // The transaction is only complete in the journal once TXN_END is
+    // written, so a torn write is ignored on recovery
+    if (memory->journal == NULL ||
+        fwrite(memory->txn.data, 1, memory->txn.length, memory->journal) != memory->txn.length ||
+        fflush(memory->journal) != 0) {
+        memory->failed = 1;
+    }
+    if (memory->failed) {
+        fprintf(stderr, "In-memory database: journal write failed; flushing now\n");
+        memory->failed = 0;
+        flush_memory(memory);
+    }
+
+    memory->txn.length = 0;
+    memory->txn.data[0] = '\0';
+
+    if (seconds_since(&memory->last_flush) >= memory->flush_seconds) {
+        flush_memory(memory);
+    }
+}
+
+static int starts_with(sqlite3_stmt *stmt, const char *keyword) {
+    const char *sql = sqlite3_sql(stmt);
+    while (*sql == ' ' || *sql == '\n' || *sql == '\t') sql++;
+    return sqlite3_strnicmp(sql, keyword, (int)strlen(keyword)) == 0;
+}
+
+// Records each write statement once it has finished and changed rows (or
+// the schema, which total_changes does not count), and closes the
+// transaction when the connection returns to autocommit
+static int trace_callback(unsigned type, void *context, void *p, void *x) {
+    MemoryDb *memory = context;
+    sqlite3_stmt *stmt = p;
+
+    if (type == SQLITE_TRACE_STMT) {
+        // Trigger bodies are reported as "-- TRIGGER name"; their changes
+        // belong to the statement that fired them
+        if (strncmp((const char *)x, "--", 2) != 0) {
+            memory->changes_before = sqlite3_total_changes64(memory->db);
+        }
+        return 0;
+    }
+
+    if (!sqlite3_stmt_readonly(stmt) &&
+        (sqlite3_total_changes64(memory->db) != memory->changes_before ||
+         starts_with(stmt, "CREATE") || starts_with(stmt, "DROP") || starts_with(stmt, "ALTER"))) {
+        char *sql = sqlite3_expanded_sql(stmt);
+        if (sql == NULL) {
+            fprintf(stderr, "In-memory database: cannot journal a statement\n");
+        } else {
+            size_t length = strlen(sql);
+            while (length > 0 && (sql[length - 1] == ' ' || sql[length - 1] == '\n')) length--;
+            int terminated = length > 0 && sql[length - 1] == ';';
+
+            if (!buffer_append(&memory->txn, sql, length) ||
+                !buffer_append(&memory->txn, terminated ? "\n" : "\n;\n", terminated ? 1 : 3)) {
+                memory->failed = 1;
+            }
+            sqlite3_free(sql);
+
+            if (starts_with(stmt, "INSERT") || starts_with(stmt, "REPLACE")) {
+                char mark[64];
+                int length = snprintf(mark, sizeof(mark), ROWID_MARK,
+                                      (long long)sqlite3_last_insert_rowid(memory->db));
+                if (!buffer_append(&memory->txn, mark, length)) memory->failed = 1;
+            }
+        }
+    }
+
+    if (sqlite3_get_autocommit(memory->db)) {
+        if (starts_with(stmt, "ROLLBACK")) {
+            memory->txn.length = 0;
+            if (memory->txn.data) memory->txn.data[0] = '\0';
+        } else if (memory->txn.length > 0) {
+            commit_transaction(memory);
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// OPEN / CLOSE
+// ============================================================================
+
+static sqlite3_int64 flushed_generation(sqlite3 *file) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 generation = 0;
+    if (sqlite3_prepare_v2(file, "SELECT generation FROM memory_flush_state WHERE id = 1;",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) generation = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return generation;
+}
+
+// Complete transactions of a journal newer than the file, or NULL
+static char* read_journal(const char *path, sqlite3_int64 flushed, sqlite3_int64 *generation) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return NULL;
+
+    long long header_generation;
+    char *text = NULL;
+    if (fscanf(file, "-- lessons memory journal, generation %lld\n", &header_generation) == 1 &&
+        header_generation > flushed) {
+        long start = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file) - start;
+        fseek(file, start, SEEK_SET);
+
+        text = malloc((size_t)size + 1);
+        if (text && fread(text, 1, (size_t)size, file) == (size_t)size) {
+            text[size] = '\0';
+            // Drop a torn last transaction
+            char *end = NULL;
+            for (char *at = strstr(text, TXN_END); at; at = strstr(at + 1, TXN_END)) {
+                end = at + strlen(TXN_END);
+            }
+            if (end) *end = '\0';
+            else text[0] = '\0';
+            *generation = header_generation;
+        } else {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+static void release_memory(MemoryDb *memory) {
+    if (memory->journal) fclose(memory->journal);
+    if (memory->file) sqlite3_close(memory->file);
+    free(memory->journal_path);
+    free(memory->txn.data);
+    free(memory->pending.data);
+    memset(memory, 0, sizeof(*memory));
+}
+
+int memory_open(const char *path, sqlite3 **db) {
+    *db = NULL;
+    MemoryDb *memory = find_memory(NULL);
+    if (memory == NULL) {
+        fprintf(stderr, "Too many in-memory databases open\n");
+        return SQLITE_ERROR;
+    }
+
+    int rc = open_database(path, &memory->file);
+    if (rc != SQLITE_OK) {
+        sqlite3_close(memory->file);
+        memory->file = NULL;
+        return rc;
+    }
+
+    memory->journal_path = malloc(strlen(path) + sizeof(JOURNAL_SUFFIX));
+    if (memory->journal_path == NULL) {
+        release_memory(memory);
+        return SQLITE_NOMEM;
+    }
+    strcpy(memory->journal_path, path);
+    strcat(memory->journal_path, JOURNAL_SUFFIX);
+
+    sqlite3_int64 flushed = flushed_generation(memory->file);
+    memory->generation = flushed + 1;
+    char *recovered = read_journal(memory->journal_path, flushed, &memory->generation);
+
+    // The whole file as one buffer. A WAL-mode header (bytes 18-19 = 2)
+    // would make the in-memory VFS look for a WAL file, so mark it legacy.
+    // Read in one transaction with the version, so no commit falls between
+    sqlite3_exec(memory->file, "BEGIN;", NULL, NULL, NULL);
+    memory->file_version = data_version(memory->file);
+    sqlite3_int64 size;
+    unsigned char *image = sqlite3_serialize(memory->file, "main", &size, 0);
+    sqlite3_exec(memory->file, "COMMIT;", NULL, NULL, NULL);
+    if (image == NULL) {
+        fprintf(stderr, "Cannot load database into memory: %s\n", sqlite3_errmsg(memory->file));
+        free(recovered);
+        release_memory(memory);
+        return SQLITE_NOMEM;
+    }
+    if (size > 19 && image[18] == 2) image[18] = image[19] = 1;
+
+    rc = sqlite3_open(":memory:", db);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_deserialize(*db, "main", image, size, size,
+                                 SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_RESIZEABLE);
+    } else {
+        sqlite3_free(image);
+    }
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot load database into memory: %s\n", sqlite3_errmsg(*db));
+        sqlite3_close(*db);
+        *db = NULL;
+        free(recovered);
+        release_memory(memory);
+        return rc;
+    }
+    memory->db = *db;
+
+    const char *seconds = getenv(MEMORY_FLUSH_ENV);
+    memory->flush_seconds = seconds && *seconds ? atof(seconds) : DEFAULT_FLUSH_SECONDS;
+
+    // Writes journaled by a run that never flushed them: apply them to the
+    // copy and the file, then start a fresh journal. A journal that no
+    // longer fits the file is left alone for someone to look at.
+    if (recovered && *recovered) {
+        fprintf(stderr, "Replaying unflushed writes from %s\n", memory->journal_path);
+        rc = run_statements(*db, recovered);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Cannot replay %s onto the database as it is now\n", memory->journal_path);
+        }
+    }
+    if (rc == SQLITE_OK) rc = start_journal(memory);
+    if (rc == SQLITE_OK && recovered && *recovered) {
+        if (!buffer_append(&memory->pending, recovered, strlen(recovered)) ||
+            fputs(recovered, memory->journal) == EOF || fflush(memory->journal) != 0) {
+            rc = SQLITE_IOERR;
+        } else {
+            rc = flush_memory(memory);
+        }
+    }
+    free(recovered);
+    if (rc != SQLITE_OK) {
+        sqlite3_close(*db);
+        *db = NULL;
+        release_memory(memory);
+        return rc;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &memory->last_flush);
+    sqlite3_trace_v2(*db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, trace_callback, memory);
+    return SQLITE_OK;
+}
+
+int memory_is_open(sqlite3 *db) {
+    return db != NULL && find_memory(db) != NULL;
+}
+
+int memory_flush(sqlite3 *db) {
+    MemoryDb *memory = db ? find_memory(db) : NULL;
+    return memory ? flush_memory(memory) : SQLITE_OK;
+}
+
+int memory_close(sqlite3 *db) {
+    MemoryDb *memory = db ? find_memory(db) : NULL;
+    if (memory == NULL) return 0;
+
+    sqlite3_trace_v2(db, 0, NULL, NULL);
+    int flushed = flush_memory(memory) == SQLITE_OK;
+    sqlite3_close(db);
+
+    // Nothing left to recover: the journal is only its header
+    fclose(memory->journal);
+    memory->journal = NULL;
+    if (flushed) remove(memory->journal_path);
+
+    release_memory(memory);
+    return 1;
+}
@@ -0,0 +1,52 @@
+#ifndef DB_MEMORY_H
+#define DB_MEMORY_H
+
+#include "db_common.h"
+
+// Environment variable that turns on in-memory mode in init_database()
+#define MEMORY_MODE_ENV "LESSONS_IN_MEMORY"
+
+// Seconds between flushes of journaled writes back to the file
+#define MEMORY_FLUSH_ENV "LESSONS_FLUSH_SECONDS"
+#define DEFAULT_FLUSH_SECONDS 5
+
+// In-memory database mode for read-mostly deployments.
+//
+// memory_open() copies the whole database file into RAM with
+// sqlite3_serialize()/sqlite3_deserialize(), so reads never touch the
+// filesystem. Writes change the in-memory copy and are journaled: every
+// committed write statement is appended, with its parameters expanded,
+// to <file>-memjournal before the transaction's last statement returns.
+// At most every LESSONS_FLUSH_SECONDS, and on close, the journaled
+// statements are replayed into the file in one transaction and the
+// journal is emptied. A journal left behind by a crash is replayed on
+// the next memory_open(); a generation number stored in the file keeps
+// it from being applied twice.
+//
+// Replay reproduces the copy only if the file has not changed since it
+// was loaded, so the in-memory connection must be the file's only writer.
+// A flush that finds another connection's commit in the file is refused,
+// as is one where a statement fails or an INSERT gets a different rowid
+// than it got in memory (each INSERT is journaled with its rowid); the
+// writes then stay in the journal and the file is left as it was.
+// Savepoints (ROLLBACK TO) are not tracked, and REAL values are journaled
+// with 15 significant digits.
+
+// LESSONS_IN_MEMORY is set to something other than "0"
+int memory_mode_requested(void);
+
+// Open path in memory mode; *db is an in-memory connection
+int memory_open(const char *path, sqlite3 **db);
+
+// 1 if db was opened by memory_open(). Statements are all the journal
+// sees, so writes that bypass them (sqlite3_blob_write) must be refused.
+int memory_is_open(sqlite3 *db);
+
+// Write journaled changes of an in-memory connection to its file now
+int memory_flush(sqlite3 *db);
+
+// Flush and close db if it was opened by memory_open(); returns 0 and
+// does nothing otherwise
+int memory_close(sqlite3 *db);
+
+#endif // DB_MEMORY_H
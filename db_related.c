@@ -0,0 +1,302 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_similar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_K 5
+#define MAX_K 100
+#define DEFAULT_BENCH_LESSONS 100000
+#define BENCH_QUERIES 1000
+#define BENCH_CHANGES 100
+#define BENCH_DB "related_bench.db"
+
+// Synthetic corpus: each lesson is mostly words of its topic, the rest
+// drawn from the whole vocabulary with a Zipf-like skew
+#define BENCH_VOCABULARY 20000
+#define BENCH_TOPICS 500
+#define BENCH_TOPIC_WORDS 40
+#define BENCH_WORDS_PER_LESSON 120
+
+static void print_usage(const char *program) {
+    printf("Usage: %s <lesson_id> [k]\n", program);
+    printf("       %s --text \"words\" [k]\n", program);
+    printf("       %s --bench [lessons]\n", program);
+    printf("\n");
+    printf("  lesson_id   The k lessons most similar to this one (default %d)\n", DEFAULT_K);
+    printf("  --text      The k lessons most similar to the given text\n");
+    printf("  --bench     Build the index for a synthetic corpus (default %d lessons)\n",
+           DEFAULT_BENCH_LESSONS);
+    printf("              in %s and time queries with and without the vector kernel\n", BENCH_DB);
+}
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void print_matches(sqlite3 *db, const SimilarMatch *matches, int count) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT topic, category FROM lessons WHERE id = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        sqlite3_bind_int(stmt, 1, matches[i].lesson_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            printf("  %.3f  [%d] %s (%s)\n", matches[i].score, matches[i].lesson_id,
+                   sqlite3_column_text(stmt, 0), sqlite3_column_text(stmt, 1));
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (count == 0) printf("  (no related lessons)\n");
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+static unsigned bench_seed = 12345;
+
+static unsigned next_random(void) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return bench_seed >> 8;
+}
+
+// A pronounceable made-up word for vocabulary entry n
+static void bench_word(int n, char *word) {
+    static const char consonants[] = "bcdfghklmnprstvz";
+    static const char vowels[] = "aeiou";
+    int length = 0;
+    n++;
+    while (n > 0) {
+        word[length++] = consonants[n % 16];
+        n /= 16;
+        word[length++] = vowels[n % 5];
+        n /= 5;
+    }
+    word[length] = '\0';
+}
+
+// Rank r of the vocabulary with probability roughly proportional to 1/r
+static int zipf_word(void) {
+    double u = (next_random() % 1000000) / 1e6;
+    int rank = (int)(BENCH_VOCABULARY * u * u * u);
+    return rank < BENCH_VOCABULARY ? rank : BENCH_VOCABULARY - 1;
+}
+
+static void bench_content(int topic, char *content, size_t size) {
+    size_t length = 0;
+    char word[32];
+    for (int w = 0; w < BENCH_WORDS_PER_LESSON && length + sizeof(word) < size; w++) {
+        int n = next_random() % 10 < 6
+              ? (topic * 7919 + (int)(next_random() % BENCH_TOPIC_WORDS) * 104729) % BENCH_VOCABULARY
+              : zipf_word();
+        bench_word(n, word);
+        length += snprintf(content + length, size - length, "%s ", word);
+    }
+}
+
+static int insert_bench_lessons(sqlite3 *db, int first, int count) {
+    sqlite3_stmt *lesson = NULL, *content = NULL;
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lessons (topic, category, difficulty, timestamp) "
+                                    "VALUES (?, 'Synthetic', 1, ?);", -1, &lesson, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lesson_content (lesson_id, content) "
+                                    "VALUES (last_insert_rowid(), ?);", -1, &content, NULL);
+    }
+
+    char text[BENCH_WORDS_PER_LESSON * 32];
+    for (int i = first; rc == SQLITE_OK && i < first + count; i++) {
+        char topic[64];
+        snprintf(topic, sizeof(topic), "Topic %d lesson %d", i % BENCH_TOPICS, i);
+        bench_content(i % BENCH_TOPICS, text, sizeof(text));
+
+        sqlite3_bind_text(lesson, 1, topic, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(lesson, 2, (sqlite3_int64)time(NULL));
+        sqlite3_bind_text(content, 1, text, -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(lesson) != SQLITE_DONE || sqlite3_step(content) != SQLITE_DONE) {
+            rc = sqlite3_errcode(db);
+        }
+        sqlite3_reset(lesson);
+        sqlite3_reset(content);
+    }
+    sqlite3_finalize(lesson);
+    sqlite3_finalize(content);
+    sqlite3_exec(db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) fprintf(stderr, "Cannot build the bench corpus: %s\n", sqlite3_errmsg(db));
+    return rc;
+}
+
+static void remove_bench_db(void) {
+    const char *suffixes[] = { "", "-wal", "-shm", "-journal" };
+    char path[128];
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", BENCH_DB, suffixes[i]);
+        remove(path);
+    }
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Average, median and 99th percentile of BENCH_QUERIES top-k queries for
+// random lessons; the same lessons for both kernels
+static void time_queries(SimilarIndex *index, int lessons, int scalar, double *latency,
+                         double *avg, double *p50, double *p99, double *score_sum) {
+    SimilarMatch matches[DEFAULT_K];
+    similar_use_scalar(index, scalar);
+    bench_seed = 777;
+    *avg = 0.0;
+    *score_sum = 0.0;
+
+    for (int q = 0; q < BENCH_QUERIES; q++) {
+        int lesson_id = 1 + (int)(next_random() % lessons);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int found = similar_to_lesson(index, lesson_id, DEFAULT_K, matches);
+        latency[q] = elapsed_seconds(&start);
+        *avg += latency[q];
+        for (int i = 0; i < found; i++) *score_sum += matches[i].score;
+    }
+    similar_use_scalar(index, 0);
+
+    qsort(latency, BENCH_QUERIES, sizeof(double), compare_double);
+    *avg /= BENCH_QUERIES;
+    *p50 = latency[BENCH_QUERIES / 2];
+    *p99 = latency[BENCH_QUERIES * 99 / 100];
+}
+
+static int run_bench(int lessons) {
+    remove_bench_db();
+    sqlite3 *db;
+    if (open_database(BENCH_DB, &db) != SQLITE_OK || insert_bench_lessons(db, 0, lessons) != SQLITE_OK) {
+        close_database(db);
+        remove_bench_db();
+        return 1;
+    }
+
+    printf("=== Similar Lessons (%d lessons, %d words each) ===\n", lessons, BENCH_WORDS_PER_LESSON);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SimilarIndex *index = similar_open(db);
+    double build = elapsed_seconds(&start);
+    if (index == NULL) {
+        close_database(db);
+        remove_bench_db();
+        return 1;
+    }
+    similar_close(index);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    index = similar_open(db);
+    double load = elapsed_seconds(&start);
+    if (index == NULL) {
+        close_database(db);
+        remove_bench_db();
+        return 1;
+    }
+
+    SimilarStats stats;
+    similar_stats(index, &stats);
+    printf("  build            %10.2f s   (%d lessons, %d terms)\n", build, stats.lessons, stats.terms);
+    printf("  open (stored)    %10.2f s\n", load);
+
+    double *latency = malloc(BENCH_QUERIES * sizeof(double));
+    double avg[2], p50[2], p99[2], scores[2];
+    for (int scalar = 0; scalar < 2; scalar++) {
+        time_queries(index, lessons, scalar, latency, &avg[scalar], &p50[scalar], &p99[scalar], &scores[scalar]);
+    }
+    free(latency);
+
+    printf("\n  top-%d query      %10s %10s %10s\n", DEFAULT_K, "avg", "p50", "p99");
+    printf("  vector kernel    %7.1f us %7.1f us %7.1f us\n", avg[0] * 1e6, p50[0] * 1e6, p99[0] * 1e6);
+    printf("  scalar loop      %7.1f us %7.1f us %7.1f us\n", avg[1] * 1e6, p50[1] * 1e6, p99[1] * 1e6);
+    printf("  (%d queries; kernel speedup %.1fx; score sums %.3f / %.3f)\n", BENCH_QUERIES,
+           avg[0] > 0 ? avg[1] / avg[0] : 0.0, scores[0], scores[1]);
+
+    // Incremental refresh: a few lessons added, a few deleted
+    int rc = insert_bench_lessons(db, lessons, BENCH_CHANGES);
+    if (rc == SQLITE_OK) rc = similar_refresh(index);
+    similar_stats(index, &stats);
+    printf("\n  refresh, %d added  %8.2f ms\n", stats.added, stats.refresh_seconds * 1e3);
+
+    if (rc == SQLITE_OK) {
+        char sql[160];
+        snprintf(sql, sizeof(sql), "DELETE FROM lesson_content WHERE lesson_id <= %d; "
+                                   "DELETE FROM lessons WHERE id <= %d;", BENCH_CHANGES, BENCH_CHANGES);
+        rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    }
+    if (rc == SQLITE_OK) rc = similar_refresh(index);
+    similar_stats(index, &stats);
+    printf("  refresh, %d removed %7.2f ms\n", stats.removed, stats.refresh_seconds * 1e3);
+
+    similar_close(index);
+    close_database(db);
+    remove_bench_db();
+    return rc == SQLITE_OK ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        print_usage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+
+    if (strcmp(argv[1], "--bench") == 0) {
+        int lessons = argc > 2 ? atoi(argv[2]) : DEFAULT_BENCH_LESSONS;
+        return run_bench(lessons > BENCH_CHANGES ? lessons : BENCH_CHANGES + 1);
+    }
+
+    int by_text = strcmp(argv[1], "--text") == 0;
+    if (by_text && argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    int k = argc > 2 + by_text ? atoi(argv[2 + by_text]) : DEFAULT_K;
+    if (k < 1 || k > MAX_K) k = DEFAULT_K;
+
+    sqlite3 *db;
+    if (init_database(&db) != SQLITE_OK) {
+        fprintf(stderr, "Failed to initialize database.\n");
+        close_database(db);
+        return 1;
+    }
+
+    SimilarIndex *index = similar_open(db);
+    if (index == NULL) {
+        close_database(db);
+        return 1;
+    }
+
+    SimilarMatch matches[MAX_K];
+    int rc = 0;
+    if (by_text) {
+        printf("Lessons similar to \"%s\":\n", argv[2]);
+        print_matches(db, matches, similar_to_text(index, argv[2], k, matches));
+    } else {
+        int lesson_id = atoi(argv[1]);
+        int found = similar_to_lesson(index, lesson_id, k, matches);
+        if (found < 0) {
+            fprintf(stderr, "No lesson with ID %d.\n", lesson_id);
+            rc = 1;
+        } else {
+            printf("Lessons similar to lesson %d:\n", lesson_id);
+            print_matches(db, matches, found);
+        }
+    }
+
+    similar_close(index);
+    close_database(db);
+    return rc;
+}
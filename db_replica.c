@@ -0,0 +1,404 @@
+// The session extension API is only declared when these are defined
+#define SQLITE_ENABLE_PREUPDATE_HOOK 1
+#define SQLITE_ENABLE_SESSION 1
+
+#include "db_replica.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    sqlite3 *db;
+    sqlite3_session *session;   // NULL when the primary is not replicated
+    CdcLog *cdc;
+} ReplicaCapture;
+
+// Writers capturing changes in this process. A program rarely opens more
+// than a few connections, so they are found by a linear search.
+static ReplicaCapture **captures;
+static int capture_count;
+static int capture_capacity;
+
+static ReplicaCapture* find_capture(sqlite3 *db) {
+    for (int i = 0; i < capture_count; i++) {
+        if (captures[i]->db == db) return captures[i];
+    }
+    return NULL;
+}
+
+// Bookkeeping tables are never replicated themselves
+static int table_filter(void *user_data, const char *table_name) {
+    (void)user_data;
+    // The similar-lesson index is derived data each side builds for itself
+    return strcmp(table_name, "replica_changesets") != 0 &&
+           strcmp(table_name, "replica_state") != 0 &&
+           strcmp(table_name, "similar_terms") != 0 &&
+           strcmp(table_name, "lesson_vectors") != 0;
+}
+
+static int start_session(ReplicaCapture *capture) {
+    int rc = sqlite3session_create(capture->db, "main", &capture->session);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot create replication session: %s\n", sqlite3_errmsg(capture->db));
+        capture->session = NULL;
+        return rc;
+    }
+
+    sqlite3session_table_filter(capture->session, table_filter, NULL);
+    return sqlite3session_attach(capture->session, NULL);
+}
+
+static int table_exists(sqlite3 *db, const char *name) {
+    const char *sql = "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return 0;
+
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    int exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+int replica_enable(sqlite3 *primary) {
+    const char *sql =
+        "CREATE TABLE IF NOT EXISTS replica_changesets ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "created INTEGER NOT NULL,"
+        "changeset BLOB NOT NULL"
+        ");";
+
+    char *err_msg = NULL;
+    int rc = sqlite3_exec(primary, sql, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (replica_changesets): %s\n", err_msg);
+        sqlite3_free(err_msg);
+    }
+    return rc;
+}
+
+int replica_capture_open(sqlite3 *db, CdcLog *cdc) {
+    if (capture_count == capture_capacity) {
+        int capacity = capture_capacity ? 2 * capture_capacity : 4;
+        ReplicaCapture **grown = realloc(captures, capacity * sizeof(ReplicaCapture *));
+        if (grown == NULL) {
+            fprintf(stderr, "Cannot start replication capture: out of memory\n");
+            return SQLITE_NOMEM;
+        }
+        captures = grown;
+        capture_capacity = capacity;
+    }
+
+    ReplicaCapture *capture = calloc(1, sizeof(ReplicaCapture));
+    if (capture == NULL) {
+        fprintf(stderr, "Cannot start replication capture: out of memory\n");
+        return SQLITE_NOMEM;
+    }
+    capture->db = db;
+    capture->cdc = cdc;
+    captures[capture_count++] = capture;
+
+    if (!table_exists(db, "replica_changesets")) return SQLITE_OK;
+
+    // The session registers its own pre-update hook, which must not find
+    // the CDC log's hook still installed
+    cdc_release_preupdate_hook(cdc);
+    return start_session(capture);
+}
+
+void replica_capture_close(sqlite3 *db) {
+    for (int i = 0; i < capture_count; i++) {
+        ReplicaCapture *capture = captures[i];
+        if (capture->db != db) continue;
+
+        if (capture->session) sqlite3session_delete(capture->session);
+        free(capture);
+        captures[i] = captures[--capture_count];
+        break;
+    }
+    if (capture_count == 0) {
+        free(captures);
+        captures = NULL;
+        capture_capacity = 0;
+    }
+}
+
+int replica_capture_begin(sqlite3 *db) {
+    return sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+}
+
+static int store_changeset(ReplicaCapture *capture) {
+    int size = 0;
+    void *changeset = NULL;
+
+    int rc = sqlite3session_changeset(capture->session, &size, &changeset);
+    if (rc != SQLITE_OK || size == 0) {
+        sqlite3_free(changeset);
+        return rc;
+    }
+
+    cdc_log_changeset(capture->cdc, size, changeset);
+
+    const char *sql = "INSERT INTO replica_changesets (created, changeset) VALUES (?, ?);";
+    sqlite3_stmt *stmt;
+    rc = sqlite3_prepare_v2(capture->db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, time(NULL));
+        sqlite3_bind_blob(stmt, 2, changeset, size, SQLITE_STATIC);
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(capture->db);
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_free(changeset);
+    return rc;
+}
+
+static void restart_session(ReplicaCapture *capture) {
+    sqlite3session_delete(capture->session);
+    start_session(capture);
+}
+
+int replica_capture_commit(sqlite3 *db) {
+    ReplicaCapture *capture = find_capture(db);
+
+    if (capture && capture->session) {
+        int rc = store_changeset(capture);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Cannot record changeset: %s\n", sqlite3_errmsg(db));
+            replica_capture_rollback(db);
+            return rc;
+        }
+    }
+
+    int rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Commit failed: %s\n", sqlite3_errmsg(db));
+        replica_capture_rollback(db);
+        return rc;
+    }
+
+    if (capture && capture->session) restart_session(capture);
+    return SQLITE_OK;
+}
+
+void replica_capture_rollback(sqlite3 *db) {
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+
+    // The session still holds the rolled-back changes; start over
+    ReplicaCapture *capture = find_capture(db);
+    if (capture && capture->session) restart_session(capture);
+}
+
+static sqlite3_int64 query_int64(sqlite3 *db, const char *sql) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 value = 0;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// Same setup as the primary, so a replica made before a schema change is
+// upgraded before changesets with the new columns reach it
+static int open_replica(const char *replica_path, sqlite3 **replica) {
+    int rc = open_database(replica_path, replica);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot open replica %s: %s\n", replica_path, sqlite3_errmsg(*replica));
+        sqlite3_close(*replica);
+        return rc;
+    }
+
+    sqlite3_exec(*replica, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+    return SQLITE_OK;
+}
+
+int replica_init(sqlite3 *primary, const char *replica_path) {
+    int rc = replica_enable(primary);
+    if (rc != SQLITE_OK) return rc;
+
+    rc = backup_database(primary, replica_path, 0, 0, NULL, NULL);
+    if (rc != SQLITE_OK) return rc;
+
+    sqlite3 *replica;
+    rc = open_replica(replica_path, &replica);
+    if (rc != SQLITE_OK) return rc;
+
+    // The snapshot already contains every changeset up to its newest seq;
+    // that is where this replica starts. Its own copy of the queue is unused.
+    sqlite3_int64 seq = query_int64(replica, "SELECT COALESCE(MAX(seq), 0) FROM replica_changesets;");
+
+    char sql[256];
+    snprintf(sql, sizeof(sql),
+             "BEGIN;"
+             "DELETE FROM replica_changesets;"
+             "CREATE TABLE IF NOT EXISTS replica_state ("
+             "id INTEGER PRIMARY KEY CHECK(id = 1),"
+             "applied_seq INTEGER NOT NULL);"
+             "INSERT OR REPLACE INTO replica_state (id, applied_seq) VALUES (1, %lld);"
+             "COMMIT;", seq);
+
+    char *err_msg = NULL;
+    rc = sqlite3_exec(replica, sql, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "SQL error (replica_state): %s\n", err_msg);
+        sqlite3_free(err_msg);
+    }
+
+    sqlite3_close(replica);
+    return rc;
+}
+
+const char* replica_conflict_string(int type) {
+    switch (type) {
+        case SQLITE_CHANGESET_DATA: return "DATA";
+        case SQLITE_CHANGESET_NOTFOUND: return "NOTFOUND";
+        case SQLITE_CHANGESET_CONFLICT: return "CONFLICT";
+        case SQLITE_CHANGESET_CONSTRAINT: return "CONSTRAINT";
+        case SQLITE_CHANGESET_FOREIGN_KEY: return "FOREIGN_KEY";
+        default: return "UNKNOWN";
+    }
+}
+
+// The primary is the source of truth: rows that drifted on the replica are
+// overwritten, and changes whose target row is gone are skipped.
+static int conflict_handler(void *user_data, int type, sqlite3_changeset_iter *iter) {
+    ReplicaSyncStats *stats = user_data;
+    if (type > 0 && type < REPLICA_CONFLICT_TYPES) stats->conflicts[type]++;
+
+    if (stats->verbose) {
+        const char *table_name;
+        int column_count, op, indirect;
+        sqlite3changeset_op(iter, &table_name, &column_count, &op, &indirect);
+        fprintf(stderr, "  conflict %-11s on %s (%s)\n", replica_conflict_string(type),
+                table_name, op == SQLITE_INSERT ? "INSERT" : op == SQLITE_DELETE ? "DELETE" : "UPDATE");
+    }
+
+    if (type == SQLITE_CHANGESET_DATA || type == SQLITE_CHANGESET_CONFLICT) {
+        return SQLITE_CHANGESET_REPLACE;
+    }
+    return SQLITE_CHANGESET_OMIT;
+}
+
+static int count_changes(int size, void *changeset) {
+    sqlite3_changeset_iter *iter;
+    int count = 0;
+
+    if (sqlite3changeset_start(&iter, size, changeset) != SQLITE_OK) return 0;
+    while (sqlite3changeset_next(iter) == SQLITE_ROW) count++;
+    sqlite3changeset_finalize(iter);
+    return count;
+}
+
+// Combine up to batch_size changesets after seq into one changeset
+static int load_batch(sqlite3 *primary, sqlite3_int64 after_seq, int batch_size,
+                      sqlite3_int64 *last_seq, int *loaded, int *size, void **changeset) {
+    const char *sql = "SELECT seq, changeset FROM replica_changesets "
+                      "WHERE seq > ? ORDER BY seq LIMIT ?;";
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(primary, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return rc;
+
+    sqlite3_changegroup *group;
+    rc = sqlite3changegroup_new(&group);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return rc;
+    }
+
+    sqlite3_bind_int64(stmt, 1, after_seq);
+    sqlite3_bind_int(stmt, 2, batch_size);
+
+    *loaded = 0;
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        *last_seq = sqlite3_column_int64(stmt, 0);
+        rc = sqlite3changegroup_add(group, sqlite3_column_bytes(stmt, 1),
+                                    (void *)sqlite3_column_blob(stmt, 1));
+        (*loaded)++;
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc == SQLITE_OK) rc = sqlite3changegroup_output(group, size, changeset);
+    sqlite3changegroup_delete(group);
+    return rc;
+}
+
+int replica_sync(sqlite3 *primary, const char *replica_path, int batch_size,
+                 ReplicaSyncStats *stats) {
+    if (batch_size <= 0) batch_size = REPLICA_DEFAULT_BATCH;
+
+    sqlite3 *replica;
+    int rc = open_replica(replica_path, &replica);
+    if (rc != SQLITE_OK) return rc;
+
+    if (!table_exists(replica, "replica_state")) {
+        fprintf(stderr, "%s is not a replica (run db_sync --init first)\n", replica_path);
+        sqlite3_close(replica);
+        return SQLITE_ERROR;
+    }
+
+    stats->applied_seq = query_int64(replica, "SELECT applied_seq FROM replica_state WHERE id = 1;");
+
+    // Read every batch from one snapshot of the primary
+    sqlite3_exec(primary, "BEGIN;", NULL, NULL, NULL);
+
+    while (1) {
+        sqlite3_int64 last_seq = stats->applied_seq;
+        int loaded = 0, size = 0;
+        void *changeset = NULL;
+
+        rc = load_batch(primary, stats->applied_seq, batch_size, &last_seq, &loaded,
+                        &size, &changeset);
+        if (rc != SQLITE_OK || loaded == 0) {
+            sqlite3_free(changeset);
+            break;
+        }
+
+        // Apply and advance the cursor in one replica transaction, so an
+        // interrupted sync resumes exactly where it stopped
+        sqlite3_exec(replica, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+        rc = sqlite3changeset_apply(replica, size, changeset, NULL, conflict_handler, stats);
+
+        if (rc == SQLITE_OK) {
+            sqlite3_stmt *stmt;
+            rc = sqlite3_prepare_v2(replica, "UPDATE replica_state SET applied_seq = ? WHERE id = 1;",
+                                    -1, &stmt, NULL);
+            if (rc == SQLITE_OK) {
+                sqlite3_bind_int64(stmt, 1, last_seq);
+                rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(replica);
+                sqlite3_finalize(stmt);
+            }
+        }
+
+        if (rc == SQLITE_OK) rc = sqlite3_exec(replica, "COMMIT;", NULL, NULL, NULL);
+
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Apply failed on %s: %s\n", replica_path, sqlite3_errmsg(replica));
+            sqlite3_exec(replica, "ROLLBACK;", NULL, NULL, NULL);
+            sqlite3_free(changeset);
+            break;
+        }
+
+        stats->changes += count_changes(size, changeset);
+        stats->changesets += loaded;
+        stats->batches++;
+        stats->applied_seq = last_seq;
+        sqlite3_free(changeset);
+    }
+
+    sqlite3_exec(primary, "COMMIT;", NULL, NULL, NULL);
+    sqlite3_close(replica);
+    return rc;
+}
+
+int replica_prune(sqlite3 *primary, sqlite3_int64 seq) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(primary, "DELETE FROM replica_changesets WHERE seq <= ?;",
+                                -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return rc;
+
+    sqlite3_bind_int64(stmt, 1, seq);
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(primary);
+    sqlite3_finalize(stmt);
+    return rc;
+}
@@ -0,0 +1,64 @@
+#ifndef DB_REPLICA_H
+#define DB_REPLICA_H
+
+#include "db_common.h"
+#include "db_cdc.h"
+
+// Read-replica replication built on the SQLite session extension.
+//
+// Once a primary has been prepared with replica_enable(), every writer that
+// calls replica_capture_open() records its changes with an sqlite3_session.
+// Each write transaction bracketed by replica_capture_begin()/commit() stores
+// its changeset in the primary's replica_changesets table, in the same
+// transaction as the change itself, so changesets are numbered in commit
+// order. replica_sync() then ships only the changesets a replica has not
+// seen yet and applies them in batched transactions.
+
+// Default number of changesets combined into one replica transaction
+#define REPLICA_DEFAULT_BATCH 64
+
+// Conflict counters, indexed by SQLITE_CHANGESET_DATA .. SQLITE_CHANGESET_FOREIGN_KEY
+#define REPLICA_CONFLICT_TYPES 6
+
+typedef struct {
+    sqlite3_int64 applied_seq;      // Last changeset applied to the replica
+    int changesets;                 // Changesets shipped in this sync
+    int batches;                    // Replica transactions used
+    int changes;                    // Row changes applied
+    int conflicts[REPLICA_CONFLICT_TYPES];
+    int verbose;                    // Print every conflict as it is resolved
+} ReplicaSyncStats;
+
+// Create the replica_changesets table on the primary (idempotent)
+int replica_enable(sqlite3 *primary);
+
+// Start recording changes on a writer connection. Does nothing and returns
+// SQLITE_OK when the primary has not been enabled for replication, and
+// SQLITE_NOMEM (with a message) when out of memory. cdc may be
+// NULL; when given, change-data-capture is fed from the same changesets,
+// because the session extension takes over the connection's pre-update hook.
+int replica_capture_open(sqlite3 *db, CdcLog *cdc);
+
+// Stop recording changes on db
+void replica_capture_close(sqlite3 *db);
+
+// Bracket one write transaction. Without capture these are plain
+// BEGIN IMMEDIATE / COMMIT / ROLLBACK.
+int replica_capture_begin(sqlite3 *db);
+int replica_capture_commit(sqlite3 *db);
+void replica_capture_rollback(sqlite3 *db);
+
+// Create a new replica at replica_path from an online backup of the primary
+int replica_init(sqlite3 *primary, const char *replica_path);
+
+// Apply pending changesets to a replica, batch_size changesets per transaction
+int replica_sync(sqlite3 *primary, const char *replica_path, int batch_size,
+                 ReplicaSyncStats *stats);
+
+// Drop changesets up to and including seq from the primary
+int replica_prune(sqlite3 *primary, sqlite3_int64 seq);
+
+// Name of a SQLITE_CHANGESET_* conflict type
+const char* replica_conflict_string(int type);
+
+#endif // DB_REPLICA_H
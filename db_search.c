@@ -0,0 +1,646 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_search.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_WORD 2
+#define MAX_WORD 32
+#define MAX_EDITS 3
+#define MAX_EXPANSIONS 16       // Closest vocabulary words tried per query word
+
+// Trigram characters: a-z, 0-9, '_' and the '$' word boundary
+#define ALPHABET 38
+#define BOUNDARY 37
+#define TRIGRAM_SPACE (ALPHABET * ALPHABET * ALPHABET)
+
+typedef struct {
+    int *items;
+    int count;
+    int capacity;
+} IntList;
+
+typedef struct {
+    int doc;                    // Slot in doc_lesson, -1 if not indexed
+    sqlite3_int64 timestamp;
+    sqlite3_int64 content_hash;
+    int has_hash;
+    unsigned seen;              // Refresh that last found the lesson
+} LessonState;
+
+typedef struct {
+    int word;
+    int edits;
+} Expansion;
+
+struct SearchIndex {
+    sqlite3 *db;
+
+    // Vocabulary by word id
+    char *text;                 // All words back to back
+    int text_length;
+    int text_capacity;
+    int *word_offset;
+    unsigned char *word_length;
+    IntList *word_docs;         // doc << 1 | (word is in the topic)
+    unsigned *word_stamp;       // Scratch: last lesson or query that saw the word
+    int *word_overlap;          // Scratch: trigrams shared with the query word
+    int word_count;
+    int word_capacity;
+    unsigned word_generation;
+    int *table;                 // Open addressing by word hash: id + 1, 0 if empty
+    int table_capacity;         // Power of two
+    IntList trigrams[TRIGRAM_SPACE];    // Word ids by trigram
+    IntList touched_words;
+
+    // Indexed lessons; a reindexed lesson gets a new slot
+    int *doc_lesson;            // 0 once removed
+    int doc_count;
+    int doc_capacity;
+    int live;
+    unsigned *doc_stamp;        // Scratch: query that last matched the slot
+    unsigned doc_generation;
+    unsigned char *doc_mask;    // Scratch: query words matched
+    unsigned char *doc_terms;
+    unsigned char *doc_topic;
+    int *doc_edits;
+    IntList touched_docs;
+
+    LessonState *lessons;       // By lesson id
+    int lesson_capacity;
+    unsigned refresh_generation;
+
+    sqlite3_int64 data_version; // At the last refresh
+    sqlite3_int64 total_changes;
+    SearchStats last;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Grow array (of element size bytes) to hold at least needed elements,
+// zero-filling the new part
+static int reserve(void **array, int *capacity, int needed, size_t size) {
+    if (needed <= *capacity) return 1;
+    int grown = *capacity ? *capacity : 64;
+    while (grown < needed) grown *= 2;
+
+    void *data = realloc(*array, (size_t)grown * size);
+    if (data == NULL) return 0;
+    memset((char *)data + (size_t)*capacity * size, 0, (size_t)(grown - *capacity) * size);
+    *array = data;
+    *capacity = grown;
+    return 1;
+}
+
+static int list_push(IntList *list, int value) {
+    if (!reserve((void **)&list->items, &list->capacity, list->count + 1, sizeof(int))) return 0;
+    list->items[list->count++] = value;
+    return 1;
+}
+
+// ============================================================================
+// WORDS AND TRIGRAMS
+// ============================================================================
+
+// The next indexable word at *cursor, lowercased into word; 0 at the end
+static int next_word(const char **cursor, char *word) {
+    const char *c = *cursor;
+    while (*c) {
+        int length = 0;
+        while ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '_') {
+            if (length < MAX_WORD) word[length] = (*c >= 'A' && *c <= 'Z') ? *c - 'A' + 'a' : *c;
+            length++;
+            c++;
+        }
+        if (length >= MIN_WORD && length <= MAX_WORD) {
+            *cursor = c;
+            return length;
+        }
+        if (length == 0) c++;
+    }
+    *cursor = c;
+    return 0;
+}
+
+static int trigram_char(char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + c - '0';
+    return c == '_' ? 36 : BOUNDARY;
+}
+
+// Distinct trigrams of "$word$"; codes holds at least MAX_WORD entries
+static int word_trigrams(const char *word, int length, int *codes) {
+    int count = 0;
+    for (int i = -1; i <= length - 2; i++) {
+        int a = i < 0 ? BOUNDARY : trigram_char(word[i]);
+        int b = trigram_char(word[i + 1]);
+        int c = i + 2 < length ? trigram_char(word[i + 2]) : BOUNDARY;
+        int code = (a * ALPHABET + b) * ALPHABET + c;
+
+        int seen = 0;
+        for (int j = 0; j < count && !seen; j++) seen = codes[j] == code;
+        if (!seen) codes[count++] = code;
+    }
+    return count;
+}
+
+static uint64_t word_hash(const char *word, int length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < length; i++) hash = (hash ^ (unsigned char)word[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+static int find_word(const SearchIndex *index, const char *word, int length) {
+    if (index->table_capacity == 0) return -1;
+    int mask = index->table_capacity - 1;
+    for (int slot = (int)(word_hash(word, length) & mask); ; slot = (slot + 1) & mask) {
+        int id = index->table[slot] - 1;
+        if (id < 0) return -1;
+        if (index->word_length[id] == length &&
+            memcmp(index->text + index->word_offset[id], word, length) == 0) {
+            return id;
+        }
+    }
+}
+
+static void table_insert(SearchIndex *index, int id) {
+    int mask = index->table_capacity - 1;
+    int slot = (int)(word_hash(index->text + index->word_offset[id], index->word_length[id]) & mask);
+    while (index->table[slot] != 0) slot = (slot + 1) & mask;
+    index->table[slot] = id + 1;
+}
+
+// Id of word, adding it to the vocabulary if new; -1 if out of memory
+static int add_word(SearchIndex *index, const char *word, int length) {
+    int id = find_word(index, word, length);
+    if (id >= 0) return id;
+
+    id = index->word_count;
+    int capacity = index->word_capacity;
+    int ok = 1, c;
+    c = capacity; ok &= reserve((void **)&index->word_offset, &c, id + 1, sizeof(int));
+    c = capacity; ok &= reserve((void **)&index->word_length, &c, id + 1, sizeof(unsigned char));
+    c = capacity; ok &= reserve((void **)&index->word_docs, &c, id + 1, sizeof(IntList));
+    c = capacity; ok &= reserve((void **)&index->word_stamp, &c, id + 1, sizeof(unsigned));
+    c = capacity; ok &= reserve((void **)&index->word_overlap, &c, id + 1, sizeof(int));
+    ok = ok && reserve((void **)&index->text, &index->text_capacity, index->text_length + length, 1);
+    if (!ok) return -1;
+    index->word_capacity = c;
+
+    // Keep the hash table at most half full
+    if (2 * (id + 1) > index->table_capacity) {
+        int size = index->table_capacity ? 2 * index->table_capacity : 1024;
+        int *table = calloc(size, sizeof(int));
+        if (table == NULL) return -1;
+        free(index->table);
+        index->table = table;
+        index->table_capacity = size;
+        for (int w = 0; w < id; w++) table_insert(index, w);
+    }
+
+    index->word_offset[id] = index->text_length;
+    index->word_length[id] = (unsigned char)length;
+    memcpy(index->text + index->text_length, word, length);
+    index->text_length += length;
+    index->word_count++;
+    table_insert(index, id);
+
+    int codes[MAX_WORD + 2];
+    int count = word_trigrams(word, length, codes);
+    for (int i = 0; i < count; i++) {
+        if (!list_push(&index->trigrams[codes[i]], id)) return -1;
+    }
+    return id;
+}
+
+// ============================================================================
+// EDIT DISTANCE
+// ============================================================================
+
+// Myers' bit-vector algorithm (in Hyyrö's formulation for the distance of
+// whole strings): bit i of pv/mv says whether the DP column steps up or
+// down between pattern rows i and i + 1, so one text character updates
+// all m rows in a handful of word operations. peq[c] has bit i set where
+// pattern[i] == c.
+static int myers_distance(const uint64_t *peq, int m, const char *text, int n) {
+    if (m == 0) return n;
+
+    uint64_t pv = ~0ULL, mv = 0;
+    uint64_t high = 1ULL << (m - 1);
+    int score = m;
+
+    for (int j = 0; j < n; j++) {
+        uint64_t eq = peq[(unsigned char)text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & high) score++;
+        else if (mh & high) score--;
+
+        // Row 0 grows by one per text character
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+static void pattern_masks(const char *pattern, int m, uint64_t *peq) {
+    memset(peq, 0, 256 * sizeof(uint64_t));
+    for (int i = 0; i < m; i++) peq[(unsigned char)pattern[i]] |= 1ULL << i;
+}
+
+int search_edit_distance(const char *a, int a_length, const char *b, int b_length) {
+    uint64_t peq[256];
+    if (a_length > 64) a_length = 64;
+    pattern_masks(a, a_length, peq);
+    return myers_distance(peq, a_length, b, b_length);
+}
+
+// ============================================================================
+// INDEXING
+// ============================================================================
+
+static int add_words(SearchIndex *index, int doc, const char *text, int in_topic) {
+    char word[MAX_WORD];
+    const char *cursor = text;
+    int length;
+    while ((length = next_word(&cursor, word)) > 0) {
+        int id = add_word(index, word, length);
+        if (id < 0) return 0;
+        // Once per lesson; the topic comes first, so its words keep the flag
+        if (index->word_stamp[id] == index->word_generation) continue;
+        index->word_stamp[id] = index->word_generation;
+        if (!list_push(&index->word_docs[id], doc << 1 | in_topic)) return 0;
+    }
+    return 1;
+}
+
+static int index_lesson(SearchIndex *index, int lesson_id, const char *topic, const char *content) {
+    int capacity = index->doc_capacity;
+    int needed = index->doc_count + 1;
+    int ok = 1, c;
+    c = capacity; ok &= reserve((void **)&index->doc_lesson, &c, needed, sizeof(int));
+    c = capacity; ok &= reserve((void **)&index->doc_stamp, &c, needed, sizeof(unsigned));
+    c = capacity; ok &= reserve((void **)&index->doc_mask, &c, needed, sizeof(unsigned char));
+    c = capacity; ok &= reserve((void **)&index->doc_terms, &c, needed, sizeof(unsigned char));
+    c = capacity; ok &= reserve((void **)&index->doc_topic, &c, needed, sizeof(unsigned char));
+    c = capacity; ok &= reserve((void **)&index->doc_edits, &c, needed, sizeof(int));
+    if (!ok) return -1;
+    index->doc_capacity = c;
+
+    int doc = index->doc_count++;
+    index->doc_lesson[doc] = lesson_id;
+    index->live++;
+
+    index->word_generation++;
+    if (!add_words(index, doc, topic, 1) || !add_words(index, doc, content, 0)) return -1;
+    return doc;
+}
+
+static void remove_lesson(SearchIndex *index, LessonState *state) {
+    if (state->doc < 0) return;
+    // Its postings stay until the next rebuild and are skipped by queries
+    index->doc_lesson[state->doc] = 0;
+    state->doc = -1;
+    index->live--;
+}
+
+static void clear_index(SearchIndex *index) {
+    for (int w = 0; w < index->word_count; w++) free(index->word_docs[w].items);
+    for (int t = 0; t < TRIGRAM_SPACE; t++) free(index->trigrams[t].items);
+    free(index->text);
+    free(index->word_offset);
+    free(index->word_length);
+    free(index->word_docs);
+    free(index->word_stamp);
+    free(index->word_overlap);
+    free(index->table);
+    free(index->touched_words.items);
+    free(index->doc_lesson);
+    free(index->doc_stamp);
+    free(index->doc_mask);
+    free(index->doc_terms);
+    free(index->doc_topic);
+    free(index->doc_edits);
+    free(index->touched_docs.items);
+    free(index->lessons);
+
+    sqlite3 *db = index->db;
+    SearchStats last = index->last;
+    memset(index, 0, sizeof(*index));
+    index->db = db;
+    index->last = last;
+}
+
+typedef struct {
+    int lesson_id;
+    sqlite3_int64 timestamp;
+    sqlite3_int64 content_hash;
+    int has_hash;
+} PendingLesson;
+
+static int reindex_pending(SearchIndex *index, const PendingLesson *pending, int count) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(index->db, "SELECT l.topic, c.content FROM lessons l "
+                                           "LEFT JOIN lesson_content c ON c.lesson_id = l.id "
+                                           "WHERE l.id = ?;", -1, &stmt, NULL);
+    for (int i = 0; rc == SQLITE_OK && i < count; i++) {
+        LessonState *state = &index->lessons[pending[i].lesson_id];
+        remove_lesson(index, state);
+
+        sqlite3_bind_int(stmt, 1, pending[i].lesson_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *topic = (const char *)sqlite3_column_text(stmt, 0);
+            const char *content = (const char *)sqlite3_column_text(stmt, 1);
+            state->doc = index_lesson(index, pending[i].lesson_id, topic ? topic : "",
+                                      content ? content : "");
+            if (state->doc < 0) rc = SQLITE_NOMEM;
+            state->timestamp = pending[i].timestamp;
+            state->content_hash = pending[i].content_hash;
+            state->has_hash = pending[i].has_hash;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    index->last.reindexed = count;
+    return rc;
+}
+
+// Compare lessons with what was indexed; reindex the new and changed ones
+// and drop those that are gone
+static int update_lessons(SearchIndex *index) {
+    unsigned generation = ++index->refresh_generation;
+    PendingLesson *pending = NULL;
+    int count = 0, capacity = 0;
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(index->db, "SELECT id, timestamp, content_hash FROM lessons;",
+                                -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        int lesson_id = sqlite3_column_int(stmt, 0);
+        if (lesson_id <= 0) continue;
+        if (lesson_id >= index->lesson_capacity) {
+            int old = index->lesson_capacity;
+            if (!reserve((void **)&index->lessons, &index->lesson_capacity, lesson_id + 1, sizeof(LessonState))) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            for (int i = old; i < index->lesson_capacity; i++) index->lessons[i].doc = -1;
+        }
+
+        LessonState *state = &index->lessons[lesson_id];
+        state->seen = generation;
+        PendingLesson lesson = {
+            .lesson_id = lesson_id,
+            .timestamp = sqlite3_column_int64(stmt, 1),
+            .content_hash = sqlite3_column_int64(stmt, 2),
+            .has_hash = sqlite3_column_type(stmt, 2) != SQLITE_NULL
+        };
+        if (state->doc >= 0 && state->timestamp == lesson.timestamp && state->has_hash == lesson.has_hash &&
+            (!lesson.has_hash || state->content_hash == lesson.content_hash)) {
+            continue;
+        }
+        if (!reserve((void **)&pending, &capacity, count + 1, sizeof(PendingLesson))) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        pending[count++] = lesson;
+    }
+    sqlite3_finalize(stmt);
+
+    int removed = 0;
+    for (int id = 1; rc == SQLITE_OK && id < index->lesson_capacity; id++) {
+        LessonState *state = &index->lessons[id];
+        if (state->doc >= 0 && state->seen != generation) {
+            remove_lesson(index, state);
+            removed++;
+        }
+    }
+    index->last.removed = removed;
+
+    if (rc == SQLITE_OK) rc = reindex_pending(index, pending, count);
+    free(pending);
+    return rc;
+}
+
+int search_refresh(SearchIndex *index) {
+    sqlite3 *db = index->db;
+
+    // Nothing committed since the last refresh, here or elsewhere
+    sqlite3_stmt *stmt;
+    sqlite3_int64 data_version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA data_version;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) data_version = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (index->total_changes != 0 && data_version == index->data_version &&
+        sqlite3_total_changes64(db) == index->total_changes) {
+        return SQLITE_OK;
+    }
+
+    double start = now_seconds();
+    int own_transaction = sqlite3_get_autocommit(db);
+    if (own_transaction) sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+
+    int rc = update_lessons(index);
+
+    // Removed and reindexed lessons leave dead postings behind; start over
+    // once they outnumber the live ones
+    if (rc == SQLITE_OK && index->doc_count > 1024 && index->doc_count - index->live > index->live) {
+        clear_index(index);
+        rc = update_lessons(index);
+    }
+    if (own_transaction) sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot refresh the search index: %s\n",
+                rc == SQLITE_NOMEM ? "out of memory" : sqlite3_errmsg(db));
+        // A partial index would silently miss lessons: rebuild next time
+        clear_index(index);
+        return rc;
+    }
+
+    index->data_version = data_version;
+    index->total_changes = sqlite3_total_changes64(db);
+    if (index->total_changes == 0) index->total_changes = -1;
+    index->last.refresh_seconds = now_seconds() - start;
+    return SQLITE_OK;
+}
+
+SearchIndex* search_open(sqlite3 *db) {
+    SearchIndex *index = calloc(1, sizeof(SearchIndex));
+    if (index == NULL) return NULL;
+    index->db = db;
+
+    if (search_refresh(index) != SQLITE_OK) {
+        search_close(index);
+        return NULL;
+    }
+    return index;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+static int compare_expansion(const void *a, const void *b, const SearchIndex *index) {
+    const Expansion *x = a, *y = b;
+    if (x->edits != y->edits) return x->edits - y->edits;
+    // Between equally close words, the more common one
+    return index->word_docs[y->word].count - index->word_docs[x->word].count;
+}
+
+// Vocabulary words within the allowed edits of word, closest first
+static int expand_word(SearchIndex *index, const char *word, int length, Expansion *expansions) {
+    int max_edits = length / 4 < MAX_EDITS ? length / 4 : MAX_EDITS;
+    int codes[MAX_WORD + 2];
+    int trigram_count = word_trigrams(word, length, codes);
+
+    // An edit changes at most three trigrams
+    int min_shared = trigram_count - 3 * max_edits;
+    if (min_shared < 1) min_shared = 1;
+
+    unsigned generation = ++index->word_generation;
+    index->touched_words.count = 0;
+    for (int t = 0; t < trigram_count; t++) {
+        const IntList *words = &index->trigrams[codes[t]];
+        for (int i = 0; i < words->count; i++) {
+            int w = words->items[i];
+            if (index->word_stamp[w] != generation) {
+                index->word_stamp[w] = generation;
+                index->word_overlap[w] = 0;
+                if (!list_push(&index->touched_words, w)) return 0;
+            }
+            index->word_overlap[w]++;
+        }
+    }
+
+    uint64_t peq[256];
+    pattern_masks(word, length, peq);
+
+    int count = 0;
+    for (int i = 0; i < index->touched_words.count; i++) {
+        int w = index->touched_words.items[i];
+        int w_length = index->word_length[w];
+        if (index->word_overlap[w] < min_shared || index->word_docs[w].count == 0 ||
+            w_length < length - max_edits || w_length > length + max_edits) {
+            continue;
+        }
+
+        int edits = myers_distance(peq, length, index->text + index->word_offset[w], w_length);
+        if (edits > max_edits) continue;
+
+        // Insertion into the closest MAX_EXPANSIONS
+        Expansion candidate = { w, edits };
+        int at = count < MAX_EXPANSIONS ? count++ : MAX_EXPANSIONS;
+        while (at > 0 && compare_expansion(&candidate, &expansions[at - 1], index) < 0) {
+            if (at < MAX_EXPANSIONS) expansions[at] = expansions[at - 1];
+            at--;
+        }
+        if (at < MAX_EXPANSIONS) expansions[at] = candidate;
+    }
+    return count;
+}
+
+// Orders matches best first
+static int better_match(const SearchMatch *a, const SearchMatch *b) {
+    if (a->terms != b->terms) return a->terms > b->terms;
+    if (a->edits != b->edits) return a->edits < b->edits;
+    if (a->topic_terms != b->topic_terms) return a->topic_terms > b->topic_terms;
+    return a->lesson_id < b->lesson_id;
+}
+
+int search_fuzzy(SearchIndex *index, const char *query, int k, SearchMatch *matches,
+                 char *corrected, size_t corrected_size) {
+    if (corrected && corrected_size > 0) corrected[0] = '\0';
+    if (k <= 0) return 0;
+
+    unsigned generation = ++index->doc_generation;
+    if (generation == 0) {
+        memset(index->doc_stamp, 0, index->doc_capacity * sizeof(unsigned));
+        generation = index->doc_generation = 1;
+    }
+    index->touched_docs.count = 0;
+
+    char word[MAX_WORD];
+    const char *cursor = query;
+    int length, terms = 0;
+    size_t corrected_length = 0;
+
+    while (terms < SEARCH_MAX_TERMS && (length = next_word(&cursor, word)) > 0) {
+        int term = terms++;
+        Expansion expansions[MAX_EXPANSIONS];
+        int count = expand_word(index, word, length, expansions);
+
+        if (corrected && corrected_size > corrected_length + 1) {
+            const char *best = count > 0 ? index->text + index->word_offset[expansions[0].word] : word;
+            int best_length = count > 0 ? index->word_length[expansions[0].word] : length;
+            corrected_length += snprintf(corrected + corrected_length, corrected_size - corrected_length,
+                                         "%s%.*s", term ? " " : "", best_length, best);
+            if (corrected_length >= corrected_size) corrected_length = corrected_size - 1;
+        }
+
+        // Closest words first, so a lesson's first hit for a term is its best
+        for (int e = 0; e < count; e++) {
+            const IntList *docs = &index->word_docs[expansions[e].word];
+            for (int i = 0; i < docs->count; i++) {
+                int doc = docs->items[i] >> 1;
+                if (index->doc_lesson[doc] == 0) continue;
+
+                if (index->doc_stamp[doc] != generation) {
+                    index->doc_stamp[doc] = generation;
+                    index->doc_mask[doc] = 0;
+                    index->doc_terms[doc] = 0;
+                    index->doc_topic[doc] = 0;
+                    index->doc_edits[doc] = 0;
+                    if (!list_push(&index->touched_docs, doc)) return 0;
+                }
+                if (index->doc_mask[doc] & (1u << term)) continue;
+                index->doc_mask[doc] |= 1u << term;
+                index->doc_terms[doc]++;
+                index->doc_edits[doc] += expansions[e].edits;
+                index->doc_topic[doc] += docs->items[i] & 1;
+            }
+        }
+    }
+
+    // The best k by insertion; most lessons fail the first comparison
+    int found = 0;
+    for (int i = 0; i < index->touched_docs.count; i++) {
+        int doc = index->touched_docs.items[i];
+        SearchMatch match = { index->doc_lesson[doc], index->doc_terms[doc],
+                              index->doc_edits[doc], index->doc_topic[doc] };
+        if (found == k && !better_match(&match, &matches[k - 1])) continue;
+
+        int at = found < k ? found++ : k - 1;
+        while (at > 0 && better_match(&match, &matches[at - 1])) {
+            matches[at] = matches[at - 1];
+            at--;
+        }
+        matches[at] = match;
+    }
+    return found;
+}
+
+void search_stats(const SearchIndex *index, SearchStats *stats) {
+    *stats = index->last;
+    stats->lessons = index->live;
+    stats->words = index->word_count;
+}
+
+void search_close(SearchIndex *index) {
+    if (index == NULL) return;
+    clear_index(index);
+    free(index);
+}
@@ -0,0 +1,64 @@
+#ifndef DB_SEARCH_H
+#define DB_SEARCH_H
+
+#include "db_common.h"
+#include <stddef.h>
+
+// Query words considered; the rest of a longer query is ignored
+#define SEARCH_MAX_TERMS 8
+
+// Typo-tolerant search over lesson topics and content.
+//
+// The index is built in memory from lessons and lesson_content. Every
+// distinct word (lowercase letters, digits and '_', 2 to 32 characters)
+// is filed under its trigrams, with "$" marking the start and end of the
+// word, and lists the lessons that use it.
+//
+// A query word is matched against the vocabulary, not the lessons: words
+// sharing enough of its trigrams to be within the allowed number of edits
+// (one per four characters, at most three) are candidates, and their
+// exact edit distance is computed with Myers' bit-parallel algorithm, one
+// 64-bit step per character. The lessons of the closest words are then
+// ranked by query words matched, total edits and matches in the topic.
+//
+// search_refresh() reindexes lessons whose timestamp or content_hash
+// changed and drops deleted ones.
+
+typedef struct SearchIndex SearchIndex;
+
+typedef struct {
+    int lesson_id;
+    int terms;                  // Query words matched
+    int edits;                  // Total edit distance of those matches
+    int topic_terms;            // Query words matched in the topic
+} SearchMatch;
+
+typedef struct {
+    int lessons;                // Lessons in the index
+    int words;                  // Vocabulary size
+    int reindexed;              // Added or edited lessons, last refresh
+    int removed;                // Deleted lessons, last refresh
+    double refresh_seconds;     // Last refresh (or the build on open)
+} SearchStats;
+
+// Build the index for db's lessons. It belongs to db's connection and
+// must be used on the same thread.
+SearchIndex* search_open(sqlite3 *db);
+
+// Bring the index up to date; cheap when nothing changed
+int search_refresh(SearchIndex *index);
+
+// Up to k lessons for query, best first; returns how many. When
+// corrected is not NULL it receives the query with each word replaced by
+// its closest indexed word.
+int search_fuzzy(SearchIndex *index, const char *query, int k, SearchMatch *matches,
+                 char *corrected, size_t corrected_size);
+
+// Levenshtein distance of a and b; a must be at most 64 bytes
+int search_edit_distance(const char *a, int a_length, const char *b, int b_length);
+
+void search_stats(const SearchIndex *index, SearchStats *stats);
+
+void search_close(SearchIndex *index);
+
+#endif // DB_SEARCH_H
@@ -0,0 +1,905 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_similar.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SIMILAR_LANES 8
+#define SEED_TERMS 8            // Query terms whose lessons become candidates
+#define COMMON_POSTINGS 1024    // Seed terms in more lessons than this and a
+                                // quarter of the index are skipped
+#define PREFETCH_AHEAD 4      // Candidates
+#define MIN_WORD 2
+#define MAX_WORD 32
+#define MAX_TF 255
+
+typedef float SimilarVec __attribute__((vector_size(SIMILAR_LANES * sizeof(float))));
+
+static const char *stopwords[] = {
+    "an", "and", "are", "as", "at", "be", "but", "by", "can", "for", "from", "has",
+    "have", "in", "into", "is", "it", "its", "more", "not", "of", "on", "or", "than",
+    "that", "the", "their", "this", "to", "was", "were", "when", "which", "with", "you", "your"
+};
+#define STOPWORD_COUNT ((int)(sizeof(stopwords) / sizeof(stopwords[0])))
+
+typedef struct {
+    int *docs;
+    int count;
+    int capacity;
+} Postings;
+
+typedef struct {
+    int lesson_id;              // 0 once removed
+    int offset;                 // Into pool_terms/pool_weights
+    int count;                  // Multiple of SIMILAR_LANES; padding has weight 0
+} Doc;
+
+// One distinct term of a lesson: a hash while tokenizing, then an id
+typedef struct {
+    uint64_t key;
+    int tf;
+} TermCount;
+
+typedef struct {
+    int term;
+    float weight;
+} WeightedTerm;
+
+struct SimilarIndex {
+    sqlite3 *db;
+    uint64_t stop_hashes[STOPWORD_COUNT];   // Sorted
+
+    // Vocabulary by term id; id 0 is unused, padding lanes point at it
+    uint64_t *hashes;
+    int *df;
+    unsigned char *dirty;       // df changed during this refresh
+    Postings *postings;         // Lessons that keep the term in memory
+    float *query;               // Dense query vector, all zero between queries
+    int term_count;             // Highest id + 1
+    int term_capacity;
+    int *table;                 // Open addressing by hash: term id, 0 if empty
+    int table_capacity;         // Power of two
+
+    Doc *docs;
+    int doc_count;
+    int doc_capacity;
+    int live;                   // Docs not removed
+    int corpus;                 // Lesson count the idf weights are computed for
+    int *doc_of_lesson;         // By lesson id, -1 if not indexed
+    int lesson_capacity;
+    int *pool_terms;
+    float *pool_weights;
+    int pool_length;
+    int pool_capacity;
+
+    unsigned *stamp;            // By doc: candidate of query number `generation`
+    unsigned generation;
+    int *candidates;
+
+    int scalar;
+    sqlite3_int64 data_version; // At the last refresh
+    sqlite3_int64 total_changes;
+    SimilarStats last;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Grow array (of element size bytes) to hold at least needed elements,
+// zero-filling the new part
+static int reserve(void **array, int *capacity, int needed, size_t size) {
+    if (needed <= *capacity) return 1;
+    int grown = *capacity ? *capacity : 64;
+    while (grown < needed) grown *= 2;
+
+    void *data = realloc(*array, (size_t)grown * size);
+    if (data == NULL) return 0;
+    memset((char *)data + (size_t)*capacity * size, 0, (size_t)(grown - *capacity) * size);
+    *array = data;
+    *capacity = grown;
+    return 1;
+}
+
+// ============================================================================
+// TOKENIZING
+// ============================================================================
+
+static uint64_t word_hash(const char *word, int length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < length; i++) hash = (hash ^ (unsigned char)word[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_term_key(const void *a, const void *b) {
+    uint64_t x = ((const TermCount *)a)->key, y = ((const TermCount *)b)->key;
+    return (x > y) - (x < y);
+}
+
+// Distinct words of text with their counts, keyed by word hash. Returns
+// the count, or -1 when out of memory; *terms is malloc'd.
+static int count_words(const SimilarIndex *index, const char *text, TermCount **terms) {
+    uint64_t *words = NULL;
+    int count = 0, capacity = 0;
+    char word[MAX_WORD];
+    int length = 0;
+
+    for (const char *c = text; ; c++) {
+        char ch = *c;
+        int is_word = (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_' ||
+                      (ch >= 'A' && ch <= 'Z');
+        if (is_word) {
+            if (length < MAX_WORD) word[length] = (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+            length++;
+            continue;
+        }
+
+        if (length >= MIN_WORD && length <= MAX_WORD) {
+            uint64_t hash = word_hash(word, length);
+            if (bsearch(&hash, index->stop_hashes, STOPWORD_COUNT, sizeof(uint64_t), compare_u64) == NULL) {
+                if (!reserve((void **)&words, &capacity, count + 1, sizeof(uint64_t))) {
+                    free(words);
+                    return -1;
+                }
+                words[count++] = hash;
+            }
+        }
+        length = 0;
+        if (ch == '\0') break;
+    }
+
+    qsort(words, count, sizeof(uint64_t), compare_u64);
+    *terms = malloc((count ? count : 1) * sizeof(TermCount));
+    if (*terms == NULL) {
+        free(words);
+        return -1;
+    }
+
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        if (distinct > 0 && (*terms)[distinct - 1].key == words[i]) {
+            if ((*terms)[distinct - 1].tf < MAX_TF) (*terms)[distinct - 1].tf++;
+        } else {
+            (*terms)[distinct++] = (TermCount){ .key = words[i], .tf = 1 };
+        }
+    }
+    free(words);
+    return distinct;
+}
+
+// ============================================================================
+// VOCABULARY
+// ============================================================================
+
+static int find_term(const SimilarIndex *index, uint64_t hash) {
+    if (index->table_capacity == 0) return 0;
+    int mask = index->table_capacity - 1;
+    for (int slot = (int)(hash & mask); ; slot = (slot + 1) & mask) {
+        int id = index->table[slot];
+        if (id == 0 || index->hashes[id] == hash) return id;
+    }
+}
+
+static void table_insert(SimilarIndex *index, int id) {
+    int mask = index->table_capacity - 1;
+    int slot = (int)(index->hashes[id] & mask);
+    while (index->table[slot] != 0) slot = (slot + 1) & mask;
+    index->table[slot] = id;
+}
+
+// Make room for term id; keeps the hash table at most half full
+static int reserve_term(SimilarIndex *index, int id) {
+    int capacity = index->term_capacity;
+    if (id >= capacity) {
+        int needed = id + 1;
+        int ok = 1;
+        int c;
+        c = capacity; ok &= reserve((void **)&index->hashes, &c, needed, sizeof(uint64_t));
+        c = capacity; ok &= reserve((void **)&index->df, &c, needed, sizeof(int));
+        c = capacity; ok &= reserve((void **)&index->dirty, &c, needed, sizeof(unsigned char));
+        c = capacity; ok &= reserve((void **)&index->postings, &c, needed, sizeof(Postings));
+        c = capacity; ok &= reserve((void **)&index->query, &c, needed, sizeof(float));
+        if (!ok) return 0;
+        index->term_capacity = c;
+    }
+
+    if (2 * (id + 1) > index->table_capacity) {
+        int size = index->table_capacity ? 2 * index->table_capacity : 1024;
+        while (2 * (id + 1) > size) size *= 2;
+        int *table = calloc(size, sizeof(int));
+        if (table == NULL) return 0;
+        free(index->table);
+        index->table = table;
+        index->table_capacity = size;
+        for (int t = 1; t < index->term_count; t++) {
+            if (t != id) table_insert(index, t);
+        }
+    }
+    return 1;
+}
+
+static int set_term(SimilarIndex *index, int id, uint64_t hash, int df) {
+    if (!reserve_term(index, id)) return 0;
+    index->hashes[id] = hash;
+    index->df[id] = df;
+    if (id >= index->term_count) index->term_count = id + 1;
+    table_insert(index, id);
+    return 1;
+}
+
+// Id of a word hash, adding it to the vocabulary if new; 0 if out of memory
+static int term_id(SimilarIndex *index, uint64_t hash) {
+    int id = find_term(index, hash);
+    if (id != 0) return id;
+    id = index->term_count > 0 ? index->term_count : 1;
+    return set_term(index, id, hash, 0) ? id : 0;
+}
+
+// ============================================================================
+// DOCUMENT VECTORS
+// ============================================================================
+
+static float idf(const SimilarIndex *index, int term) {
+    return logf((1.0f + index->corpus) / (1.0f + index->df[term])) + 1.0f;
+}
+
+static int compare_weight(const void *a, const void *b) {
+    float x = ((const WeightedTerm *)a)->weight, y = ((const WeightedTerm *)b)->weight;
+    return (x < y) - (x > y);
+}
+
+// The SIMILAR_MAX_TERMS best terms of a lesson, normalized, best first,
+// padded to whole lanes. terms[].key holds term ids. Returns the padded
+// count; out must hold SIMILAR_MAX_TERMS + SIMILAR_LANES entries.
+static int weigh_terms(const SimilarIndex *index, const TermCount *terms, int count,
+                       WeightedTerm *out) {
+    WeightedTerm *all = malloc((count ? count : 1) * sizeof(WeightedTerm));
+    if (all == NULL) return 0;
+
+    int used = 0;
+    for (int i = 0; i < count; i++) {
+        int term = (int)terms[i].key;
+        if (term <= 0) continue;
+        all[used++] = (WeightedTerm){ term, (1.0f + logf((float)terms[i].tf)) * idf(index, term) };
+    }
+    qsort(all, used, sizeof(WeightedTerm), compare_weight);
+    if (used > SIMILAR_MAX_TERMS) used = SIMILAR_MAX_TERMS;
+
+    float norm = 0.0f;
+    for (int i = 0; i < used; i++) norm += all[i].weight * all[i].weight;
+    norm = norm > 0.0f ? 1.0f / sqrtf(norm) : 0.0f;
+
+    for (int i = 0; i < used; i++) out[i] = (WeightedTerm){ all[i].term, all[i].weight * norm };
+    free(all);
+
+    int padded = (used + SIMILAR_LANES - 1) / SIMILAR_LANES * SIMILAR_LANES;
+    for (int i = used; i < padded; i++) out[i] = (WeightedTerm){ 0, 0.0f };
+    return padded;
+}
+
+static void remove_doc(SimilarIndex *index, int lesson_id) {
+    if (lesson_id <= 0 || lesson_id >= index->lesson_capacity) return;
+    int d = index->doc_of_lesson[lesson_id];
+    if (d < 0) return;
+
+    // Postings keep pointing at the slot until the next reload
+    index->docs[d].lesson_id = 0;
+    index->doc_of_lesson[lesson_id] = -1;
+    index->live--;
+}
+
+static int add_doc(SimilarIndex *index, int lesson_id, const TermCount *terms, int count) {
+    WeightedTerm weighted[SIMILAR_MAX_TERMS + SIMILAR_LANES];
+    int padded = weigh_terms(index, terms, count, weighted);
+
+    if (lesson_id >= index->lesson_capacity) {
+        int old = index->lesson_capacity;
+        if (!reserve((void **)&index->doc_of_lesson, &index->lesson_capacity, lesson_id + 1, sizeof(int))) {
+            return 0;
+        }
+        for (int i = old; i < index->lesson_capacity; i++) index->doc_of_lesson[i] = -1;
+    }
+    remove_doc(index, lesson_id);
+
+    int doc_capacity = index->doc_capacity;
+    int pool_capacity = index->pool_capacity;
+    int ok = reserve((void **)&index->docs, &doc_capacity, index->doc_count + 1, sizeof(Doc));
+    int c = index->doc_capacity;
+    ok = ok && reserve((void **)&index->stamp, &c, index->doc_count + 1, sizeof(unsigned));
+    c = index->doc_capacity;
+    ok = ok && reserve((void **)&index->candidates, &c, index->doc_count + 1, sizeof(int));
+    ok = ok && reserve((void **)&index->pool_terms, &pool_capacity,
+                       index->pool_length + padded, sizeof(int));
+    pool_capacity = index->pool_capacity;
+    ok = ok && reserve((void **)&index->pool_weights, &pool_capacity,
+                       index->pool_length + padded, sizeof(float));
+    if (!ok) return 0;
+    index->doc_capacity = doc_capacity;
+    index->pool_capacity = pool_capacity;
+
+    int d = index->doc_count++;
+    index->docs[d] = (Doc){ lesson_id, index->pool_length, padded };
+    for (int i = 0; i < padded; i++) {
+        index->pool_terms[index->pool_length + i] = weighted[i].term;
+        index->pool_weights[index->pool_length + i] = weighted[i].weight;
+
+        if (weighted[i].weight <= 0.0f) continue;
+        Postings *postings = &index->postings[weighted[i].term];
+        if (!reserve((void **)&postings->docs, &postings->capacity, postings->count + 1, sizeof(int))) {
+            return 0;
+        }
+        postings->docs[postings->count++] = d;
+    }
+    index->pool_length += padded;
+    index->doc_of_lesson[lesson_id] = d;
+    index->live++;
+    return 1;
+}
+
+// Stored form: distinct term ids in ascending order, each as a varint
+// delta from the previous id followed by one byte of term count
+static unsigned char* encode_terms(TermCount *terms, int count, int *size) {
+    qsort(terms, count, sizeof(TermCount), compare_term_key);
+    unsigned char *blob = malloc((size_t)count * 6 + 1);
+    if (blob == NULL) return NULL;
+
+    int length = 0;
+    uint64_t previous = 0;
+    for (int i = 0; i < count; i++) {
+        uint64_t delta = terms[i].key - previous;
+        previous = terms[i].key;
+        do {
+            blob[length++] = (unsigned char)((delta & 0x7f) | (delta > 0x7f ? 0x80 : 0));
+            delta >>= 7;
+        } while (delta);
+        blob[length++] = (unsigned char)terms[i].tf;
+    }
+    *size = length;
+    return blob;
+}
+
+// Returns the term count, or -1 when out of memory; *terms is malloc'd
+static int decode_terms(const unsigned char *blob, int size, TermCount **terms) {
+    *terms = malloc((size / 2 + 1) * sizeof(TermCount));
+    if (*terms == NULL) return -1;
+
+    int count = 0;
+    uint64_t id = 0;
+    for (int i = 0; i < size; ) {
+        uint64_t delta = 0;
+        int shift = 0;
+        while (i < size && (blob[i] & 0x80)) {
+            delta |= (uint64_t)(blob[i++] & 0x7f) << shift;
+            shift += 7;
+        }
+        if (i + 1 >= size) break;
+        delta |= (uint64_t)blob[i++] << shift;
+        id += delta;
+        (*terms)[count++] = (TermCount){ .key = id, .tf = blob[i++] };
+    }
+    return count;
+}
+
+// ============================================================================
+// LOADING AND REFRESHING
+// ============================================================================
+
+static void clear_index(SimilarIndex *index) {
+    for (int t = 0; t < index->term_capacity; t++) free(index->postings[t].docs);
+    free(index->hashes);
+    free(index->df);
+    free(index->dirty);
+    free(index->postings);
+    free(index->query);
+    free(index->table);
+    free(index->docs);
+    free(index->doc_of_lesson);
+    free(index->pool_terms);
+    free(index->pool_weights);
+    free(index->stamp);
+    free(index->candidates);
+
+    sqlite3 *db = index->db;
+    SimilarStats last = index->last;
+    uint64_t stop_hashes[STOPWORD_COUNT];
+    memcpy(stop_hashes, index->stop_hashes, sizeof(stop_hashes));
+    int scalar = index->scalar;
+
+    memset(index, 0, sizeof(*index));
+    index->db = db;
+    index->last = last;
+    memcpy(index->stop_hashes, stop_hashes, sizeof(stop_hashes));
+    index->scalar = scalar;
+}
+
+static sqlite3_int64 query_int64(sqlite3 *db, const char *sql) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 value = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// (Re)build the in-memory index from similar_terms and lesson_vectors
+static int load_index(SimilarIndex *index) {
+    sqlite3 *db = index->db;
+    clear_index(index);
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, "SELECT id, hash, df FROM similar_terms ORDER BY id;",
+                                -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        if (!set_term(index, sqlite3_column_int(stmt, 0), (uint64_t)sqlite3_column_int64(stmt, 1),
+                      sqlite3_column_int(stmt, 2))) {
+            rc = SQLITE_NOMEM;
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK) return rc;
+
+    index->corpus = (int)query_int64(db, "SELECT COUNT(*) FROM lesson_vectors;");
+
+    rc = sqlite3_prepare_v2(db, "SELECT lesson_id, terms FROM lesson_vectors;", -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        TermCount *terms;
+        int count = decode_terms(sqlite3_column_blob(stmt, 1), sqlite3_column_bytes(stmt, 1), &terms);
+        if (count < 0 || !add_doc(index, sqlite3_column_int(stmt, 0), terms, count)) rc = SQLITE_NOMEM;
+        free(terms);
+    }
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+SimilarIndex* similar_open(sqlite3 *db) {
+    const char *sql =
+        "CREATE TABLE IF NOT EXISTS similar_terms ("
+        "id INTEGER PRIMARY KEY,"
+        "hash INTEGER NOT NULL,"
+        "df INTEGER NOT NULL"
+        ");"
+        "CREATE TABLE IF NOT EXISTS lesson_vectors ("
+        "lesson_id INTEGER PRIMARY KEY,"
+        "timestamp INTEGER NOT NULL,"
+        "content_hash INTEGER,"
+        "terms BLOB NOT NULL"
+        ");";
+
+    char *err_msg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "SQL error (similar index): %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return NULL;
+    }
+
+    SimilarIndex *index = calloc(1, sizeof(SimilarIndex));
+    if (index == NULL) return NULL;
+    index->db = db;
+    for (int i = 0; i < STOPWORD_COUNT; i++) {
+        index->stop_hashes[i] = word_hash(stopwords[i], (int)strlen(stopwords[i]));
+    }
+    qsort(index->stop_hashes, STOPWORD_COUNT, sizeof(uint64_t), compare_u64);
+
+    if (load_index(index) != SQLITE_OK || similar_refresh(index) != SQLITE_OK) {
+        similar_close(index);
+        return NULL;
+    }
+    return index;
+}
+
+typedef struct {
+    int lesson_id;
+    sqlite3_int64 timestamp;
+    sqlite3_int64 content_hash;
+    int has_hash;
+} PendingLesson;
+
+// Vectors whose lesson is gone or changed, and lessons without a vector
+#define STALE_VECTORS "FROM lesson_vectors v LEFT JOIN lessons l ON l.id = v.lesson_id " \
+                      "WHERE l.id IS NULL OR l.timestamp IS NOT v.timestamp " \
+                      "OR l.content_hash IS NOT v.content_hash"
+#define UNINDEXED_LESSONS "FROM lessons l " \
+                          "WHERE NOT EXISTS (SELECT 1 FROM lesson_vectors v WHERE v.lesson_id = l.id)"
+
+// Whether a refresh has anything to write; reads only, so progress writes
+// and other tables' commits do not take the write lock
+static int needs_refresh(SimilarIndex *index) {
+    return query_int64(index->db, "SELECT EXISTS (SELECT 1 " STALE_VECTORS ") "
+                                  "OR EXISTS (SELECT 1 " UNINDEXED_LESSONS ");") != 0;
+}
+
+// Drop vectors whose lesson is gone or changed; their terms lose a lesson
+static int remove_stale(SimilarIndex *index) {
+    sqlite3 *db = index->db;
+    const char *sql = "SELECT v.lesson_id, v.terms " STALE_VECTORS ";";
+
+    int *stale = NULL;
+    int count = 0, capacity = 0;
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        TermCount *terms;
+        int term_count = decode_terms(sqlite3_column_blob(stmt, 1), sqlite3_column_bytes(stmt, 1), &terms);
+        if (term_count < 0 || !reserve((void **)&stale, &capacity, count + 1, sizeof(int))) {
+            if (term_count >= 0) free(terms);
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        for (int i = 0; i < term_count; i++) {
+            int term = (int)terms[i].key;
+            if (term > 0 && term < index->term_count && index->df[term] > 0) {
+                index->df[term]--;
+                index->dirty[term] = 1;
+            }
+        }
+        free(terms);
+        stale[count++] = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    sqlite3_stmt *remove = NULL;
+    if (rc == SQLITE_OK && count > 0) {
+        rc = sqlite3_prepare_v2(db, "DELETE FROM lesson_vectors WHERE lesson_id = ?;", -1, &remove, NULL);
+    }
+    for (int i = 0; rc == SQLITE_OK && i < count; i++) {
+        sqlite3_bind_int(remove, 1, stale[i]);
+        if (sqlite3_step(remove) != SQLITE_DONE) rc = sqlite3_errcode(db);
+        sqlite3_reset(remove);
+        remove_doc(index, stale[i]);
+    }
+    sqlite3_finalize(remove);
+
+    free(stale);
+    index->last.removed = count;
+    return rc;
+}
+
+// Lessons without a vector, collected before any vector is written
+static int find_unindexed(SimilarIndex *index, PendingLesson **pending) {
+    const char *sql = "SELECT l.id, l.timestamp, l.content_hash " UNINDEXED_LESSONS ";";
+    int count = 0, capacity = 0;
+    *pending = NULL;
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(index->db, sql, -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        if (!reserve((void **)pending, &capacity, count + 1, sizeof(PendingLesson))) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        (*pending)[count++] = (PendingLesson){
+            .lesson_id = sqlite3_column_int(stmt, 0),
+            .timestamp = sqlite3_column_int64(stmt, 1),
+            .content_hash = sqlite3_column_int64(stmt, 2),
+            .has_hash = sqlite3_column_type(stmt, 2) != SQLITE_NULL
+        };
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_OK ? count : -1;
+}
+
+// Tokenize, store and (unless the whole index is reloaded afterwards)
+// index each pending lesson
+static int add_pending(SimilarIndex *index, const PendingLesson *pending, int count, int in_memory) {
+    sqlite3 *db = index->db;
+    sqlite3_stmt *content = NULL, *insert = NULL;
+    int rc = sqlite3_prepare_v2(db, "SELECT content FROM lesson_content WHERE lesson_id = ?;",
+                                -1, &content, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(db, "INSERT INTO lesson_vectors (lesson_id, timestamp, content_hash, terms) "
+                                    "VALUES (?, ?, ?, ?);", -1, &insert, NULL);
+    }
+
+    for (int i = 0; rc == SQLITE_OK && i < count; i++) {
+        sqlite3_bind_int(content, 1, pending[i].lesson_id);
+        const char *text = sqlite3_step(content) == SQLITE_ROW
+                         ? (const char *)sqlite3_column_text(content, 0) : NULL;
+
+        TermCount *terms;
+        int term_count = count_words(index, text ? text : "", &terms);
+        sqlite3_reset(content);
+        if (term_count < 0) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+
+        for (int t = 0; t < term_count; t++) {
+            int id = term_id(index, terms[t].key);
+            if (id == 0) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            terms[t].key = (uint64_t)id;
+            index->df[id]++;
+            index->dirty[id] = 1;
+        }
+
+        int size = 0;
+        unsigned char *blob = rc == SQLITE_OK ? encode_terms(terms, term_count, &size) : NULL;
+        if (rc == SQLITE_OK && blob == NULL) rc = SQLITE_NOMEM;
+        if (rc == SQLITE_OK) {
+            sqlite3_bind_int(insert, 1, pending[i].lesson_id);
+            sqlite3_bind_int64(insert, 2, pending[i].timestamp);
+            if (pending[i].has_hash) {
+                sqlite3_bind_int64(insert, 3, pending[i].content_hash);
+            } else {
+                sqlite3_bind_null(insert, 3);
+            }
+            sqlite3_bind_blob(insert, 4, blob, size, SQLITE_STATIC);
+            if (sqlite3_step(insert) != SQLITE_DONE) rc = sqlite3_errcode(db);
+            sqlite3_reset(insert);
+        }
+        if (rc == SQLITE_OK && in_memory && !add_doc(index, pending[i].lesson_id, terms, term_count)) {
+            rc = SQLITE_NOMEM;
+        }
+        free(blob);
+        free(terms);
+    }
+
+    sqlite3_finalize(content);
+    sqlite3_finalize(insert);
+    return rc;
+}
+
+static int store_term_counts(SimilarIndex *index) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(index->db, "INSERT OR REPLACE INTO similar_terms (id, hash, df) "
+                                           "VALUES (?, ?, ?);", -1, &stmt, NULL);
+    for (int t = 1; rc == SQLITE_OK && t < index->term_count; t++) {
+        if (!index->dirty[t]) continue;
+        index->dirty[t] = 0;
+        sqlite3_bind_int(stmt, 1, t);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)index->hashes[t]);
+        sqlite3_bind_int(stmt, 3, index->df[t]);
+        if (sqlite3_step(stmt) != SQLITE_DONE) rc = sqlite3_errcode(index->db);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+// Remember what the next refresh compares against
+static void mark_refreshed(SimilarIndex *index, sqlite3_int64 data_version, double start) {
+    index->data_version = data_version;
+    index->total_changes = sqlite3_total_changes64(index->db);
+    if (index->total_changes == 0) index->total_changes = -1;
+    index->last.refresh_seconds = now_seconds() - start;
+}
+
+int similar_refresh(SimilarIndex *index) {
+    sqlite3 *db = index->db;
+
+    // Nothing committed since the last refresh, here or elsewhere
+    sqlite3_int64 data_version = query_int64(db, "PRAGMA data_version;");
+    if (index->total_changes != 0 && data_version == index->data_version &&
+        sqlite3_total_changes64(db) == index->total_changes) {
+        return SQLITE_OK;
+    }
+
+    double start = now_seconds();
+    index->last.added = index->last.removed = 0;
+    if (!needs_refresh(index)) {
+        mark_refreshed(index, data_version, start);
+        return SQLITE_OK;
+    }
+
+    int rc = sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot refresh the similar-lesson index: %s\n", sqlite3_errmsg(db));
+        return rc;
+    }
+
+    rc = remove_stale(index);
+
+    PendingLesson *pending = NULL;
+    int count = rc == SQLITE_OK ? find_unindexed(index, &pending) : 0;
+    if (count < 0) rc = SQLITE_NOMEM;
+
+    // Many new lessons change every idf: index them in the tables only,
+    // then reload everything with the final counts
+    int reload = count > 64 && count > index->live / 4;
+    if (rc == SQLITE_OK) {
+        index->corpus = index->live + count;
+        rc = add_pending(index, pending, count, !reload);
+        index->last.added = count;
+    }
+    free(pending);
+    if (rc == SQLITE_OK) rc = store_term_counts(index);
+
+    if (rc == SQLITE_OK) rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot refresh the similar-lesson index: %s\n", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        reload = 1;
+    }
+
+    // Removed lessons still hold postings; rebuild once they are half the slots
+    if (reload || index->doc_count - index->live > index->live) {
+        int loaded = load_index(index);
+        if (rc == SQLITE_OK) rc = loaded;
+    }
+
+    mark_refreshed(index, data_version, start);
+    return rc;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+// query is dense by term id; terms/weights hold count entries, a multiple
+// of SIMILAR_LANES. The gather of query values is the only scalar part.
+static float dot_vector(const float *query, const int *terms, const float *weights, int count) {
+    SimilarVec sum = { 0 };
+    for (int i = 0; i < count; i += SIMILAR_LANES) {
+        SimilarVec q, w;
+        for (int lane = 0; lane < SIMILAR_LANES; lane++) q[lane] = query[terms[i + lane]];
+        memcpy(&w, weights + i, sizeof(w));
+        sum += q * w;
+    }
+
+    float total = 0.0f;
+    for (int lane = 0; lane < SIMILAR_LANES; lane++) total += sum[lane];
+    return total;
+}
+
+static float dot_scalar(const float *query, const int *terms, const float *weights, int count) {
+    float total = 0.0f;
+    for (int i = 0; i < count; i++) total += query[terms[i]] * weights[i];
+    return total;
+}
+
+// Min-heap on score, so the weakest of the best k is at the top
+static int worse(const SimilarMatch *a, const SimilarMatch *b) {
+    return a->score < b->score || (a->score == b->score && a->lesson_id > b->lesson_id);
+}
+
+static void sift_down(SimilarMatch *heap, int size, int i) {
+    for (;;) {
+        int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < size && worse(&heap[left], &heap[smallest])) smallest = left;
+        if (right < size && worse(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) return;
+        SimilarMatch swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+static void heap_offer(SimilarMatch *heap, int *size, int k, SimilarMatch match) {
+    if (*size < k) {
+        int i = (*size)++;
+        heap[i] = match;
+        while (i > 0 && worse(&heap[i], &heap[(i - 1) / 2])) {
+            SimilarMatch swap = heap[i];
+            heap[i] = heap[(i - 1) / 2];
+            heap[(i - 1) / 2] = swap;
+            i = (i - 1) / 2;
+        }
+    } else if (worse(&heap[0], &match)) {
+        heap[0] = match;
+        sift_down(heap, *size, 0);
+    }
+}
+
+// terms/weights: the query vector, best terms first
+static int search(SimilarIndex *index, const int *terms, const float *weights, int count,
+                  int exclude, int k, SimilarMatch *matches) {
+    if (k <= 0 || index->live == 0) return 0;
+
+    for (int i = 0; i < count; i++) index->query[terms[i]] = weights[i];
+    index->query[0] = 0.0f;
+
+    if (++index->generation == 0) {
+        memset(index->stamp, 0, index->doc_capacity * sizeof(unsigned));
+        index->generation = 1;
+    }
+
+    int candidates = 0;
+    int common = index->live / 4 > COMMON_POSTINGS ? index->live / 4 : COMMON_POSTINGS;
+    for (int i = 0; i < count && i < SEED_TERMS; i++) {
+        if (weights[i] <= 0.0f) break;
+        const Postings *postings = &index->postings[terms[i]];
+        if (postings->count > common && candidates > 0) continue;
+
+        for (int p = 0; p < postings->count; p++) {
+            int d = postings->docs[p];
+            int lesson_id = index->docs[d].lesson_id;
+            if (lesson_id == 0 || lesson_id == exclude || index->stamp[d] == index->generation) continue;
+            index->stamp[d] = index->generation;
+            index->candidates[candidates++] = d;
+        }
+    }
+
+    // Candidates are scattered over the pool; scoring waits on memory far
+    // more than on arithmetic, so the vectors a few candidates ahead are
+    // fetched while this one is scored
+    int size = 0;
+    for (int c = 0; c < candidates; c++) {
+        if (c + PREFETCH_AHEAD < candidates) {
+            const Doc *ahead = &index->docs[index->candidates[c + PREFETCH_AHEAD]];
+            for (int i = 0; i < ahead->count; i += 16) {
+                __builtin_prefetch(index->pool_terms + ahead->offset + i);
+                __builtin_prefetch(index->pool_weights + ahead->offset + i);
+            }
+        }
+        const Doc *doc = &index->docs[index->candidates[c]];
+        const int *doc_terms = index->pool_terms + doc->offset;
+        const float *doc_weights = index->pool_weights + doc->offset;
+        float score = index->scalar
+                    ? dot_scalar(index->query, doc_terms, doc_weights, doc->count)
+                    : dot_vector(index->query, doc_terms, doc_weights, doc->count);
+        heap_offer(matches, &size, k, (SimilarMatch){ doc->lesson_id, score });
+    }
+
+    for (int i = 0; i < count; i++) index->query[terms[i]] = 0.0f;
+
+    // Best first
+    for (int end = size - 1; end > 0; end--) {
+        SimilarMatch swap = matches[0];
+        matches[0] = matches[end];
+        matches[end] = swap;
+        sift_down(matches, end, 0);
+    }
+    return size;
+}
+
+int similar_to_lesson(SimilarIndex *index, int lesson_id, int k, SimilarMatch *matches) {
+    if (lesson_id <= 0 || lesson_id >= index->lesson_capacity) return -1;
+    int d = index->doc_of_lesson[lesson_id];
+    if (d < 0) return -1;
+
+    const Doc *doc = &index->docs[d];
+    return search(index, index->pool_terms + doc->offset, index->pool_weights + doc->offset,
+                  doc->count, lesson_id, k, matches);
+}
+
+int similar_to_text(SimilarIndex *index, const char *text, int k, SimilarMatch *matches) {
+    TermCount *terms;
+    int count = count_words(index, text, &terms);
+    if (count < 0) return 0;
+
+    // Unknown words become id 0 and are skipped by weigh_terms()
+    for (int i = 0; i < count; i++) terms[i].key = (uint64_t)find_term(index, terms[i].key);
+
+    WeightedTerm weighted[SIMILAR_MAX_TERMS + SIMILAR_LANES];
+    int padded = weigh_terms(index, terms, count, weighted);
+    free(terms);
+
+    int query_terms[SIMILAR_MAX_TERMS + SIMILAR_LANES];
+    float query_weights[SIMILAR_MAX_TERMS + SIMILAR_LANES];
+    for (int i = 0; i < padded; i++) {
+        query_terms[i] = weighted[i].term;
+        query_weights[i] = weighted[i].weight;
+    }
+    return search(index, query_terms, query_weights, padded, 0, k, matches);
+}
+
+void similar_use_scalar(SimilarIndex *index, int scalar) {
+    index->scalar = scalar;
+}
+
+void similar_stats(const SimilarIndex *index, SimilarStats *stats) {
+    *stats = index->last;
+    stats->lessons = index->live;
+    stats->terms = index->term_count > 0 ? index->term_count - 1 : 0;
+}
+
+void similar_close(SimilarIndex *index) {
+    if (index == NULL) return;
+    clear_index(index);
+    free(index);
+}
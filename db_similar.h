@@ -0,0 +1,68 @@
+#ifndef DB_SIMILAR_H
+#define DB_SIMILAR_H
+
+#include "db_common.h"
+
+// Highest-weighted terms kept per lesson in memory
+#define SIMILAR_MAX_TERMS 64
+
+// Similar-lesson search over TF-IDF vectors of lesson_content.
+//
+// Every lesson's content is split into lowercase words (a few stopwords
+// dropped) and stored once in lesson_vectors as its distinct term ids and
+// counts, delta-encoded as varints. similar_terms holds the vocabulary:
+// a 64-bit hash per term and how many lessons use it. Both tables belong
+// to this module and are created on first use.
+//
+// In memory each lesson keeps its SIMILAR_MAX_TERMS best terms, weighted
+// (1 + ln tf) * idf and normalized, so the dot product of two lessons is
+// their cosine similarity. A query takes the lessons sharing one of its
+// top terms as candidates, scores each with a vector dot-product kernel
+// and keeps the best k in a heap. Lessons that only share common words
+// with the query are never candidates; their score would be low anyway.
+//
+// similar_refresh() compares lessons with the stored vectors (timestamp
+// and content_hash) and indexes only what was added, edited or deleted
+// since. Weights of lessons already in memory use the term counts from
+// when they were indexed, until a large refresh or the next open
+// recomputes them all.
+
+typedef struct SimilarIndex SimilarIndex;
+
+typedef struct {
+    int lesson_id;
+    float score;                // Cosine similarity, 0..1
+} SimilarMatch;
+
+typedef struct {
+    int lessons;                // Lessons in the index
+    int terms;                  // Vocabulary size
+    int added;                  // Indexed by the last refresh
+    int removed;                // Dropped by the last refresh
+    double refresh_seconds;     // Last refresh
+} SimilarStats;
+
+// Load the stored vectors of db's lessons and refresh them. The index
+// belongs to db's connection and must be used on the same thread.
+SimilarIndex* similar_open(sqlite3 *db);
+
+// Index lessons added or edited since the last refresh and drop deleted
+// ones, in one transaction. Cheap when nothing changed, and only reads
+// when other tables changed but no lesson did.
+int similar_refresh(SimilarIndex *index);
+
+// Up to k lessons most similar to lesson_id (itself excluded), best
+// first; returns how many were found, or -1 if lesson_id is not indexed
+int similar_to_lesson(SimilarIndex *index, int lesson_id, int k, SimilarMatch *matches);
+
+// Up to k lessons most similar to text; words not in any lesson are ignored
+int similar_to_text(SimilarIndex *index, const char *text, int k, SimilarMatch *matches);
+
+// Score with the plain scalar loop instead of the vector kernel (benchmarks)
+void similar_use_scalar(SimilarIndex *index, int scalar);
+
+void similar_stats(const SimilarIndex *index, SimilarStats *stats);
+
+void similar_close(SimilarIndex *index);
+
+#endif // DB_SIMILAR_H
@@ -0,0 +1,239 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_replica.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_PRIMARY "sync_bench_primary.db"
+#define BENCH_REPLICA "sync_bench_replica.db"
+#define BENCH_BASE "sync_bench_base.db"
+#define BENCH_LESSONS 1000
+#define DEFAULT_BENCH_CHANGES 20000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_usage(const char *program) {
+    printf("Usage: %s --init <replica.db>...\n", program);
+    printf("       %s [--batch N] [--verbose] [--prune] <replica.db>...\n", program);
+    printf("       %s --bench [changes]\n", program);
+    printf("\n");
+    printf("  --init     Create replicas from an online backup of %s\n", database_path());
+    printf("  --batch    Changesets combined per replica transaction (default: %d)\n",
+           REPLICA_DEFAULT_BATCH);
+    printf("  --verbose  Print every conflict as it is resolved\n");
+    printf("  --prune    Drop changesets every listed replica has applied\n");
+    printf("  --bench    Measure changeset capture and apply rates on scratch files\n");
+}
+
+static void print_stats(const char *replica_path, const ReplicaSyncStats *stats, double seconds) {
+    int conflicts = 0;
+    for (int i = 0; i < REPLICA_CONFLICT_TYPES; i++) conflicts += stats->conflicts[i];
+
+    printf("✓ %s: %d changeset(s), %d row change(s) in %d batch(es), now at seq %lld (%.3f s)\n",
+           replica_path, stats->changesets, stats->changes, stats->batches,
+           stats->applied_seq, seconds);
+
+    if (conflicts > 0) {
+        printf("  Conflicts resolved:");
+        for (int i = 1; i < REPLICA_CONFLICT_TYPES; i++) {
+            if (stats->conflicts[i]) {
+                printf(" %s=%d", replica_conflict_string(i), stats->conflicts[i]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void remove_database_files(const char *path) {
+    char name[256];
+    unlink(path);
+    snprintf(name, sizeof(name), "%s-wal", path);
+    unlink(name);
+    snprintf(name, sizeof(name), "%s-shm", path);
+    unlink(name);
+}
+
+static int copy_database_file(const char *from, const char *to) {
+    sqlite3 *src;
+    int rc = sqlite3_open(from, &src);
+    if (rc == SQLITE_OK) rc = backup_database(src, to, 0, 0, NULL, NULL);
+    sqlite3_close(src);
+    return rc;
+}
+
+static int run_bench(int changes) {
+    remove_database_files(BENCH_PRIMARY);
+    remove_database_files(BENCH_BASE);
+
+    sqlite3 *primary;
+    if (open_database(BENCH_PRIMARY, &primary) != SQLITE_OK) return 1;
+
+    // Base data set shared by primary and replica
+    sqlite3_exec(primary, "BEGIN;", NULL, NULL, NULL);
+    sqlite3_stmt *stmt, *content_stmt;
+    sqlite3_prepare_v2(primary, "INSERT INTO lessons (topic, category, difficulty, timestamp) "
+                                "VALUES (?, 'Benchmark', ?, ?);", -1, &stmt, NULL);
+    sqlite3_prepare_v2(primary, "INSERT INTO lesson_content (lesson_id, content) "
+                                "VALUES (last_insert_rowid(), ?);", -1, &content_stmt, NULL);
+    for (int i = 0; i < BENCH_LESSONS; i++) {
+        char topic[64];
+        snprintf(topic, sizeof(topic), "Benchmark lesson %d", i);
+        sqlite3_bind_text(stmt, 1, topic, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, 1 + i % 4);
+        sqlite3_bind_int64(stmt, 3, time(NULL));
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+
+        sqlite3_bind_text(content_stmt, 1, "Lorem ipsum dolor sit amet, consectetur adipiscing elit.", -1, SQLITE_STATIC);
+        sqlite3_step(content_stmt);
+        sqlite3_reset(content_stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(content_stmt);
+    sqlite3_exec(primary, "COMMIT;", NULL, NULL, NULL);
+
+    if (replica_init(primary, BENCH_BASE) != SQLITE_OK) return 1;
+    replica_capture_open(primary, NULL);
+
+    printf("=== Changeset Replication Benchmark ===\n");
+    printf("Primary: %d lessons, workload: %d single-row write transactions\n\n",
+           BENCH_LESSONS, changes);
+
+    // Capture: each write transaction records one changeset
+    srand(42);
+    sqlite3_prepare_v2(primary, "UPDATE lessons SET difficulty = ?, timestamp = ? WHERE id = ?;",
+                       -1, &stmt, NULL);
+    double start = now_seconds();
+    for (int i = 0; i < changes; i++) {
+        replica_capture_begin(primary);
+        sqlite3_bind_int(stmt, 1, 1 + rand() % 4);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)time(NULL) + i);
+        sqlite3_bind_int(stmt, 3, 1 + rand() % BENCH_LESSONS);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        replica_capture_commit(primary);
+    }
+    double capture_seconds = now_seconds() - start;
+    sqlite3_finalize(stmt);
+    replica_capture_close(primary);
+
+    printf("Capture: %.0f changesets/s (%.3f s)\n\n", changes / capture_seconds, capture_seconds);
+
+    // Apply the same backlog with different batch sizes
+    printf("%-8s %10s %12s %10s %14s %14s\n",
+           "batch", "batches", "row changes", "seconds", "changesets/s", "rows/s");
+    int batch_sizes[] = { 1, 16, 256, 4096 };
+    for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); i++) {
+        remove_database_files(BENCH_REPLICA);
+        if (copy_database_file(BENCH_BASE, BENCH_REPLICA) != SQLITE_OK) return 1;
+
+        ReplicaSyncStats stats = {0};
+        start = now_seconds();
+        replica_sync(primary, BENCH_REPLICA, batch_sizes[i], &stats);
+        double seconds = now_seconds() - start;
+
+        printf("%-8d %10d %12d %10.3f %14.0f %14.0f\n", batch_sizes[i], stats.batches,
+               stats.changes, seconds, stats.changesets / seconds, stats.changes / seconds);
+    }
+
+    // Reference point: shipping the whole file instead of the changes
+    remove_database_files(BENCH_REPLICA);
+    start = now_seconds();
+    backup_database(primary, BENCH_REPLICA, 0, 0, NULL, NULL);
+    printf("\nFull file copy for comparison: %.3f s\n", now_seconds() - start);
+
+    close_database(primary);
+    remove_database_files(BENCH_PRIMARY);
+    remove_database_files(BENCH_REPLICA);
+    remove_database_files(BENCH_BASE);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int init = 0, prune = 0, verbose = 0;
+    int batch_size = REPLICA_DEFAULT_BATCH;
+    int replica_count = 0;
+    char **replicas = calloc(argc, sizeof(char *));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--init") == 0) {
+            init = 1;
+        } else if (strcmp(argv[i], "--prune") == 0) {
+            prune = 1;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            free(replicas);
+            return run_bench(i + 1 < argc ? atoi(argv[i + 1]) : DEFAULT_BENCH_CHANGES);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            free(replicas);
+            return 0;
+        } else {
+            replicas[replica_count++] = argv[i];
+        }
+    }
+
+    if (replica_count == 0) {
+        print_usage(argv[0]);
+        free(replicas);
+        return 1;
+    }
+
+    sqlite3 *db;
+    int rc = init_database(&db);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Failed to initialize database.\n");
+        free(replicas);
+        return 1;
+    }
+
+    int failures = 0;
+    sqlite3_int64 min_applied = -1;
+
+    for (int i = 0; i < replica_count; i++) {
+        if (init) {
+            rc = replica_init(db, replicas[i]);
+            if (rc == SQLITE_OK) {
+                printf("✓ Created replica: %s\n", replicas[i]);
+            } else {
+                printf("✗ Failed to create replica: %s\n", replicas[i]);
+                failures++;
+            }
+            continue;
+        }
+
+        ReplicaSyncStats stats = { .verbose = verbose };
+        double start = now_seconds();
+        rc = replica_sync(db, replicas[i], batch_size, &stats);
+
+        if (rc != SQLITE_OK) {
+            printf("✗ Sync failed: %s\n", replicas[i]);
+            failures++;
+            continue;
+        }
+
+        print_stats(replicas[i], &stats, now_seconds() - start);
+        if (min_applied < 0 || stats.applied_seq < min_applied) min_applied = stats.applied_seq;
+    }
+
+    if (prune && failures == 0 && min_applied > 0) {
+        if (replica_prune(db, min_applied) == SQLITE_OK) {
+            printf("✓ Pruned changesets up to seq %lld\n", min_applied);
+        }
+    }
+
+    close_database(db);
+    free(replicas);
+    return failures > 0 ? 1 : 0;
+}
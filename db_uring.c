@@ -0,0 +1,601 @@
+#define _GNU_SOURCE
+
+#include "db_uring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define RING_ENTRIES 16
+#define READAHEAD_CHUNK 65536       // Bytes per read in a window
+#define READAHEAD_CHUNKS 4          // Reads submitted together per window
+#define READAHEAD_WINDOW (READAHEAD_CHUNK * READAHEAD_CHUNKS)
+#define SEQUENTIAL_READS 3          // Forward reads in a row that start read-ahead
+#define SINGLE_READ_TAG 0           // user_data of a read that is not read-ahead
+
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_array, sq_mask;
+    unsigned *cq_head, *cq_tail, cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned unsubmitted;
+} Ring;
+
+typedef struct {
+    unsigned char *data;
+    sqlite3_int64 offset;
+    int length;                 // Bytes read, once nothing is pending
+    int pending;                // Reads still in flight
+    int in_use;
+    int results[READAHEAD_CHUNKS];
+} ReadWindow;
+
+typedef struct {
+    sqlite3_file base;
+    sqlite3_file *real;         // The unix VFS file, stored right after this struct
+    int fd;                     // Its descriptor; -1 when reads are not ours
+    Ring ring;
+    ReadWindow windows[2];
+    sqlite3_int64 last_end;     // Where the previous read stopped
+    int streak;                 // Forward reads in a row
+    int single_pending;
+    int single_result;
+    UringStats stats;
+} UringFile;
+
+static sqlite3_vfs uring_vfs;
+static sqlite3_vfs *root_vfs;
+static int registered = -1;     // -1 not tried yet, 0 unavailable, 1 registered
+static UringStats totals;
+
+#define REAL_FILE_OFFSET ((sizeof(UringFile) + 7) & ~(size_t)7)
+
+// ============================================================================
+// RING
+// ============================================================================
+
+static int ring_init(Ring *ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (ring->fd < 0) return -errno;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) goto fail;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) goto fail;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) goto fail;
+
+    unsigned char *sq = ring->sq_ring, *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+
+fail: ;
+    int error = -errno;
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->cq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    close(ring->fd);
+    ring->fd = -1;
+    return error;
+}
+
+static void ring_free(Ring *ring) {
+    if (ring->fd < 0) return;
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+// Queue a read; it goes to the kernel with the next ring_enter()
+static void ring_queue_read(Ring *ring, int fd, void *buf, unsigned length,
+                            sqlite3_int64 offset, unsigned long long tag) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long)(uintptr_t)buf;
+    sqe->len = length;
+    sqe->off = (unsigned long long)offset;
+    sqe->user_data = tag;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->unsubmitted++;
+}
+
+// Submit queued reads and wait for at least min_complete completions
+static int ring_enter(Ring *ring, unsigned min_complete) {
+    for (;;) {
+        long rc = syscall(__NR_io_uring_enter, ring->fd, ring->unsubmitted, min_complete,
+                          min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (rc >= 0) {
+            ring->unsubmitted -= (unsigned)rc;
+            return 0;
+        }
+        if (errno != EINTR) return -errno;
+    }
+}
+
+// ============================================================================
+// READ-AHEAD
+// ============================================================================
+
+// Record every completion that has arrived; returns how many
+static int reap(UringFile *file) {
+    Ring *ring = &file->ring;
+    unsigned head = *ring->cq_head;
+    int count = 0;
+
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        unsigned long long tag = cqe->user_data;
+
+        if (tag == SINGLE_READ_TAG) {
+            file->single_result = cqe->res;
+            file->single_pending = 0;
+        } else {
+            ReadWindow *window = &file->windows[(tag >> 8) - 1];
+            window->results[tag & 0xff] = cqe->res;
+            window->pending--;
+        }
+        head++;
+        count++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+static int wait_for(UringFile *file, const int *pending) {
+    while (*pending) {
+        if (reap(file) > 0) continue;
+        int rc = ring_enter(&file->ring, 1);
+        if (rc < 0) return rc;
+    }
+    return 0;
+}
+
+static int wait_window(UringFile *file, ReadWindow *window) {
+    int rc = wait_for(file, &window->pending);
+    if (rc < 0) return rc;
+
+    // Bytes read up to the first short or failed read
+    window->length = 0;
+    for (int c = 0; c < READAHEAD_CHUNKS; c++) {
+        if (window->results[c] <= 0) break;
+        window->length += window->results[c];
+        if (window->results[c] < READAHEAD_CHUNK) break;
+    }
+    return 0;
+}
+
+// Ask for READAHEAD_WINDOW bytes at offset without waiting for them
+static void start_window(UringFile *file, ReadWindow *window, sqlite3_int64 offset) {
+    wait_window(file, window);
+
+    int index = (int)(window - file->windows) + 1;
+    for (int c = 0; c < READAHEAD_CHUNKS; c++) {
+        ring_queue_read(&file->ring, file->fd, window->data + c * READAHEAD_CHUNK, READAHEAD_CHUNK,
+                        offset + (sqlite3_int64)c * READAHEAD_CHUNK,
+                        ((unsigned long long)index << 8) | (unsigned)c);
+    }
+    window->offset = offset;
+    window->length = 0;
+    window->pending = READAHEAD_CHUNKS;
+    window->in_use = 1;
+    file->stats.windows++;
+
+    if (ring_enter(&file->ring, 0) < 0) {
+        // Nothing was submitted: drop the reads again
+        *file->ring.sq_tail -= file->ring.unsubmitted;
+        file->ring.unsubmitted = 0;
+        window->pending = 0;
+        window->in_use = 0;
+    }
+}
+
+// Drop read-ahead; the file may have changed underneath it
+static void invalidate(UringFile *file) {
+    for (int w = 0; w < 2; w++) {
+        wait_window(file, &file->windows[w]);
+        file->windows[w].in_use = 0;
+    }
+    file->streak = 0;
+}
+
+// Copy from a window holding all of [offset, offset + amount); 0 if none does
+static int serve_from_window(UringFile *file, void *buf, int amount, sqlite3_int64 offset) {
+    for (int w = 0; w < 2; w++) {
+        ReadWindow *window = &file->windows[w];
+        if (!window->in_use || offset < window->offset ||
+            offset + amount > window->offset + READAHEAD_WINDOW) {
+            continue;
+        }
+
+        if (wait_window(file, window) < 0 || offset + amount > window->offset + window->length) {
+            return 0;   // Failed, or past the end of the file
+        }
+        memcpy(buf, window->data + (offset - window->offset), (size_t)amount);
+        file->stats.window_hits++;
+
+        // Keep the next window on its way while this one is read
+        ReadWindow *other = &file->windows[1 - w];
+        sqlite3_int64 next = window->offset + READAHEAD_WINDOW;
+        if (window->length == READAHEAD_WINDOW && !(other->in_use && other->offset == next)) {
+            start_window(file, other, next);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// FILE METHODS
+// ============================================================================
+
+static int uring_read(sqlite3_file *pFile, void *buf, int amount, sqlite3_int64 offset) {
+    UringFile *file = (UringFile *)pFile;
+    if (file->fd < 0) return file->real->pMethods->xRead(file->real, buf, amount, offset);
+
+    int forward = offset >= file->last_end && offset < file->last_end + READAHEAD_WINDOW;
+    file->streak = forward ? file->streak + 1 : 0;
+    file->last_end = offset + amount;
+
+    if (serve_from_window(file, buf, amount, offset)) return SQLITE_OK;
+
+    if (file->streak >= SEQUENTIAL_READS) {
+        start_window(file, &file->windows[0], offset);
+        start_window(file, &file->windows[1], offset + READAHEAD_WINDOW);
+        if (serve_from_window(file, buf, amount, offset)) return SQLITE_OK;
+    }
+
+    // A single read through the ring
+    ring_queue_read(&file->ring, file->fd, buf, (unsigned)amount, offset, SINGLE_READ_TAG);
+    file->single_pending = 1;
+    if (ring_enter(&file->ring, 0) < 0 || wait_for(file, &file->single_pending) < 0) {
+        *file->ring.sq_tail -= file->ring.unsubmitted;
+        file->ring.unsubmitted = 0;
+        file->single_pending = 0;
+        file->single_result = -EIO;
+    }
+
+    int got = file->single_result;
+    if (got == amount) {
+        file->stats.uring_reads++;
+        return SQLITE_OK;
+    }
+    if (got >= 0 && got < amount) {
+        // Past the end of the file: SQLite expects the rest zeroed
+        file->stats.uring_reads++;
+        memset((char *)buf + got, 0, (size_t)(amount - got));
+        return SQLITE_IOERR_SHORT_READ;
+    }
+
+    // Not supported by this kernel (or interrupted): let the unix VFS do it
+    file->stats.fallback_reads++;
+    return file->real->pMethods->xRead(file->real, buf, amount, offset);
+}
+
+static int uring_close(sqlite3_file *pFile) {
+    UringFile *file = (UringFile *)pFile;
+
+    if (file->fd >= 0) {
+        invalidate(file);
+        ring_free(&file->ring);
+        free(file->windows[0].data);
+
+        sqlite3_mutex *mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP1);
+        sqlite3_mutex_enter(mutex);
+        totals.uring_reads += file->stats.uring_reads;
+        totals.windows += file->stats.windows;
+        totals.window_hits += file->stats.window_hits;
+        totals.fallback_reads += file->stats.fallback_reads;
+        sqlite3_mutex_leave(mutex);
+    }
+    return file->real->pMethods->xClose(file->real);
+}
+
+static int uring_write(sqlite3_file *pFile, const void *buf, int amount, sqlite3_int64 offset) {
+    UringFile *file = (UringFile *)pFile;
+    if (file->fd >= 0) invalidate(file);
+    return file->real->pMethods->xWrite(file->real, buf, amount, offset);
+}
+
+static int uring_truncate(sqlite3_file *pFile, sqlite3_int64 size) {
+    UringFile *file = (UringFile *)pFile;
+    if (file->fd >= 0) invalidate(file);
+    return file->real->pMethods->xTruncate(file->real, size);
+}
+
+static int uring_sync(sqlite3_file *pFile, int flags) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xSync(file->real, flags);
+}
+
+static int uring_file_size(sqlite3_file *pFile, sqlite3_int64 *size) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xFileSize(file->real, size);
+}
+
+static int uring_lock(sqlite3_file *pFile, int lock) {
+    UringFile *file = (UringFile *)pFile;
+    if (file->fd >= 0) invalidate(file);
+    return file->real->pMethods->xLock(file->real, lock);
+}
+
+static int uring_unlock(sqlite3_file *pFile, int lock) {
+    UringFile *file = (UringFile *)pFile;
+    if (file->fd >= 0) invalidate(file);
+    return file->real->pMethods->xUnlock(file->real, lock);
+}
+
+static int uring_check_reserved_lock(sqlite3_file *pFile, int *result) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xCheckReservedLock(file->real, result);
+}
+
+static int uring_file_control(sqlite3_file *pFile, int op, void *arg) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xFileControl(file->real, op, arg);
+}
+
+static int uring_sector_size(sqlite3_file *pFile) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xSectorSize(file->real);
+}
+
+static int uring_device_characteristics(sqlite3_file *pFile) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xDeviceCharacteristics(file->real);
+}
+
+static int uring_shm_map(sqlite3_file *pFile, int page, int page_size, int extend, void volatile **pp) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xShmMap(file->real, page, page_size, extend, pp);
+}
+
+// WAL read transactions start and end here rather than in xLock
+static int uring_shm_lock(sqlite3_file *pFile, int offset, int n, int flags) {
+    UringFile *file = (UringFile *)pFile;
+    if (file->fd >= 0) invalidate(file);
+    return file->real->pMethods->xShmLock(file->real, offset, n, flags);
+}
+
+static void uring_shm_barrier(sqlite3_file *pFile) {
+    UringFile *file = (UringFile *)pFile;
+    file->real->pMethods->xShmBarrier(file->real);
+}
+
+static int uring_shm_unmap(sqlite3_file *pFile, int delete_flag) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xShmUnmap(file->real, delete_flag);
+}
+
+static int uring_fetch(sqlite3_file *pFile, sqlite3_int64 offset, int amount, void **pp) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xFetch(file->real, offset, amount, pp);
+}
+
+static int uring_unfetch(sqlite3_file *pFile, sqlite3_int64 offset, void *p) {
+    UringFile *file = (UringFile *)pFile;
+    return file->real->pMethods->xUnfetch(file->real, offset, p);
+}
+
+static const sqlite3_io_methods uring_io_methods = {
+    3,
+    uring_close, uring_read, uring_write, uring_truncate, uring_sync,
+    uring_file_size, uring_lock, uring_unlock, uring_check_reserved_lock,
+    uring_file_control, uring_sector_size, uring_device_characteristics,
+    uring_shm_map, uring_shm_lock, uring_shm_barrier, uring_shm_unmap,
+    uring_fetch, uring_unfetch
+};
+
+// ============================================================================
+// VFS
+// ============================================================================
+
+// The unix VFS keeps its descriptor right after three pointers in every
+// SQLite 3 release. It is only used if it is open on the same file.
+typedef struct {
+    const sqlite3_io_methods *methods;
+    sqlite3_vfs *vfs;
+    void *inode;
+    int h;
+} UnixFileHead;
+
+static int unix_descriptor(sqlite3_file *real, const char *path) {
+    struct stat ours, theirs;
+    int fd = ((UnixFileHead *)real)->h;
+
+    if (fd < 0 || path == NULL || fstat(fd, &theirs) != 0 || stat(path, &ours) != 0) return -1;
+    return ours.st_dev == theirs.st_dev && ours.st_ino == theirs.st_ino ? fd : -1;
+}
+
+static int uring_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *pFile, int flags, int *out_flags) {
+    (void)vfs;
+    UringFile *file = (UringFile *)pFile;
+    memset(file, 0, sizeof(*file));
+    file->real = (sqlite3_file *)((char *)file + REAL_FILE_OFFSET);
+    file->fd = -1;
+
+    int rc = root_vfs->xOpen(root_vfs, name, file->real, flags, out_flags);
+    if (rc != SQLITE_OK) {
+        file->base.pMethods = NULL;
+        return rc;
+    }
+    file->base.pMethods = &uring_io_methods;
+
+    // Journals, the WAL and temp files keep plain reads
+    if (!(flags & SQLITE_OPEN_MAIN_DB)) return SQLITE_OK;
+
+    int fd = unix_descriptor(file->real, name);
+    unsigned char *data = fd >= 0 ? malloc(2 * READAHEAD_WINDOW) : NULL;
+    if (data == NULL) return SQLITE_OK;
+    if (ring_init(&file->ring) < 0) {
+        free(data);
+        return SQLITE_OK;
+    }
+
+    file->windows[0].data = data;
+    file->windows[1].data = data + READAHEAD_WINDOW;
+    file->fd = fd;
+    return SQLITE_OK;
+}
+
+static int uring_delete(sqlite3_vfs *vfs, const char *name, int sync_dir) {
+    (void)vfs;
+    return root_vfs->xDelete(root_vfs, name, sync_dir);
+}
+
+static int uring_access(sqlite3_vfs *vfs, const char *name, int flags, int *result) {
+    (void)vfs;
+    return root_vfs->xAccess(root_vfs, name, flags, result);
+}
+
+static int uring_full_pathname(sqlite3_vfs *vfs, const char *name, int size, char *out) {
+    (void)vfs;
+    return root_vfs->xFullPathname(root_vfs, name, size, out);
+}
+
+static void* uring_dl_open(sqlite3_vfs *vfs, const char *name) {
+    (void)vfs;
+    return root_vfs->xDlOpen(root_vfs, name);
+}
+
+static void uring_dl_error(sqlite3_vfs *vfs, int size, char *message) {
+    (void)vfs;
+    root_vfs->xDlError(root_vfs, size, message);
+}
+
+static void (*uring_dl_sym(sqlite3_vfs *vfs, void *handle, const char *symbol))(void) {
+    (void)vfs;
+    return root_vfs->xDlSym(root_vfs, handle, symbol);
+}
+
+static void uring_dl_close(sqlite3_vfs *vfs, void *handle) {
+    (void)vfs;
+    root_vfs->xDlClose(root_vfs, handle);
+}
+
+static int uring_randomness(sqlite3_vfs *vfs, int size, char *out) {
+    (void)vfs;
+    return root_vfs->xRandomness(root_vfs, size, out);
+}
+
+static int uring_sleep(sqlite3_vfs *vfs, int microseconds) {
+    (void)vfs;
+    return root_vfs->xSleep(root_vfs, microseconds);
+}
+
+static int uring_current_time(sqlite3_vfs *vfs, double *now) {
+    (void)vfs;
+    return root_vfs->xCurrentTime(root_vfs, now);
+}
+
+static int uring_get_last_error(sqlite3_vfs *vfs, int size, char *message) {
+    (void)vfs;
+    return root_vfs->xGetLastError(root_vfs, size, message);
+}
+
+static int uring_current_time_int64(sqlite3_vfs *vfs, sqlite3_int64 *now) {
+    (void)vfs;
+    return root_vfs->xCurrentTimeInt64(root_vfs, now);
+}
+
+int uring_vfs_register(void) {
+    sqlite3_mutex *mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP1);
+    sqlite3_mutex_enter(mutex);
+
+    if (registered < 0) {
+        registered = 0;
+        root_vfs = sqlite3_vfs_find("unix");
+
+        Ring probe;
+        int rc = root_vfs ? ring_init(&probe) : -ENOSYS;
+        if (rc < 0) {
+            fprintf(stderr, "io_uring unavailable (%s); using the default VFS\n", strerror(-rc));
+        } else {
+            ring_free(&probe);
+
+            uring_vfs = (sqlite3_vfs){
+                .iVersion = 2,
+                .szOsFile = (int)(REAL_FILE_OFFSET + (size_t)root_vfs->szOsFile),
+                .mxPathname = root_vfs->mxPathname,
+                .zName = URING_VFS_NAME,
+                .xOpen = uring_open,
+                .xDelete = uring_delete,
+                .xAccess = uring_access,
+                .xFullPathname = uring_full_pathname,
+                .xDlOpen = uring_dl_open,
+                .xDlError = uring_dl_error,
+                .xDlSym = uring_dl_sym,
+                .xDlClose = uring_dl_close,
+                .xRandomness = uring_randomness,
+                .xSleep = uring_sleep,
+                .xCurrentTime = uring_current_time,
+                .xGetLastError = uring_get_last_error,
+                .xCurrentTimeInt64 = uring_current_time_int64
+            };
+            registered = sqlite3_vfs_register(&uring_vfs, 0) == SQLITE_OK;
+        }
+    }
+
+    int result = registered;
+    sqlite3_mutex_leave(mutex);
+    return result;
+}
+
+const char* uring_vfs_name(void) {
+    const char *value = getenv(URING_ENV);
+    if (!value || !*value || strcmp(value, "0") == 0) return NULL;
+    return uring_vfs_register() ? URING_VFS_NAME : NULL;
+}
+
+void uring_stats(UringStats *stats) {
+    sqlite3_mutex *mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP1);
+    sqlite3_mutex_enter(mutex);
+    *stats = totals;
+    sqlite3_mutex_leave(mutex);
+}
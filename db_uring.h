@@ -0,0 +1,41 @@
+#ifndef DB_URING_H
+#define DB_URING_H
+
+#include "db_common.h"
+
+// Environment variable that makes open_database() use the io_uring VFS
+#define URING_ENV "LESSONS_IO_URING"
+#define URING_VFS_NAME "uring"
+
+// io_uring VFS for large scans on a cold page cache.
+//
+// A shim over the default unix VFS: locking, writes, syncs and the WAL
+// go to the unix VFS unchanged. Reads of the main database file are
+// issued through an io_uring per open file instead of pread(). After a
+// few reads that move forward through the file, the next window of the
+// file is requested as several reads submitted together, and the window
+// after it is fetched in the background while the first one is served.
+// Read-ahead is thrown away on every lock change and on writes, so a
+// new transaction never sees pages from before it started.
+//
+// The ring is set up with raw system calls (no liburing). Kernels without
+// io_uring, or where it is disabled, get the default VFS.
+
+typedef struct {
+    long long uring_reads;      // Single reads issued through the ring
+    long long windows;          // Read-ahead windows requested
+    long long window_hits;      // Reads served from a window
+    long long fallback_reads;   // Reads passed to the unix VFS
+} UringStats;
+
+// Register the VFS; returns 0 if io_uring is not available
+int uring_vfs_register(void);
+
+// URING_VFS_NAME if LESSONS_IO_URING is set and io_uring works, else
+// NULL (the default VFS) — for sqlite3_open_v2()
+const char* uring_vfs_name(void);
+
+// Totals over every file closed so far
+void uring_stats(UringStats *stats);
+
+#endif // DB_URING_H
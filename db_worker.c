@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_worker.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct DbJob {
+    DbJobFn fn;
+    void *arg;
+    int done;
+    int detached;       // Posted job: the worker frees it
+    DbJob *next;
+};
+
+struct DbWorker {
+    sqlite3 *db;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t job_done;
+    DbJob *head;
+    DbJob *tail;
+    int stopping;
+
+    // Idle job: runs once the queue has been empty for idle_ms
+    DbJobFn idle_fn;
+    void *idle_arg;
+    int idle_ms;
+    int idle_due;           // A job ran since the idle job last did
+};
+
+// Wait for work, running the idle job if none comes in time. Called and
+// returns with the lock held.
+static void wait_for_work(DbWorker *worker) {
+    while (worker->head == NULL && !worker->stopping) {
+        if (worker->idle_fn == NULL || !worker->idle_due) {
+            pthread_cond_wait(&worker->work_ready, &worker->lock);
+            continue;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += worker->idle_ms / 1000;
+        deadline.tv_nsec += (long)(worker->idle_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = 0;
+        while (worker->head == NULL && !worker->stopping && rc == 0) {
+            rc = pthread_cond_timedwait(&worker->work_ready, &worker->lock, &deadline);
+        }
+        if (worker->head != NULL || worker->stopping) break;
+
+        worker->idle_due = 0;
+        DbJobFn fn = worker->idle_fn;
+        void *arg = worker->idle_arg;
+        pthread_mutex_unlock(&worker->lock);
+        fn(worker->db, arg);
+        pthread_mutex_lock(&worker->lock);
+    }
+}
+
+static void* worker_main(void *user_data) {
+    DbWorker *worker = user_data;
+
+    pthread_mutex_lock(&worker->lock);
+    while (1) {
+        wait_for_work(worker);
+        if (worker->head == NULL) break;   // Stopping and fully drained
+
+        DbJob *job = worker->head;
+        worker->head = job->next;
+        if (worker->head == NULL) worker->tail = NULL;
+        pthread_mutex_unlock(&worker->lock);
+
+        job->fn(worker->db, job->arg);
+
+        pthread_mutex_lock(&worker->lock);
+        worker->idle_due = 1;
+        if (job->detached) {
+            free(job);
+        } else {
+            job->done = 1;
+            pthread_cond_broadcast(&worker->job_done);
+        }
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return NULL;
+}
+
+DbWorker* db_worker_start(sqlite3 *db) {
+    DbWorker *worker = calloc(1, sizeof(DbWorker));
+    if (worker == NULL) return NULL;
+
+    worker->db = db;
+    worker->idle_due = 1;
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->work_ready, NULL);
+    pthread_cond_init(&worker->job_done, NULL);
+
+    if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+        fprintf(stderr, "Cannot start database worker thread\n");
+        pthread_mutex_destroy(&worker->lock);
+        pthread_cond_destroy(&worker->work_ready);
+        pthread_cond_destroy(&worker->job_done);
+        free(worker);
+        return NULL;
+    }
+    return worker;
+}
+
+void db_worker_stop(DbWorker *worker) {
+    if (worker == NULL) return;
+
+    pthread_mutex_lock(&worker->lock);
+    worker->stopping = 1;
+    pthread_cond_signal(&worker->work_ready);
+    pthread_mutex_unlock(&worker->lock);
+
+    pthread_join(worker->thread, NULL);
+
+    pthread_mutex_destroy(&worker->lock);
+    pthread_cond_destroy(&worker->work_ready);
+    pthread_cond_destroy(&worker->job_done);
+    free(worker);
+}
+
+void db_worker_set_idle(DbWorker *worker, int idle_ms, DbJobFn fn, void *arg) {
+    pthread_mutex_lock(&worker->lock);
+    worker->idle_fn = fn;
+    worker->idle_arg = arg;
+    worker->idle_ms = idle_ms > 0 ? idle_ms : 0;
+    pthread_cond_signal(&worker->work_ready);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+static DbJob* enqueue(DbWorker *worker, DbJobFn fn, void *arg, int detached) {
+    DbJob *job = calloc(1, sizeof(DbJob));
+    if (job == NULL) return NULL;
+
+    job->fn = fn;
+    job->arg = arg;
+    job->detached = detached;
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->tail) {
+        worker->tail->next = job;
+    } else {
+        worker->head = job;
+    }
+    worker->tail = job;
+    pthread_cond_signal(&worker->work_ready);
+    pthread_mutex_unlock(&worker->lock);
+    return job;
+}
+
+DbJob* db_worker_submit(DbWorker *worker, DbJobFn fn, void *arg) {
+    DbJob *job = enqueue(worker, fn, arg, 0);
+    if (job == NULL) fprintf(stderr, "Database worker: out of memory\n");
+    return job;
+}
+
+int db_worker_post(DbWorker *worker, DbJobFn fn, void *arg) {
+    if (enqueue(worker, fn, arg, 1) == NULL) {
+        fprintf(stderr, "Database worker: out of memory\n");
+        return 0;
+    }
+    return 1;
+}
+
+int db_worker_done(DbWorker *worker, const DbJob *job) {
+    if (job == NULL) return 1;
+
+    pthread_mutex_lock(&worker->lock);
+    int done = job->done;
+    pthread_mutex_unlock(&worker->lock);
+    return done;
+}
+
+void db_worker_wait(DbWorker *worker, DbJob *job) {
+    if (job == NULL) return;
+
+    pthread_mutex_lock(&worker->lock);
+    while (!job->done) {
+        pthread_cond_wait(&worker->job_done, &worker->lock);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    free(job);
+}
+
+void db_worker_call(DbWorker *worker, DbJobFn fn, void *arg) {
+    db_worker_wait(worker, db_worker_submit(worker, fn, arg));
+}
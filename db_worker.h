@@ -0,0 +1,45 @@
+#ifndef DB_WORKER_H
+#define DB_WORKER_H
+
+#include "db_common.h"
+
+// Background thread that owns a database connection and runs queued jobs
+// on it in FIFO order. Because every job goes through the same queue, a
+// read submitted after a write always sees that write, while the caller's
+// thread never blocks on SQLite unless it explicitly waits for a result.
+typedef struct DbWorker DbWorker;
+typedef struct DbJob DbJob;
+
+typedef void (*DbJobFn)(sqlite3 *db, void *arg);
+
+// Start a worker that takes over db; the caller must not use db until
+// db_worker_stop() returns
+DbWorker* db_worker_start(sqlite3 *db);
+
+// Drain the queue and join the thread
+void db_worker_stop(DbWorker *worker);
+
+// Run fn on the worker's connection whenever the queue has been empty for
+// idle_ms, at most once between two jobs; fn NULL turns it off. Jobs
+// queued while fn runs wait for it, so it should do its work in short steps.
+void db_worker_set_idle(DbWorker *worker, int idle_ms, DbJobFn fn, void *arg);
+
+// Queue a job and return a handle for db_worker_wait()/db_worker_done().
+// Returns NULL when out of memory; both functions treat NULL as finished.
+DbJob* db_worker_submit(DbWorker *worker, DbJobFn fn, void *arg);
+
+// Queue a job nobody waits for (the worker frees its handle). Returns 0
+// when out of memory, in which case fn never runs and arg is still the
+// caller's.
+int db_worker_post(DbWorker *worker, DbJobFn fn, void *arg);
+
+// Non-blocking check whether a submitted job has finished
+int db_worker_done(DbWorker *worker, const DbJob *job);
+
+// Block until the job has finished and release its handle
+void db_worker_wait(DbWorker *worker, DbJob *job);
+
+// Submit and wait in one call
+void db_worker_call(DbWorker *worker, DbJobFn fn, void *arg);
+
+#endif // DB_WORKER_H
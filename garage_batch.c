@@ -0,0 +1,216 @@
+/*
+ * GARAGE BATCH PATHFINDING - worker threads, per-thread search scratch
+ */
+
+#include "garage_batch.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Each worker on its own cache lines, so updating one worker's counters
+// never invalidates a line another thread is reading
+typedef struct {
+    alignas(64) PathSearch search;
+    long long expanded;
+    pthread_t thread;
+    PathPool *pool;
+} PoolWorker;
+
+typedef void (*PoolTaskFn)(PathPool *pool, PoolWorker *worker, int index);
+
+struct PathPool {
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t batch_done;
+    unsigned batch;         // Bumped for every batch; workers wait for a change
+    bool stopping;
+    int busy;               // Workers still on the current batch
+    atomic_int next_task;
+
+    // The current batch
+    PoolTaskFn run_task;
+    int task_count;
+    const PathGraph *graph;
+    PathAlgorithm algorithm;
+    PathQuery *queries;
+    const int *sources;
+    const int *targets;
+    int target_count;
+    double *costs;
+
+    int thread_count;
+    PoolWorker *workers;
+};
+
+static void* worker_main(void *user_data) {
+    PoolWorker *worker = user_data;
+    PathPool *pool = worker->pool;
+    unsigned done_batch = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (!pool->stopping && pool->batch == done_batch) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->stopping) break;
+        done_batch = pool->batch;
+        pthread_mutex_unlock(&pool->lock);
+
+        int index;
+        while ((index = atomic_fetch_add(&pool->next_task, 1)) < pool->task_count) {
+            pool->run_task(pool, worker, index);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->batch_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return nullptr;
+}
+
+// Hand the batch described in pool to every worker and wait for it
+static void run_batch(PathPool *pool, PoolTaskFn run_task, int task_count) {
+    if (task_count <= 0) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->run_task = run_task;
+    pool->task_count = task_count;
+    atomic_store(&pool->next_task, 0);
+    for (int t = 0; t < pool->thread_count; t++) {
+        pool->workers[t].expanded = 0;
+    }
+    pool->busy = pool->thread_count;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->batch_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// ============================================================================
+// POOL LIFETIME
+// ============================================================================
+
+static void stop_workers(PathPool *pool, int started) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(pool->workers[t].thread, nullptr);
+    }
+    for (int t = 0; t < pool->thread_count; t++) {
+        path_search_free(&pool->workers[t].search);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->batch_done);
+    free(pool->workers);
+    free(pool);
+}
+
+PathPool* path_pool_start(int thread_count, int capacity) {
+    if (thread_count < 1) thread_count = 1;
+
+    PathPool *pool = calloc(1, sizeof(PathPool));
+    PoolWorker *workers = aligned_alloc(alignof(PoolWorker),
+                                        (size_t)thread_count * sizeof(PoolWorker));
+    if (pool == nullptr || workers == nullptr) {
+        free(pool);
+        free(workers);
+        return nullptr;
+    }
+
+    pool->thread_count = thread_count;
+    pool->workers = workers;
+    atomic_init(&pool->next_task, 0);
+    pthread_mutex_init(&pool->lock, nullptr);
+    pthread_cond_init(&pool->work_ready, nullptr);
+    pthread_cond_init(&pool->batch_done, nullptr);
+
+    for (int t = 0; t < thread_count; t++) {
+        workers[t] = (PoolWorker){ .pool = pool };
+    }
+
+    int started = 0;
+    for (int t = 0; t < thread_count; t++) {
+        if (!path_search_init(&workers[t].search, capacity) ||
+            pthread_create(&workers[t].thread, nullptr, worker_main, &workers[t]) != 0) {
+            stop_workers(pool, started);
+            return nullptr;
+        }
+        started++;
+    }
+    return pool;
+}
+
+void path_pool_stop(PathPool *pool) {
+    if (pool == nullptr) return;
+    stop_workers(pool, pool->thread_count);
+}
+
+int path_pool_threads(const PathPool *pool) {
+    return pool->thread_count;
+}
+
+// ============================================================================
+// BATCHES
+// ============================================================================
+
+static void run_query(PathPool *pool, PoolWorker *worker, int index) {
+    PathQuery *query = &pool->queries[index];
+
+    query->cost = pool->algorithm == PATH_ASTAR
+        ? path_astar(pool->graph, &worker->search, query->start, query->goal)
+        : path_dijkstra(pool->graph, &worker->search, query->start, query->goal);
+    query->expanded = worker->search.expanded;
+    worker->expanded += worker->search.expanded;
+}
+
+static void run_matrix_row(PathPool *pool, PoolWorker *worker, int index) {
+    int source = pool->sources[index];
+    double *row = pool->costs + (size_t)index * pool->target_count;
+
+    if (source < 0 || source >= pool->graph->node_count) {
+        for (int t = 0; t < pool->target_count; t++) row[t] = PATH_UNREACHABLE;
+        return;
+    }
+
+    path_dijkstra_targets(pool->graph, &worker->search, source, pool->targets, pool->target_count);
+    worker->expanded += worker->search.expanded;
+
+    for (int t = 0; t < pool->target_count; t++) {
+        row[t] = path_cost(&worker->search, pool->targets[t]);
+    }
+}
+
+void path_pool_run(PathPool *pool, const PathGraph *graph, PathAlgorithm algorithm,
+                   PathQuery queries[], int query_count) {
+    pool->graph = graph;
+    pool->algorithm = algorithm;
+    pool->queries = queries;
+    run_batch(pool, run_query, query_count);
+}
+
+long long path_pool_matrix(PathPool *pool, const PathGraph *graph,
+                           const int sources[], int source_count,
+                           const int targets[], int target_count, double costs[]) {
+    pool->graph = graph;
+    pool->sources = sources;
+    pool->targets = targets;
+    pool->target_count = target_count;
+    pool->costs = costs;
+    run_batch(pool, run_matrix_row, source_count);
+
+    long long expanded = 0;
+    for (int t = 0; t < pool->thread_count; t++) {
+        expanded += pool->workers[t].expanded;
+    }
+    return expanded;
+}
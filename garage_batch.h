@@ -0,0 +1,52 @@
+/*
+ * GARAGE BATCH PATHFINDING - many independent queries on a thread pool
+ * ====================================================================
+ *
+ * Every worker thread owns a full-size PathSearch, so threads share
+ * nothing but the read-only graph and the result arrays (each query or row
+ * is written by exactly one thread). Workers claim queries one at a time
+ * from an atomic counter, which keeps them busy when query costs vary
+ * wildly (a neighbor next door vs. the far side of the map).
+ */
+
+#ifndef GARAGE_BATCH_H
+#define GARAGE_BATCH_H
+
+#include "garage_path.h"
+
+typedef enum {
+    PATH_DIJKSTRA,
+    PATH_ASTAR
+} PathAlgorithm;
+
+typedef struct {
+    int start;
+    int goal;
+    double cost;        // Filled in: distance, or PATH_UNREACHABLE
+    int expanded;       // Filled in: nodes settled
+} PathQuery;
+
+typedef struct PathPool PathPool;
+
+// Start thread_count workers, each with scratch for graphs of up to
+// capacity nodes. Returns nullptr when out of memory or threads.
+PathPool* path_pool_start(int thread_count, int capacity);
+
+// Join the workers and free their scratch
+void path_pool_stop(PathPool *pool);
+
+int path_pool_threads(const PathPool *pool);
+
+// Answer every query; returns once all are done
+void path_pool_run(PathPool *pool, const PathGraph *graph, PathAlgorithm algorithm,
+                   PathQuery queries[], int query_count);
+
+// Distance from every source to every target into
+// costs[source * target_count + target]. Each source is one
+// path_dijkstra_targets() search, which stops once all targets are
+// settled. Returns the total number of nodes settled.
+long long path_pool_matrix(PathPool *pool, const PathGraph *graph,
+                           const int sources[], int source_count,
+                           const int targets[], int target_count, double costs[]);
+
+#endif // GARAGE_BATCH_H
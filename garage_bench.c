@@ -0,0 +1,1342 @@
+/*
+ * GARAGE BENCHMARKS
+ * =================
+ *
+ * Pathfinding: random 4-connected grids with walls, searched with the
+ * heap-based module and with ports of the game's original linear-scan
+ * Dijkstra/A* (which only run on the smaller grids: they are O(V²)).
+ *
+ * Fleet, sim, optimize and parse drive the game's own vehicles, physics
+ * and parser through garage_game.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "garage_bench.h"
+#include "garage_path.h"
+#include "garage_world.h"
+#include "garage_hpa.h"
+#include "garage_batch.h"
+#include "garage_game.h"
+#include "garage_sim.h"
+#include "garage_optimize.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+constexpr double WALL_RATIO = 0.2;
+constexpr int SCAN_MAX_NODES = 16384;    // 128 x 128
+constexpr int SCAN_QUERIES = 20;
+constexpr int QUERY_BUDGET = 2000000;    // Nodes per size, split across queries
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift32: the same maps and queries on every run and platform
+static unsigned next_random(unsigned *state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static double random_unit(unsigned *state) {
+    return (next_random(state) >> 8) / 16777216.0;
+}
+
+// Edges of a side x side grid with WALL_RATIO of the cells blocked. Moving
+// to a neighbor costs between 1 and 1.5 (never less than the straight-line
+// distance, so the A* heuristic stays admissible).
+static PathEdge* grid_edges(int side, unsigned seed, int *edge_count) {
+    int node_count = side * side;
+    bool *open = malloc((size_t)node_count * sizeof(bool));
+    PathEdge *edges = malloc((size_t)node_count * 4 * sizeof(PathEdge));
+    if (open == nullptr || edges == nullptr) {
+        free(open);
+        free(edges);
+        return nullptr;
+    }
+
+    unsigned rng = seed;
+    for (int n = 0; n < node_count; n++) {
+        open[n] = random_unit(&rng) >= WALL_RATIO;
+    }
+
+    *edge_count = 0;
+    for (int row = 0; row < side; row++) {
+        for (int col = 0; col < side; col++) {
+            int n = row * side + col;
+            if (!open[n]) continue;
+
+            int neighbors[4] = {
+                col > 0 ? n - 1 : -1,
+                col < side - 1 ? n + 1 : -1,
+                row > 0 ? n - side : -1,
+                row < side - 1 ? n + side : -1
+            };
+            for (int i = 0; i < 4; i++) {
+                if (neighbors[i] < 0 || !open[neighbors[i]]) continue;
+                edges[(*edge_count)++] = (PathEdge){
+                    .from = n,
+                    .to = neighbors[i],
+                    .weight = 1.0 + 0.5 * random_unit(&rng)
+                };
+            }
+        }
+    }
+
+    free(open);
+    return edges;
+}
+
+static bool build_grid(PathGraph *graph, int side, const PathEdge edges[], int edge_count) {
+    if (!path_graph_build(graph, side * side, edges, edge_count)) return false;
+
+    for (int n = 0; n < side * side; n++) {
+        graph->x[n] = n % side;
+        graph->y[n] = n / side;
+    }
+    return true;
+}
+
+static bool make_grid(PathGraph *graph, int side, unsigned seed) {
+    int edge_count;
+    PathEdge *edges = grid_edges(side, seed, &edge_count);
+    if (edges == nullptr) return false;
+
+    bool ok = build_grid(graph, side, edges, edge_count);
+    free(edges);
+    return ok;
+}
+
+// Random node with at least one edge
+static int random_node(const PathGraph *graph, unsigned *rng) {
+    while (true) {
+        int n = (int)(next_random(rng) % (unsigned)graph->node_count);
+        if (graph->offsets[n + 1] > graph->offsets[n]) return n;
+    }
+}
+
+// ============================================================================
+// ORIGINAL ALGORITHMS (linear scan for the next node)
+// ============================================================================
+
+typedef struct {
+    double *g;
+    double *f;
+    bool *open;
+    bool *closed;
+    int expanded;
+} ScanState;
+
+static double scan_dijkstra(const PathGraph *graph, ScanState *s, int start, int goal) {
+    int n_count = graph->node_count;
+    for (int i = 0; i < n_count; i++) {
+        s->g[i] = INFINITY;
+        s->closed[i] = false;
+    }
+    s->g[start] = 0;
+    s->expanded = 0;
+
+    for (int count = 0; count < n_count; count++) {
+        double min_cost = INFINITY;
+        int min_node = -1;
+        for (int i = 0; i < n_count; i++) {
+            if (!s->closed[i] && s->g[i] < min_cost) {
+                min_cost = s->g[i];
+                min_node = i;
+            }
+        }
+
+        if (min_node == -1) break;
+        s->expanded++;
+        if (min_node == goal) return s->g[goal];
+        s->closed[min_node] = true;
+
+        for (int e = graph->offsets[min_node]; e < graph->offsets[min_node + 1]; e++) {
+            int neighbor = graph->targets[e];
+            double new_cost = s->g[min_node] + graph->weights[e];
+            if (!s->closed[neighbor] && new_cost < s->g[neighbor]) {
+                s->g[neighbor] = new_cost;
+            }
+        }
+    }
+    return PATH_UNREACHABLE;
+}
+
+static double scan_astar(const PathGraph *graph, ScanState *s, int start, int goal) {
+    int n_count = graph->node_count;
+    for (int i = 0; i < n_count; i++) {
+        s->g[i] = INFINITY;
+        s->f[i] = INFINITY;
+        s->open[i] = false;
+        s->closed[i] = false;
+    }
+
+    s->g[start] = 0;
+    s->f[start] = hypot(graph->x[start] - graph->x[goal], graph->y[start] - graph->y[goal]);
+    s->open[start] = true;
+    s->expanded = 0;
+
+    while (true) {
+        double min_f = INFINITY;
+        int current = -1;
+        for (int i = 0; i < n_count; i++) {
+            if (s->open[i] && s->f[i] < min_f) {
+                min_f = s->f[i];
+                current = i;
+            }
+        }
+
+        if (current == -1) return PATH_UNREACHABLE;
+        s->expanded++;
+        if (current == goal) return s->g[goal];
+
+        s->open[current] = false;
+        s->closed[current] = true;
+
+        for (int e = graph->offsets[current]; e < graph->offsets[current + 1]; e++) {
+            int neighbor = graph->targets[e];
+            if (s->closed[neighbor]) continue;
+
+            double tentative_g = s->g[current] + graph->weights[e];
+            if (s->open[neighbor] && tentative_g >= s->g[neighbor]) continue;
+
+            s->open[neighbor] = true;
+            s->g[neighbor] = tentative_g;
+            s->f[neighbor] = tentative_g + hypot(graph->x[neighbor] - graph->x[goal],
+                                                 graph->y[neighbor] - graph->y[goal]);
+        }
+    }
+}
+
+// ============================================================================
+// PATHFINDING BENCHMARK
+// ============================================================================
+
+typedef struct {
+    double seconds;
+    long long expanded;
+    int queries;
+} BenchTotals;
+
+static void print_row(int nodes, const char *name, const BenchTotals *t, const BenchTotals *baseline) {
+    printf("%-10d %-16s %8d %14.1f %16.0f", nodes, name, t->queries,
+           t->seconds / t->queries * 1e6, (double)t->expanded / t->queries);
+    if (baseline && baseline->queries > 0) {
+        printf(" %9.1fx", (baseline->seconds / baseline->queries) / (t->seconds / t->queries));
+    }
+    printf("\n");
+}
+
+static int bench_grid(int side) {
+    PathGraph graph;
+    PathSearch search;
+    if (!make_grid(&graph, side, 12345u + (unsigned)side)) {
+        fprintf(stderr, "Out of memory building %dx%d grid\n", side, side);
+        return 1;
+    }
+    if (!path_search_init(&search, graph.node_count)) {
+        fprintf(stderr, "Out of memory for %d-node search\n", graph.node_count);
+        path_graph_free(&graph);
+        return 1;
+    }
+
+    int nodes = graph.node_count;
+    int queries = QUERY_BUDGET / nodes;
+    if (queries < 5) queries = 5;
+    if (queries > 200) queries = 200;
+
+    // Where both versions run they answer the same queries, so the
+    // expanded counts and speedups compare like with like
+    bool run_scan = nodes <= SCAN_MAX_NODES;
+    if (run_scan && queries > SCAN_QUERIES) queries = SCAN_QUERIES;
+    int scan_queries = run_scan ? queries : 0;
+
+    int *starts = malloc((size_t)queries * sizeof(int));
+    int *goals = malloc((size_t)queries * sizeof(int));
+    double *expected = malloc((size_t)queries * sizeof(double));
+    ScanState scan = {
+        .g = malloc((size_t)nodes * sizeof(double)),
+        .f = malloc((size_t)nodes * sizeof(double)),
+        .open = malloc((size_t)nodes * sizeof(bool)),
+        .closed = malloc((size_t)nodes * sizeof(bool))
+    };
+
+    unsigned rng = 777u;
+    for (int q = 0; q < queries; q++) {
+        starts[q] = random_node(&graph, &rng);
+        goals[q] = random_node(&graph, &rng);
+    }
+
+    BenchTotals scan_dijkstra_t = { .queries = scan_queries };
+    BenchTotals scan_astar_t = { .queries = scan_queries };
+    BenchTotals heap_dijkstra_t = { .queries = queries };
+    BenchTotals heap_astar_t = { .queries = queries };
+    int mismatches = 0;
+
+    for (int q = 0; q < scan_queries; q++) {
+        double start = now_seconds();
+        expected[q] = scan_dijkstra(&graph, &scan, starts[q], goals[q]);
+        scan_dijkstra_t.seconds += now_seconds() - start;
+        scan_dijkstra_t.expanded += scan.expanded;
+
+        start = now_seconds();
+        double cost = scan_astar(&graph, &scan, starts[q], goals[q]);
+        scan_astar_t.seconds += now_seconds() - start;
+        scan_astar_t.expanded += scan.expanded;
+        if (fabs(cost - expected[q]) > 1e-9) mismatches++;
+    }
+
+    for (int q = 0; q < queries; q++) {
+        double start = now_seconds();
+        double cost = path_dijkstra(&graph, &search, starts[q], goals[q]);
+        heap_dijkstra_t.seconds += now_seconds() - start;
+        heap_dijkstra_t.expanded += search.expanded;
+        if (run_scan && fabs(cost - expected[q]) > 1e-9) mismatches++;
+        expected[q] = cost;
+
+        start = now_seconds();
+        cost = path_astar(&graph, &search, starts[q], goals[q]);
+        heap_astar_t.seconds += now_seconds() - start;
+        heap_astar_t.expanded += search.expanded;
+        if (fabs(cost - expected[q]) > 1e-9) mismatches++;
+    }
+
+    if (run_scan) print_row(nodes, "scan dijkstra", &scan_dijkstra_t, nullptr);
+    print_row(nodes, "heap dijkstra", &heap_dijkstra_t, run_scan ? &scan_dijkstra_t : nullptr);
+    if (run_scan) print_row(nodes, "scan a*", &scan_astar_t, nullptr);
+    print_row(nodes, "heap a*", &heap_astar_t, run_scan ? &scan_astar_t : nullptr);
+    if (mismatches > 0) {
+        printf("%-10d !! %d cost mismatch(es) between implementations\n", nodes, mismatches);
+    }
+
+    free(starts);
+    free(goals);
+    free(expected);
+    free(scan.g);
+    free(scan.f);
+    free(scan.open);
+    free(scan.closed);
+    path_search_free(&search);
+    path_graph_free(&graph);
+    return mismatches > 0 ? 1 : 0;
+}
+
+int bench_pathfinding(int max_side) {
+    int sides[] = { 32, 128, 512, 1000 };
+    int failures = 0;
+
+    printf("=== Pathfinding Benchmark (4-connected grids, %.0f%% walls) ===\n", WALL_RATIO * 100);
+    printf("Linear-scan versions only run up to %d nodes.\n\n", SCAN_MAX_NODES);
+    printf("%-10s %-16s %8s %14s %16s %10s\n",
+           "nodes", "algorithm", "queries", "us/query", "expanded/query", "speedup");
+
+    for (size_t i = 0; i < sizeof(sides) / sizeof(sides[0]); i++) {
+        int side = sides[i] < max_side ? sides[i] : max_side;
+        failures += bench_grid(side);
+        if (side == max_side) break;
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// ============================================================================
+// ROUTE TABLE BENCHMARK
+// ============================================================================
+
+constexpr int ROUTE_MAX_SIDE = 64;       // 4096 nodes: a 200 MB table
+constexpr int ROUTE_QUERIES = 10000;
+constexpr int ROUTE_TOGGLES = 20;
+
+// Rebuild the graph from the edges that are not removed
+static bool rebuild_without(PathGraph *graph, int side, const PathEdge edges[],
+                            const bool removed[], int edge_count, PathEdge scratch[]) {
+    int kept = 0;
+    for (int i = 0; i < edge_count; i++) {
+        if (!removed[i]) scratch[kept++] = edges[i];
+    }
+    path_graph_free(graph);
+    return build_grid(graph, side, scratch, kept);
+}
+
+int bench_routes(int side) {
+    if (side > ROUTE_MAX_SIDE) {
+        printf("Route tables grow with nodes²; using a %dx%d grid.\n", ROUTE_MAX_SIDE, ROUTE_MAX_SIDE);
+        side = ROUTE_MAX_SIDE;
+    }
+
+    int edge_count;
+    PathEdge *edges = grid_edges(side, 4242u, &edge_count);
+    PathEdge *scratch = malloc(((size_t)edge_count + 1) * sizeof(PathEdge));
+    bool *removed = calloc((size_t)edge_count + 1, sizeof(bool));
+    int nodes = side * side;
+    int *path = malloc((size_t)nodes * sizeof(int));
+
+    PathGraph graph = {};
+    PathSearch search = {};
+    PathRoutes routes = {};
+    PathRoutes fresh = {};
+
+    if (edges == nullptr || scratch == nullptr || removed == nullptr || path == nullptr ||
+        !build_grid(&graph, side, edges, edge_count) || !path_search_init(&search, nodes)) {
+        fprintf(stderr, "Out of memory for %dx%d route benchmark\n", side, side);
+        free(edges);
+        free(scratch);
+        free(removed);
+        free(path);
+        path_graph_free(&graph);
+        path_search_free(&search);
+        return 1;
+    }
+
+    printf("=== Route Table Benchmark (%dx%d grid, %d nodes, %.0f%% walls) ===\n\n",
+           side, side, nodes, WALL_RATIO * 100);
+
+    double start = now_seconds();
+    bool ok = path_routes_build(&routes, &graph, &search);
+    double build_seconds = now_seconds() - start;
+    if (!ok) {
+        fprintf(stderr, "Out of memory building the route table\n");
+        return 1;
+    }
+
+    printf("Full build:         %10.2f ms  (%d searches, %.1f MB table)\n", build_seconds * 1e3,
+           nodes, (double)nodes * nodes * (sizeof(int) + sizeof(double)) / (1024.0 * 1024.0));
+
+    // Lookups against A* on the same pairs
+    unsigned rng = 99u;
+    int mismatches = 0;
+    double walk_seconds = 0, astar_seconds = 0;
+    long long hops = 0;
+
+    for (int q = 0; q < ROUTE_QUERIES; q++) {
+        int from = random_node(&graph, &rng);
+        int to = random_node(&graph, &rng);
+
+        start = now_seconds();
+        int length = path_routes_walk(&routes, from, to, path, nodes);
+        walk_seconds += now_seconds() - start;
+        if (length > 0) hops += length - 1;
+
+        start = now_seconds();
+        double cost = path_astar(&graph, &search, from, to);
+        if (cost >= 0) path_extract(&search, to, path, nodes);
+        astar_seconds += now_seconds() - start;
+
+        if (fabs(cost - path_routes_distance(&routes, from, to)) > 1e-9) mismatches++;
+    }
+
+    printf("Table walk:         %10.2f us/query  (%.1f hops on average)\n",
+           walk_seconds / ROUTE_QUERIES * 1e6, (double)hops / ROUTE_QUERIES);
+    printf("A* search:          %10.2f us/query\n", astar_seconds / ROUTE_QUERIES * 1e6);
+
+    // Toggle single edges, updating the table incrementally each time
+    double update_seconds = 0;
+    long long recomputed = 0;
+
+    for (int t = 0; t < ROUTE_TOGGLES && ok; t++) {
+        int i = (int)(next_random(&rng) % (unsigned)edge_count);
+        removed[i] = !removed[i];
+
+        PathEdge change = edges[i];
+        if (removed[i]) change.weight = -1.0;
+
+        ok = rebuild_without(&graph, side, edges, removed, edge_count, scratch);
+
+        start = now_seconds();
+        int count = ok ? path_routes_update(&routes, &graph, &search, &change, 1) : -1;
+        update_seconds += now_seconds() - start;
+
+        if (count < 0) ok = false;
+        recomputed += count;
+    }
+
+    start = now_seconds();
+    ok = ok && path_routes_build(&fresh, &graph, &search);
+    double rebuild_seconds = now_seconds() - start;
+
+    if (!ok) {
+        fprintf(stderr, "Out of memory updating the route table\n");
+        return 1;
+    }
+
+    printf("Incremental update: %10.2f ms  (avg over %d edge toggles, %.1f of %d destinations)\n",
+           update_seconds / ROUTE_TOGGLES * 1e3, ROUTE_TOGGLES,
+           (double)recomputed / ROUTE_TOGGLES, nodes);
+    printf("Full rebuild:       %10.2f ms\n", rebuild_seconds * 1e3);
+
+    for (size_t cell = 0; cell < (size_t)nodes * nodes; cell++) {
+        if (fabs(routes.distance[cell] - fresh.distance[cell]) > 1e-9) mismatches++;
+    }
+
+    if (mismatches == 0) {
+        printf("\n✓ Table agrees with A* and with a fresh build after the updates\n");
+    } else {
+        printf("\n!! %d mismatch(es) against A* or a fresh build\n", mismatches);
+    }
+
+    free(edges);
+    free(scratch);
+    free(removed);
+    free(path);
+    path_routes_free(&routes);
+    path_routes_free(&fresh);
+    path_search_free(&search);
+    path_graph_free(&graph);
+    return mismatches > 0 ? 1 : 0;
+}
+
+// ============================================================================
+// WORLD FILE HARNESS
+// ============================================================================
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    const char *name;
+    double (*search)(const PathGraph *graph, PathSearch *search, int start, int goal);
+} SearchAlgorithm;
+
+int bench_world(const char *path, int queries) {
+    PathGraph graph;
+    WorldMapping mapping;
+
+    double start = now_seconds();
+    if (!world_load(path, &graph, &mapping)) return 1;
+    double load_seconds = now_seconds() - start;
+
+    PathSearch search;
+    double *micros = malloc((size_t)queries * sizeof(double));
+    int *starts = malloc((size_t)queries * sizeof(int));
+    int *goals = malloc((size_t)queries * sizeof(int));
+    if (micros == nullptr || starts == nullptr || goals == nullptr ||
+        !path_search_init(&search, graph.node_count)) {
+        fprintf(stderr, "Out of memory for %d-node world\n", graph.node_count);
+        free(micros);
+        free(starts);
+        free(goals);
+        world_unload(&graph, &mapping);
+        return 1;
+    }
+
+    printf("=== World: %s (%s, %d nodes, %d edges, %.1f MB) ===\n",
+           path, world_kind_to_string(mapping.kind), graph.node_count, graph.edge_count,
+           mapping.size / (1024.0 * 1024.0));
+    printf("mmap load: %.3f ms\n\n", load_seconds * 1e3);
+
+    unsigned rng = 2024u;
+    for (int q = 0; q < queries; q++) {
+        starts[q] = random_node(&graph, &rng);
+        goals[q] = random_node(&graph, &rng);
+    }
+
+    printf("%-10s %8s %10s %16s %12s %12s %12s\n",
+           "algorithm", "queries", "reachable", "expanded/query", "mean us", "p50 us", "p99 us");
+
+    SearchAlgorithm algorithms[] = {
+        { "dijkstra", path_dijkstra },
+        { "a*", path_astar }
+    };
+    double costs[2] = {};
+    int mismatches = 0;
+
+    for (size_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+        long long expanded = 0;
+        int reachable = 0;
+        double total = 0, checksum = 0;
+
+        for (int q = 0; q < queries; q++) {
+            double t0 = now_seconds();
+            double cost = algorithms[a].search(&graph, &search, starts[q], goals[q]);
+            micros[q] = (now_seconds() - t0) * 1e6;
+
+            total += micros[q];
+            expanded += search.expanded;
+            if (cost >= 0) {
+                reachable++;
+                checksum += cost;
+            }
+        }
+        costs[a] = checksum;
+
+        qsort(micros, (size_t)queries, sizeof(double), compare_doubles);
+        printf("%-10s %8d %10d %16.0f %12.1f %12.1f %12.1f\n", algorithms[a].name, queries,
+               reachable, (double)expanded / queries, total / queries,
+               micros[queries / 2], micros[(int)(queries * 0.99)]);
+    }
+
+    // Both must agree on every route length
+    if (fabs(costs[0] - costs[1]) > 1e-6 * (1.0 + fabs(costs[0]))) {
+        printf("\n!! Dijkstra and A* disagree on total route length\n");
+        mismatches++;
+    }
+
+    free(micros);
+    free(starts);
+    free(goals);
+    path_search_free(&search);
+    world_unload(&graph, &mapping);
+    return mismatches > 0 ? 1 : 0;
+}
+
+// ============================================================================
+// HIERARCHICAL PATHFINDING HARNESS
+// ============================================================================
+
+static double search_megabytes(int capacity) {
+    size_t per_node = 2 * sizeof(unsigned) + 2 * sizeof(double) + 3 * sizeof(int);
+    return (double)capacity * per_node / (1024.0 * 1024.0);
+}
+
+static void print_timings(const char *name, int queries, int reachable, long long expanded,
+                          double micros[]) {
+    double total = 0;
+    for (int q = 0; q < queries; q++) total += micros[q];
+
+    qsort(micros, (size_t)queries, sizeof(double), compare_doubles);
+    printf("%-10s %8d %10d %16.0f %12.1f %12.1f %12.1f\n", name, queries, reachable,
+           (double)expanded / queries, total / queries,
+           micros[queries / 2], micros[(int)(queries * 0.99)]);
+}
+
+int bench_hpa(const char *path, int queries, double cluster_size) {
+    PathGraph graph;
+    WorldMapping mapping;
+    if (!world_load(path, &graph, &mapping)) return 1;
+
+    PathSearch search;
+    HpaMap map = {};
+    double *micros = malloc((size_t)queries * sizeof(double));
+    double *flat_costs = malloc((size_t)queries * sizeof(double));
+    int *starts = malloc((size_t)queries * sizeof(int));
+    int *goals = malloc((size_t)queries * sizeof(int));
+    int *route = malloc((size_t)graph.node_count * sizeof(int));
+    bool ready = micros != nullptr && flat_costs != nullptr && starts != nullptr &&
+                 goals != nullptr && route != nullptr &&
+                 path_search_init(&search, graph.node_count);
+
+    double build_seconds = 0;
+    if (ready) {
+        double t0 = now_seconds();
+        ready = hpa_build(&map, &graph, &search, cluster_size);
+        build_seconds = now_seconds() - t0;
+        if (!ready) path_search_free(&search);
+    }
+
+    if (!ready) {
+        fprintf(stderr, "Out of memory for %d-node world\n", graph.node_count);
+        free(micros);
+        free(flat_costs);
+        free(starts);
+        free(goals);
+        free(route);
+        world_unload(&graph, &mapping);
+        return 1;
+    }
+
+    printf("=== HPA*: %s (%s, %d nodes, clusters of %.0f x %.0f) ===\n",
+           path, world_kind_to_string(mapping.kind), graph.node_count, cluster_size, cluster_size);
+    printf("Hierarchy: %d clusters, %d entrances, %d abstract edges, built in %.2f s\n",
+           map.cluster_count, map.abstract_count, map.abstract.edge_count, build_seconds);
+    printf("Memory:    search workspace %.1f MB (both), hierarchy %.1f MB (HPA* only)\n\n",
+           search_megabytes(graph.node_count), hpa_memory(&map) / (1024.0 * 1024.0));
+
+    unsigned rng = 2024u;
+    for (int q = 0; q < queries; q++) {
+        starts[q] = random_node(&graph, &rng);
+        goals[q] = random_node(&graph, &rng);
+    }
+
+    printf("%-10s %8s %10s %16s %12s %12s %12s\n",
+           "algorithm", "queries", "reachable", "expanded/query", "mean us", "p50 us", "p99 us");
+
+    long long expanded = 0;
+    int reachable = 0;
+    for (int q = 0; q < queries; q++) {
+        double t0 = now_seconds();
+        flat_costs[q] = path_astar(&graph, &search, starts[q], goals[q]);
+        micros[q] = (now_seconds() - t0) * 1e6;
+        expanded += search.expanded;
+        if (flat_costs[q] >= 0) reachable++;
+    }
+    print_timings("a*", queries, reachable, expanded, micros);
+
+    // HPA* routes include refinement, so every query yields a full path
+    int mismatches = 0;
+    double excess = 0, worst = 0;
+    expanded = 0;
+    reachable = 0;
+    for (int q = 0; q < queries; q++) {
+        double cost = 0;
+        double t0 = now_seconds();
+        int length = hpa_find_path(&map, &graph, &search, starts[q], goals[q],
+                                   route, graph.node_count, &cost);
+        micros[q] = (now_seconds() - t0) * 1e6;
+        expanded += map.expanded;
+
+        if ((length > 0) != (flat_costs[q] >= 0)) {
+            mismatches++;
+        } else if (length > 0) {
+            reachable++;
+            double ratio = flat_costs[q] > 0 ? cost / flat_costs[q] - 1.0 : 0.0;
+            excess += ratio;
+            if (ratio > worst) worst = ratio;
+        }
+    }
+    print_timings("hpa*", queries, reachable, expanded, micros);
+
+    printf("\nHPA* route length: %.2f%% above optimal on average, %.2f%% worst\n",
+           reachable ? 100.0 * excess / reachable : 0.0, 100.0 * worst);
+    if (mismatches > 0) {
+        printf("!! %d queries disagree on reachability\n", mismatches);
+    }
+
+    free(micros);
+    free(flat_costs);
+    free(starts);
+    free(goals);
+    free(route);
+    hpa_free(&map);
+    path_search_free(&search);
+    world_unload(&graph, &mapping);
+    return mismatches > 0 ? 1 : 0;
+}
+
+// ============================================================================
+// BATCHED QUERY BENCHMARK
+// ============================================================================
+
+constexpr int BATCH_QUERIES = 500;
+constexpr int MATRIX_SOURCES = 64;
+constexpr int MATRIX_TARGETS = 64;
+constexpr int MATRIX_BLOCK = 24;        // Targets sit in one block mid-map
+
+static void print_scaling(int threads, double seconds, int tasks, double single_seconds) {
+    printf("%8d %10.3f %12.0f %9.2fx\n", threads, seconds, tasks / seconds,
+           single_seconds / seconds);
+}
+
+int bench_batch(int side) {
+    PathGraph graph;
+    if (!make_grid(&graph, side, 4242u)) {
+        fprintf(stderr, "Out of memory building %dx%d grid\n", side, side);
+        return 1;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cores > 4 ? (int)cores : 4;
+
+    PathQuery *queries = malloc(BATCH_QUERIES * sizeof(PathQuery));
+    double *expected = malloc(BATCH_QUERIES * sizeof(double));
+    int sources[MATRIX_SOURCES];
+    int targets[MATRIX_TARGETS];
+    double *costs = malloc((size_t)MATRIX_SOURCES * MATRIX_TARGETS * sizeof(double));
+    double *full_costs = malloc((size_t)MATRIX_SOURCES * MATRIX_TARGETS * sizeof(double));
+    PathSearch search;
+
+    if (queries == nullptr || expected == nullptr || costs == nullptr || full_costs == nullptr ||
+        !path_search_init(&search, graph.node_count)) {
+        fprintf(stderr, "Out of memory for %d-node batch\n", graph.node_count);
+        free(queries);
+        free(expected);
+        free(costs);
+        free(full_costs);
+        path_graph_free(&graph);
+        return 1;
+    }
+
+    unsigned rng = 99u;
+    for (int q = 0; q < BATCH_QUERIES; q++) {
+        queries[q] = (PathQuery){ .start = random_node(&graph, &rng), .goal = random_node(&graph, &rng) };
+    }
+    for (int s = 0; s < MATRIX_SOURCES; s++) {
+        sources[s] = random_node(&graph, &rng);
+    }
+
+    // "Every source to the showroom": targets clustered in a block in the
+    // middle of the map, all reachable from each other (an unreachable
+    // target would make every early-stop search run to exhaustion)
+    int block = side < MATRIX_BLOCK ? side : MATRIX_BLOCK;
+    int corner = (side - block) / 2;
+    int hub = corner * side + corner;
+    while (graph.offsets[hub + 1] == graph.offsets[hub]) hub++;
+
+    path_dijkstra(&graph, &search, hub, -1);
+    for (int t = 0; t < MATRIX_TARGETS; t++) {
+        do {
+            int x = corner + (int)(next_random(&rng) % (unsigned)block);
+            int y = corner + (int)(next_random(&rng) % (unsigned)block);
+            targets[t] = y * side + x;
+        } while (path_cost(&search, targets[t]) == PATH_UNREACHABLE);
+    }
+
+    printf("=== Batched Pathfinding: %d x %d grid (%d nodes), %ld cores online ===\n\n",
+           side, side, graph.node_count, cores);
+
+    // Reference answers, one query at a time on the caller's thread
+    for (int q = 0; q < BATCH_QUERIES; q++) {
+        expected[q] = path_astar(&graph, &search, queries[q].start, queries[q].goal);
+    }
+
+    // Early stop vs. a full one-to-all search per source
+    long long full_expanded = 0;
+    double t0 = now_seconds();
+    for (int s = 0; s < MATRIX_SOURCES; s++) {
+        path_dijkstra(&graph, &search, sources[s], -1);
+        full_expanded += search.expanded;
+        for (int t = 0; t < MATRIX_TARGETS; t++) {
+            full_costs[s * MATRIX_TARGETS + t] = path_cost(&search, targets[t]);
+        }
+    }
+    double full_seconds = now_seconds() - t0;
+
+    int mismatches = 0;
+    double pair_single = 0, matrix_single = 0;
+    long long early_expanded = 0;
+
+    printf("Pair queries (A*, %d per batch):\n", BATCH_QUERIES);
+    printf("%8s %10s %12s %10s\n", "threads", "seconds", "queries/s", "speedup");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        PathPool *pool = path_pool_start(threads, graph.node_count);
+        if (pool == nullptr) {
+            fprintf(stderr, "Could not start %d threads\n", threads);
+            mismatches++;
+            break;
+        }
+
+        t0 = now_seconds();
+        path_pool_run(pool, &graph, PATH_ASTAR, queries, BATCH_QUERIES);
+        double seconds = now_seconds() - t0;
+        if (threads == 1) pair_single = seconds;
+        print_scaling(threads, seconds, BATCH_QUERIES, pair_single);
+
+        for (int q = 0; q < BATCH_QUERIES; q++) {
+            if (queries[q].cost != expected[q]) mismatches++;
+        }
+        path_pool_stop(pool);
+    }
+
+    printf("\nDistance matrix (%d sources x %d targets, early-stop Dijkstra):\n",
+           MATRIX_SOURCES, MATRIX_TARGETS);
+    printf("%8s %10s %12s %10s\n", "threads", "seconds", "sources/s", "speedup");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        PathPool *pool = path_pool_start(threads, graph.node_count);
+        if (pool == nullptr) {
+            fprintf(stderr, "Could not start %d threads\n", threads);
+            mismatches++;
+            break;
+        }
+
+        t0 = now_seconds();
+        early_expanded = path_pool_matrix(pool, &graph, sources, MATRIX_SOURCES,
+                                          targets, MATRIX_TARGETS, costs);
+        double seconds = now_seconds() - t0;
+        if (threads == 1) matrix_single = seconds;
+        print_scaling(threads, seconds, MATRIX_SOURCES, matrix_single);
+
+        for (int i = 0; i < MATRIX_SOURCES * MATRIX_TARGETS; i++) {
+            if (costs[i] != full_costs[i]) mismatches++;
+        }
+        path_pool_stop(pool);
+    }
+
+    printf("\nEarly stop: %.0f nodes settled per source vs %.0f for full one-to-all "
+           "(%.1fx fewer; one thread %.3f s vs %.3f s)\n",
+           (double)early_expanded / MATRIX_SOURCES, (double)full_expanded / MATRIX_SOURCES,
+           (double)full_expanded / (early_expanded > 0 ? early_expanded : 1),
+           matrix_single, full_seconds);
+    if (cores < max_threads) {
+        printf("Only %ld cores online: thread counts above that cannot scale.\n", cores);
+    }
+    if (mismatches > 0) {
+        printf("!! %d batched answers differ from sequential ones\n", mismatches);
+    }
+
+    free(queries);
+    free(expected);
+    free(costs);
+    free(full_costs);
+    path_search_free(&search);
+    path_graph_free(&graph);
+    return mismatches > 0 ? 1 : 0;
+}
+
+// ============================================================================
+// FLEET PHYSICS BENCHMARKS
+// ============================================================================
+
+constexpr double FLEET_BENCH_WORK = 2e6;   // Vehicle evaluations per timing
+constexpr double SIM_FINE_DT = 0.001;       // Reference step for the convergence check
+constexpr int SIM_CHECK_VEHICLES = 32;
+
+static double relative_error(double a, double b) {
+    return fabs(a - b) / (fabs(b) > 1e-300 ? fabs(b) : 1.0);
+}
+
+// Variations of the garage's cars: every parameter within +-20%
+static void vary_vehicles(Vehicle vehicles[], int count) {
+    GarageInventory templates = {};
+    init_garage(&templates);
+
+    unsigned rng = 777u;
+    for (int i = 0; i < count; i++) {
+        vehicles[i] = templates.vehicles[i % templates.vehicle_count];
+        double *fields[] = {
+            &vehicles[i].mass, &vehicles[i].engine_power, &vehicles[i].drag_coefficient,
+            &vehicles[i].frontal_area, &vehicles[i].max_speed, &vehicles[i].acceleration
+        };
+        for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            *fields[f] *= 0.8 + 0.4 * ((rng >> 8) / 16777216.0);
+        }
+    }
+}
+
+// Scalar calculate_* over an array of Vehicle structs against
+// fleet_analyze() over the packed fleet
+int bench_fleet(int count) {
+    Vehicle *vehicles = malloc((size_t)count * sizeof(Vehicle));
+    FleetMetrics scalar;
+    FleetMetrics vector;
+    Fleet fleet;
+    bool scalar_ready = fleet_metrics_init(&scalar, count);
+    bool vector_ready = fleet_metrics_init(&vector, count);
+    bool fleet_ready = fleet_init(&fleet, count);
+
+    if (vehicles == nullptr || !scalar_ready || !vector_ready || !fleet_ready) {
+        fprintf(stderr, "Out of memory for %d vehicles\n", count);
+        free(vehicles);
+        if (scalar_ready) fleet_metrics_free(&scalar);
+        if (vector_ready) fleet_metrics_free(&vector);
+        if (fleet_ready) fleet_free(&fleet);
+        return 1;
+    }
+
+    vary_vehicles(vehicles, count);
+
+    int rounds = (int)(FLEET_BENCH_WORK / count);
+    if (rounds < 1) rounds = 1;
+
+    double t0 = now_seconds();
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < count; i++) {
+            const Vehicle *v = &vehicles[i];
+            scalar.terminal_velocity[i] = calculate_terminal_velocity(v);
+            scalar.launch_time[i] = calculate_acceleration_time(v, TEST_SPEED);
+            scalar.braking_distance[i] = calculate_braking_distance(v, TEST_SPEED);
+            scalar.drag_at_max[i] = calculate_drag_force(v, v->max_speed);
+            scalar.power_at_max[i] = calculate_power_required(v, v->max_speed);
+            scalar.lap_time[i] = calculate_lap_time(v, TEST_TRACK_LENGTH, TEST_TURNS);
+        }
+    }
+    double scalar_seconds = (now_seconds() - t0) / rounds;
+
+    t0 = now_seconds();
+    for (int i = 0; i < count; i++) {
+        FleetVehicle physics = vehicle_physics(&vehicles[i]);
+        fleet_add(&fleet, &physics);
+    }
+    double pack_seconds = now_seconds() - t0;
+
+    FleetCourse course = { .test_speed = TEST_SPEED, .track_length = TEST_TRACK_LENGTH, .turns = TEST_TURNS };
+    t0 = now_seconds();
+    for (int round = 0; round < rounds; round++) {
+        fleet_analyze(&fleet, &course, &vector);
+    }
+    double vector_seconds = (now_seconds() - t0) / rounds;
+
+    double worst = 0;
+    for (int i = 0; i < count; i++) {
+        double errors[] = {
+            relative_error(vector.terminal_velocity[i], scalar.terminal_velocity[i]),
+            relative_error(vector.launch_time[i], scalar.launch_time[i]),
+            relative_error(vector.braking_distance[i], scalar.braking_distance[i]),
+            relative_error(vector.drag_at_max[i], scalar.drag_at_max[i]),
+            relative_error(vector.power_at_max[i], scalar.power_at_max[i]),
+            relative_error(vector.lap_time[i], scalar.lap_time[i])
+        };
+        for (size_t e = 0; e < sizeof(errors) / sizeof(errors[0]); e++) {
+            if (errors[e] > worst) worst = errors[e];
+        }
+    }
+
+    printf("=== Fleet Physics Benchmark (%d vehicles, 6 metrics each, %d rounds) ===\n\n",
+           count, rounds);
+    printf("Layout: Vehicle struct %zu bytes; fleet %zu bytes per vehicle in %d-lane vectors\n\n",
+           sizeof(Vehicle), 6 * sizeof(double), FLEET_LANES);
+    printf("%-26s %14s %16s %10s\n", "version", "ns/vehicle", "vehicles/s", "speedup");
+    printf("%-26s %14.2f %16.3e %10s\n", "scalar calculate_* (AoS)",
+           scalar_seconds / count * 1e9, count / scalar_seconds, "1.0x");
+    printf("%-26s %14.2f %16.3e %9.1fx\n", "fleet_analyze (SoA SIMD)",
+           vector_seconds / count * 1e9, count / vector_seconds, scalar_seconds / vector_seconds);
+    printf("\nPacking the fleet once: %.2f ms. Largest relative difference: %.2e\n",
+           pack_seconds * 1e3, worst);
+
+    int status = worst < 1e-12 ? 0 : 1;
+    if (status != 0) printf("!! Vectorized results differ from the scalar functions\n");
+
+    free(vehicles);
+    fleet_metrics_free(&scalar);
+    fleet_metrics_free(&vector);
+    fleet_free(&fleet);
+    return status;
+}
+
+// Time-stepped laps for a fleet of variations, across thread counts, with
+// a convergence check against a ten times smaller step
+int bench_sim(int count) {
+    Vehicle *vehicles = malloc((size_t)count * sizeof(Vehicle));
+    FleetVehicle *physics = malloc((size_t)count * sizeof(FleetVehicle));
+    SimResult *reference = malloc((size_t)count * sizeof(SimResult));
+    SimResult *results = malloc((size_t)count * sizeof(SimResult));
+    if (vehicles == nullptr || physics == nullptr || reference == nullptr || results == nullptr) {
+        fprintf(stderr, "Out of memory for %d vehicles\n", count);
+        free(vehicles);
+        free(physics);
+        free(reference);
+        free(results);
+        return 1;
+    }
+
+    vary_vehicles(vehicles, count);
+    for (int i = 0; i < count; i++) physics[i] = vehicle_physics(&vehicles[i]);
+
+    SimSegment segments[2 * TEST_TURNS + 1];
+    SimTrack track = {
+        .segments = segments,
+        .count = sim_track_build(segments, TEST_TRACK_LENGTH, TEST_TURNS,
+                                 TEST_TURN_LENGTH, TEST_TURN_RADIUS)
+    };
+
+    printf("=== Lap Simulation Benchmark (%d vehicles, %d laps, dt = %.3f s) ===\n\n",
+           count, SIM_BENCH_LAPS, SIM_DT);
+    printf("%-8s %12s %16s %18s %10s\n", "threads", "seconds", "steps/s", "steps/s/thread", "speedup");
+
+    int status = 0;
+    double single_seconds = 0;
+    int thread_counts[] = { 1, 2, 4, 8 };
+    for (size_t c = 0; c < sizeof(thread_counts) / sizeof(thread_counts[0]); c++) {
+        int threads = thread_counts[c];
+        SimResult *out = threads == 1 ? reference : results;
+
+        double t0 = now_seconds();
+        if (!sim_laps_parallel(physics, count, &track, SIM_BENCH_LAPS, SIM_DT, out, threads)) {
+            fprintf(stderr, "Could not start %d threads\n", threads);
+            status = 1;
+            break;
+        }
+        double seconds = now_seconds() - t0;
+        if (threads == 1) single_seconds = seconds;
+
+        long long steps = 0;
+        for (int i = 0; i < count; i++) {
+            steps += out[i].steps;
+            if (out != reference && out[i].total_time != reference[i].total_time) status = 1;
+        }
+        printf("%-8d %12.3f %16.3e %18.3e %9.1fx\n", threads, seconds, steps / seconds,
+               steps / seconds / threads, single_seconds / seconds);
+    }
+    if (status != 0) printf("!! Threaded results differ from the single-threaded run\n");
+
+    // Step-size check: the same laps and launches at SIM_FINE_DT
+    int checked = count < SIM_CHECK_VEHICLES ? count : SIM_CHECK_VEHICLES;
+    double worst_lap = 0, worst_launch = 0, worst_estimate = 0;
+    for (int i = 0; i < checked; i++) {
+        SimResult fine = sim_laps(&physics[i], &track, SIM_BENCH_LAPS, SIM_FINE_DT);
+        double lap_error = relative_error(reference[i].best_lap, fine.best_lap);
+        if (lap_error > worst_lap) worst_lap = lap_error;
+
+        double launch = sim_launch_time(&physics[i], TEST_SPEED, SIM_DT, nullptr);
+        double fine_launch = sim_launch_time(&physics[i], TEST_SPEED, SIM_FINE_DT, nullptr);
+        double launch_error = relative_error(launch, fine_launch);
+        if (launch_error > worst_launch) worst_launch = launch_error;
+
+        double estimate = calculate_lap_time(&vehicles[i], TEST_TRACK_LENGTH, TEST_TURNS);
+        double estimate_error = relative_error(estimate, fine.best_lap);
+        if (estimate_error > worst_estimate) worst_estimate = estimate_error;
+    }
+
+    printf("\nAgainst dt = %.3f s (%d vehicles): best lap within %.2e, 0-60 within %.2e\n",
+           SIM_FINE_DT, checked, worst_lap, worst_launch);
+    printf("Closed-form lap estimate differs from the simulation by up to %.0f%%\n",
+           worst_estimate * 100.0);
+    printf("Target: 1e6 steps/s per core; thread rows only scale up to the machine's core count\n");
+
+    free(vehicles);
+    free(physics);
+    free(reference);
+    free(results);
+    return status;
+}
+
+// ============================================================================
+// PARTS OPTIMIZER BENCHMARK
+// ============================================================================
+
+constexpr int OPTIMIZE_MIN_PARTS = 4;
+constexpr int BRUTE_FORCE_PARTS = 6;        // Check against full enumeration up to here
+constexpr double OPTIMIZE_BUDGET_SHARE = 0.35;
+
+// Every assignment of parts to vehicles, evaluated from scratch
+static double brute_force(const FleetVehicle vehicles[], int vehicle_count,
+                          const OptPart parts[], int part_count, double budget) {
+    long long assignments = 1;
+    for (int p = 0; p < part_count; p++) assignments *= vehicle_count + 1;
+
+    double best = INFINITY;
+    for (long long a = 0; a < assignments; a++) {
+        unsigned masks[OPT_MAX_VEHICLES] = {};
+        double cost = 0;
+        long long digits = a;
+        for (int p = 0; p < part_count; p++) {
+            int v = (int)(digits % (vehicle_count + 1)) - 1;
+            digits /= vehicle_count + 1;
+            if (v == OPT_UNUSED) continue;
+            masks[v] |= 1u << p;
+            cost += parts[p].cost;
+        }
+        if (cost > budget) continue;
+
+        double value = 0;
+        for (int v = 0; v < vehicle_count; v++) {
+            FleetVehicle equipped = opt_equip(&vehicles[v], parts, masks[v]);
+            value += simulated_launch(&equipped);
+        }
+        if (value < best) best = value;
+    }
+    return best;
+}
+
+// Optimize the garage's cars' summed 0-60 time over growing sets of
+// generated parts, on one thread and on OPTIMIZE_THREADS
+int bench_optimize(int max_parts) {
+    if (max_parts > OPT_MAX_PARTS) max_parts = OPT_MAX_PARTS;
+
+    GarageInventory garage = {};
+    init_garage(&garage);
+    FleetVehicle vehicles[MAX_VEHICLES];
+    for (int v = 0; v < garage.vehicle_count; v++) {
+        vehicles[v] = vehicle_physics(&garage.vehicles[v]);
+    }
+
+    OptPart parts[OPT_MAX_PARTS];
+    unsigned rng = 2024u;
+    for (int p = 0; p < OPT_MAX_PARTS; p++) {
+        double draws[3];
+        for (int d = 0; d < 3; d++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            draws[d] = (rng >> 8) / 16777216.0;
+        }
+        parts[p] = (OptPart){
+            .cost = 1000.0 + 100.0 * (int)(50.0 * draws[0]),
+            .weight = 2.0 + 38.0 * draws[1],
+            .performance_boost = 5 + (int)(25.0 * draws[2])
+        };
+    }
+
+    printf("=== Parts Optimizer Benchmark (%d vehicles, 0-60 time, budget %.0f%% of the parts) ===\n\n",
+           garage.vehicle_count, OPTIMIZE_BUDGET_SHARE * 100.0);
+    printf("%-6s %14s %10s %8s %12s %12s %14s %10s %10s\n", "parts", "assignments",
+           "table ms", "threads", "nodes", "search ms", "nodes/s", "pruned", "gain");
+
+    int status = 0;
+    for (int count = OPTIMIZE_MIN_PARTS; count <= max_parts; count += 2) {
+        double total_cost = 0;
+        for (int p = 0; p < count; p++) total_cost += parts[p].cost;
+        double budget = OPTIMIZE_BUDGET_SHARE * total_cost;
+        double assignments = pow(garage.vehicle_count + 1, count);
+
+        double values[2];
+        int thread_counts[] = { 1, OPTIMIZE_THREADS };
+        for (int t = 0; t < 2; t++) {
+            OptResult result;
+            if (!opt_search(vehicles, garage.vehicle_count, parts, count, budget,
+                            simulated_launch, thread_counts[t], &result)) {
+                fprintf(stderr, "Optimizer failed at %d parts\n", count);
+                return 1;
+            }
+            values[t] = result.value;
+
+            printf("%-6d %14.0f %10.1f %8d %12lld %12.2f %14.3e %9.4f%% %9.2f%%\n",
+                   count, assignments, result.table_seconds * 1e3, thread_counts[t], result.nodes,
+                   result.search_seconds * 1e3,
+                   result.nodes / (result.search_seconds > 0 ? result.search_seconds : 1e-9),
+                   100.0 * (1.0 - result.nodes / assignments),
+                   100.0 * (1.0 - result.value / result.baseline));
+        }
+
+        if (values[0] != values[1]) {
+            printf("!! %d parts: threaded search found %.6f, single thread %.6f\n",
+                   count, values[1], values[0]);
+            status = 1;
+        }
+        if (count <= BRUTE_FORCE_PARTS) {
+            double exact = brute_force(vehicles, garage.vehicle_count, parts, count, budget);
+            if (relative_error(values[0], exact) > 1e-12) {
+                printf("!! %d parts: branch and bound found %.6f, full enumeration %.6f\n",
+                       count, values[0], exact);
+                status = 1;
+            }
+        }
+    }
+
+    printf("\nTable: one 0-60 simulation per vehicle and subset of parts. Pruned: share of\n");
+    printf("all assignments never visited. Results match full enumeration up to %d parts.\n",
+           BRUTE_FORCE_PARTS);
+    printf("Thread rows only scale up to the machine's core count.\n");
+    return status;
+}
+
+// ============================================================================
+// COMMAND REPLAY BENCHMARK
+// ============================================================================
+
+constexpr int PARSE_ONLY_FACTOR = 10;   // Parse-only rounds per executed command
+
+// A loop through the garage that ends where it starts, so it can be
+// replayed any number of times. Nothing in it waits for an answer.
+static const char *const REPLAY_SCRIPT[] = {
+    "look", "e", "calculate braking", "examine computer", "w",
+    "n", "LOOK", "s", "inventory", "lock east", "Go East",
+    "unlock east", "go   east", "calc terminal", "west", "xyzzy",
+    "x car", "move north", "south", "i", "examine door"
+};
+
+// parse_command() as it was, with strtok and a strcmp chain
+static bool legacy_parse_command(const char *input, Command *cmd) {
+    char buffer[MAX_INPUT];
+    strncpy(buffer, input, MAX_INPUT - 1);
+    buffer[MAX_INPUT - 1] = '\0';
+    to_lowercase(buffer);
+
+    *cmd = (Command){ .verb = VERB_UNKNOWN, .object = "", .target = "", .direction = DIR_COUNT };
+
+    char *token = strtok(buffer, " \t");
+    if (token == nullptr) return false;
+
+    static const struct { const char *word; Verb verb; } verbs[] = {
+        { "go", VERB_GO }, { "move", VERB_GO }, { "look", VERB_LOOK }, { "l", VERB_LOOK },
+        { "examine", VERB_EXAMINE }, { "x", VERB_EXAMINE }, { "inventory", VERB_INVENTORY },
+        { "i", VERB_INVENTORY }, { "take", VERB_TAKE }, { "get", VERB_TAKE },
+        { "install", VERB_INSTALL }, { "calculate", VERB_CALCULATE }, { "calc", VERB_CALCULATE },
+        { "optimize", VERB_OPTIMIZE }, { "opt", VERB_OPTIMIZE }, { "navigate", VERB_NAVIGATE },
+        { "nav", VERB_NAVIGATE }, { "path", VERB_PATH }, { "lock", VERB_LOCK },
+        { "unlock", VERB_UNLOCK }, { "help", VERB_HELP }, { "?", VERB_HELP },
+        { "quit", VERB_QUIT }, { "exit", VERB_QUIT }, { "q", VERB_QUIT }
+    };
+    for (size_t v = 0; v < sizeof(verbs) / sizeof(verbs[0]); v++) {
+        if (strcmp(token, verbs[v].word) == 0) {
+            cmd->verb = verbs[v].verb;
+            break;
+        }
+    }
+    if (cmd->verb == VERB_UNKNOWN) {
+        cmd->direction = string_to_direction(token);
+        if (cmd->direction == DIR_COUNT) return false;
+        cmd->verb = VERB_GO;
+        return true;
+    }
+
+    token = strtok(nullptr, " \t");
+    if (token != nullptr) {
+        strncpy(cmd->object, token, MAX_INPUT - 1);
+        if (cmd->verb == VERB_GO) cmd->direction = string_to_direction(token);
+        token = strtok(nullptr, " \t");
+        if (token != nullptr) strncpy(cmd->target, token, MAX_INPUT - 1);
+    }
+    return true;
+}
+
+// Feed the replay script through the parser alone (old and new) and then
+// through parse_command() + execute_command() with output discarded
+int bench_parse(int commands) {
+    int status = 0;
+    int script_length = (int)(sizeof(REPLAY_SCRIPT) / sizeof(REPLAY_SCRIPT[0]));
+
+    // Both parsers agree on every script line
+    for (int i = 0; i < script_length; i++) {
+        Command old_cmd, new_cmd;
+        bool old_ok = legacy_parse_command(REPLAY_SCRIPT[i], &old_cmd);
+        bool new_ok = parse_command(REPLAY_SCRIPT[i], &new_cmd);
+        if (old_ok != new_ok || (new_ok && memcmp(&old_cmd, &new_cmd, sizeof(Command)) != 0)) {
+            printf("!! Parsers disagree on '%s'\n", REPLAY_SCRIPT[i]);
+            status = 1;
+        }
+    }
+
+    long long parse_rounds = (long long)commands * PARSE_ONLY_FACTOR;
+    Command cmd;
+    long long understood = 0;
+
+    double t0 = now_seconds();
+    for (long long i = 0; i < parse_rounds; i++) {
+        understood += legacy_parse_command(REPLAY_SCRIPT[i % script_length], &cmd);
+    }
+    double legacy_seconds = now_seconds() - t0;
+
+    t0 = now_seconds();
+    for (long long i = 0; i < parse_rounds; i++) {
+        understood -= parse_command(REPLAY_SCRIPT[i % script_length], &cmd);
+    }
+    double parse_seconds = now_seconds() - t0;
+    if (understood != 0) status = 1;
+
+    // The game prints on every command; send it to /dev/null meanwhile
+    GameState game = {};
+    fflush(stdout);
+    int saved_stdout = dup(fileno(stdout));
+    if (saved_stdout < 0 || freopen("/dev/null", "w", stdout) == nullptr) {
+        fprintf(stderr, "Could not redirect the game's output\n");
+        return 1;
+    }
+
+    init_game(&game);
+    t0 = now_seconds();
+    for (int i = 0; i < commands; i++) {
+        if (parse_command(REPLAY_SCRIPT[i % script_length], &cmd)) {
+            execute_command(&game, &cmd);
+            game.moves_count++;
+        }
+    }
+    double replay_seconds = now_seconds() - t0;
+
+    fflush(stdout);
+    dup2(saved_stdout, fileno(stdout));
+    close(saved_stdout);
+    clearerr(stdout);
+    free_game(&game);
+
+    printf("=== Command Parsing Benchmark (%d-line script) ===\n\n", script_length);
+    printf("%-34s %12s %16s\n", "stage", "ns/command", "commands/s");
+    printf("%-34s %12.1f %16.3e\n", "strtok + strcmp chain (old)",
+           legacy_seconds / parse_rounds * 1e9, parse_rounds / legacy_seconds);
+    printf("%-34s %12.1f %16.3e\n", "tokenizer + perfect hash",
+           parse_seconds / parse_rounds * 1e9, parse_rounds / parse_seconds);
+    printf("%-34s %12.1f %16.3e\n", "parse + execute, output discarded",
+           replay_seconds / commands * 1e9, commands / replay_seconds);
+    printf("\nParsing: %.1fx faster. Replayed %d commands in %.2f s, ending in %s.\n",
+           legacy_seconds / parse_seconds, commands, replay_seconds,
+           game.rooms[game.current_room].name);
+
+    if (status != 0) printf("!! Parser check failed\n");
+    return status;
+}
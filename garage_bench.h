@@ -0,0 +1,44 @@
+/*
+ * GARAGE BENCHMARKS - timing harnesses behind `garage_adventure --bench`
+ */
+
+#ifndef GARAGE_BENCH_H
+#define GARAGE_BENCH_H
+
+// Heap-based Dijkstra/A* against the original linear-scan versions on
+// generated grid maps, up to max_side x max_side nodes
+int bench_pathfinding(int max_side);
+
+// All-pairs route table on a side x side grid: build time, lookup vs A*,
+// and incremental updates vs full rebuilds as walls are toggled
+int bench_routes(int side);
+
+// Load a world file (see garage_world.h) and time random queries on it:
+// load time, nodes expanded and microseconds per query for Dijkstra and A*
+int bench_world(const char *path, int queries);
+
+// Build an HPA* hierarchy over a world file and compare it with flat A*:
+// build time, memory, latency per query and how much longer its routes are
+int bench_hpa(const char *path, int queries, double cluster_size);
+
+// Batched queries on a side x side grid across 1, 2, 4, ... threads: pair
+// queries with A*, and a sources x targets matrix with early-stop Dijkstra
+int bench_batch(int side);
+
+// Scalar calculate_* over the garage's cars against fleet_analyze() on
+// count generated variations, with a check that both agree
+int bench_fleet(int count);
+
+// Time-stepped laps for count vehicles across 1, 2, 4 and 8 threads, and
+// the error against a ten times smaller step
+int bench_sim(int count);
+
+// The parts optimizer on growing sets of generated parts, up to max_parts,
+// checked against full enumeration on the small sets
+int bench_optimize(int max_parts);
+
+// The command parser, old and new, on a scripted tour; then the same tour
+// parsed and executed commands times with output discarded
+int bench_parse(int commands);
+
+#endif // GARAGE_BENCH_H
@@ -0,0 +1,183 @@
+/*
+ * GARAGE FLEET ANALYSIS - SoA storage and vectorized physics kernels
+ */
+
+#include "garage_fleet.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+// Same constants as the game's scalar calculations
+constexpr double GRAVITY = 9.81;
+constexpr double AIR_DENSITY = 1.225;
+constexpr double WATTS_PER_HP = 745.7;
+constexpr double TURN_LENGTH = 50.0;        // m of track per turn
+constexpr double TURN_PENALTY = 1.5;        // s lost accelerating out of each turn
+
+// cbrt has no vector form in libm. Iterate on r = x^(-1/3) instead, whose
+// Newton step r * (4 - x r³) / 3 needs no division: seed r from the
+// exponent bits, refine, and return x r². Each step roughly doubles the
+// correct digits.
+constexpr int CBRT_STEPS = 4;                          // 3.7% -> 3e-3 -> 1e-5 -> 4e-10 -> exact
+constexpr uint64_t RCBRT_MAGIC = 0x553F000000000000;    // ≈ (4 * 1023 / 3) << 52
+
+typedef double FleetVec __attribute__((vector_size(FLEET_LANES * sizeof(double))));
+typedef uint64_t FleetBits __attribute__((vector_size(FLEET_LANES * sizeof(double))));
+
+static inline int round_to_lanes(int count) {
+    return (count + FLEET_LANES - 1) / FLEET_LANES * FLEET_LANES;
+}
+
+static double* alloc_lanes(int capacity) {
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return aligned_alloc(sizeof(FleetVec), (size_t)capacity * sizeof(double));
+}
+
+// ============================================================================
+// STORAGE
+// ============================================================================
+
+bool fleet_init(Fleet *fleet, int capacity) {
+    capacity = round_to_lanes(capacity > 0 ? capacity : 1);
+    *fleet = (Fleet){
+        .capacity = capacity,
+        .mass = alloc_lanes(capacity),
+        .engine_power = alloc_lanes(capacity),
+        .drag_coefficient = alloc_lanes(capacity),
+        .frontal_area = alloc_lanes(capacity),
+        .max_speed = alloc_lanes(capacity),
+        .acceleration = alloc_lanes(capacity)
+    };
+
+    if (fleet->mass == nullptr || fleet->engine_power == nullptr ||
+        fleet->drag_coefficient == nullptr || fleet->frontal_area == nullptr ||
+        fleet->max_speed == nullptr || fleet->acceleration == nullptr) {
+        fleet_free(fleet);
+        return false;
+    }
+
+    // Lanes past count are computed too; keep them finite
+    for (int i = 0; i < capacity; i++) {
+        fleet->mass[i] = fleet->engine_power[i] = fleet->drag_coefficient[i] = 1.0;
+        fleet->frontal_area[i] = fleet->max_speed[i] = fleet->acceleration[i] = 1.0;
+    }
+    return true;
+}
+
+void fleet_free(Fleet *fleet) {
+    free(fleet->mass);
+    free(fleet->engine_power);
+    free(fleet->drag_coefficient);
+    free(fleet->frontal_area);
+    free(fleet->max_speed);
+    free(fleet->acceleration);
+    *fleet = (Fleet){};
+}
+
+bool fleet_add(Fleet *fleet, const FleetVehicle *vehicle) {
+    if (fleet->count == fleet->capacity) return false;
+
+    int i = fleet->count++;
+    fleet->mass[i] = vehicle->mass;
+    fleet->engine_power[i] = vehicle->engine_power;
+    fleet->drag_coefficient[i] = vehicle->drag_coefficient;
+    fleet->frontal_area[i] = vehicle->frontal_area;
+    fleet->max_speed[i] = vehicle->max_speed;
+    fleet->acceleration[i] = vehicle->acceleration;
+    return true;
+}
+
+bool fleet_metrics_init(FleetMetrics *metrics, int capacity) {
+    capacity = round_to_lanes(capacity > 0 ? capacity : 1);
+    *metrics = (FleetMetrics){
+        .terminal_velocity = alloc_lanes(capacity),
+        .launch_time = alloc_lanes(capacity),
+        .braking_distance = alloc_lanes(capacity),
+        .drag_at_max = alloc_lanes(capacity),
+        .power_at_max = alloc_lanes(capacity),
+        .lap_time = alloc_lanes(capacity)
+    };
+
+    if (metrics->terminal_velocity == nullptr || metrics->launch_time == nullptr ||
+        metrics->braking_distance == nullptr || metrics->drag_at_max == nullptr ||
+        metrics->power_at_max == nullptr || metrics->lap_time == nullptr) {
+        fleet_metrics_free(metrics);
+        return false;
+    }
+    return true;
+}
+
+void fleet_metrics_free(FleetMetrics *metrics) {
+    free(metrics->terminal_velocity);
+    free(metrics->launch_time);
+    free(metrics->braking_distance);
+    free(metrics->drag_at_max);
+    free(metrics->power_at_max);
+    free(metrics->lap_time);
+    *metrics = (FleetMetrics){};
+}
+
+// ============================================================================
+// KERNELS
+// ============================================================================
+
+// Vectors go through pointers: passing 32-byte vectors by value changes
+// the calling convention depending on whether AVX is enabled
+static inline void vec_load(FleetVec *v, const double *source) {
+    *v = *(const FleetVec *)source;
+}
+
+static inline void vec_store(double *target, const FleetVec *v) {
+    *(FleetVec *)target = *v;
+}
+
+static inline void vec_cbrt(FleetVec *v) {
+    FleetVec x = *v;
+    FleetBits bits = RCBRT_MAGIC - (FleetBits)x / 3;
+    FleetVec r = (FleetVec)bits;
+
+    for (int step = 0; step < CBRT_STEPS; step++) {
+        r = r * (4.0 - x * r * r * r) * (1.0 / 3.0);
+    }
+    *v = x * r * r;
+}
+
+void fleet_analyze(const Fleet *fleet, const FleetCourse *course, FleetMetrics *metrics) {
+    double braking_decel = 0.8 * GRAVITY;
+    double braking = course->test_speed * course->test_speed / (2.0 * braking_decel);
+    double turn_distance = course->turns * TURN_LENGTH;
+    double straight_distance = course->track_length - turn_distance;
+    double turn_penalty = course->turns * TURN_PENALTY;
+
+    // Turns at 60% of max speed, straights at 90%: time = lap_distance / max
+    double lap_distance = turn_distance / 0.6 + straight_distance / 0.9;
+    // test / (accel * power/100 / (mass/1000)) = launch_scale * mass / (accel * power)
+    double launch_scale = course->test_speed * 100.0 / 1000.0;
+
+    for (int i = 0; i < fleet->count; i += FLEET_LANES) {
+        FleetVec mass, power, cd, area, max_speed, accel;
+        vec_load(&mass, fleet->mass + i);
+        vec_load(&power, fleet->engine_power + i);
+        vec_load(&cd, fleet->drag_coefficient + i);
+        vec_load(&area, fleet->frontal_area + i);
+        vec_load(&max_speed, fleet->max_speed + i);
+        vec_load(&accel, fleet->acceleration + i);
+
+        // The scalar formulas, regrouped so each needs at most one division
+        FleetVec drag_factor = 0.5 * AIR_DENSITY * cd * area;
+        FleetVec terminal = power * WATTS_PER_HP / drag_factor;
+        vec_cbrt(&terminal);
+
+        FleetVec launch = launch_scale * mass / (accel * power);
+        FleetVec drag = drag_factor * max_speed * max_speed;
+        FleetVec required = drag * max_speed;
+        FleetVec lap = lap_distance / max_speed + turn_penalty;
+        FleetVec stopping = (FleetVec){} + braking;
+
+        vec_store(metrics->terminal_velocity + i, &terminal);
+        vec_store(metrics->launch_time + i, &launch);
+        vec_store(metrics->braking_distance + i, &stopping);
+        vec_store(metrics->drag_at_max + i, &drag);
+        vec_store(metrics->power_at_max + i, &required);
+        vec_store(metrics->lap_time + i, &lap);
+    }
+}
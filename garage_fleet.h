@@ -0,0 +1,72 @@
+/*
+ * GARAGE FLEET ANALYSIS - performance metrics for thousands of vehicles
+ * =====================================================================
+ *
+ * The game's Vehicle struct is ~5 KB (it embeds its parts list), so a loop
+ * over vehicles reads one cache line of physics per 80 lines of struct. A
+ * Fleet keeps only the physics parameters, one array per field
+ * (structure of arrays), padded to a whole number of SIMD vectors. The
+ * kernels then load FLEET_LANES vehicles per instruction using GCC vector
+ * extensions: 4 doubles per vector, which GCC maps to AVX with
+ * -march=native and to pairs of SSE2 registers otherwise.
+ */
+
+#ifndef GARAGE_FLEET_H
+#define GARAGE_FLEET_H
+
+#include <stdbool.h>
+
+#define FLEET_LANES 4
+
+// Physics parameters of one vehicle, in the units of the game's Vehicle
+typedef struct {
+    double mass;               // kg
+    double engine_power;       // horsepower
+    double drag_coefficient;   // Cd
+    double frontal_area;       // m²
+    double max_speed;          // m/s
+    double acceleration;       // m/s²
+} FleetVehicle;
+
+typedef struct {
+    int count;
+    int capacity;              // Multiple of FLEET_LANES
+    double *mass;
+    double *engine_power;
+    double *drag_coefficient;
+    double *frontal_area;
+    double *max_speed;
+    double *acceleration;
+} Fleet;
+
+// One array per metric, count entries each (same order as the fleet)
+typedef struct {
+    double *terminal_velocity;  // m/s
+    double *launch_time;        // s, from rest to the test speed
+    double *braking_distance;   // m, from the test speed
+    double *drag_at_max;        // N at max speed
+    double *power_at_max;       // W at max speed
+    double *lap_time;           // s
+} FleetMetrics;
+
+// The same track and test speed for every vehicle
+typedef struct {
+    double test_speed;          // m/s (26.8 = 60 mph)
+    double track_length;        // m
+    int turns;
+} FleetCourse;
+
+bool fleet_init(Fleet *fleet, int capacity);
+void fleet_free(Fleet *fleet);
+
+// Append a vehicle; returns false when the fleet is full
+bool fleet_add(Fleet *fleet, const FleetVehicle *vehicle);
+
+bool fleet_metrics_init(FleetMetrics *metrics, int capacity);
+void fleet_metrics_free(FleetMetrics *metrics);
+
+// Every metric for every vehicle in one pass. Matches the scalar
+// calculate_* functions of the game to within rounding.
+void fleet_analyze(const Fleet *fleet, const FleetCourse *course, FleetMetrics *metrics);
+
+#endif // GARAGE_FLEET_H
@@ -0,0 +1,250 @@
+/*
+ * GARAGE GAME - rooms, vehicles, commands and the game state
+ *
+ * Shared by the game (advanced_garage_adventure_c23.c) and the benchmarks
+ * that drive its physics and parser (garage_bench.c).
+ */
+
+#ifndef GARAGE_GAME_H
+#define GARAGE_GAME_H
+
+#include "garage_path.h"
+#include "garage_hpa.h"
+#include "garage_fleet.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// ============================================================================
+// CONSTANTS AND CONFIGURATION
+// ============================================================================
+
+constexpr int MAX_ROOMS = 20;
+constexpr int MAX_INPUT = 256;
+constexpr int MAX_NAME = 64;
+constexpr int MAX_DESCRIPTION = 512;
+constexpr int MAX_VEHICLES = 10;
+constexpr int MAX_PARTS = 50;
+
+// The standard test: 0-60 mph, braking from 60 mph, 5 km lap with 12 turns
+constexpr double TEST_SPEED = 26.8;
+constexpr double TEST_TRACK_LENGTH = 5000.0;
+constexpr int TEST_TURNS = 12;
+constexpr double TEST_TURN_LENGTH = 50.0;   // m per turn
+constexpr double TEST_TURN_RADIUS = 40.0;   // m
+constexpr double SIM_DT = 0.01;             // s per RK4 step
+constexpr int SIM_BENCH_LAPS = 2;
+constexpr int OPTIMIZE_THREADS = 4;
+
+// ============================================================================
+// TYPE DEFINITIONS
+// ============================================================================
+
+typedef enum {
+    ROOM_GARAGE_ENTRANCE,
+    ROOM_MAIN_GARAGE,
+    ROOM_WORKSHOP,
+    ROOM_PARTS_STORAGE,
+    ROOM_PAINT_BOOTH,
+    ROOM_TESTING_TRACK,
+    ROOM_OFFICE,
+    ROOM_TOOL_ROOM,
+    ROOM_COMPUTER_LAB,
+    ROOM_SHOWROOM,
+    ROOM_COUNT
+} RoomID;
+
+typedef enum {
+    DIR_NORTH,
+    DIR_SOUTH,
+    DIR_EAST,
+    DIR_WEST,
+    DIR_COUNT
+} Direction;
+
+typedef enum {
+    VEHICLE_NONE,
+    VEHICLE_SPORTS_CAR,
+    VEHICLE_TRUCK,
+    VEHICLE_MOTORCYCLE,
+    VEHICLE_RACE_CAR,
+    VEHICLE_CLASSIC_CAR
+} VehicleType;
+
+typedef enum {
+    PART_ENGINE,
+    PART_TRANSMISSION,
+    PART_WHEELS,
+    PART_BRAKES,
+    PART_SUSPENSION,
+    PART_TURBOCHARGER,
+    PART_EXHAUST,
+    PART_ECU
+} PartType;
+
+typedef enum {
+    VERB_UNKNOWN,
+    VERB_GO,
+    VERB_LOOK,
+    VERB_EXAMINE,
+    VERB_INVENTORY,
+    VERB_TAKE,
+    VERB_DROP,
+    VERB_USE,
+    VERB_INSTALL,
+    VERB_CALCULATE,
+    VERB_OPTIMIZE,
+    VERB_PATH,
+    VERB_NAVIGATE,
+    VERB_TUNE,
+    VERB_LOCK,
+    VERB_UNLOCK,
+    VERB_HELP,
+    VERB_QUIT,
+    VERB_COUNT
+} Verb;
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+typedef struct {
+    double x;
+    double y;
+} Point2D;
+
+typedef struct {
+    char name[MAX_NAME];
+    PartType type;
+    double weight;      // kg
+    double cost;        // dollars
+    int performance_boost;  // percentage
+    bool installed;
+} Part;
+
+typedef struct {
+    char name[MAX_NAME];
+    VehicleType type;
+    double mass;           // kg
+    double engine_power;   // horsepower
+    double drag_coefficient;  // Cd
+    double frontal_area;   // m²
+    double max_speed;      // m/s
+    double acceleration;   // m/s²
+    int parts_count;
+    Part parts[MAX_PARTS];
+} Vehicle;
+
+typedef struct {
+    Vehicle vehicles[MAX_VEHICLES];
+    int vehicle_count;
+    Part loose_parts[MAX_PARTS];
+    int loose_parts_count;
+    int money;
+} GarageInventory;
+
+typedef struct {
+    RoomID id;
+    char name[MAX_NAME];
+    char description[MAX_DESCRIPTION];
+    RoomID connections[DIR_COUNT];
+    Point2D coordinates;  // For pathfinding
+    bool has_vehicle_access;
+    bool has_computer;
+} Room;
+
+typedef struct {
+    Verb verb;
+    char object[MAX_INPUT];
+    char target[MAX_INPUT];
+    Direction direction;
+} Command;
+
+// Time spent parsing and executing each kind of command (see --replay)
+typedef struct {
+    long long count[VERB_COUNT];
+    double seconds[VERB_COUNT];
+} CommandTimes;
+
+// ============================================================================
+// GLOBAL GAME STATE
+// ============================================================================
+
+typedef struct {
+    Room rooms[MAX_ROOMS];
+    RoomID current_room;
+    GarageInventory garage;
+    Vehicle *current_vehicle;
+    bool running;
+    int moves_count;
+    bool locked[MAX_ROOMS][DIR_COUNT];  // Doors closed with 'lock'
+    PathGraph room_graph;     // Open connections in CSR form
+    PathSearch room_search;
+    PathRoutes room_routes;   // Next-hop table used by navigate
+    HpaMap room_hpa;          // Cluster hierarchy used by 'navigate <room> hpa'
+    FILE *input;              // Commands and prompt answers; stdin unless replaying
+    FILE *record;             // Copy of every line read, for --record; may be null
+    CommandTimes *times;      // Per-verb timing, for --replay; may be null
+} GameState;
+
+// ============================================================================
+// FUNCTION PROTOTYPES
+// ============================================================================
+
+// Initialization
+void init_game(GameState *game);
+void init_rooms(Room rooms[]);
+void init_garage(GarageInventory *garage);
+
+// Game loop
+void game_loop(GameState *game);
+bool read_line(GameState *game, char buffer[], int size);
+bool parse_command(const char *input, Command *cmd);
+void execute_command(GameState *game, const Command *cmd);
+
+// Commands
+void cmd_go(GameState *game, Direction dir);
+void cmd_look(GameState *game);
+void cmd_examine(GameState *game, const char *object);
+void cmd_inventory(GameState *game);
+void cmd_take(GameState *game, const char *object);
+void cmd_install(GameState *game, const char *part_name);
+void cmd_calculate(GameState *game, const char *calc_type);
+void cmd_optimize(GameState *game, const char *metric_name, const char *action);
+void install_part(Vehicle *v, Part *part);
+void cmd_navigate(GameState *game, const char *destination, const char *mode);
+void cmd_lock(GameState *game, Direction dir, bool lock);
+void cmd_help(void);
+
+// Physics calculations
+double calculate_terminal_velocity(const Vehicle *v);
+double calculate_acceleration_time(const Vehicle *v, double target_speed);
+double calculate_braking_distance(const Vehicle *v, double initial_speed);
+double calculate_drag_force(const Vehicle *v, double velocity);
+double calculate_power_required(const Vehicle *v, double velocity);
+double calculate_lap_time(const Vehicle *v, double track_length, int turns);
+FleetVehicle vehicle_physics(const Vehicle *v);
+double simulate_acceleration_time(const Vehicle *v, double target_speed);
+double simulate_lap_time(const Vehicle *v);
+double simulated_launch(const FleetVehicle *physics);
+double simulated_lap(const FleetVehicle *physics);
+void calculate_fleet(const GarageInventory *garage);
+
+// Pathfinding algorithms
+double heuristic_distance(Point2D a, Point2D b);
+bool build_room_graph(const GameState *game, PathGraph *graph);
+void print_path(const Room rooms[], const RoomID path[], int path_length);
+
+// Utilities
+const char* direction_to_string(Direction dir);
+Direction string_to_direction(const char *str);
+const char* vehicle_type_to_string(VehicleType type);
+const char* part_type_to_string(PartType type);
+const char* verb_to_string(Verb verb);
+void to_lowercase(char *str);
+void print_separator(void);
+int world_command(int argc, char *argv[]);
+void free_game(GameState *game);
+int replay_script(const char *path, int rounds, const char *expected_hash);
+
+#endif // GARAGE_GAME_H
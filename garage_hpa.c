@@ -0,0 +1,407 @@
+/*
+ * GARAGE HIERARCHICAL PATHFINDING - clusters, entrances, abstract graph
+ */
+
+#include "garage_hpa.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Crossing edges per entrance: along a long border, one crossing in every
+// run of this many becomes an entrance
+constexpr int ENTRANCE_WIDTH = 6;
+
+typedef struct {
+    int from;
+    int to;
+    double weight;
+    int from_component;     // Connected piece of each endpoint's cluster
+    int to_component;
+    double position;        // Where along the border the crossing lies
+} Crossing;
+
+typedef struct {
+    PathEdge *edges;
+    int count;
+    int capacity;
+} EdgeBuffer;
+
+static bool edge_buffer_add(EdgeBuffer *buffer, int from, int to, double weight) {
+    if (buffer->count == buffer->capacity) {
+        int capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        PathEdge *grown = realloc(buffer->edges, (size_t)capacity * sizeof(PathEdge));
+        if (grown == nullptr) return false;
+        buffer->edges = grown;
+        buffer->capacity = capacity;
+    }
+    buffer->edges[buffer->count++] = (PathEdge){ .from = from, .to = to, .weight = weight };
+    return true;
+}
+
+static int compare_crossings(const void *a, const void *b) {
+    const Crossing *x = a, *y = b;
+    if (x->from_component != y->from_component) return x->from_component < y->from_component ? -1 : 1;
+    if (x->to_component != y->to_component) return x->to_component < y->to_component ? -1 : 1;
+    return (x->position > y->position) - (x->position < y->position);
+}
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+static void assign_clusters(HpaMap *map, const PathGraph *graph, double cluster_size) {
+    double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    for (int n = 0; n < graph->node_count; n++) {
+        if (n == 0 || graph->x[n] < min_x) min_x = graph->x[n];
+        if (n == 0 || graph->y[n] < min_y) min_y = graph->y[n];
+        if (n == 0 || graph->x[n] > max_x) max_x = graph->x[n];
+        if (n == 0 || graph->y[n] > max_y) max_y = graph->y[n];
+    }
+
+    int columns = (int)floor((max_x - min_x) / cluster_size) + 1;
+    int rows = (int)floor((max_y - min_y) / cluster_size) + 1;
+    map->cluster_count = columns * rows;
+
+    for (int n = 0; n < graph->node_count; n++) {
+        int column = (int)floor((graph->x[n] - min_x) / cluster_size);
+        int row = (int)floor((graph->y[n] - min_y) / cluster_size);
+        map->cluster[n] = row * columns + column;
+    }
+}
+
+// Label the connected pieces of every cluster (breadth-first, never leaving
+// the cluster). Keeping one entrance per pair of pieces, rather than per
+// pair of clusters, is what keeps every reachable goal reachable.
+static int label_components(const HpaMap *map, const PathGraph *graph, int component[], int queue[]) {
+    int count = 0;
+    for (int n = 0; n < graph->node_count; n++) component[n] = -1;
+
+    for (int seed = 0; seed < graph->node_count; seed++) {
+        if (component[seed] >= 0) continue;
+
+        int head = 0, tail = 0;
+        component[seed] = count;
+        queue[tail++] = seed;
+
+        while (head < tail) {
+            int node = queue[head++];
+            for (int e = graph->offsets[node]; e < graph->offsets[node + 1]; e++) {
+                int neighbor = graph->targets[e];
+                if (component[neighbor] >= 0 || map->cluster[neighbor] != map->cluster[seed]) continue;
+                component[neighbor] = count;
+                queue[tail++] = neighbor;
+            }
+        }
+        count++;
+    }
+    return count;
+}
+
+static Crossing* collect_crossings(const HpaMap *map, const PathGraph *graph,
+                                   const int component[], int *crossing_count) {
+    int count = 0;
+    for (int n = 0; n < graph->node_count; n++) {
+        for (int e = graph->offsets[n]; e < graph->offsets[n + 1]; e++) {
+            if (map->cluster[n] < map->cluster[graph->targets[e]]) count++;
+        }
+    }
+
+    Crossing *crossings = malloc(((size_t)count + 1) * sizeof(Crossing));
+    if (crossings == nullptr) return nullptr;
+
+    // Each undirected crossing once, from the lower-numbered cluster
+    count = 0;
+    for (int n = 0; n < graph->node_count; n++) {
+        for (int e = graph->offsets[n]; e < graph->offsets[n + 1]; e++) {
+            int to = graph->targets[e];
+            if (map->cluster[n] >= map->cluster[to]) continue;
+
+            crossings[count++] = (Crossing){
+                .from = n,
+                .to = to,
+                .weight = graph->weights[e],
+                .from_component = component[n],
+                .to_component = component[to],
+                .position = graph->x[n] + graph->x[to] + graph->y[n] + graph->y[to]
+            };
+        }
+    }
+
+    qsort(crossings, (size_t)count, sizeof(Crossing), compare_crossings);
+    *crossing_count = count;
+    return crossings;
+}
+
+static int entrance_node(HpaMap *map, int abstract_of[], int node) {
+    if (abstract_of[node] < 0) {
+        abstract_of[node] = map->abstract_count;
+        map->node_of[map->abstract_count++] = node;
+    }
+    return abstract_of[node];
+}
+
+// Pick entrances from the sorted crossings: runs of equal component pairs,
+// one crossing from the middle of every ENTRANCE_WIDTH
+static bool add_entrances(HpaMap *map, EdgeBuffer *edges, int abstract_of[],
+                          const Crossing crossings[], int crossing_count) {
+    int run_start = 0;
+    while (run_start < crossing_count) {
+        int run_end = run_start + 1;
+        while (run_end < crossing_count &&
+               crossings[run_end].from_component == crossings[run_start].from_component &&
+               crossings[run_end].to_component == crossings[run_start].to_component) {
+            run_end++;
+        }
+
+        for (int chunk = run_start; chunk < run_end; chunk += ENTRANCE_WIDTH) {
+            int width = run_end - chunk < ENTRANCE_WIDTH ? run_end - chunk : ENTRANCE_WIDTH;
+            const Crossing *c = &crossings[chunk + width / 2];
+            int a = entrance_node(map, abstract_of, c->from);
+            int b = entrance_node(map, abstract_of, c->to);
+
+            if (!edge_buffer_add(edges, a, b, c->weight) || !edge_buffer_add(edges, b, a, c->weight)) {
+                return false;
+            }
+        }
+        run_start = run_end;
+    }
+    return true;
+}
+
+static bool group_members(HpaMap *map) {
+    map->cluster_offsets = calloc((size_t)map->cluster_count + 1, sizeof(int));
+    map->members = malloc(((size_t)map->abstract_count + 1) * sizeof(int));
+    if (map->cluster_offsets == nullptr || map->members == nullptr) return false;
+
+    for (int a = 0; a < map->abstract_count; a++) {
+        map->cluster_offsets[map->cluster[map->node_of[a]] + 1]++;
+    }
+    for (int c = 0; c < map->cluster_count; c++) {
+        int size = map->cluster_offsets[c + 1];
+        if (size + 1 > map->start_slots) map->start_slots = size + 1;
+        map->cluster_offsets[c + 1] += map->cluster_offsets[c];
+    }
+
+    int *fill = malloc(((size_t)map->cluster_count + 1) * sizeof(int));
+    if (fill == nullptr) return false;
+    memcpy(fill, map->cluster_offsets, (size_t)map->cluster_count * sizeof(int));
+    for (int a = 0; a < map->abstract_count; a++) {
+        map->members[fill[map->cluster[map->node_of[a]]]++] = a;
+    }
+    free(fill);
+    return true;
+}
+
+// Shortest in-cluster path between every two entrances of each cluster
+static bool add_intra_edges(HpaMap *map, EdgeBuffer *edges, const PathGraph *graph, PathSearch *search) {
+    for (int c = 0; c < map->cluster_count; c++) {
+        for (int i = map->cluster_offsets[c]; i < map->cluster_offsets[c + 1]; i++) {
+            int a = map->members[i];
+            path_dijkstra_within(graph, search, map->node_of[a], -1, map->cluster);
+
+            for (int j = map->cluster_offsets[c]; j < map->cluster_offsets[c + 1]; j++) {
+                int b = map->members[j];
+                double cost = path_cost(search, map->node_of[b]);
+                if (a == b || cost == PATH_UNREACHABLE) continue;
+                if (!edge_buffer_add(edges, a, b, cost)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Everything after cluster assignment; component and scratch hold one int
+// per map node
+static bool build_levels(HpaMap *map, const PathGraph *graph, PathSearch *search,
+                         int component[], int scratch[]) {
+    label_components(map, graph, component, scratch);
+
+    int crossing_count = 0;
+    Crossing *crossings = collect_crossings(map, graph, component, &crossing_count);
+    if (crossings == nullptr) return false;
+
+    // scratch now maps map nodes to entrances
+    EdgeBuffer edges = {};
+    for (int n = 0; n < graph->node_count; n++) scratch[n] = -1;
+    bool ok = add_entrances(map, &edges, scratch, crossings, crossing_count) &&
+              group_members(map) &&
+              add_intra_edges(map, &edges, graph, search);
+    free(crossings);
+
+    // Every entrance ends with a spare edge (a harmless self-loop) that a
+    // query points at the goal; the start node gets start_slots of them
+    int start_node = map->abstract_count;
+    for (int a = 0; ok && a < map->abstract_count; a++) {
+        ok = edge_buffer_add(&edges, a, a, 0.0);
+    }
+    for (int i = 0; ok && i < map->start_slots; i++) {
+        ok = edge_buffer_add(&edges, start_node, start_node, 0.0);
+    }
+
+    ok = ok && path_graph_build(&map->abstract, map->abstract_count + 2, edges.edges, edges.count);
+    free(edges.edges);
+    if (!ok) return false;
+
+    for (int a = 0; a < map->abstract_count; a++) {
+        map->abstract.x[a] = graph->x[map->node_of[a]];
+        map->abstract.y[a] = graph->y[map->node_of[a]];
+    }
+
+    map->route = malloc(((size_t)map->abstract_count + 2) * sizeof(int));
+    return map->route != nullptr &&
+           path_search_init(&map->abstract_search, map->abstract_count + 2);
+}
+
+bool hpa_build(HpaMap *map, const PathGraph *graph, PathSearch *search, double cluster_size) {
+    int n = graph->node_count;
+    *map = (HpaMap){
+        .node_count = n,
+        .cluster = malloc(((size_t)n + 1) * sizeof(int)),
+        .node_of = malloc(((size_t)n + 1) * sizeof(int))
+    };
+
+    int *component = malloc(((size_t)n + 1) * sizeof(int));
+    int *scratch = malloc(((size_t)n + 1) * sizeof(int));
+    bool ok = map->cluster != nullptr && map->node_of != nullptr &&
+              component != nullptr && scratch != nullptr &&
+              search->capacity >= n && cluster_size > 0;
+
+    if (ok) {
+        assign_clusters(map, graph, cluster_size);
+        ok = build_levels(map, graph, search, component, scratch);
+    }
+
+    free(component);
+    free(scratch);
+    if (!ok) hpa_free(map);
+    return ok;
+}
+
+void hpa_free(HpaMap *map) {
+    free(map->cluster);
+    free(map->cluster_offsets);
+    free(map->members);
+    free(map->node_of);
+    free(map->route);
+    path_graph_free(&map->abstract);
+    path_search_free(&map->abstract_search);
+    *map = (HpaMap){};
+}
+
+size_t hpa_memory(const HpaMap *map) {
+    size_t abstract_nodes = (size_t)map->abstract_count + 2;
+    size_t abstract_edges = (size_t)map->abstract.edge_count;
+
+    return (size_t)map->node_count * sizeof(int)                        // cluster
+         + ((size_t)map->cluster_count + 1) * sizeof(int)               // cluster_offsets
+         + abstract_nodes * 3 * sizeof(int)                             // members, node_of, route
+         + (abstract_nodes + 1) * (sizeof(int) + 2 * sizeof(double))    // offsets, x, y
+         + abstract_edges * (sizeof(int) + sizeof(double))              // targets, weights
+         + abstract_nodes * (3 * sizeof(int) + 2 * sizeof(unsigned) + 2 * sizeof(double));
+}
+
+// ============================================================================
+// QUERY
+// ============================================================================
+
+static inline int spare_slot(const PathGraph *abstract, int node) {
+    return abstract->offsets[node + 1] - 1;
+}
+
+static void set_edge(PathGraph *abstract, int slot, int target, double weight) {
+    abstract->targets[slot] = target;
+    abstract->weights[slot] = weight;
+}
+
+int hpa_find_path(HpaMap *map, const PathGraph *graph, PathSearch *search,
+                  int start, int goal, int path[], int max_nodes, double *cost) {
+    map->expanded = 0;
+    if (start < 0 || goal < 0 || start >= map->node_count || goal >= map->node_count ||
+        max_nodes < 1) {
+        return -1;
+    }
+    if (start == goal) {
+        path[0] = start;
+        *cost = 0.0;
+        return 1;
+    }
+
+    PathGraph *abstract = &map->abstract;
+    int start_node = map->abstract_count;
+    int goal_node = start_node + 1;
+    int start_cluster = map->cluster[start];
+    int goal_cluster = map->cluster[goal];
+    int first_slot = abstract->offsets[start_node];
+    int slots = 0;
+
+    abstract->x[start_node] = graph->x[start];
+    abstract->y[start_node] = graph->y[start];
+    abstract->x[goal_node] = graph->x[goal];
+    abstract->y[goal_node] = graph->y[goal];
+
+    // Link start to its cluster's entrances, and straight to the goal when
+    // both share a cluster
+    if (start_cluster == goal_cluster) {
+        double direct = path_astar_within(graph, search, start, goal, map->cluster);
+        map->expanded += search->expanded;
+        if (direct != PATH_UNREACHABLE) set_edge(abstract, first_slot + slots++, goal_node, direct);
+    }
+
+    path_dijkstra_within(graph, search, start, -1, map->cluster);
+    map->expanded += search->expanded;
+    for (int i = map->cluster_offsets[start_cluster]; i < map->cluster_offsets[start_cluster + 1]; i++) {
+        double link = path_cost(search, map->node_of[map->members[i]]);
+        if (link != PATH_UNREACHABLE) set_edge(abstract, first_slot + slots++, map->members[i], link);
+    }
+
+    // Link the goal cluster's entrances to the goal (edges are symmetric,
+    // so searching out from the goal gives the costs into it)
+    path_dijkstra_within(graph, search, goal, -1, map->cluster);
+    map->expanded += search->expanded;
+    for (int i = map->cluster_offsets[goal_cluster]; i < map->cluster_offsets[goal_cluster + 1]; i++) {
+        int a = map->members[i];
+        double link = path_cost(search, map->node_of[a]);
+        if (link != PATH_UNREACHABLE) set_edge(abstract, spare_slot(abstract, a), goal_node, link);
+    }
+
+    double total = path_astar(abstract, &map->abstract_search, start_node, goal_node);
+    map->expanded += map->abstract_search.expanded;
+    int hops = path_extract(&map->abstract_search, goal_node, map->route, map->abstract_count + 2);
+
+    // Put the spare edges back
+    for (int i = 0; i < slots; i++) set_edge(abstract, first_slot + i, start_node, 0.0);
+    for (int i = map->cluster_offsets[goal_cluster]; i < map->cluster_offsets[goal_cluster + 1]; i++) {
+        int a = map->members[i];
+        set_edge(abstract, spare_slot(abstract, a), a, 0.0);
+    }
+
+    if (total == PATH_UNREACHABLE || hops < 0) return -1;
+
+    // Refine: hops between clusters are single map edges; hops inside a
+    // cluster are expanded with a search that stays in that cluster
+    int length = 0;
+    path[length++] = start;
+
+    for (int h = 1; h < hops; h++) {
+        int from = path[length - 1];
+        int to = map->route[h] == goal_node ? goal : map->node_of[map->route[h]];
+        if (from == to) continue;
+
+        if (map->cluster[from] != map->cluster[to]) {
+            if (length == max_nodes) return -1;
+            path[length++] = to;
+            continue;
+        }
+
+        path_astar_within(graph, search, from, to, map->cluster);
+        map->expanded += search->expanded;
+
+        // The segment starts with from, which is already in place
+        int segment = path_extract(search, to, path + length - 1, max_nodes - length + 1);
+        if (segment < 0) return -1;
+        length += segment - 1;
+    }
+
+    *cost = total;
+    return length;
+}
@@ -0,0 +1,56 @@
+/*
+ * GARAGE HIERARCHICAL PATHFINDING (HPA*)
+ * ======================================
+ *
+ * Flat A* on a million-node map settles a large share of the map for a long
+ * route. HPA* cuts the map into square clusters of cluster_size x
+ * cluster_size coordinate units and precomputes, once:
+ *
+ *   - entrances: a few of the edges that cross between neighboring clusters,
+ *     whose endpoints become the nodes of a small abstract graph
+ *   - abstract edges: the entrance edges themselves, plus the shortest path
+ *     cost between every two entrance nodes of the same cluster
+ *
+ * A query links start and goal to the entrances of their clusters, runs A*
+ * on the abstract graph and then refines each abstract hop with an A*
+ * search confined to one cluster. Routes are at most a few percent longer
+ * than optimal; the answer is never "unreachable" when a route exists.
+ *
+ * The map must be undirected (every edge has a twin of equal weight), as
+ * the room graph and all generated worlds are.
+ */
+
+#ifndef GARAGE_HPA_H
+#define GARAGE_HPA_H
+
+#include "garage_path.h"
+
+typedef struct {
+    int node_count;         // Nodes in the underlying map
+    int cluster_count;
+    int *cluster;           // Cluster of every map node
+    int *cluster_offsets;   // Entrances of cluster c: members[cluster_offsets[c] .. [c + 1])
+    int *members;
+    int abstract_count;     // Entrance nodes; start and goal use the two after them
+    int *node_of;           // Map node behind each entrance
+    int start_slots;        // Edges reserved for linking the start node
+    int *route;             // Scratch for the abstract route
+    PathGraph abstract;
+    PathSearch abstract_search;
+    int expanded;           // Nodes settled by the last query, all levels
+} HpaMap;
+
+// Build the hierarchy over graph. search is scratch space with capacity for
+// graph. Returns false when out of memory.
+bool hpa_build(HpaMap *map, const PathGraph *graph, PathSearch *search, double cluster_size);
+void hpa_free(HpaMap *map);
+
+// Route from start to goal into path[]; returns its node count and stores
+// its length in *cost, or -1 if goal is unreachable or max_nodes too small
+int hpa_find_path(HpaMap *map, const PathGraph *graph, PathSearch *search,
+                  int start, int goal, int path[], int max_nodes, double *cost);
+
+// Bytes held by the hierarchy (not counting the caller's PathSearch)
+size_t hpa_memory(const HpaMap *map);
+
+#endif // GARAGE_HPA_H
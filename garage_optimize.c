@@ -0,0 +1,340 @@
+/*
+ * GARAGE PARTS OPTIMIZER - memoized branch and bound over part assignments
+ */
+
+#include "garage_optimize.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+constexpr int TABLE_BLOCK = 256;        // Table entries claimed per task
+constexpr int TASKS_PER_THREAD = 16;    // Search subtrees per thread, for balance
+
+typedef struct {
+    // Problem, parts sorted by descending cost
+    const FleetVehicle *vehicles;
+    int vehicle_count;
+    OptPart parts[OPT_MAX_PARTS];
+    int order[OPT_MAX_PARTS];           // Sorted position -> caller's index
+    int part_count;
+    double budget;
+    OptMetricFn metric;
+
+    // reach[v][(1 << k) - 1 + mask]: best metric for vehicle v holding
+    // exactly `mask` of parts 0..k-1 and any of parts k..count-1.
+    // Level k = part_count is the metric itself.
+    double **reach;
+
+    // Work distribution
+    atomic_llong next_task;
+    long long task_count;
+    int prefix_depth;                   // Parts fixed by each search task
+
+    // Best so far; value readable without the lock
+    pthread_mutex_t lock;
+    _Atomic double best_value;
+    int best_assignment[OPT_MAX_PARTS];
+    double best_cost;
+} OptProblem;
+
+// Each worker on its own cache lines: the node counter changes constantly
+typedef struct {
+    alignas(64) OptProblem *problem;
+    unsigned masks[OPT_MAX_VEHICLES];
+    int assignment[OPT_MAX_PARTS];
+    long long nodes;
+    long long evaluations;
+    pthread_t thread;
+} OptWorker;
+
+static double clock_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+FleetVehicle opt_equip(const FleetVehicle *vehicle, const OptPart parts[], unsigned mask) {
+    FleetVehicle equipped = *vehicle;
+    for (int p = 0; mask != 0; p++, mask >>= 1) {
+        if ((mask & 1u) == 0) continue;
+        equipped.engine_power *= 1.0 + parts[p].performance_boost / 100.0;
+        equipped.max_speed *= 1.0 + parts[p].performance_boost / 200.0;
+        equipped.mass += parts[p].weight;
+    }
+    return equipped;
+}
+
+// Run fn on thread_count workers; the last one runs on the calling thread
+static bool run_workers(OptWorker workers[], int thread_count, void *(*fn)(void *)) {
+    int started = 0;
+    bool ok = true;
+    for (int t = 0; t < thread_count - 1; t++) {
+        if (pthread_create(&workers[t].thread, nullptr, fn, &workers[t]) != 0) {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+
+    if (ok) fn(&workers[thread_count - 1]);
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t].thread, nullptr);
+    }
+    return ok;
+}
+
+// ============================================================================
+// MEMO TABLE
+// ============================================================================
+
+static inline double* reach_level(const OptProblem *problem, int vehicle, int level) {
+    return problem->reach[vehicle] + ((size_t)1 << level) - 1;
+}
+
+static void* fill_metrics(void *user_data) {
+    OptWorker *worker = user_data;
+    OptProblem *problem = worker->problem;
+    long long subsets = 1LL << problem->part_count;
+
+    long long first;
+    while ((first = atomic_fetch_add(&problem->next_task, TABLE_BLOCK)) < problem->task_count) {
+        long long last = first + TABLE_BLOCK;
+        if (last > problem->task_count) last = problem->task_count;
+
+        for (long long i = first; i < last; i++) {
+            int v = (int)(i / subsets);
+            unsigned mask = (unsigned)(i % subsets);
+            FleetVehicle equipped = opt_equip(&problem->vehicles[v], problem->parts, mask);
+            reach_level(problem, v, problem->part_count)[mask] = problem->metric(&equipped);
+            worker->evaluations++;
+        }
+    }
+    return nullptr;
+}
+
+// Fold the metric level down: a vehicle at level k may or may not get part k
+static void fold_levels(OptProblem *problem) {
+    for (int v = 0; v < problem->vehicle_count; v++) {
+        for (int k = problem->part_count - 1; k >= 0; k--) {
+            const double *above = reach_level(problem, v, k + 1);
+            double *level = reach_level(problem, v, k);
+            unsigned with_part = 1u << k;
+
+            for (unsigned mask = 0; mask < with_part; mask++) {
+                double without = above[mask];
+                double with = above[mask | with_part];
+                level[mask] = with < without ? with : without;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// SEARCH
+// ============================================================================
+
+// Lower bound on every assignment below the current node at depth k
+static inline double node_bound(const OptWorker *worker, int k) {
+    const OptProblem *problem = worker->problem;
+    double sum = 0;
+    for (int v = 0; v < problem->vehicle_count; v++) {
+        sum += reach_level(problem, v, k)[worker->masks[v]];
+    }
+    return sum;
+}
+
+static void offer(OptWorker *worker, double value, double cost) {
+    OptProblem *problem = worker->problem;
+
+    pthread_mutex_lock(&problem->lock);
+    if (value < atomic_load(&problem->best_value)) {
+        atomic_store(&problem->best_value, value);
+        memcpy(problem->best_assignment, worker->assignment, sizeof(worker->assignment));
+        problem->best_cost = cost;
+    }
+    pthread_mutex_unlock(&problem->lock);
+}
+
+static void search(OptWorker *worker, int k, double cost, double bound) {
+    OptProblem *problem = worker->problem;
+    worker->nodes++;
+
+    if (bound >= atomic_load_explicit(&problem->best_value, memory_order_relaxed)) return;
+    if (k == problem->part_count) {
+        // Every part decided: the bound is the exact value
+        offer(worker, bound, cost);
+        return;
+    }
+
+    // Children: part k on each vehicle it is affordable for, or unused.
+    // Most promising first, so good assignments are found early.
+    int choices[OPT_MAX_VEHICLES + 1];
+    double bounds[OPT_MAX_VEHICLES + 1];
+    int count = 0;
+    unsigned bit = 1u << k;
+    double part_cost = problem->parts[k].cost;
+
+    for (int choice = OPT_UNUSED; choice < problem->vehicle_count; choice++) {
+        if (choice != OPT_UNUSED) {
+            if (cost + part_cost > problem->budget) break;
+            worker->masks[choice] |= bit;
+        }
+        double child = node_bound(worker, k + 1);
+        if (choice != OPT_UNUSED) worker->masks[choice] &= ~bit;
+
+        int at = count++;
+        while (at > 0 && bounds[at - 1] > child) {
+            bounds[at] = bounds[at - 1];
+            choices[at] = choices[at - 1];
+            at--;
+        }
+        bounds[at] = child;
+        choices[at] = choice;
+    }
+
+    for (int c = 0; c < count; c++) {
+        int choice = choices[c];
+        worker->assignment[k] = choice;
+        if (choice == OPT_UNUSED) {
+            search(worker, k + 1, cost, bounds[c]);
+        } else {
+            worker->masks[choice] |= bit;
+            search(worker, k + 1, cost + part_cost, bounds[c]);
+            worker->masks[choice] &= ~bit;
+        }
+    }
+    worker->assignment[k] = OPT_UNUSED;
+}
+
+// A task fixes the first prefix_depth parts (task index in base vehicles + 1)
+// and searches the subtree below
+static void* search_tasks(void *user_data) {
+    OptWorker *worker = user_data;
+    OptProblem *problem = worker->problem;
+    int radix = problem->vehicle_count + 1;
+
+    long long task;
+    while ((task = atomic_fetch_add(&problem->next_task, 1)) < problem->task_count) {
+        memset(worker->masks, 0, sizeof(worker->masks));
+        double cost = 0;
+
+        for (int k = 0; k < problem->prefix_depth; k++) {
+            int choice = (int)(task % radix) - 1;
+            task /= radix;
+            worker->assignment[k] = choice;
+            if (choice == OPT_UNUSED) continue;
+
+            cost += problem->parts[k].cost;
+            worker->masks[choice] |= 1u << k;
+        }
+        if (cost > problem->budget) continue;
+
+        search(worker, problem->prefix_depth, cost, node_bound(worker, problem->prefix_depth));
+    }
+    return nullptr;
+}
+
+// ============================================================================
+// DRIVER
+// ============================================================================
+
+bool opt_search(const FleetVehicle vehicles[], int vehicle_count,
+                const OptPart parts[], int part_count, double budget,
+                OptMetricFn metric, int thread_count, OptResult *result) {
+    *result = (OptResult){};
+    if (part_count < 0 || part_count > OPT_MAX_PARTS ||
+        vehicle_count < 1 || vehicle_count > OPT_MAX_VEHICLES) {
+        return false;
+    }
+    if (thread_count < 1) thread_count = 1;
+
+    OptProblem *problem = calloc(1, sizeof(OptProblem));
+    OptWorker *workers = aligned_alloc(alignof(OptWorker), (size_t)thread_count * sizeof(OptWorker));
+    double **reach = calloc((size_t)vehicle_count, sizeof(double *));
+    bool ok = problem != nullptr && workers != nullptr && reach != nullptr;
+
+    size_t table_size = ((size_t)2 << part_count) - 1;
+    for (int v = 0; ok && v < vehicle_count; v++) {
+        reach[v] = malloc(table_size * sizeof(double));
+        ok = reach[v] != nullptr;
+    }
+    if (!ok) {
+        for (int v = 0; reach != nullptr && v < vehicle_count; v++) free(reach[v]);
+        free(reach);
+        free(workers);
+        free(problem);
+        return false;
+    }
+
+    // Most expensive parts first, remembering where each came from
+    for (int p = 0; p < part_count; p++) {
+        int at = p;
+        while (at > 0 && parts[problem->order[at - 1]].cost < parts[p].cost) {
+            problem->order[at] = problem->order[at - 1];
+            at--;
+        }
+        problem->order[at] = p;
+    }
+    for (int s = 0; s < part_count; s++) problem->parts[s] = parts[problem->order[s]];
+
+    problem->vehicles = vehicles;
+    problem->vehicle_count = vehicle_count;
+    problem->part_count = part_count;
+    problem->budget = budget;
+    problem->metric = metric;
+    problem->reach = reach;
+    pthread_mutex_init(&problem->lock, nullptr);
+    for (int t = 0; t < thread_count; t++) {
+        workers[t] = (OptWorker){ .problem = problem };
+        for (int k = 0; k < OPT_MAX_PARTS; k++) workers[t].assignment[k] = OPT_UNUSED;
+    }
+
+    // Phase 1: the metric for every vehicle and subset of parts
+    double t0 = clock_seconds();
+    problem->task_count = (long long)vehicle_count << part_count;
+    atomic_init(&problem->next_task, 0);
+    ok = run_workers(workers, thread_count, fill_metrics);
+    fold_levels(problem);
+    result->table_seconds = clock_seconds() - t0;
+
+    // The empty assignment is the first incumbent
+    double baseline = 0;
+    for (int v = 0; v < vehicle_count; v++) baseline += reach_level(problem, v, part_count)[0];
+    atomic_init(&problem->best_value, baseline);
+    for (int k = 0; k < OPT_MAX_PARTS; k++) problem->best_assignment[k] = OPT_UNUSED;
+
+    // Phase 2: one subtree per task; a single thread searches from the root
+    t0 = clock_seconds();
+    long long tasks = 1;
+    problem->prefix_depth = 0;
+    while (thread_count > 1 && problem->prefix_depth < part_count &&
+           tasks < (long long)TASKS_PER_THREAD * thread_count) {
+        tasks *= vehicle_count + 1;
+        problem->prefix_depth++;
+    }
+    problem->task_count = tasks;
+    atomic_store(&problem->next_task, 0);
+    if (ok) ok = run_workers(workers, thread_count, search_tasks);
+    result->search_seconds = clock_seconds() - t0;
+
+    result->baseline = baseline;
+    result->value = atomic_load(&problem->best_value);
+    result->cost = problem->best_cost;
+    for (int k = 0; k < OPT_MAX_PARTS; k++) result->assignment[k] = OPT_UNUSED;
+    for (int s = 0; s < part_count; s++) {
+        result->assignment[problem->order[s]] = problem->best_assignment[s];
+    }
+    for (int t = 0; t < thread_count; t++) {
+        result->evaluations += workers[t].evaluations;
+        result->nodes += workers[t].nodes;
+    }
+
+    pthread_mutex_destroy(&problem->lock);
+    for (int v = 0; v < vehicle_count; v++) free(reach[v]);
+    free(reach);
+    free(workers);
+    free(problem);
+    return ok;
+}
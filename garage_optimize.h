@@ -0,0 +1,66 @@
+/*
+ * GARAGE PARTS OPTIMIZER - best use of the loose parts across the garage
+ * ======================================================================
+ *
+ * Every loose part either goes on one of the vehicles or stays on the
+ * shelf, and the parts bought must fit the budget. The optimizer finds
+ * the assignment that minimizes a metric (lap time, 0-60 time) summed
+ * over all vehicles.
+ *
+ * The (vehicles + 1)^parts assignments are searched depth first, one part
+ * per level, with branch and bound:
+ *
+ *   - A vehicle's performance depends only on which parts it carries, so
+ *     the metric is evaluated once per (vehicle, subset of parts) and
+ *     memoized: vehicles x 2^parts evaluations in total.
+ *   - From that table, a second table gives for every vehicle the best
+ *     metric it could still reach from the parts decided so far, if it
+ *     also got any mix of the parts not yet decided. Their sum is a lower
+ *     bound for the whole subtree; subtrees whose bound cannot beat the
+ *     best assignment found so far are skipped.
+ *   - Parts are searched most expensive first, so the budget cuts
+ *     branches near the root.
+ *
+ * Both the table and the search are split across threads.
+ */
+
+#ifndef GARAGE_OPTIMIZE_H
+#define GARAGE_OPTIMIZE_H
+
+#include "garage_fleet.h"
+
+#define OPT_MAX_PARTS 20        // The tables hold 2^(parts + 1) entries per vehicle
+#define OPT_MAX_VEHICLES 16
+#define OPT_UNUSED (-1)
+
+typedef struct {
+    double cost;                // dollars
+    double weight;              // kg
+    int performance_boost;      // percentage, applied as by cmd_install
+} OptPart;
+
+// Lower is better. Called from several threads at once.
+typedef double (*OptMetricFn)(const FleetVehicle *vehicle);
+
+typedef struct {
+    double value;                       // Summed metric of the best assignment
+    double baseline;                    // Summed metric with no parts installed
+    double cost;                        // What the best assignment spends
+    int assignment[OPT_MAX_PARTS];      // Vehicle index per part, or OPT_UNUSED
+    long long evaluations;              // Metric calls to fill the table
+    long long nodes;                    // Search nodes visited
+    double table_seconds;
+    double search_seconds;
+} OptResult;
+
+// The vehicle with the given parts installed
+FleetVehicle opt_equip(const FleetVehicle *vehicle, const OptPart parts[], unsigned mask);
+
+// Search every assignment of parts to vehicles that costs at most budget.
+// Returns false if there are too many parts or vehicles, memory runs out
+// or a thread could not be started.
+bool opt_search(const FleetVehicle vehicles[], int vehicle_count,
+                const OptPart parts[], int part_count, double budget,
+                OptMetricFn metric, int thread_count, OptResult *result);
+
+#endif // GARAGE_OPTIMIZE_H
@@ -0,0 +1,470 @@
+/*
+ * GARAGE PATHFINDING - CSR graph, indexed 4-ary heap, Dijkstra and A*
+ */
+
+#include "garage_path.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Children per heap node: shallower than a binary heap, and the four
+// children of a node share one or two cache lines
+constexpr int HEAP_ARITY = 4;
+
+// ============================================================================
+// GRAPH CONSTRUCTION
+// ============================================================================
+
+bool path_graph_build(PathGraph *graph, int node_count,
+                      const PathEdge edges[], int edge_count) {
+    *graph = (PathGraph){
+        .node_count = node_count,
+        .edge_count = edge_count,
+        .offsets = calloc((size_t)node_count + 1, sizeof(int)),
+        .targets = malloc(((size_t)edge_count + 1) * sizeof(int)),
+        .weights = malloc(((size_t)edge_count + 1) * sizeof(double)),
+        .x = calloc((size_t)node_count + 1, sizeof(double)),
+        .y = calloc((size_t)node_count + 1, sizeof(double))
+    };
+
+    if (graph->offsets == nullptr || graph->targets == nullptr ||
+        graph->weights == nullptr || graph->x == nullptr || graph->y == nullptr) {
+        path_graph_free(graph);
+        return false;
+    }
+
+    // Counting sort by source node: count, prefix-sum, then scatter
+    for (int i = 0; i < edge_count; i++) {
+        graph->offsets[edges[i].from + 1]++;
+    }
+    for (int n = 0; n < node_count; n++) {
+        graph->offsets[n + 1] += graph->offsets[n];
+    }
+
+    int *fill = malloc(((size_t)node_count + 1) * sizeof(int));
+    if (fill == nullptr) {
+        path_graph_free(graph);
+        return false;
+    }
+    memcpy(fill, graph->offsets, (size_t)node_count * sizeof(int));
+
+    for (int i = 0; i < edge_count; i++) {
+        int slot = fill[edges[i].from]++;
+        graph->targets[slot] = edges[i].to;
+        graph->weights[slot] = edges[i].weight;
+    }
+
+    free(fill);
+    return true;
+}
+
+void path_graph_free(PathGraph *graph) {
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->weights);
+    free(graph->x);
+    free(graph->y);
+    *graph = (PathGraph){};
+}
+
+// ============================================================================
+// SEARCH WORKSPACE
+// ============================================================================
+
+bool path_search_init(PathSearch *search, int capacity) {
+    *search = (PathSearch){
+        .capacity = capacity,
+        .stamp = calloc((size_t)capacity, sizeof(unsigned)),
+        .target_stamp = calloc((size_t)capacity, sizeof(unsigned)),
+        .cost = malloc((size_t)capacity * sizeof(double)),
+        .parent = malloc((size_t)capacity * sizeof(int)),
+        .heap = malloc((size_t)capacity * sizeof(int)),
+        .heap_pos = malloc((size_t)capacity * sizeof(int)),
+        .heap_key = malloc((size_t)capacity * sizeof(double))
+    };
+
+    if (search->stamp == nullptr || search->target_stamp == nullptr ||
+        search->cost == nullptr || search->parent == nullptr ||
+        search->heap == nullptr || search->heap_pos == nullptr || search->heap_key == nullptr) {
+        path_search_free(search);
+        return false;
+    }
+    return true;
+}
+
+void path_search_free(PathSearch *search) {
+    free(search->stamp);
+    free(search->target_stamp);
+    free(search->cost);
+    free(search->parent);
+    free(search->heap);
+    free(search->heap_pos);
+    free(search->heap_key);
+    *search = (PathSearch){};
+}
+
+static void begin_query(PathSearch *search) {
+    search->heap_size = 0;
+    search->expanded = 0;
+
+    // After 2^32 queries the stamps wrap around; clear them once
+    if (++search->generation == 0) {
+        memset(search->stamp, 0, (size_t)search->capacity * sizeof(unsigned));
+        memset(search->target_stamp, 0, (size_t)search->capacity * sizeof(unsigned));
+        search->generation = 1;
+    }
+}
+
+static inline bool seen(const PathSearch *search, int node) {
+    return search->stamp[node] == search->generation;
+}
+
+// ============================================================================
+// INDEXED 4-ARY HEAP
+// ============================================================================
+
+static inline void heap_place(PathSearch *s, int index, int node) {
+    s->heap[index] = node;
+    s->heap_pos[node] = index;
+}
+
+static void heap_sift_up(PathSearch *s, int index) {
+    int node = s->heap[index];
+    double key = s->heap_key[node];
+
+    while (index > 0) {
+        int parent = (index - 1) / HEAP_ARITY;
+        if (s->heap_key[s->heap[parent]] <= key) break;
+        heap_place(s, index, s->heap[parent]);
+        index = parent;
+    }
+    heap_place(s, index, node);
+}
+
+static void heap_sift_down(PathSearch *s, int index) {
+    int node = s->heap[index];
+    double key = s->heap_key[node];
+
+    while (true) {
+        int first = index * HEAP_ARITY + 1;
+        if (first >= s->heap_size) break;
+
+        int last = first + HEAP_ARITY;
+        if (last > s->heap_size) last = s->heap_size;
+
+        int best = first;
+        double best_key = s->heap_key[s->heap[first]];
+        for (int child = first + 1; child < last; child++) {
+            double child_key = s->heap_key[s->heap[child]];
+            if (child_key < best_key) {
+                best = child;
+                best_key = child_key;
+            }
+        }
+
+        if (best_key >= key) break;
+        heap_place(s, index, s->heap[best]);
+        index = best;
+    }
+    heap_place(s, index, node);
+}
+
+// Insert node, or lower its key if it is already queued
+static void heap_push_or_decrease(PathSearch *s, int node, double key) {
+    s->heap_key[node] = key;
+
+    if (s->heap_pos[node] < 0) {
+        s->heap_pos[node] = s->heap_size++;
+        s->heap[s->heap_pos[node]] = node;
+    }
+    heap_sift_up(s, s->heap_pos[node]);
+}
+
+static int heap_pop(PathSearch *s) {
+    int top = s->heap[0];
+    s->heap_pos[top] = -1;
+
+    if (--s->heap_size > 0) {
+        heap_place(s, 0, s->heap[s->heap_size]);
+        heap_sift_down(s, 0);
+    }
+    return top;
+}
+
+// ============================================================================
+// SEARCHES
+// ============================================================================
+
+static inline double goal_distance(const PathGraph *graph, int node, int goal) {
+    double dx = graph->x[node] - graph->x[goal];
+    double dy = graph->y[node] - graph->y[goal];
+    return sqrt(dx * dx + dy * dy);
+}
+
+// Queue start as the only node of a fresh query
+static void push_start(PathSearch *search, int start, double key) {
+    begin_query(search);
+
+    search->stamp[start] = search->generation;
+    search->cost[start] = 0.0;
+    search->parent[start] = -1;
+    search->heap_pos[start] = -1;
+    heap_push_or_decrease(search, start, key);
+}
+
+// Relax the edges out of a node just settled. With use_heuristic the heap
+// is keyed on cost + distance to goal instead of cost alone; with a region
+// map, edges leaving region `home` are ignored.
+static void relax_edges(const PathGraph *graph, PathSearch *search, int current, int goal,
+                        bool use_heuristic, const int region[], int home) {
+    double current_cost = search->cost[current];
+
+    for (int e = graph->offsets[current]; e < graph->offsets[current + 1]; e++) {
+        int neighbor = graph->targets[e];
+        double new_cost = current_cost + graph->weights[e];
+
+        if (region != nullptr && region[neighbor] != home) continue;
+
+        if (!seen(search, neighbor)) {
+            search->stamp[neighbor] = search->generation;
+            search->heap_pos[neighbor] = -1;
+        } else if (search->heap_pos[neighbor] < 0 || new_cost >= search->cost[neighbor]) {
+            // Settled, or no improvement
+            continue;
+        }
+
+        search->cost[neighbor] = new_cost;
+        search->parent[neighbor] = current;
+        heap_push_or_decrease(search, neighbor,
+                              use_heuristic ? new_cost + goal_distance(graph, neighbor, goal)
+                                            : new_cost);
+    }
+}
+
+// Shared Dijkstra / A* loop. With a region map the search never leaves
+// the region of the start node.
+static double search_graph(const PathGraph *graph, PathSearch *search, int start, int goal,
+                           bool use_heuristic, const int region[]) {
+    if (start < 0 || start >= graph->node_count || graph->node_count > search->capacity) {
+        return PATH_UNREACHABLE;
+    }
+
+    push_start(search, start, use_heuristic ? goal_distance(graph, start, goal) : 0.0);
+    int home = region != nullptr ? region[start] : 0;
+
+    while (search->heap_size > 0) {
+        int current = heap_pop(search);
+        search->expanded++;
+
+        if (current == goal) {
+            return search->cost[goal];
+        }
+        relax_edges(graph, search, current, goal, use_heuristic, region, home);
+    }
+
+    return goal < 0 ? 0.0 : PATH_UNREACHABLE;
+}
+
+double path_dijkstra(const PathGraph *graph, PathSearch *search, int start, int goal) {
+    return search_graph(graph, search, start, goal, false, nullptr);
+}
+
+double path_astar(const PathGraph *graph, PathSearch *search, int start, int goal) {
+    if (goal < 0 || goal >= graph->node_count) return PATH_UNREACHABLE;
+    return search_graph(graph, search, start, goal, true, nullptr);
+}
+
+double path_dijkstra_within(const PathGraph *graph, PathSearch *search,
+                            int start, int goal, const int region[]) {
+    return search_graph(graph, search, start, goal, false, region);
+}
+
+double path_astar_within(const PathGraph *graph, PathSearch *search,
+                         int start, int goal, const int region[]) {
+    if (goal < 0 || goal >= graph->node_count) return PATH_UNREACHABLE;
+    return search_graph(graph, search, start, goal, true, region);
+}
+
+int path_dijkstra_targets(const PathGraph *graph, PathSearch *search, int start,
+                          const int targets[], int target_count) {
+    if (start < 0 || start >= graph->node_count || graph->node_count > search->capacity) {
+        return 0;
+    }
+
+    push_start(search, start, 0.0);
+
+    // Tag the targets for this query; duplicates count once
+    int remaining = 0;
+    for (int t = 0; t < target_count; t++) {
+        int target = targets[t];
+        if (target < 0 || target >= graph->node_count ||
+            search->target_stamp[target] == search->generation) {
+            continue;
+        }
+        search->target_stamp[target] = search->generation;
+        remaining++;
+    }
+
+    int settled = 0;
+    while (search->heap_size > 0 && settled < remaining) {
+        int current = heap_pop(search);
+        search->expanded++;
+
+        if (search->target_stamp[current] == search->generation) settled++;
+        relax_edges(graph, search, current, -1, false, nullptr, 0);
+    }
+    return settled;
+}
+
+double path_cost(const PathSearch *search, int node) {
+    if (node < 0 || node >= search->capacity || !seen(search, node)) {
+        return PATH_UNREACHABLE;
+    }
+    return search->cost[node];
+}
+
+int path_extract(const PathSearch *search, int goal, int path[], int max_nodes) {
+    if (path_cost(search, goal) == PATH_UNREACHABLE) return -1;
+
+    int length = 0;
+    for (int node = goal; node != -1; node = search->parent[node]) {
+        if (length == max_nodes) return -1;
+        path[length++] = node;
+    }
+
+    // Collected goal-first; flip to start-first
+    for (int i = 0; i < length / 2; i++) {
+        int temp = path[i];
+        path[i] = path[length - 1 - i];
+        path[length - 1 - i] = temp;
+    }
+    return length;
+}
+
+// ============================================================================
+// ALL-PAIRS ROUTE TABLE
+// ============================================================================
+
+static bool build_reverse(const PathGraph *graph, PathGraph *reverse) {
+    PathEdge *edges = malloc(((size_t)graph->edge_count + 1) * sizeof(PathEdge));
+    if (edges == nullptr) return false;
+
+    for (int n = 0; n < graph->node_count; n++) {
+        for (int e = graph->offsets[n]; e < graph->offsets[n + 1]; e++) {
+            edges[e] = (PathEdge){ .from = graph->targets[e], .to = n, .weight = graph->weights[e] };
+        }
+    }
+
+    bool ok = path_graph_build(reverse, graph->node_count, edges, graph->edge_count);
+    free(edges);
+    return ok;
+}
+
+// Settle every node's route to destination in one search of the reversed
+// graph: there, a node's parent is its next hop towards destination
+static void compute_destination(PathRoutes *routes, PathSearch *search, int destination) {
+    int n = routes->node_count;
+    path_dijkstra(&routes->reverse, search, destination, -1);
+
+    for (int node = 0; node < n; node++) {
+        size_t cell = (size_t)node * n + destination;
+        if (seen(search, node)) {
+            routes->next_hop[cell] = node == destination ? destination : search->parent[node];
+            routes->distance[cell] = search->cost[node];
+        } else {
+            routes->next_hop[cell] = -1;
+            routes->distance[cell] = PATH_UNREACHABLE;
+        }
+    }
+}
+
+bool path_routes_build(PathRoutes *routes, const PathGraph *graph, PathSearch *search) {
+    int n = graph->node_count;
+    *routes = (PathRoutes){
+        .node_count = n,
+        .next_hop = malloc((size_t)n * n * sizeof(int) + 1),
+        .distance = malloc((size_t)n * n * sizeof(double) + 1)
+    };
+
+    if (routes->next_hop == nullptr || routes->distance == nullptr ||
+        search->capacity < n || !build_reverse(graph, &routes->reverse)) {
+        path_routes_free(routes);
+        return false;
+    }
+
+    for (int destination = 0; destination < n; destination++) {
+        compute_destination(routes, search, destination);
+    }
+    return true;
+}
+
+void path_routes_free(PathRoutes *routes) {
+    free(routes->next_hop);
+    free(routes->distance);
+    path_graph_free(&routes->reverse);
+    *routes = (PathRoutes){};
+}
+
+int path_routes_update(PathRoutes *routes, const PathGraph *graph, PathSearch *search,
+                       const PathEdge changes[], int change_count) {
+    int n = routes->node_count;
+    bool *stale = calloc((size_t)n + 1, sizeof(bool));
+    if (stale == nullptr) return -1;
+
+    // Judged against the old table. A destination is affected if one of
+    // its routes used a changed edge, or if a new or cheaper edge offers a
+    // shorter way there; every other column is still exact.
+    for (int c = 0; c < change_count; c++) {
+        int from = changes[c].from;
+        int to = changes[c].to;
+
+        for (int destination = 0; destination < n; destination++) {
+            if (stale[destination]) continue;
+
+            size_t from_cell = (size_t)from * n + destination;
+            double via = routes->distance[(size_t)to * n + destination];
+
+            if (routes->next_hop[from_cell] == to && from != destination) {
+                stale[destination] = true;
+            } else if (changes[c].weight >= 0 && via != PATH_UNREACHABLE) {
+                double old_distance = routes->distance[from_cell];
+                double new_distance = changes[c].weight + via;
+                stale[destination] = old_distance == PATH_UNREACHABLE || new_distance < old_distance;
+            }
+        }
+    }
+
+    path_graph_free(&routes->reverse);
+    if (!build_reverse(graph, &routes->reverse)) {
+        free(stale);
+        return -1;
+    }
+
+    int recomputed = 0;
+    for (int destination = 0; destination < n; destination++) {
+        if (!stale[destination]) continue;
+        compute_destination(routes, search, destination);
+        recomputed++;
+    }
+
+    free(stale);
+    return recomputed;
+}
+
+double path_routes_distance(const PathRoutes *routes, int from, int to) {
+    if (from < 0 || to < 0 || from >= routes->node_count || to >= routes->node_count) {
+        return PATH_UNREACHABLE;
+    }
+    return routes->distance[(size_t)from * routes->node_count + to];
+}
+
+int path_routes_walk(const PathRoutes *routes, int from, int to, int path[], int max_nodes) {
+    if (path_routes_distance(routes, from, to) == PATH_UNREACHABLE) return -1;
+
+    int length = 0;
+    for (int node = from; ; node = routes->next_hop[(size_t)node * routes->node_count + to]) {
+        if (length == max_nodes) return -1;
+        path[length++] = node;
+        if (node == to) return length;
+    }
+}
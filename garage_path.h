@@ -0,0 +1,118 @@
+/*
+ * GARAGE PATHFINDING - shortest paths over large sparse maps
+ * ==========================================================
+ *
+ * Graphs are stored in CSR (compressed sparse row) form: the outgoing edges
+ * of node n are targets[offsets[n] .. offsets[n + 1]) with matching weights.
+ * Searches keep their frontier in an indexed 4-ary heap with decrease-key,
+ * so one query costs O((V + E) log V) instead of the O(V²) linear scan.
+ *
+ * A PathSearch holds all per-node scratch arrays and can be reused for any
+ * number of queries on graphs up to its capacity; nothing is cleared between
+ * queries (entries are tagged with a generation counter instead), which keeps
+ * short queries on million-node maps cheap.
+ */
+
+#ifndef GARAGE_PATH_H
+#define GARAGE_PATH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Returned for unreachable goals
+#define PATH_UNREACHABLE (-1.0)
+
+typedef struct {
+    int from;
+    int to;
+    double weight;
+} PathEdge;
+
+typedef struct {
+    int node_count;
+    int edge_count;
+    int *offsets;       // node_count + 1 entries
+    int *targets;       // edge_count entries
+    double *weights;    // edge_count entries
+    double *x;          // Node coordinates for the A* heuristic
+    double *y;
+} PathGraph;
+
+typedef struct {
+    int capacity;
+    unsigned generation;
+    unsigned *stamp;    // stamp[n] == generation: cost/parent/heap_pos valid
+    unsigned *target_stamp; // target_stamp[n] == generation: n is a target
+    double *cost;       // Best known distance from the start
+    int *parent;
+    int *heap;          // Frontier, ordered by heap_key
+    int *heap_pos;      // Index in heap, or -1 once the node is settled
+    double *heap_key;
+    int heap_size;
+    int expanded;       // Nodes settled by the last query
+} PathSearch;
+
+// Build a CSR graph from an edge list. Coordinates start at zero; fill
+// graph->x / graph->y before running A*. Returns false when out of memory.
+bool path_graph_build(PathGraph *graph, int node_count,
+                      const PathEdge edges[], int edge_count);
+void path_graph_free(PathGraph *graph);
+
+bool path_search_init(PathSearch *search, int capacity);
+void path_search_free(PathSearch *search);
+
+// Shortest distance from start to goal, or PATH_UNREACHABLE. With goal < 0
+// every reachable node is settled (one-to-all); read them with path_cost().
+double path_dijkstra(const PathGraph *graph, PathSearch *search, int start, int goal);
+
+// Same result as path_dijkstra(), guided by the Euclidean distance to the
+// goal. Edge weights must be at least the distance between their endpoints.
+double path_astar(const PathGraph *graph, PathSearch *search, int start, int goal);
+
+// One-to-many Dijkstra that stops as soon as every target is settled
+// instead of exhausting the graph. Returns how many distinct targets were
+// reached; read their distances with path_cost() (other nodes may hold
+// tentative costs).
+int path_dijkstra_targets(const PathGraph *graph, PathSearch *search, int start,
+                          const int targets[], int target_count);
+
+// The same searches confined to the nodes n with region[n] == region[start]
+// (a cluster, a zone); a goal outside that region is unreachable
+double path_dijkstra_within(const PathGraph *graph, PathSearch *search,
+                            int start, int goal, const int region[]);
+double path_astar_within(const PathGraph *graph, PathSearch *search,
+                         int start, int goal, const int region[]);
+
+// Distance to node found by the last query, or PATH_UNREACHABLE
+double path_cost(const PathSearch *search, int node);
+
+// Write the route from the last query's start to goal into path[] and
+// return its node count; -1 if goal was not reached or max_nodes is too small
+int path_extract(const PathSearch *search, int goal, int path[], int max_nodes);
+
+// All-pairs route table for small, mostly static maps (n² entries). Built
+// with one Dijkstra per destination over the reversed graph; afterwards a
+// route is a chain of next-hop lookups, O(path length) per query.
+typedef struct {
+    int node_count;
+    int *next_hop;      // [from * node_count + to]: node after from, -1 if unreachable
+    double *distance;   // [from * node_count + to], PATH_UNREACHABLE if unreachable
+    PathGraph reverse;  // graph with every edge flipped
+} PathRoutes;
+
+bool path_routes_build(PathRoutes *routes, const PathGraph *graph, PathSearch *search);
+void path_routes_free(PathRoutes *routes);
+
+// Bring the table up to date after edges changed. graph is the rebuilt
+// graph; changes[] lists every edge that was added or re-weighted (new
+// weight) or removed (weight < 0). Only destinations whose routes could be
+// affected are recomputed; returns how many, or -1 when out of memory.
+int path_routes_update(PathRoutes *routes, const PathGraph *graph, PathSearch *search,
+                       const PathEdge changes[], int change_count);
+
+double path_routes_distance(const PathRoutes *routes, int from, int to);
+
+// Same contract as path_extract(), walking the next-hop table
+int path_routes_walk(const PathRoutes *routes, int from, int to, int path[], int max_nodes);
+
+#endif // GARAGE_PATH_H
@@ -0,0 +1,267 @@
+/*
+ * GARAGE SIMULATOR - RK4 integration of longitudinal vehicle dynamics
+ */
+
+#include "garage_sim.h"
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+constexpr double GRAVITY = 9.81;
+constexpr double AIR_DENSITY = 1.225;
+constexpr double WATTS_PER_HP = 745.7;
+constexpr double TIRE_GRIP = 1.0;               // Friction coefficient, road tires
+constexpr double ROLLING_RESISTANCE = 0.015;
+constexpr double DRIVETRAIN_EFFICIENCY = 0.85;
+constexpr double MIN_DRIVE_SPEED = 1.0;         // m/s; below this P / v is unbounded
+constexpr double LAUNCH_TIME_LIMIT = 120.0;     // s
+constexpr double LAP_TIME_LIMIT = 3600.0;       // s per lap
+
+// Per-vehicle constants, computed once per simulation
+typedef struct {
+    double mass;
+    double drive_power;     // W at the wheels
+    double drag_factor;     // F_drag = drag_factor * v²
+    double roll_force;
+    double grip_force;      // Most force the tires can transmit
+    double max_speed;       // Gearing / rev limit
+} SimCar;
+
+static SimCar make_car(const FleetVehicle *vehicle) {
+    return (SimCar){
+        .mass = vehicle->mass,
+        .drive_power = vehicle->engine_power * WATTS_PER_HP * DRIVETRAIN_EFFICIENCY,
+        .drag_factor = 0.5 * AIR_DENSITY * vehicle->drag_coefficient * vehicle->frontal_area,
+        .roll_force = ROLLING_RESISTANCE * vehicle->mass * GRAVITY,
+        .grip_force = TIRE_GRIP * vehicle->mass * GRAVITY,
+        .max_speed = vehicle->max_speed
+    };
+}
+
+// Acceleration at full throttle
+static inline double drive_accel(const SimCar *car, double v) {
+    double drive = car->drive_power / (v > MIN_DRIVE_SPEED ? v : MIN_DRIVE_SPEED);
+    if (drive > car->grip_force) drive = car->grip_force;
+
+    double resistance = car->drag_factor * v * v + car->roll_force;
+    // At the rev limit the engine only holds speed
+    if (v >= car->max_speed && drive > resistance) drive = resistance;
+
+    return (drive - resistance) / car->mass;
+}
+
+// One RK4 step of dv/dt = drive_accel(v), ds/dt = v. Returns the new speed
+// and stores the distance covered in *distance.
+static inline double rk4_drive(const SimCar *car, double v, double dt, double *distance) {
+    double k1 = drive_accel(car, v);
+    double v2 = v + 0.5 * dt * k1;
+    double k2 = drive_accel(car, v2);
+    double v3 = v + 0.5 * dt * k2;
+    double k3 = drive_accel(car, v3);
+    double v4 = v + dt * k3;
+    double k4 = drive_accel(car, v4);
+
+    *distance = dt / 6.0 * (v + 2.0 * v2 + 2.0 * v3 + v4);
+    return v + dt / 6.0 * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
+}
+
+// ============================================================================
+// TRACKS
+// ============================================================================
+
+int sim_track_build(SimSegment segments[], double track_length, int turns,
+                    double turn_length, double turn_radius) {
+    if (turns <= 0) {
+        segments[0] = (SimSegment){ .length = track_length, .radius = 0.0 };
+        return 1;
+    }
+
+    double straight = (track_length - turns * turn_length) / turns;
+    int count = 0;
+    for (int t = 0; t < turns; t++) {
+        if (straight > 0) segments[count++] = (SimSegment){ .length = straight, .radius = 0.0 };
+        segments[count++] = (SimSegment){ .length = turn_length, .radius = turn_radius };
+    }
+    return count;
+}
+
+// Highest speed allowed when entering each segment, so that braking at
+// full grip reaches every later corner at its limit. The track is a loop,
+// so two backward passes settle it.
+static void entry_limits(const SimTrack *track, const SimCar *car, double limit[], double entry[]) {
+    double brake = TIRE_GRIP * GRAVITY;
+
+    for (int i = 0; i < track->count; i++) {
+        double radius = track->segments[i].radius;
+        limit[i] = radius > 0 ? sqrt(TIRE_GRIP * GRAVITY * radius) : INFINITY;
+        if (limit[i] > car->max_speed) limit[i] = car->max_speed;
+        entry[i] = limit[i];
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = track->count - 1; i >= 0; i--) {
+            double next = entry[(i + 1) % track->count];
+            double reachable = sqrt(next * next + 2.0 * brake * track->segments[i].length);
+            if (reachable < entry[i]) entry[i] = reachable;
+        }
+    }
+}
+
+// ============================================================================
+// SIMULATIONS
+// ============================================================================
+
+double sim_launch_time(const FleetVehicle *vehicle, double target_speed, double dt, long long *steps) {
+    SimCar car = make_car(vehicle);
+    double v = 0.0, t = 0.0, distance;
+    long long taken = 0;
+
+    while (t < LAUNCH_TIME_LIMIT) {
+        double next = rk4_drive(&car, v, dt, &distance);
+        taken++;
+
+        if (next >= target_speed) {
+            // Speed is smooth within a step: interpolate the crossing
+            if (steps != nullptr) *steps = taken;
+            return t + dt * (target_speed - v) / (next - v);
+        }
+        if (next <= v) break;   // Top speed is below the target
+
+        v = next;
+        t += dt;
+    }
+
+    if (steps != nullptr) *steps = taken;
+    return -1.0;
+}
+
+SimResult sim_laps(const FleetVehicle *vehicle, const SimTrack *track, int laps, double dt) {
+    SimResult result = { .best_lap = -1.0 };
+    SimCar car = make_car(vehicle);
+
+    double *limit = malloc(2 * ((size_t)track->count + 1) * sizeof(double));
+    if (limit == nullptr || track->count == 0) {
+        free(limit);
+        return result;
+    }
+    double *entry = limit + track->count + 1;
+    entry_limits(track, &car, limit, entry);
+
+    double brake = TIRE_GRIP * GRAVITY;
+    double v = 0.0, t = 0.0, lap_start = 0.0, position = 0.0;
+    int segment = 0, lap = 0;
+
+    while (lap < laps && t - lap_start < LAP_TIME_LIMIT) {
+        const SimSegment *here = &track->segments[segment];
+        double next_entry = entry[(segment + 1) % track->count];
+        double remaining = here->length - position;
+
+        // Fastest speed from which the car can still brake for what is next
+        double allowed = sqrt(next_entry * next_entry + 2.0 * brake * remaining);
+        if (allowed > limit[segment]) allowed = limit[segment];
+
+        double distance;
+        double next;
+        if (v > allowed + 1e-9) {
+            // Braking at the grip limit: constant deceleration, exact
+            next = v - brake * dt;
+            if (next < 0) next = 0;
+            distance = 0.5 * (v + next) * dt;
+        } else {
+            next = rk4_drive(&car, v, dt, &distance);
+            // Hold the corner or braking-curve speed instead of overshooting it
+            if (next > allowed) {
+                next = allowed;
+                distance = 0.5 * (v + next) * dt;
+            }
+        }
+
+        result.steps++;
+        if (next > result.top_speed) result.top_speed = next;
+        position += distance;
+
+        while (position >= track->segments[segment].length) {
+            position -= track->segments[segment].length;
+            if (++segment < track->count) continue;
+
+            // Crossed the line: back out the part of the step beyond it
+            segment = 0;
+            double crossing = t + dt - (next > 0 ? position / next : 0.0);
+            double lap_time = crossing - lap_start;
+            if (result.best_lap < 0 || lap_time < result.best_lap) result.best_lap = lap_time;
+            lap_start = crossing;
+            if (++lap == laps) {
+                result.total_time = crossing;
+                break;
+            }
+        }
+
+        v = next;
+        t += dt;
+    }
+
+    free(limit);
+    return result;
+}
+
+// ============================================================================
+// PARALLEL BATCHES
+// ============================================================================
+
+typedef struct {
+    const FleetVehicle *vehicles;
+    SimResult *results;
+    int count;
+    const SimTrack *track;
+    int laps;
+    double dt;
+    pthread_t thread;
+} SimShare;
+
+static void* run_share(void *user_data) {
+    SimShare *share = user_data;
+    for (int i = 0; i < share->count; i++) {
+        share->results[i] = sim_laps(&share->vehicles[i], share->track, share->laps, share->dt);
+    }
+    return nullptr;
+}
+
+bool sim_laps_parallel(const FleetVehicle vehicles[], int count, const SimTrack *track,
+                       int laps, double dt, SimResult results[], int thread_count) {
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > count) thread_count = count > 0 ? count : 1;
+
+    SimShare *shares = calloc((size_t)thread_count, sizeof(SimShare));
+    if (shares == nullptr) return false;
+
+    int started = 0;
+    bool ok = true;
+    for (int t = 0; t < thread_count; t++) {
+        int first = (int)((long long)count * t / thread_count);
+        int last = (int)((long long)count * (t + 1) / thread_count);
+        shares[t] = (SimShare){
+            .vehicles = vehicles + first,
+            .results = results + first,
+            .count = last - first,
+            .track = track,
+            .laps = laps,
+            .dt = dt
+        };
+
+        // The last share runs on the calling thread
+        if (t == thread_count - 1) break;
+        if (pthread_create(&shares[t].thread, nullptr, run_share, &shares[t]) != 0) {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+
+    if (ok) run_share(&shares[thread_count - 1]);
+    for (int t = 0; t < started; t++) {
+        pthread_join(shares[t].thread, nullptr);
+    }
+
+    free(shares);
+    return ok;
+}
@@ -0,0 +1,59 @@
+/*
+ * GARAGE SIMULATOR - time-stepped launch and lap simulation
+ * =========================================================
+ *
+ * Instead of t = v / a and fixed corner speeds, the car's speed is
+ * integrated over time with fourth-order Runge-Kutta:
+ *
+ *   m dv/dt = F_drive - F_drag - F_roll       (or -m*mu*g when braking)
+ *   F_drive = min(P * efficiency / v, mu * m * g)   power- or grip-limited
+ *   F_drag  = 0.5 * rho * Cd * A * v²
+ *   F_roll  = C_rr * m * g
+ *
+ * A track is a list of segments; a corner of radius R can be taken at no
+ * more than sqrt(mu * g * R). Before each corner the car brakes along the
+ * curve v² = v_corner² + 2 * mu * g * distance, so it arrives at exactly
+ * the corner speed.
+ */
+
+#ifndef GARAGE_SIM_H
+#define GARAGE_SIM_H
+
+#include "garage_fleet.h"
+
+typedef struct {
+    double length;      // m
+    double radius;      // m; 0 for a straight
+} SimSegment;
+
+typedef struct {
+    const SimSegment *segments;
+    int count;
+} SimTrack;
+
+typedef struct {
+    double total_time;  // s, all laps from a standing start
+    double best_lap;    // s
+    double top_speed;   // m/s
+    long long steps;    // RK4 steps taken
+} SimResult;
+
+// A track of the given length with `turns` evenly spaced corners of
+// turn_length metres at radius turn_radius. segments[] needs 2 * turns + 1
+// entries; returns how many were used.
+int sim_track_build(SimSegment segments[], double track_length, int turns,
+                    double turn_length, double turn_radius);
+
+// Seconds from rest to target_speed, or -1 if the car cannot reach it
+double sim_launch_time(const FleetVehicle *vehicle, double target_speed, double dt, long long *steps);
+
+// Drive `laps` laps from a standing start with time step dt (s)
+SimResult sim_laps(const FleetVehicle *vehicle, const SimTrack *track, int laps, double dt);
+
+// sim_laps() for every vehicle, split across thread_count threads
+// (each thread takes a contiguous share). Returns false if a thread
+// could not be started.
+bool sim_laps_parallel(const FleetVehicle vehicles[], int count, const SimTrack *track,
+                       int laps, double dt, SimResult results[], int thread_count);
+
+#endif // GARAGE_SIM_H
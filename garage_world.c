@@ -0,0 +1,412 @@
+/*
+ * GARAGE WORLDS - generators and the mmap-able world file
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "garage_world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr uint32_t WORLD_VERSION = 1;
+constexpr double GRID_WALL_RATIO = 0.2;
+constexpr double GEOMETRIC_DEGREE = 7.0;    // Average neighbors per point
+constexpr double PI = 3.14159265358979323846;
+constexpr double MAZE_LOOP_RATIO = 0.05;    // Extra openings per cell
+
+// ============================================================================
+// EDGE LIST HELPERS
+// ============================================================================
+
+typedef struct {
+    PathEdge *edges;
+    int count;
+    int capacity;
+} EdgeList;
+
+static bool edge_list_add(EdgeList *list, int from, int to, double weight) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 1024;
+        PathEdge *grown = realloc(list->edges, (size_t)capacity * sizeof(PathEdge));
+        if (grown == nullptr) return false;
+        list->edges = grown;
+        list->capacity = capacity;
+    }
+    list->edges[list->count++] = (PathEdge){ .from = from, .to = to, .weight = weight };
+    return true;
+}
+
+// Both directions of an undirected connection
+static bool edge_list_link(EdgeList *list, int a, int b, double weight) {
+    return edge_list_add(list, a, b, weight) && edge_list_add(list, b, a, weight);
+}
+
+static unsigned next_random(unsigned *state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static double random_unit(unsigned *state) {
+    return (next_random(state) >> 8) / 16777216.0;
+}
+
+static int square_side(int node_count) {
+    int side = (int)ceil(sqrt((double)node_count));
+    return side < 2 ? 2 : side;
+}
+
+// ============================================================================
+// GENERATORS
+// ============================================================================
+
+static bool generate_grid(EdgeList *list, double *x, double *y, int side, unsigned *rng) {
+    int node_count = side * side;
+    bool *open = malloc((size_t)node_count * sizeof(bool));
+    if (open == nullptr) return false;
+
+    for (int n = 0; n < node_count; n++) {
+        open[n] = random_unit(rng) >= GRID_WALL_RATIO;
+        x[n] = n % side;
+        y[n] = n / side;
+    }
+
+    bool ok = true;
+    for (int n = 0; n < node_count && ok; n++) {
+        if (!open[n]) continue;
+        int col = n % side;
+        int row = n / side;
+
+        // Right and down neighbors; the link adds both directions, each
+        // with a cost no lower than the distance (keeps A* admissible)
+        if (col < side - 1 && open[n + 1]) {
+            ok = edge_list_link(list, n, n + 1, 1.0 + 0.5 * random_unit(rng));
+        }
+        if (ok && row < side - 1 && open[n + side]) {
+            ok = edge_list_link(list, n, n + side, 1.0 + 0.5 * random_unit(rng));
+        }
+    }
+
+    free(open);
+    return ok;
+}
+
+static bool generate_geometric(EdgeList *list, double *x, double *y, int node_count, unsigned *rng) {
+    // Unit density: node_count points in a square of side sqrt(node_count)
+    double extent = sqrt((double)node_count);
+    double radius = sqrt(GEOMETRIC_DEGREE / PI);
+
+    for (int n = 0; n < node_count; n++) {
+        x[n] = random_unit(rng) * extent;
+        y[n] = random_unit(rng) * extent;
+    }
+
+    // Bucket points into radius-sized cells so each point only checks
+    // the 3x3 cells around it
+    int cells = (int)ceil(extent / radius);
+    int *cell_start = calloc((size_t)cells * cells + 1, sizeof(int));
+    int *cell_points = malloc((size_t)node_count * sizeof(int));
+    int *cell_of = malloc((size_t)node_count * sizeof(int));
+    if (cell_start == nullptr || cell_points == nullptr || cell_of == nullptr) {
+        free(cell_start);
+        free(cell_points);
+        free(cell_of);
+        return false;
+    }
+
+    for (int n = 0; n < node_count; n++) {
+        int cx = (int)(x[n] / radius);
+        int cy = (int)(y[n] / radius);
+        if (cx >= cells) cx = cells - 1;
+        if (cy >= cells) cy = cells - 1;
+        cell_of[n] = cy * cells + cx;
+        cell_start[cell_of[n] + 1]++;
+    }
+    for (int c = 0; c < cells * cells; c++) {
+        cell_start[c + 1] += cell_start[c];
+    }
+    for (int n = 0; n < node_count; n++) {
+        cell_points[cell_start[cell_of[n]]++] = n;
+    }
+    // The scatter advanced each start to the next cell's; shift back
+    for (int c = cells * cells; c > 0; c--) {
+        cell_start[c] = cell_start[c - 1];
+    }
+    cell_start[0] = 0;
+
+    bool ok = true;
+    for (int n = 0; n < node_count && ok; n++) {
+        int cx = cell_of[n] % cells;
+        int cy = cell_of[n] / cells;
+
+        for (int dy = -1; dy <= 1 && ok; dy++) {
+            for (int dx = -1; dx <= 1 && ok; dx++) {
+                int nx = cx + dx, ny = cy + dy;
+                if (nx < 0 || ny < 0 || nx >= cells || ny >= cells) continue;
+
+                int c = ny * cells + nx;
+                for (int i = cell_start[c]; i < cell_start[c + 1] && ok; i++) {
+                    int other = cell_points[i];
+                    if (other == n) continue;
+
+                    double distance = hypot(x[n] - x[other], y[n] - y[other]);
+                    if (distance <= radius) {
+                        // Each pair is met from both ends: add one direction here
+                        ok = edge_list_add(list, n, other, distance);
+                    }
+                }
+            }
+        }
+    }
+
+    free(cell_start);
+    free(cell_points);
+    free(cell_of);
+    return ok;
+}
+
+static bool generate_maze(EdgeList *list, double *x, double *y, int side, unsigned *rng) {
+    int node_count = side * side;
+    bool *visited = calloc((size_t)node_count, sizeof(bool));
+    int *stack = malloc((size_t)node_count * sizeof(int));
+    if (visited == nullptr || stack == nullptr) {
+        free(visited);
+        free(stack);
+        return false;
+    }
+
+    for (int n = 0; n < node_count; n++) {
+        x[n] = n % side;
+        y[n] = n / side;
+    }
+
+    // Recursive backtracker with an explicit stack: carves a spanning tree
+    int top = 0;
+    stack[top++] = 0;
+    visited[0] = true;
+    bool ok = true;
+
+    while (top > 0 && ok) {
+        int cell = stack[top - 1];
+        int col = cell % side, row = cell / side;
+
+        int candidates[4];
+        int count = 0;
+        if (col > 0 && !visited[cell - 1]) candidates[count++] = cell - 1;
+        if (col < side - 1 && !visited[cell + 1]) candidates[count++] = cell + 1;
+        if (row > 0 && !visited[cell - side]) candidates[count++] = cell - side;
+        if (row < side - 1 && !visited[cell + side]) candidates[count++] = cell + side;
+
+        if (count == 0) {
+            top--;
+            continue;
+        }
+
+        int next = candidates[next_random(rng) % (unsigned)count];
+        visited[next] = true;
+        ok = edge_list_link(list, cell, next, 1.0);
+        stack[top++] = next;
+    }
+
+    // Knock out a few extra walls so there is more than one way around
+    int openings = (int)(node_count * MAZE_LOOP_RATIO);
+    for (int i = 0; i < openings && ok; i++) {
+        int cell = (int)(next_random(rng) % (unsigned)node_count);
+        int col = cell % side, row = cell / side;
+        if (col < side - 1 && (next_random(rng) & 1)) {
+            ok = edge_list_link(list, cell, cell + 1, 1.0);
+        } else if (row < side - 1) {
+            ok = edge_list_link(list, cell, cell + side, 1.0);
+        }
+    }
+
+    free(visited);
+    free(stack);
+    return ok;
+}
+
+bool world_generate(PathGraph *graph, WorldKind kind, int node_count, unsigned seed) {
+    if (node_count < 4) node_count = 4;
+    if (kind == WORLD_GRID || kind == WORLD_MAZE) {
+        int side = square_side(node_count);
+        node_count = side * side;
+    }
+
+    double *x = malloc((size_t)node_count * sizeof(double));
+    double *y = malloc((size_t)node_count * sizeof(double));
+    EdgeList list = {};
+    unsigned rng = seed ? seed : 1u;
+    bool ok = x != nullptr && y != nullptr;
+
+    if (ok) {
+        switch (kind) {
+            case WORLD_GRID:
+                ok = generate_grid(&list, x, y, square_side(node_count), &rng);
+                break;
+            case WORLD_GEOMETRIC:
+                ok = generate_geometric(&list, x, y, node_count, &rng);
+                break;
+            case WORLD_MAZE:
+                ok = generate_maze(&list, x, y, square_side(node_count), &rng);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    ok = ok && path_graph_build(graph, node_count, list.edges, list.count);
+    if (ok) {
+        memcpy(graph->x, x, (size_t)node_count * sizeof(double));
+        memcpy(graph->y, y, (size_t)node_count * sizeof(double));
+    }
+
+    free(x);
+    free(y);
+    free(list.edges);
+    return ok;
+}
+
+// ============================================================================
+// WORLD FILES
+// ============================================================================
+
+static size_t world_file_size(uint32_t node_count, uint32_t edge_count) {
+    return sizeof(WorldHeader)
+         + 2 * (size_t)node_count * sizeof(double)
+         + (size_t)edge_count * sizeof(double)
+         + ((size_t)node_count + 1) * sizeof(int32_t)
+         + (size_t)edge_count * sizeof(int32_t);
+}
+
+bool world_save(const PathGraph *graph, WorldKind kind, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        perror(path);
+        return false;
+    }
+
+    WorldHeader header = {
+        .version = WORLD_VERSION,
+        .kind = (uint32_t)kind,
+        .node_count = (uint32_t)graph->node_count,
+        .edge_count = (uint32_t)graph->edge_count
+    };
+    memcpy(header.magic, WORLD_MAGIC, sizeof(header.magic));
+
+    size_t n = (size_t)graph->node_count;
+    size_t m = (size_t)graph->edge_count;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(graph->x, sizeof(double), n, file) == n
+           && fwrite(graph->y, sizeof(double), n, file) == n
+           && fwrite(graph->weights, sizeof(double), m, file) == m
+           && fwrite(graph->offsets, sizeof(int32_t), n + 1, file) == n + 1
+           && fwrite(graph->targets, sizeof(int32_t), m, file) == m;
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Cannot write world file %s\n", path);
+    return ok;
+}
+
+// The searches index x, y and targets through offsets without bounds checks,
+// so a file whose CSR arrays disagree would read outside the mapping.
+static bool world_graph_valid(const PathGraph *graph) {
+    if (graph->offsets[0] != 0 || graph->offsets[graph->node_count] != graph->edge_count) {
+        return false;
+    }
+    for (int node = 0; node < graph->node_count; node++) {
+        if (graph->offsets[node] > graph->offsets[node + 1]) return false;
+    }
+    for (int edge = 0; edge < graph->edge_count; edge++) {
+        if (graph->targets[edge] < 0 || graph->targets[edge] >= graph->node_count) return false;
+    }
+    return true;
+}
+
+bool world_load(const char *path, PathGraph *graph, WorldMapping *mapping) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(WorldHeader)) {
+        fprintf(stderr, "%s: not a world file\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *base = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+
+    const WorldHeader *header = base;
+    if (memcmp(header->magic, WORLD_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != WORLD_VERSION || header->kind >= WORLD_KIND_COUNT ||
+        header->node_count > INT_MAX || header->edge_count > INT_MAX ||
+        world_file_size(header->node_count, header->edge_count) != (size_t)info.st_size) {
+        fprintf(stderr, "%s: not a world file (or a different version)\n", path);
+        munmap(base, (size_t)info.st_size);
+        return false;
+    }
+
+    size_t n = header->node_count;
+    size_t m = header->edge_count;
+    char *cursor = (char *)base + sizeof(WorldHeader);
+
+    *graph = (PathGraph){ .node_count = (int)n, .edge_count = (int)m };
+    graph->x = (double *)cursor;        cursor += n * sizeof(double);
+    graph->y = (double *)cursor;        cursor += n * sizeof(double);
+    graph->weights = (double *)cursor;  cursor += m * sizeof(double);
+    graph->offsets = (int *)cursor;     cursor += (n + 1) * sizeof(int32_t);
+    graph->targets = (int *)cursor;
+
+    if (!world_graph_valid(graph)) {
+        fprintf(stderr, "%s: corrupt world file (edge offsets or targets out of range)\n", path);
+        munmap(base, (size_t)info.st_size);
+        *graph = (PathGraph){};
+        return false;
+    }
+
+    *mapping = (WorldMapping){
+        .base = base,
+        .size = (size_t)info.st_size,
+        .kind = (WorldKind)header->kind
+    };
+    return true;
+}
+
+void world_unload(PathGraph *graph, WorldMapping *mapping) {
+    if (mapping->base) munmap(mapping->base, mapping->size);
+    *mapping = (WorldMapping){};
+    *graph = (PathGraph){};
+}
+
+const char* world_kind_to_string(WorldKind kind) {
+    switch (kind) {
+        case WORLD_GRID: return "grid";
+        case WORLD_GEOMETRIC: return "geometric";
+        case WORLD_MAZE: return "maze";
+        default: return "unknown";
+    }
+}
+
+WorldKind string_to_world_kind(const char *str) {
+    for (int kind = 0; kind < WORLD_KIND_COUNT; kind++) {
+        if (strcmp(str, world_kind_to_string((WorldKind)kind)) == 0) return (WorldKind)kind;
+    }
+    return WORLD_KIND_COUNT;
+}
@@ -0,0 +1,62 @@
+/*
+ * GARAGE WORLDS - procedurally generated maps for pathfinding at scale
+ * ====================================================================
+ *
+ * Generated worlds are plain PathGraphs with coordinates, so every search
+ * in garage_path.h runs on them unchanged. They are saved in a flat binary
+ * layout that is the in-memory CSR layout, so loading one is a single mmap:
+ *
+ *   WorldHeader (32 bytes)
+ *   double x[node_count], y[node_count]
+ *   double weights[edge_count]
+ *   int32  offsets[node_count + 1], targets[edge_count]
+ *
+ * Doubles come first so every array is naturally aligned.
+ */
+
+#ifndef GARAGE_WORLD_H
+#define GARAGE_WORLD_H
+
+#include "garage_path.h"
+#include <stdint.h>
+
+#define WORLD_MAGIC "GWORLD1"
+
+typedef enum {
+    WORLD_GRID,         // 4-connected grid, 20% walls, weights 1..1.5
+    WORLD_GEOMETRIC,    // Random points joined to every point within a radius
+    WORLD_MAZE,         // Perfect maze with a few extra openings (loops)
+    WORLD_KIND_COUNT
+} WorldKind;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint64_t reserved;
+} WorldHeader;
+
+// A world file mapped into memory; the graph's arrays point into it
+typedef struct {
+    void *base;
+    size_t size;
+    WorldKind kind;
+} WorldMapping;
+
+// Build a world of roughly node_count nodes (grids and mazes round to a
+// square). Free with path_graph_free().
+bool world_generate(PathGraph *graph, WorldKind kind, int node_count, unsigned seed);
+
+bool world_save(const PathGraph *graph, WorldKind kind, const char *path);
+
+// Map a saved world read-only. Do not path_graph_free() the result; call
+// world_unload() instead.
+bool world_load(const char *path, PathGraph *graph, WorldMapping *mapping);
+void world_unload(PathGraph *graph, WorldMapping *mapping);
+
+const char* world_kind_to_string(WorldKind kind);
+WorldKind string_to_world_kind(const char *str);
+
+#endif // GARAGE_WORLD_H
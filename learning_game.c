@@ -1,4 +1,8 @@
 #include "db_common.h"
+#include "db_replica.h"
+#include "db_worker.h"
+#include "db_maintenance.h"
+#include "db_similar.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +24,64 @@ typedef struct {
     const char *solution;
 } GameLesson;
 
+// The worker thread fetches a few candidates ahead of time, so the lesson a
+// learner asks for next is usually already in memory
+#define PREFETCH_DEPTH 3
+#define RECENT_WRITES 32
+
+// Lessons fall due as time passes, which no write announces: a fetch older
+// than this is run again before it answers
+#define PREFETCH_MAX_AGE 30
+
+// Checkpoints, PRAGMA optimize and incremental vacuum run on the worker
+// once the learner has been idle this long
+#define MAINTENANCE_IDLE_MS 2000
+
+// Lessons from the lessons table suggested under each game lesson
+#define RELATED_LESSONS 3
+
+typedef struct {
+    int id;
+    int level;
+    char *title;
+    char *description;
+    char *code_example;
+    char *challenge;
+    int related_count;                      // Lessons from the lessons table
+    int related_ids[RELATED_LESSONS];
+    char *related_topics[RELATED_LESSONS];
+} LessonCard;
+
+typedef enum {
+    PREFETCH_NEXT,
+    PREFETCH_REVIEW,
+    PREFETCH_KINDS
+} PrefetchKind;
+
+typedef struct {
+    PrefetchKind kind;
+    int count;
+    LessonCard cards[PREFETCH_DEPTH];
+    int write_mark;         // Progress writes queued before this fetch
+    time_t fetched_at;      // The "now" lessons were due by
+    SimilarIndex **similar; // The session's, to look up related lessons
+    DbJob *job;
+} Prefetch;
+
+typedef struct {
+    int lesson_id;
+    int confidence;
+} ProgressWrite;
+
+typedef struct {
+    DbWorker *worker;
+    Prefetch *current[PREFETCH_KINDS];  // Latest finished fetch
+    Prefetch *pending[PREFETCH_KINDS];  // Fetch queued behind the latest write
+    ProgressWrite writes[RECENT_WRITES];
+    int write_count;
+    SimilarIndex *similar;              // Only touched by worker jobs
+} GameSession;
+
 GameLesson game_lessons[] = {
     {
         1,
@@ -431,38 +493,60 @@ GameLesson game_lessons[] = {
 };
 
 int seed_game_lessons(sqlite3 *db) {
-    const char *sql = "INSERT INTO game_lessons (level, title, description, code_example, challenge, solution, timestamp) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?);";
+    const char *sql = "INSERT INTO game_lessons (level, title, timestamp) VALUES (?, ?, ?);";
+    const char *content_sql = "INSERT INTO game_lesson_content (lesson_id, description, code_example, challenge, solution) "
+                              "VALUES (?, ?, ?, ?, ?);";
 
-    for (size_t i = 0; i < sizeof(game_lessons) / sizeof(game_lessons[0]); i++) {
-        sqlite3_stmt *stmt;
-        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) continue;
+    sqlite3_stmt *stmt, *content_stmt = NULL;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) rc = sqlite3_prepare_v2(db, content_sql, -1, &content_stmt, NULL);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return rc;
+    }
 
-        time_t now = time(NULL);
+    // One transaction, captured like any other write when the database
+    // feeds a change log or replicas
+    time_t now = time(NULL);
+    replica_capture_begin(db);
+
+    for (size_t i = 0; rc == SQLITE_OK && i < sizeof(game_lessons) / sizeof(game_lessons[0]); i++) {
         GameLesson *lesson = &game_lessons[i];
 
         sqlite3_bind_int(stmt, 1, lesson->level);
         sqlite3_bind_text(stmt, 2, lesson->title, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, lesson->description, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 4, lesson->code_example, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 5, lesson->challenge, -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 6, lesson->solution, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 7, now);
+        sqlite3_bind_int64(stmt, 3, now);
 
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        if (sqlite3_step(stmt) != SQLITE_DONE) rc = sqlite3_errcode(db);
+        sqlite3_reset(stmt);
+        if (rc != SQLITE_OK) break;
+
+        sqlite3_bind_int64(content_stmt, 1, sqlite3_last_insert_rowid(db));
+        sqlite3_bind_text(content_stmt, 2, lesson->description, -1, SQLITE_STATIC);
+        sqlite3_bind_text(content_stmt, 3, lesson->code_example, -1, SQLITE_STATIC);
+        sqlite3_bind_text(content_stmt, 4, lesson->challenge, -1, SQLITE_STATIC);
+        sqlite3_bind_text(content_stmt, 5, lesson->solution, -1, SQLITE_STATIC);
+
+        if (sqlite3_step(content_stmt) != SQLITE_DONE) rc = sqlite3_errcode(db);
+        sqlite3_reset(content_stmt);
     }
 
-    return SQLITE_OK;
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(content_stmt);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Cannot seed game lessons: %s\n", sqlite3_errmsg(db));
+        replica_capture_rollback(db);
+        return rc;
+    }
+    return replica_capture_commit(db);
 }
 
-void print_lesson(sqlite3_stmt *stmt) {
-    int level = sqlite3_column_int(stmt, 1);
-    const unsigned char *title = sqlite3_column_text(stmt, 2);
-    const unsigned char *description = sqlite3_column_text(stmt, 3);
-    const unsigned char *code_example = sqlite3_column_text(stmt, 4);
-    const unsigned char *challenge = sqlite3_column_text(stmt, 5);
+void print_lesson(const LessonCard *card) {
+    int level = card->level;
+    const char *title = card->title;
+    const char *description = card->description;
+    const char *code_example = card->code_example;
+    const char *challenge = card->challenge;
 
     printf("\n");
     printf("╔════════════════════════════════════════════════════════════════════════════╗\n");
@@ -493,6 +577,8 @@ int get_next_review_interval(int review_count) {
 }
 
 void update_progress(sqlite3 *db, int lesson_id, int confidence) {
+    replica_capture_begin(db);
+
     // Check if progress exists
     const char *check_sql = "SELECT review_count FROM learning_progress WHERE lesson_id = ?;";
     sqlite3_stmt *stmt;
@@ -536,8 +622,14 @@ void update_progress(sqlite3 *db, int lesson_id, int confidence) {
         sqlite3_bind_int64(stmt, 4, next_review);
     }
 
-    sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
+
+    if (rc == SQLITE_DONE) {
+        replica_capture_commit(db);
+    } else {
+        replica_capture_rollback(db);
+    }
 }
 
 void show_progress_stats(sqlite3 *db) {
@@ -583,7 +675,278 @@ void show_progress_stats(sqlite3 *db) {
     printf("\n");
 }
 
-void play_game(sqlite3 *db) {
+static char* copy_column_text(sqlite3_stmt *stmt, int column) {
+    const unsigned char *text = sqlite3_column_text(stmt, column);
+    if (text == NULL) text = (const unsigned char *)"";
+
+    size_t length = strlen((const char *)text);
+    char *copy = malloc(length + 1);
+    if (copy) memcpy(copy, text, length + 1);
+    return copy;
+}
+
+static void free_prefetch(Prefetch *prefetch) {
+    if (prefetch == NULL) return;
+
+    for (int i = 0; i < prefetch->count; i++) {
+        free(prefetch->cards[i].title);
+        free(prefetch->cards[i].description);
+        free(prefetch->cards[i].code_example);
+        free(prefetch->cards[i].challenge);
+        for (int r = 0; r < prefetch->cards[i].related_count; r++) {
+            free(prefetch->cards[i].related_topics[r]);
+        }
+    }
+    free(prefetch);
+}
+
+// Open the similar-lesson index, or bring it up to date
+static SimilarIndex* refresh_similar(sqlite3 *db, SimilarIndex **similar) {
+    if (*similar == NULL) {
+        *similar = similar_open(db);
+    } else {
+        similar_refresh(*similar);
+    }
+    return *similar;
+}
+
+// The lessons closest to a game lesson's text
+static void fetch_related(sqlite3 *db, SimilarIndex *similar, LessonCard *card) {
+    if (card->title == NULL || card->description == NULL || card->challenge == NULL) return;
+    size_t length = strlen(card->title) + strlen(card->description) + strlen(card->challenge) + 3;
+    char *text = malloc(length);
+    if (text == NULL) return;
+    snprintf(text, length, "%s %s %s", card->title, card->description, card->challenge);
+
+    SimilarMatch matches[RELATED_LESSONS];
+    int count = similar_to_text(similar, text, RELATED_LESSONS, matches);
+    free(text);
+    if (count <= 0) return;
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT topic FROM lessons WHERE id = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        sqlite3_bind_int(stmt, 1, matches[i].lesson_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            char *topic = copy_column_text(stmt, 0);
+            if (topic) {
+                card->related_ids[card->related_count] = matches[i].lesson_id;
+                card->related_topics[card->related_count++] = topic;
+            }
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+}
+
+// Worker job: load the first PREFETCH_DEPTH candidates of one menu option,
+// with the lessons related to each
+static void fetch_candidates_job(sqlite3 *db, void *arg) {
+    Prefetch *prefetch = arg;
+
+    // Next unstarted or lowest confidence lesson
+    const char *next_sql = "SELECT gl.id, gl.level, gl.title, c.description, c.code_example, c.challenge "
+                           "FROM game_lessons gl "
+                           "JOIN game_lesson_content c ON c.lesson_id = gl.id "
+                           "LEFT JOIN learning_progress lp ON gl.id = lp.lesson_id "
+                           "WHERE lp.lesson_id IS NULL OR lp.confidence_level < 4 "
+                           "ORDER BY gl.level LIMIT ?;";
+
+    // Lessons due for review
+    const char *review_sql = "SELECT gl.id, gl.level, gl.title, c.description, c.code_example, c.challenge "
+                             "FROM game_lessons gl "
+                             "JOIN game_lesson_content c ON c.lesson_id = gl.id "
+                             "JOIN learning_progress lp ON gl.id = lp.lesson_id "
+                             "WHERE lp.next_review <= ? AND lp.confidence_level < 4 "
+                             "ORDER BY lp.next_review LIMIT ?;";
+
+    sqlite3_stmt *stmt;
+    prefetch->fetched_at = time(NULL);
+    if (prefetch->kind == PREFETCH_NEXT) {
+        sqlite3_prepare_v2(db, next_sql, -1, &stmt, NULL);
+        sqlite3_bind_int(stmt, 1, PREFETCH_DEPTH);
+    } else {
+        sqlite3_prepare_v2(db, review_sql, -1, &stmt, NULL);
+        sqlite3_bind_int64(stmt, 1, prefetch->fetched_at);
+        sqlite3_bind_int(stmt, 2, PREFETCH_DEPTH);
+    }
+
+    while (prefetch->count < PREFETCH_DEPTH && sqlite3_step(stmt) == SQLITE_ROW) {
+        LessonCard *card = &prefetch->cards[prefetch->count++];
+        card->id = sqlite3_column_int(stmt, 0);
+        card->level = sqlite3_column_int(stmt, 1);
+        card->title = copy_column_text(stmt, 2);
+        card->description = copy_column_text(stmt, 3);
+        card->code_example = copy_column_text(stmt, 4);
+        card->challenge = copy_column_text(stmt, 5);
+    }
+
+    sqlite3_finalize(stmt);
+
+    SimilarIndex *similar = prefetch->count > 0 ? refresh_similar(db, prefetch->similar) : NULL;
+    for (int i = 0; similar && i < prefetch->count; i++) {
+        fetch_related(db, similar, &prefetch->cards[i]);
+    }
+}
+
+// Worker job: persist one confidence rating
+static void update_progress_job(sqlite3 *db, void *arg) {
+    ProgressWrite *write = arg;
+    update_progress(db, write->lesson_id, write->confidence);
+    free(write);
+}
+
+static void show_progress_job(sqlite3 *db, void *arg) {
+    (void)arg;
+    show_progress_stats(db);
+}
+
+typedef struct {
+    int level;
+    char *solution;
+} SolutionRequest;
+
+static void fetch_solution_job(sqlite3 *db, void *arg) {
+    SolutionRequest *request = arg;
+
+    const char *sql = "SELECT c.solution FROM game_lessons gl "
+                      "JOIN game_lesson_content c ON c.lesson_id = gl.id WHERE gl.level = ?;";
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    sqlite3_bind_int(stmt, 1, request->level);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        request->solution = copy_column_text(stmt, 0);
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+static void close_similar_job(sqlite3 *db, void *arg) {
+    (void)db;
+    GameSession *session = arg;
+    similar_close(session->similar);
+    session->similar = NULL;
+}
+
+// Related lessons came with the card, so this never waits for the worker
+static void show_related(const LessonCard *card) {
+    if (card->related_count == 0) return;
+
+    printf("\nRELATED READING (db_manager, view lesson by ID):\n");
+    for (int i = 0; i < card->related_count; i++) {
+        printf("  [%d] %s\n", card->related_ids[i], card->related_topics[i]);
+    }
+}
+
+// Wait for the queued fetch of this kind and make it the current one
+static void promote_prefetch(GameSession *session, PrefetchKind kind) {
+    Prefetch *pending = session->pending[kind];
+    if (pending == NULL) return;
+
+    db_worker_wait(session->worker, pending->job);
+    pending->job = NULL;
+    free_prefetch(session->current[kind]);
+    session->current[kind] = pending;
+    session->pending[kind] = NULL;
+}
+
+static void queue_prefetch(GameSession *session, PrefetchKind kind) {
+    // The previous fetch is almost always finished by now
+    promote_prefetch(session, kind);
+
+    Prefetch *prefetch = calloc(1, sizeof(Prefetch));
+    if (prefetch == NULL) return;
+
+    prefetch->kind = kind;
+    prefetch->write_mark = session->write_count;
+    prefetch->similar = &session->similar;
+    prefetch->job = db_worker_submit(session->worker, fetch_candidates_job, prefetch);
+    session->pending[kind] = prefetch;
+}
+
+// Progress writes queued after a fetch can only remove candidates: a rated
+// lesson is no longer due for review, and a mastered one is no longer next.
+// Returns 1 if still valid, 0 if not, -1 if too many writes to tell.
+static int card_still_valid(const GameSession *session, const Prefetch *prefetch,
+                            const LessonCard *card) {
+    if (session->write_count - prefetch->write_mark > RECENT_WRITES) return -1;
+
+    for (int i = prefetch->write_mark; i < session->write_count; i++) {
+        const ProgressWrite *write = &session->writes[i % RECENT_WRITES];
+        if (write->lesson_id != card->id) continue;
+        if (prefetch->kind == PREFETCH_REVIEW || write->confidence >= 4) return 0;
+    }
+    return 1;
+}
+
+// Returns 1 with *card set, 0 when the list is known to be empty, -1 when
+// the fetch is too stale to decide
+static int pick_card(const GameSession *session, const Prefetch *prefetch,
+                     const LessonCard **card) {
+    if (prefetch == NULL) return -1;
+
+    // Reviews that fell due since the fetch would be missing from it
+    if (prefetch->kind == PREFETCH_REVIEW && time(NULL) - prefetch->fetched_at > PREFETCH_MAX_AGE) {
+        return -1;
+    }
+
+    int stale = 0;
+    for (int i = 0; i < prefetch->count; i++) {
+        int valid = card_still_valid(session, prefetch, &prefetch->cards[i]);
+        if (valid == 1) {
+            *card = &prefetch->cards[i];
+            return 1;
+        }
+        if (valid < 0) stale = 1;
+    }
+
+    // A short list that ran out means there really is nothing left
+    return (prefetch->count < PREFETCH_DEPTH && !stale) ? 0 : -1;
+}
+
+// Get the lesson for a menu option, waiting for the worker only when the
+// prefetched candidates cannot answer the question
+static const LessonCard* take_card(GameSession *session, PrefetchKind kind) {
+    const LessonCard *card = NULL;
+
+    Prefetch *pending = session->pending[kind];
+    if (pending && db_worker_done(session->worker, pending->job)) {
+        promote_prefetch(session, kind);
+    }
+
+    int found = pick_card(session, session->current[kind], &card);
+    if (found >= 0) return found ? card : NULL;
+
+    if (session->pending[kind] == NULL) queue_prefetch(session, kind);
+    promote_prefetch(session, kind);
+
+    found = pick_card(session, session->current[kind], &card);
+    return found == 1 ? card : NULL;
+}
+
+// Queue the write, then refresh both candidate lists behind it
+static void record_progress(GameSession *session, int lesson_id, int confidence) {
+    ProgressWrite *write = malloc(sizeof(ProgressWrite));
+    if (write == NULL) return;
+
+    // The worker frees write, possibly before db_worker_post() returns
+    ProgressWrite recent = { .lesson_id = lesson_id, .confidence = confidence };
+    *write = recent;
+    if (!db_worker_post(session->worker, update_progress_job, write)) {
+        free(write);
+        return;
+    }
+    session->writes[session->write_count % RECENT_WRITES] = recent;
+    session->write_count++;
+
+    queue_prefetch(session, PREFETCH_NEXT);
+    queue_prefetch(session, PREFETCH_REVIEW);
+}
+
+void play_game(DbWorker *worker) {
     printf("\n");
     printf("╔════════════════════════════════════════════════════════════════════════════╗\n");
     printf("║                  WELCOME TO C PROGRAMMING ADVENTURE!                       ║\n");
@@ -592,6 +955,12 @@ void play_game(sqlite3 *db) {
     printf("║  hands-on challenges and spaced repetition learning techniques.           ║\n");
     printf("╚════════════════════════════════════════════════════════════════════════════╝\n");
 
+    GameSession session = { .worker = worker };
+
+    // Start fetching while the welcome screen and menu are read
+    queue_prefetch(&session, PREFETCH_NEXT);
+    queue_prefetch(&session, PREFETCH_REVIEW);
+
     while (1) {
         printf("\n");
         printf("MENU:\n");
@@ -613,19 +982,12 @@ void play_game(sqlite3 *db) {
 
         switch (choice) {
             case 1: {
-                // Get next unstarted or lowest confidence lesson
-                const char *sql = "SELECT gl.id, gl.level, gl.title, gl.description, gl.code_example, gl.challenge "
-                                  "FROM game_lessons gl "
-                                  "LEFT JOIN learning_progress lp ON gl.id = lp.lesson_id "
-                                  "WHERE lp.lesson_id IS NULL OR lp.confidence_level < 4 "
-                                  "ORDER BY gl.level LIMIT 1;";
-
-                sqlite3_stmt *stmt;
-                sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+                const LessonCard *card = take_card(&session, PREFETCH_NEXT);
 
-                if (sqlite3_step(stmt) == SQLITE_ROW) {
-                    int lesson_id = sqlite3_column_int(stmt, 0);
-                    print_lesson(stmt);
+                if (card) {
+                    int lesson_id = card->id;
+                    print_lesson(card);
+                    show_related(card);
 
                     printf("\n\nHow confident are you with this material?\n");
                     printf("1 - Need more practice\n");
@@ -639,7 +1001,7 @@ void play_game(sqlite3 *db) {
                     getchar();
 
                     if (confidence >= 1 && confidence <= 4) {
-                        update_progress(db, lesson_id, confidence);
+                        record_progress(&session, lesson_id, confidence);
                         printf("\n✓ Progress saved! ");
 
                         int days = get_next_review_interval(0);
@@ -652,26 +1014,16 @@ void play_game(sqlite3 *db) {
                 } else {
                     printf("\n🎉 Congratulations! You've completed all lessons!\n");
                 }
-
-                sqlite3_finalize(stmt);
                 break;
             }
 
             case 2: {
-                time_t now = time(NULL);
-                const char *sql = "SELECT gl.id, gl.level, gl.title, gl.description, gl.code_example, gl.challenge "
-                                  "FROM game_lessons gl "
-                                  "JOIN learning_progress lp ON gl.id = lp.lesson_id "
-                                  "WHERE lp.next_review <= ? AND lp.confidence_level < 4 "
-                                  "ORDER BY lp.next_review LIMIT 1;";
-
-                sqlite3_stmt *stmt;
-                sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-                sqlite3_bind_int64(stmt, 1, now);
+                const LessonCard *card = take_card(&session, PREFETCH_REVIEW);
 
-                if (sqlite3_step(stmt) == SQLITE_ROW) {
-                    int lesson_id = sqlite3_column_int(stmt, 0);
-                    print_lesson(stmt);
+                if (card) {
+                    int lesson_id = card->id;
+                    print_lesson(card);
+                    show_related(card);
 
                     printf("\n\nHow confident are you now?\n");
                     printf("1 - Need more practice\n");
@@ -685,19 +1037,18 @@ void play_game(sqlite3 *db) {
                     getchar();
 
                     if (confidence >= 1 && confidence <= 4) {
-                        update_progress(db, lesson_id, confidence);
+                        record_progress(&session, lesson_id, confidence);
                         printf("\n✓ Progress updated!\n");
                     }
                 } else {
                     printf("\n✓ No lessons due for review today. Great job!\n");
                 }
-
-                sqlite3_finalize(stmt);
                 break;
             }
 
             case 3:
-                show_progress_stats(db);
+                // Queued behind any pending writes, so the stats are current
+                db_worker_call(worker, show_progress_job, NULL);
                 break;
 
             case 4: {
@@ -707,22 +1058,18 @@ void play_game(sqlite3 *db) {
                 scanf("%d", &level);
                 getchar();
 
-                const char *sql = "SELECT solution FROM game_lessons WHERE level = ?;";
-                sqlite3_stmt *stmt;
-                sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-                sqlite3_bind_int(stmt, 1, level);
+                SolutionRequest request = { .level = level, .solution = NULL };
+                db_worker_call(worker, fetch_solution_job, &request);
 
-                if (sqlite3_step(stmt) == SQLITE_ROW) {
-                    const unsigned char *solution = sqlite3_column_text(stmt, 0);
+                if (request.solution) {
                     printf("\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
                     printf("SOLUTION:\n");
                     printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
-                    printf("%s\n", solution);
+                    printf("%s\n", request.solution);
+                    free(request.solution);
                 } else {
                     printf("\nLesson not found.\n");
                 }
-
-                sqlite3_finalize(stmt);
                 break;
             }
 
@@ -730,6 +1077,12 @@ void play_game(sqlite3 *db) {
                 printf("Invalid choice.\n");
         }
     }
+
+    for (int kind = 0; kind < PREFETCH_KINDS; kind++) {
+        promote_prefetch(&session, kind);
+        free_prefetch(session.current[kind]);
+    }
+    db_worker_call(worker, close_similar_job, &session);
 }
 
 int main() {
@@ -741,22 +1094,47 @@ int main() {
         return 1;
     }
 
-    // Check if game lessons are already seeded
-    const char *check_sql = "SELECT COUNT(*) FROM game_lessons;";
+    // Check if game lessons are already seeded (stops at the first row)
+    const char *check_sql = "SELECT EXISTS (SELECT 1 FROM game_lessons);";
     sqlite3_stmt *stmt;
     sqlite3_prepare_v2(db, check_sql, -1, &stmt, NULL);
     sqlite3_step(stmt);
-    int count = sqlite3_column_int(stmt, 0);
+    int seeded = sqlite3_column_int(stmt, 0);
     sqlite3_finalize(stmt);
 
-    if (count == 0) {
+    CdcLog *cdc = cdc_open_from_env(db);
+    replica_capture_open(db, cdc);
+
+    if (!seeded) {
         printf("Initializing game lessons...\n");
         seed_game_lessons(db);
         printf("✓ Game ready!\n");
     }
 
-    play_game(db);
+    // From here on the connection belongs to the worker thread: lesson
+    // lookups are prefetched and progress writes run off the input loop
+    DbWorker *worker = db_worker_start(db);
+    if (worker == NULL) {
+        replica_capture_close(db);
+        cdc_close(cdc);
+        close_database(db);
+        return 1;
+    }
+
+    Maintenance maintenance;
+    maintenance_init(&maintenance);
+    const char *log_path = getenv(MAINTENANCE_LOG_ENV);
+    if (log_path && *log_path) maintenance.log = fopen(log_path, "a");
+    db_worker_set_idle(worker, MAINTENANCE_IDLE_MS, maintenance_job, &maintenance);
+
+    play_game(worker);
+
+    // Finishes any queued progress writes before closing
+    db_worker_stop(worker);
+    if (maintenance.log) fclose(maintenance.log);
 
+    replica_capture_close(db);
+    cdc_close(cdc);
     close_database(db);
     return 0;
 }
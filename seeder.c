@@ -1,4 +1,6 @@
-#include "db_common.h"
+#define _POSIX_C_SOURCE 200809L
+
+#include "db_replica.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -1078,68 +1080,429 @@ LessonData lessons[] = {
     },
 };
 
-int insert_lesson(sqlite3 *db, const LessonData *lesson) {
-    const char *sql = "INSERT INTO lessons (topic, category, difficulty, content, timestamp) "
-                      "VALUES (?, ?, ?, ?, ?);";
+#define BENCH_DB "seed_bench.db"
+#define DEFAULT_BENCH_LESSONS 100000
 
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+typedef struct {
+    int inserted;
+    int updated;
+    int deleted;
+    int unchanged;
+    int adopted;        // Unhashed copies of a source lesson that were kept
+    int duplicates;     // Unhashed copies removed because one already exists
+} SeedStats;
 
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
-        return rc;
-    }
+typedef struct {
+    sqlite3_int64 hash;
+    size_t index;       // Into the source array
+    int seen;           // Already in the database
+} SourceHash;
 
-    time_t now = time(NULL);
+// A hashed lesson whose hash is no longer in the source: updated in place
+// if a source lesson has its topic, deleted otherwise
+typedef struct {
+    sqlite3_int64 id;
+    char *topic;
+    int used;
+} StaleLesson;
+
+typedef struct {
+    sqlite3_stmt *insert;
+    sqlite3_stmt *update;
+    sqlite3_stmt *adopt;
+    sqlite3_stmt *remove;
+    sqlite3_stmt *store_content;    // Insert or replace a lesson body
+    sqlite3_stmt *remove_content;
+    sqlite3_stmt *remove_attachments;
+} SeedStatements;
+
+static int compare_source_hash(const void *a, const void *b) {
+    sqlite3_int64 x = ((const SourceHash *)a)->hash, y = ((const SourceHash *)b)->hash;
+    return (x > y) - (x < y);
+}
+
+static int compare_stale_topic(const void *a, const void *b) {
+    return strcmp(((const StaleLesson *)a)->topic, ((const StaleLesson *)b)->topic);
+}
 
+static SourceHash* find_source(SourceHash *sorted, size_t count, sqlite3_int64 hash) {
+    SourceHash key = { .hash = hash };
+    return bsearch(&key, sorted, count, sizeof(SourceHash), compare_source_hash);
+}
+
+static int bind_lesson(sqlite3_stmt *stmt, const LessonData *lesson, sqlite3_int64 hash) {
     sqlite3_bind_text(stmt, 1, lesson->topic, -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, lesson->category, -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 3, lesson->difficulty);
-    sqlite3_bind_text(stmt, 4, lesson->content, -1, SQLITE_STATIC);
-    sqlite3_bind_int64(stmt, 5, now);
-
-    rc = sqlite3_step(stmt);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)time(NULL));
+    sqlite3_bind_int64(stmt, 5, hash);
+    return SQLITE_OK;
+}
 
+static int run_statement(sqlite3 *db, sqlite3_stmt *stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
     if (rc != SQLITE_DONE) {
         fprintf(stderr, "Execution failed: %s\n", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
         return rc;
     }
+    return SQLITE_OK;
+}
 
-    sqlite3_finalize(stmt);
+static int run_with_id(sqlite3 *db, sqlite3_stmt *stmt, sqlite3_int64 id, sqlite3_int64 hash) {
+    sqlite3_bind_int64(stmt, 1, id);
+    if (sqlite3_bind_parameter_count(stmt) > 1) sqlite3_bind_int64(stmt, 2, hash);
+    return run_statement(db, stmt);
+}
+
+static int store_content(sqlite3 *db, SeedStatements *statements, sqlite3_int64 id,
+                         const char *content) {
+    sqlite3_bind_int64(statements->store_content, 1, id);
+    sqlite3_bind_text(statements->store_content, 2, content, -1, SQLITE_STATIC);
+    return run_statement(db, statements->store_content);
+}
+
+int insert_lesson(sqlite3 *db, SeedStatements *statements, const LessonData *lesson,
+                  sqlite3_int64 hash) {
+    bind_lesson(statements->insert, lesson, hash);
+    int rc = run_statement(db, statements->insert);
+    if (rc != SQLITE_OK) return rc;
+    return store_content(db, statements, sqlite3_last_insert_rowid(db), lesson->content);
+}
+
+static int update_lesson(sqlite3 *db, SeedStatements *statements, sqlite3_int64 id,
+                         const LessonData *lesson, sqlite3_int64 hash) {
+    bind_lesson(statements->update, lesson, hash);
+    sqlite3_bind_int64(statements->update, 6, id);
+    int rc = run_statement(db, statements->update);
+    if (rc != SQLITE_OK) return rc;
+    return store_content(db, statements, id, lesson->content);
+}
+
+static int remove_lesson(sqlite3 *db, SeedStatements *statements, sqlite3_int64 id) {
+    int rc = run_with_id(db, statements->remove_attachments, id, 0);
+    if (rc == SQLITE_OK) rc = run_with_id(db, statements->remove_content, id, 0);
+    if (rc != SQLITE_OK) return rc;
+    return run_with_id(db, statements->remove, id, 0);
+}
+
+static int prepare_statements(sqlite3 *db, SeedStatements *statements) {
+    const char *sql[] = {
+        "INSERT INTO lessons (topic, category, difficulty, timestamp, content_hash) "
+        "VALUES (?1, ?2, ?3, ?4, ?5);",
+        "UPDATE lessons SET topic = ?1, category = ?2, difficulty = ?3, "
+        "timestamp = ?4, content_hash = ?5 WHERE id = ?6;",
+        "UPDATE lessons SET content_hash = ?2 WHERE id = ?1;",
+        "DELETE FROM lessons WHERE id = ?1;",
+        "INSERT OR REPLACE INTO lesson_content (lesson_id, content) VALUES (?1, ?2);",
+        "DELETE FROM lesson_content WHERE lesson_id = ?1;",
+        "DELETE FROM attachments WHERE lesson_id = ?1;",
+    };
+    sqlite3_stmt **targets[] = {
+        &statements->insert, &statements->update, &statements->adopt, &statements->remove,
+        &statements->store_content, &statements->remove_content, &statements->remove_attachments
+    };
+
+    memset(statements, 0, sizeof(*statements));
+    for (int i = 0; i < 7; i++) {
+        if (sqlite3_prepare_v2(db, sql[i], -1, targets[i], NULL) != SQLITE_OK) {
+            fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+            return SQLITE_ERROR;
+        }
+    }
     return SQLITE_OK;
 }
 
-int main() {
-    sqlite3 *db;
-    int rc = init_database(&db);
+static void finalize_statements(SeedStatements *statements) {
+    sqlite3_finalize(statements->insert);
+    sqlite3_finalize(statements->update);
+    sqlite3_finalize(statements->adopt);
+    sqlite3_finalize(statements->remove);
+    sqlite3_finalize(statements->store_content);
+    sqlite3_finalize(statements->remove_content);
+    sqlite3_finalize(statements->remove_attachments);
+}
+
+// Bring the lessons table in line with source in one pass. Lessons are
+// matched by content hash; unchanged ones are not touched at all. Lessons
+// without a hash (added by hand, or by seeders before hashes) are left
+// alone unless they are exact copies of a source lesson.
+int sync_lessons(sqlite3 *db, const LessonData source[], size_t count, int verbose,
+                 SeedStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    SourceHash *hashes = malloc((count ? count : 1) * sizeof(SourceHash));
+    size_t stale_count = 0, stale_capacity = 64;
+    StaleLesson *stale = malloc(stale_capacity * sizeof(StaleLesson));
+    sqlite3_int64 *legacy = NULL;   // id, hash pairs of unhashed copies
+    size_t legacy_count = 0, legacy_capacity = 0;
+    SeedStatements statements;
+    int rc = hashes && stale ? prepare_statements(db, &statements) : SQLITE_NOMEM;
+    if (rc != SQLITE_OK) goto done;
+
+    for (size_t i = 0; i < count; i++) {
+        hashes[i] = (SourceHash){
+            .hash = lesson_hash(source[i].topic, source[i].category,
+                                source[i].difficulty, source[i].content),
+            .index = i
+        };
+    }
+    qsort(hashes, count, sizeof(SourceHash), compare_source_hash);
+    // A lesson listed twice in the source is only stored once
+    for (size_t i = 1; i < count; i++) {
+        if (hashes[i].hash == hashes[i - 1].hash) hashes[i].seen = 1;
+    }
+
+    // Hashed rows, straight from the content_hash index
+    sqlite3_stmt *stmt;
+    rc = sqlite3_prepare_v2(db, "SELECT id, content_hash FROM lessons "
+                                "WHERE content_hash IS NOT NULL;", -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        SourceHash *match = find_source(hashes, count, sqlite3_column_int64(stmt, 1));
+        if (match && !match->seen) {
+            match->seen = 1;
+            stats->unchanged++;
+            continue;
+        }
+        if (stale_count == stale_capacity) {
+            StaleLesson *grown = realloc(stale, 2 * stale_capacity * sizeof(StaleLesson));
+            if (grown == NULL) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            stale = grown;
+            stale_capacity *= 2;
+        }
+        stale[stale_count++] = (StaleLesson){ .id = sqlite3_column_int64(stmt, 0) };
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK) goto done;
+
+    // Unhashed rows that are copies of a source lesson
+    rc = sqlite3_prepare_v2(db, "SELECT id, topic, category, difficulty, COALESCE(content, '') FROM lessons_full "
+                                "WHERE content_hash IS NULL;", -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        sqlite3_int64 hash = lesson_hash((const char *)sqlite3_column_text(stmt, 1),
+                                         (const char *)sqlite3_column_text(stmt, 2),
+                                         sqlite3_column_int(stmt, 3),
+                                         (const char *)sqlite3_column_text(stmt, 4));
+        if (find_source(hashes, count, hash) == NULL) continue;
+
+        if (legacy_count == legacy_capacity) {
+            legacy_capacity = legacy_capacity ? 2 * legacy_capacity : 64;
+            sqlite3_int64 *grown = realloc(legacy, 2 * legacy_capacity * sizeof(sqlite3_int64));
+            if (grown == NULL) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            legacy = grown;
+        }
+        legacy[2 * legacy_count] = sqlite3_column_int64(stmt, 0);
+        legacy[2 * legacy_count + 1] = hash;
+        legacy_count++;
+    }
+    sqlite3_finalize(stmt);
 
+    // The first copy of a lesson not stored yet gets its hash; the rest go
+    for (size_t i = 0; rc == SQLITE_OK && i < legacy_count; i++) {
+        SourceHash *match = find_source(hashes, count, legacy[2 * i + 1]);
+        if (!match->seen) {
+            match->seen = 1;
+            rc = run_with_id(db, statements.adopt, legacy[2 * i], legacy[2 * i + 1]);
+            stats->adopted++;
+        } else {
+            rc = remove_lesson(db, &statements, legacy[2 * i]);
+            stats->duplicates++;
+        }
+    }
+    if (rc != SQLITE_OK) goto done;
+
+    // Topics of the stale rows, so edited lessons keep their id
+    rc = sqlite3_prepare_v2(db, "SELECT topic FROM lessons WHERE id = ?;", -1, &stmt, NULL);
+    for (size_t i = 0; rc == SQLITE_OK && i < stale_count; i++) {
+        sqlite3_bind_int64(stmt, 1, stale[i].id);
+        const char *topic = sqlite3_step(stmt) == SQLITE_ROW
+                          ? (const char *)sqlite3_column_text(stmt, 0) : "";
+        stale[i].topic = strdup(topic ? topic : "");
+        if (stale[i].topic == NULL) rc = SQLITE_NOMEM;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK) goto done;
+    qsort(stale, stale_count, sizeof(StaleLesson), compare_stale_topic);
+
+    // New and edited lessons, in source order
+    for (size_t i = 0; rc == SQLITE_OK && i < count; i++) {
+        if (hashes[i].seen) continue;
+        const LessonData *lesson = &source[hashes[i].index];
+
+        StaleLesson key = { .topic = (char *)lesson->topic };
+        StaleLesson *previous = bsearch(&key, stale, stale_count, sizeof(StaleLesson),
+                                        compare_stale_topic);
+        if (previous && !previous->used) {
+            previous->used = 1;
+            rc = update_lesson(db, &statements, previous->id, lesson, hashes[i].hash);
+            stats->updated++;
+            if (verbose && rc == SQLITE_OK) printf("~ Updated: %s\n", lesson->topic);
+        } else {
+            rc = insert_lesson(db, &statements, lesson, hashes[i].hash);
+            stats->inserted++;
+            if (verbose && rc == SQLITE_OK) printf("✓ Added: %s\n", lesson->topic);
+        }
+    }
+
+    // Whatever is left was dropped from the source
+    for (size_t i = 0; rc == SQLITE_OK && i < stale_count; i++) {
+        if (stale[i].used) continue;
+        rc = remove_lesson(db, &statements, stale[i].id);
+        stats->deleted++;
+        if (verbose && rc == SQLITE_OK) printf("- Removed: %s\n", stale[i].topic);
+    }
+
+done:
+    if (hashes && stale) finalize_statements(&statements);
+    for (size_t i = 0; stale && i < stale_count; i++) free(stale[i].topic);
+    free(stale);
+    free(legacy);
+    free(hashes);
+    return rc;
+}
+
+// One transaction (and one changeset when replicated) for the whole seed
+static int seed(sqlite3 *db, const LessonData source[], size_t count, int verbose,
+                SeedStats *stats) {
+    replica_capture_begin(db);
+    int rc = sync_lessons(db, source, count, verbose, stats);
     if (rc != SQLITE_OK) {
-        fprintf(stderr, "Failed to initialize database.\n");
+        replica_capture_rollback(db);
+        return rc;
+    }
+    return replica_capture_commit(db);
+}
+
+static void print_stats(const SeedStats *stats) {
+    printf("Added: %d, updated: %d, removed: %d, unchanged: %d",
+           stats->inserted, stats->updated, stats->deleted, stats->unchanged);
+    if (stats->adopted || stats->duplicates) {
+        printf(" (%d existing copies kept, %d duplicates removed)", stats->adopted, stats->duplicates);
+    }
+    printf("\n");
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void remove_bench_files(void) {
+    remove(BENCH_DB);
+    remove(BENCH_DB "-wal");
+    remove(BENCH_DB "-shm");
+}
+
+static int bench_step(sqlite3 *db, const char *name, const LessonData *source, size_t count) {
+    SeedStats stats;
+    double start = now_seconds();
+    int rc = seed(db, source, count, 0, &stats);
+    double seconds = now_seconds() - start;
+
+    printf("%-22s %9.3f s  ", name, seconds);
+    print_stats(&stats);
+    return rc;
+}
+
+// Seed a synthetic corpus, reseed it unchanged, then with 1% edited,
+// 1% removed and 1% new lessons
+static int run_bench(size_t count) {
+    LessonData *corpus = malloc(count * sizeof(LessonData));
+    char *text = malloc(count * 384);
+    if (corpus == NULL || text == NULL) {
+        free(corpus);
+        free(text);
         return 1;
     }
 
-    printf("Seeding database with %zu lessons...\n", sizeof(lessons) / sizeof(lessons[0]));
+    for (size_t i = 0; i < count; i++) {
+        char *topic = text + i * 384;
+        char *content = topic + 64;
+        snprintf(topic, 64, "Synthetic lesson %zu", i);
+        snprintf(content, 320, "Lesson %zu covers topic %zu of the synthetic corpus, with "
+                 "enough text to look like a real lesson body and make hashing it "
+                 "cost what it would in practice.", i, i % 97);
+        corpus[i] = (LessonData){ topic, i % 2 ? "Benchmarks" : "Synthetic",
+                                  DIFFICULTY_BEGINNER + (int)(i % 4), content };
+    }
 
-    int success_count = 0;
-    int fail_count = 0;
+    remove_bench_files();
+    sqlite3 *db;
+    int rc = open_database(BENCH_DB, &db);
+    if (rc == SQLITE_OK) {
+        printf("=== Reseeding %zu lessons ===\n", count);
+        rc = bench_step(db, "initial seed", corpus, count);
+    }
+    if (rc == SQLITE_OK) rc = bench_step(db, "reseed, unchanged", corpus, count);
 
-    for (size_t i = 0; i < sizeof(lessons) / sizeof(lessons[0]); i++) {
-        rc = insert_lesson(db, &lessons[i]);
-        if (rc == SQLITE_OK) {
-            success_count++;
-            printf("✓ Added: %s\n", lessons[i].topic);
-        } else {
-            fail_count++;
-            printf("✗ Failed: %s\n", lessons[i].topic);
+    if (rc == SQLITE_OK) {
+        // Every 100th lesson edited; the last 1% dropped and replaced by new ones
+        size_t changes = count / 100;
+        for (size_t i = 0; i < count; i += 100) {
+            char *content = text + i * 384 + 64;
+            content[0] = 'l';
         }
+        for (size_t i = count - changes; i < count; i++) {
+            snprintf(text + i * 384, 64, "Replacement lesson %zu", i);
+        }
+        rc = bench_step(db, "reseed, 3% changed", corpus, count);
     }
 
+    close_database(db);
+    remove_bench_files();
+    free(corpus);
+    free(text);
+    return rc == SQLITE_OK ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        long count = argc > 2 ? atol(argv[2]) : DEFAULT_BENCH_LESSONS;
+        return run_bench(count > 100 ? (size_t)count : 100);
+    }
+    if (argc > 1) {
+        printf("Usage: %s [--bench [lessons]]\n", argv[0]);
+        printf("  --bench  Time seeding and reseeding a synthetic corpus (default: %d lessons)\n",
+               DEFAULT_BENCH_LESSONS);
+        return strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0 ? 0 : 1;
+    }
+
+    sqlite3 *db;
+    int rc = init_database(&db);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Failed to initialize database.\n");
+        return 1;
+    }
+
+    size_t count = sizeof(lessons) / sizeof(lessons[0]);
+    printf("Seeding database with %zu lessons...\n", count);
+
+    replica_capture_open(db, NULL);
+    SeedStats stats;
+    rc = seed(db, lessons, count, 1, &stats);
+    replica_capture_close(db);
+
     printf("\n=== Seeding Complete ===\n");
-    printf("Successfully added: %d lessons\n", success_count);
-    printf("Failed: %d lessons\n", fail_count);
-    printf("\nDatabase file: %s\n", DB_FILE);
+    if (rc == SQLITE_OK) {
+        print_stats(&stats);
+    } else {
+        printf("Seeding failed; the database was not changed.\n");
+    }
+    printf("\nDatabase file: %s\n", database_path());
 
     close_database(db);
-    return 0;
+    return rc == SQLITE_OK ? 0 : 1;
 }
@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Startup timing for every program that opens the lesson database.
+#
+#   cold: no database file yet, so the program creates the schema (and the
+#         game seeds its lessons)
+#   warm: the file already exists at the current schema version, so opening
+#         it runs no DDL at all
+#
+# Each program runs against a scratch database through LESSONS_DB, so
+# lessons.db is never touched. Usage: ./startup_bench.sh [runs]
+
+RUNS=${1:-5}
+SCRATCH="startup_bench.db"
+SNAPSHOT="startup_bench_snapshot.db"
+
+export LESSONS_DB="$SCRATCH"
+unset LESSONS_CDC_LOG
+
+if [ ! -f "db_manager" ] || [ ! -f "learning_game" ]; then
+    echo "Building programs..."
+    make all > /dev/null || exit 1
+fi
+
+remove_scratch() {
+    rm -f "$SCRATCH" "$SCRATCH-wal" "$SCRATCH-shm" "$SNAPSHOT"
+}
+
+# Page cache can only be dropped as root; otherwise "cold" means cold schema
+drop_caches() {
+    sync
+    echo 3 > /proc/sys/vm/drop_caches 2> /dev/null
+}
+
+now_us() {
+    echo $(( $(date +%s%N) / 1000 ))
+}
+
+# run_program <name> <input> <args...>: prints elapsed microseconds
+run_program() {
+    local input="$1"
+    shift
+    local start=$(now_us)
+    printf "$input" | "$@" > /dev/null 2>&1
+    echo $(( $(now_us) - start ))
+}
+
+# time_program <label> <input> <args...>
+time_program() {
+    local label="$1"
+    local input="$2"
+    shift 2
+    local cold_total=0 warm_total=0
+
+    for ((i = 0; i < RUNS; i++)); do
+        remove_scratch
+        drop_caches
+        cold_total=$(( cold_total + $(run_program "$input" "$@") ))
+        rm -f "$SNAPSHOT"
+        warm_total=$(( warm_total + $(run_program "$input" "$@") ))
+    done
+    remove_scratch
+
+    awk -v label="$label" -v cold="$cold_total" -v warm="$warm_total" -v runs="$RUNS" \
+        'BEGIN { printf "%-34s %10.2f %10.2f\n", label, cold / runs / 1000, warm / runs / 1000 }'
+}
+
+echo "=== Startup Time (average of $RUNS runs, milliseconds) ==="
+if [ "$(id -u)" != "0" ]; then
+    echo "(not root: page cache is not dropped before cold runs)"
+fi
+echo ""
+printf "%-34s %10s %10s\n" "program" "cold" "warm"
+
+time_program "db_manager"                      '0\n' ./db_manager
+time_program "learning_game"                   '0\n' ./learning_game
+time_program "test_db"                         ''    ./test_db
+time_program "db_backup"                       ''    ./db_backup "$SNAPSHOT"
+time_program "seeder"                          ''    ./seeder
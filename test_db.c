@@ -1,5 +1,398 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "db_common.h"
+#include "db_cdc.h"
+#include "db_complete.h"
+#include "db_memory.h"
+#include "db_replica.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Regression checks run against a throwaway database, never lessons.db
+#define SCRATCH_DB "test_scratch.db"
+#define SCRATCH_LOG "test_scratch.cdc.log"
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    printf("  %s %s\n", ok ? "✓" : "✗", what);
+    if (!ok) failures++;
+}
+
+static int file_exists(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file) fclose(file);
+    return file != NULL;
+}
+
+static void remove_scratch(void) {
+    remove(SCRATCH_DB);
+    remove(SCRATCH_DB "-wal");
+    remove(SCRATCH_DB "-shm");
+    remove(SCRATCH_DB "-memjournal");
+    remove(SCRATCH_LOG);
+}
+
+static sqlite3_int64 query_int64(sqlite3 *db, const char *sql) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 value = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// Add a lesson the way db_manager does: the content row takes the id the
+// lessons row was given
+static sqlite3_int64 insert_lesson(sqlite3 *db, const char *topic, const char *content) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 id = -1;
+    if (sqlite3_prepare_v2(db, "INSERT INTO lessons (topic, category, difficulty, timestamp) "
+                               "VALUES (?, 'Test', 1, 0);", -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, topic, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_DONE) id = sqlite3_last_insert_rowid(db);
+    sqlite3_finalize(stmt);
+
+    if (id > 0 && content &&
+        sqlite3_prepare_v2(db, "INSERT INTO lesson_content (lesson_id, content) VALUES (?, ?);",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, id);
+        sqlite3_bind_text(stmt, 2, content, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) id = -1;
+        sqlite3_finalize(stmt);
+    }
+    return id;
+}
+
+// Writes made in memory reach the file on the same rows, and a flush that
+// cannot reproduce them there is refused instead of misplacing them
+static void test_memory_flush(void) {
+    printf("\n--- In-Memory Mode Flush ---\n");
+    remove_scratch();
+
+    sqlite3 *file, *memory;
+    if (open_database(SCRATCH_DB, &file) != SQLITE_OK || memory_open(SCRATCH_DB, &memory) != SQLITE_OK) {
+        check(0, "scratch database opens in memory mode");
+        close_database(file);
+        remove_scratch();
+        return;
+    }
+
+    sqlite3_int64 mine = insert_lesson(memory, "mine", "mine body");
+    check(memory_flush(memory) == SQLITE_OK, "journaled writes flush to the file");
+    char sql[160];
+    snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM lessons_full WHERE id = %lld "
+             "AND topic = 'mine' AND content = 'mine body';", (long long)mine);
+    check(query_int64(file, sql) == 1, "flushed lesson keeps its id and content");
+
+    // Another writer takes the rowid the next in-memory insert will get
+    insert_lesson(file, "other", NULL);
+    insert_lesson(memory, "mine too", "second body");
+    check(memory_flush(memory) != SQLITE_OK, "flush refused after another connection wrote the file");
+    check(query_int64(file, "SELECT COUNT(*) FROM lessons_full WHERE topic = 'other' "
+                            "AND content IS NOT NULL;") == 0,
+          "other writer's lesson did not receive in-memory content");
+    check(query_int64(file, "SELECT COUNT(*) FROM lessons WHERE topic = 'mine too';") == 0,
+          "refused flush left the file unchanged");
+
+    close_database(memory);
+    check(file_exists(SCRATCH_DB "-memjournal"), "unflushed writes stay in the journal");
+
+    // Replaying that journal onto the changed file gives the insert
+    // another rowid than it had, which must stop the replay
+    check(memory_open(SCRATCH_DB, &memory) != SQLITE_OK, "journal that no longer fits the file is not replayed");
+    check(file_exists(SCRATCH_DB "-memjournal"), "rejected journal is kept");
+
+    close_database(file);
+    remove_scratch();
+}
+
+// Complete lines of the change log must be numbered 1, 2, 3, ... in order
+static int log_sequence_ok(int *changes) {
+    FILE *file = fopen(SCRATCH_LOG, "r");
+    if (file == NULL) return 0;
+
+    char *line = NULL;
+    size_t capacity = 0;
+    long long expected = 1;
+    int ok = 1;
+    while (getline(&line, &capacity, file) > 0) {
+        long long seq;
+        size_t length = strlen(line);
+        if (length < 2 || line[length - 2] != '}') continue;  // Torn by a crash
+        if (sscanf(line, "{\"seq\":%lld", &seq) != 1) continue;
+        if (seq != expected) ok = 0;
+        expected = seq + 1;
+    }
+    free(line);
+    fclose(file);
+    *changes = (int)(expected - 1);
+    return ok;
+}
+
+// Sequence numbers carry on across restarts, past long and torn lines
+static void test_cdc_sequence(void) {
+    printf("\n--- Change Log Sequence ---\n");
+    remove_scratch();
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+        check(0, "scratch database opens");
+        remove_scratch();
+        return;
+    }
+
+    // A lesson whose content line is longer than any fixed tail buffer
+    size_t big = 64 * 1024;
+    char *content = malloc(big + 1);
+    if (content == NULL) {
+        close_database(db);
+        remove_scratch();
+        return;
+    }
+    memset(content, 'x', big);
+    content[big] = '\0';
+
+    CdcLog *log = cdc_open(db, SCRATCH_LOG);
+    insert_lesson(db, "first", "short");
+    insert_lesson(db, "long", content);
+    cdc_close(log);
+
+    log = cdc_open(db, SCRATCH_LOG);
+    insert_lesson(db, "after restart", "short");
+    cdc_close(log);
+    int changes;
+    check(log_sequence_ok(&changes) && changes == 6, "seq continues after a line longer than 8 KB");
+
+    // A crash in the middle of a line
+    FILE *file = fopen(SCRATCH_LOG, "a");
+    if (file) {
+        fputs("{\"seq\":7,\"txn\":7,\"op\":\"INS", file);
+        fclose(file);
+    }
+    log = cdc_open(db, SCRATCH_LOG);
+    insert_lesson(db, "after crash", "short");
+    check(log_sequence_ok(&changes) && changes == 8, "seq continues after a torn line");
+
+    // Rolled-back changes never reach the log
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    insert_lesson(db, "rolled back", "short");
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    cdc_close(log);
+    check(log_sequence_ok(&changes) && changes == 8, "rolled-back changes are not logged");
+
+    free(content);
+    close_database(db);
+    remove_scratch();
+}
+
+// Profile callback: after a statement commits, close a descriptor of the
+// log and let a child process try to lock it. *arg becomes 1 when the
+// child was refused.
+static int probe_log_lock(unsigned type, void *arg, void *statement, void *elapsed) {
+    (void)type; (void)elapsed;
+    int *lock_kept = arg;
+    if (*lock_kept >= 0 || !sqlite3_get_autocommit(sqlite3_db_handle(statement))) return 0;
+
+    cdc_read_last_sequence(SCRATCH_LOG);
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        int fd = open(SCRATCH_LOG, O_RDWR);
+        struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0 };
+        _exit(fd >= 0 && fcntl(fd, F_SETLK, &lock) == -1 ? 0 : 1);
+    }
+    int status = 1;
+    if (child > 0) waitpid(child, &status, 0);
+    *lock_kept = child > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return 0;
+}
+
+// One writer of test_cdc_writers: its own connection and change log handle
+static int commit_lessons(int count) {
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) return 0;
+    CdcLog *log = cdc_open(db, SCRATCH_LOG);
+    int ok = log != NULL;
+    for (int i = 0; ok && i < count; i++) ok = insert_lesson(db, "concurrent", "body") > 0;
+    cdc_close(log);
+    close_database(db);
+    return ok;
+}
+
+// Processes committing to one log at once never share a seq
+static void test_cdc_writers(void) {
+    printf("\n--- Change Log Writers ---\n");
+    remove_scratch();
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+        check(0, "scratch database opens");
+        remove_scratch();
+        return;
+    }
+    close_database(db);
+
+    const int writers = 4, lessons = 250;
+    pid_t children[4];
+    fflush(stdout);
+    for (int w = 1; w < writers; w++) {
+        children[w] = fork();
+        if (children[w] == 0) _exit(commit_lessons(lessons) ? 0 : 1);
+    }
+
+    int ok = commit_lessons(lessons);
+    for (int w = 1; w < writers; w++) {
+        int status = 1;
+        if (children[w] > 0) waitpid(children[w], &status, 0);
+        if (children[w] <= 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = 0;
+    }
+    check(ok, "every writer commits");
+
+    // Two changes (lessons and lesson_content) per lesson
+    int changes;
+    check(log_sequence_ok(&changes) && changes == writers * 2 * lessons, "seq rises by one across writers");
+
+    // The log lock is held from the commit until the batch is written; the
+    // profile callback runs in between. Closing another descriptor of the
+    // log there (as reading the last seq does) must not hand the lock over.
+    int lock_kept = -1;
+    if (open_database(SCRATCH_DB, &db) == SQLITE_OK) {
+        CdcLog *log = cdc_open(db, SCRATCH_LOG);
+        sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, probe_log_lock, &lock_kept);
+        insert_lesson(db, "probe", NULL);
+        sqlite3_trace_v2(db, 0, NULL, NULL);
+        cdc_close(log);
+        close_database(db);
+    }
+    check(lock_kept == 1, "closing another descriptor keeps the log locked");
+    remove_scratch();
+}
+
+// Every writer connection records its changesets, however many are open
+static void test_replica_captures(void) {
+    printf("\n--- Replica Capture ---\n");
+    remove_scratch();
+
+    enum { WRITERS = 12 };
+    sqlite3 *writers[WRITERS] = { NULL };
+    int opened = 0, committed = 0;
+    for (int i = 0; i < WRITERS; i++) {
+        if (open_database(SCRATCH_DB, &writers[i]) != SQLITE_OK) break;
+        if (i == 0) replica_enable(writers[0]);
+        if (replica_capture_open(writers[i], NULL) != SQLITE_OK) break;
+        opened++;
+    }
+    for (int i = 0; i < opened; i++) {
+        replica_capture_begin(writers[i]);
+        insert_lesson(writers[i], "captured", "body");
+        if (replica_capture_commit(writers[i]) == SQLITE_OK) committed++;
+    }
+    check(opened == WRITERS && committed == WRITERS, "twelve writers capture at once");
+    if (writers[0]) {
+        check(query_int64(writers[0], "SELECT COUNT(*) FROM replica_changesets;") == WRITERS,
+              "each writer stores its changeset");
+    }
+
+    for (int i = 0; i < WRITERS; i++) {
+        if (writers[i] == NULL) continue;
+        replica_capture_close(writers[i]);
+        close_database(writers[i]);
+    }
+    remove_scratch();
+}
+
+// Completion popularity counts lessons, and rolled-back rows do not count
+static void test_completion(void) {
+    printf("\n--- Topic Completion ---\n");
+    remove_scratch();
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+        check(0, "scratch database opens");
+        remove_scratch();
+        return;
+    }
+    insert_lesson(db, "Pointers", NULL);
+    insert_lesson(db, "Pointers", NULL);
+    insert_lesson(db, "Pipes", NULL);
+
+    CompleteIndex *index = complete_open(db);
+    Completion completions[COMPLETE_MAX_RESULTS];
+    int found = index ? complete_prefix(index, COMPLETE_TOPIC, "p", COMPLETE_MAX_RESULTS, completions) : 0;
+    check(found == 2 && strcmp(completions[0].text, "Pointers") == 0 && completions[0].popularity == 2,
+          "popularity is the number of lessons");
+
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    insert_lesson(db, "Pipelines", NULL);
+    if (index) complete_refresh(index);
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    if (index) complete_refresh(index);
+    found = index ? complete_prefix(index, COMPLETE_TOPIC, "pipel", COMPLETE_MAX_RESULTS, completions) : -1;
+    check(found == 0, "rolled-back lessons are not completed");
+
+    sqlite3_exec(db, "DELETE FROM lessons;", NULL, NULL, NULL);
+    if (index) complete_refresh(index);
+    found = index ? complete_prefix(index, COMPLETE_TOPIC, "p", COMPLETE_MAX_RESULTS, completions) : -1;
+    check(found == 0, "deleting every lesson empties the completions");
+
+    complete_close(index);
+    close_database(db);
+    remove_scratch();
+}
+
+// Run ./seeder on the scratch database; fills counts with its summary line
+// (added, updated, removed, unchanged). Returns 0 unless it ran and printed one.
+static int run_seeder(int counts[4]) {
+    setenv(DB_FILE_ENV, SCRATCH_DB, 1);
+    FILE *output = popen("./seeder", "r");
+    unsetenv(DB_FILE_ENV);
+    if (output == NULL) return 0;
+
+    char line[256];
+    int found = 0;
+    while (fgets(line, sizeof(line), output)) {
+        if (sscanf(line, "Added: %d, updated: %d, removed: %d, unchanged: %d",
+                   &counts[0], &counts[1], &counts[2], &counts[3]) == 4) {
+            found = 1;
+        }
+    }
+    return pclose(output) == 0 && found;
+}
+
+// A second seed of the same lessons finds them all unchanged and writes nothing
+static void test_reseed(void) {
+    printf("\n--- Reseeding ---\n");
+    remove_scratch();
+
+    int first[4], second[4];
+    check(run_seeder(first) && first[0] > 0, "seeder fills an empty database");
+
+    sqlite3 *db;
+    if (open_database(SCRATCH_DB, &db) != SQLITE_OK) {
+        check(0, "scratch database opens");
+        remove_scratch();
+        return;
+    }
+    sqlite3_int64 data_version = query_int64(db, "PRAGMA data_version;");
+    sqlite3_int64 max_id = query_int64(db, "SELECT MAX(id) FROM lessons;");
+
+    int ran = run_seeder(second);
+    check(ran && second[0] == 0 && second[1] == 0 && second[2] == 0 && second[3] == first[0],
+          "reseed reports every lesson unchanged");
+    check(query_int64(db, "PRAGMA data_version;") == data_version, "reseed commits no change");
+    check(query_int64(db, "SELECT MAX(id) FROM lessons;") == max_id, "reseed keeps lesson ids");
+
+    close_database(db);
+    remove_scratch();
+}
 
 int main() {
     sqlite3 *db;
@@ -78,6 +471,18 @@ int main() {
     sqlite3_finalize(stmt);
 
     close_database(db);
+
+    test_memory_flush();
+    test_cdc_sequence();
+    test_cdc_writers();
+    test_replica_captures();
+    test_completion();
+    test_reseed();
+
+    if (failures > 0) {
+        printf("\n✗ %d check(s) failed\n", failures);
+        return 1;
+    }
     printf("\n✓ All database tests passed!\n");
     printf("✓ Database persistence verified (data stored in: lessons.db)\n");
 